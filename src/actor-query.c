@@ -0,0 +1,928 @@
+//
+// actor-query.c
+//
+// find actors across every scene in a project
+//
+// the scene loader keeps global state while it parses, so scenes are read
+// here without it: only the actor lists of each room header are walked,
+// which is cheap enough to do for every scene at once; the actors are then
+// sorted by id, so a query that names the ids it wants only looks at those
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <bigendian.h>
+
+#include "actor-query.h"
+#include "project.h"
+#include "logging.h"
+#include "file.h"
+#include "misc.h"
+
+#define ACTOR_QUERY_MAX_JOBS 64
+#define ACTOR_QUERY_NUM_IDS 0x10000
+
+struct ActorQueryField
+{
+	uint16_t id;
+	uint16_t mask;
+	int name; // in ActorQueryIndex.fieldNames
+	enum ActorQueryTarget target;
+};
+
+struct ActorQueryIndex
+{
+	struct Project *project;
+	struct ActorQueryStats stats;
+	sb_array(struct ActorQueryEntry, entries); // sorted by id
+	uint32_t *byId; // an id's entries are [byId[id], byId[id + 1])
+	sb_array(char *, fieldNames);
+	sb_array(struct ActorQueryField, fields);
+	uint32_t *fieldsById; // same as byId, rebuilt after fields are added
+	char error[256];
+};
+
+struct ActorQueryScanJob
+{
+	struct ActorQueryIndex *index;
+	sb_array(struct ActorQueryEntry, *results); // one list per scene
+	int *numRooms;
+	int *numRoomsFailed;
+	const char **errors;
+	int next; // index of the next scene to claim, shared by all workers
+	pthread_mutex_t lock;
+};
+
+enum ActorQueryVar
+{
+	ACTOR_QUERY_VAR_ID,
+	ACTOR_QUERY_VAR_PARAMS,
+	ACTOR_QUERY_VAR_XROT,
+	ACTOR_QUERY_VAR_YROT,
+	ACTOR_QUERY_VAR_ZROT,
+	ACTOR_QUERY_VAR_X,
+	ACTOR_QUERY_VAR_Y,
+	ACTOR_QUERY_VAR_Z,
+	ACTOR_QUERY_VAR_SCENE,
+	ACTOR_QUERY_VAR_ROOM,
+	ACTOR_QUERY_VAR_HEADER,
+	ACTOR_QUERY_VAR_INDEX,
+	ACTOR_QUERY_VAR_COUNT
+};
+
+enum ActorQueryOp
+{
+	ACTOR_QUERY_OP_CONST,
+	ACTOR_QUERY_OP_VAR,
+	ACTOR_QUERY_OP_FIELD,
+	ACTOR_QUERY_OP_NOT,
+	ACTOR_QUERY_OP_BITNOT,
+	ACTOR_QUERY_OP_NEGATE,
+	ACTOR_QUERY_OP_MUL,
+	ACTOR_QUERY_OP_DIV,
+	ACTOR_QUERY_OP_MOD,
+	ACTOR_QUERY_OP_ADD,
+	ACTOR_QUERY_OP_SUB,
+	ACTOR_QUERY_OP_SHL,
+	ACTOR_QUERY_OP_SHR,
+	ACTOR_QUERY_OP_LT,
+	ACTOR_QUERY_OP_LE,
+	ACTOR_QUERY_OP_GT,
+	ACTOR_QUERY_OP_GE,
+	ACTOR_QUERY_OP_EQ,
+	ACTOR_QUERY_OP_NE,
+	ACTOR_QUERY_OP_BITAND,
+	ACTOR_QUERY_OP_BITXOR,
+	ACTOR_QUERY_OP_BITOR,
+	ACTOR_QUERY_OP_AND,
+	ACTOR_QUERY_OP_OR,
+};
+
+struct ActorQueryNode
+{
+	enum ActorQueryOp op;
+	int a; // operands, in ActorQuery.nodes
+	int b;
+	int64_t value; // constant, enum ActorQueryVar, or field name
+};
+
+struct ActorQuery
+{
+	struct ActorQueryIndex *index;
+	const char *expression;
+	const char *at;
+	bool hasError;
+	sb_array(struct ActorQueryNode, nodes);
+};
+
+static const char *gVarNames[ACTOR_QUERY_VAR_COUNT] = {
+	[ACTOR_QUERY_VAR_ID] = "id",
+	[ACTOR_QUERY_VAR_PARAMS] = "params",
+	[ACTOR_QUERY_VAR_XROT] = "xrot",
+	[ACTOR_QUERY_VAR_YROT] = "yrot",
+	[ACTOR_QUERY_VAR_ZROT] = "zrot",
+	[ACTOR_QUERY_VAR_X] = "x",
+	[ACTOR_QUERY_VAR_Y] = "y",
+	[ACTOR_QUERY_VAR_Z] = "z",
+	[ACTOR_QUERY_VAR_SCENE] = "scene",
+	[ACTOR_QUERY_VAR_ROOM] = "room",
+	[ACTOR_QUERY_VAR_HEADER] = "header",
+	[ACTOR_QUERY_VAR_INDEX] = "index",
+};
+
+// same precedence as c; longer tokens go first so '<' doesn't eat '<<'
+static const struct
+{
+	const char *token;
+	enum ActorQueryOp op;
+	int precedence;
+} gBinaryOps[] = {
+	{ "||", ACTOR_QUERY_OP_OR, 1 },
+	{ "&&", ACTOR_QUERY_OP_AND, 2 },
+	{ "==", ACTOR_QUERY_OP_EQ, 6 },
+	{ "!=", ACTOR_QUERY_OP_NE, 6 },
+	{ "<=", ACTOR_QUERY_OP_LE, 7 },
+	{ ">=", ACTOR_QUERY_OP_GE, 7 },
+	{ "<<", ACTOR_QUERY_OP_SHL, 8 },
+	{ ">>", ACTOR_QUERY_OP_SHR, 8 },
+	{ "|", ACTOR_QUERY_OP_BITOR, 3 },
+	{ "^", ACTOR_QUERY_OP_BITXOR, 4 },
+	{ "&", ACTOR_QUERY_OP_BITAND, 5 },
+	{ "<", ACTOR_QUERY_OP_LT, 7 },
+	{ ">", ACTOR_QUERY_OP_GT, 7 },
+	{ "+", ACTOR_QUERY_OP_ADD, 9 },
+	{ "-", ACTOR_QUERY_OP_SUB, 9 },
+	{ "*", ACTOR_QUERY_OP_MUL, 10 },
+	{ "/", ACTOR_QUERY_OP_DIV, 10 },
+	{ "%", ACTOR_QUERY_OP_MOD, 10 },
+};
+
+#if 1 // region: scanning
+
+static double ActorQueryTime(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+// same as InstanceMakeReadable()
+static struct ActorQueryEntry ActorQueryMakeReadable(struct ActorQueryEntry entry, bool isMm)
+{
+	if (!isMm)
+		return entry;
+	
+	#define HANDLE_AXIS(AXIS, MASK) \
+		entry.AXIS##rot >>= 7; \
+		if (!(entry.id & MASK)) \
+			entry.AXIS##rot = rintf(entry.AXIS##rot * 182.04444444444444444f);
+	HANDLE_AXIS(y, 0x8000)
+	HANDLE_AXIS(x, 0x4000)
+	HANDLE_AXIS(z, 0x2000)
+	entry.id &= 0xfff;
+	#undef HANDLE_AXIS
+	
+	return entry;
+}
+
+// the actors of the room header at 'offset', and where its alternate headers are
+static void ActorQueryScanRoomHeader(
+	const uint8_t *room
+	, uint32_t size
+	, uint32_t offset
+	, struct ActorQueryEntry where
+	, bool isMm
+	, sb_array(struct ActorQueryEntry, *dst)
+	, uint32_t *altHeaders
+	, int *altHeadersCount
+)
+{
+	for (uint32_t at = offset; at + 8 <= size && room[at] != 0x14; at += 8)
+	{
+		const uint8_t *cmd = room + at;
+		uint32_t w1 = u32r(cmd + 4);
+		uint32_t arr = w1 & 0x00ffffff;
+		
+		if (*cmd == 0x18 && altHeaders)
+		{
+			*altHeaders = w1;
+			*altHeadersCount = cmd[1];
+		}
+		
+		if (*cmd != 0x01 || (w1 >> 24) != 0x03 || arr + cmd[1] * 16 > size)
+			continue;
+		
+		for (int i = 0; i < cmd[1]; ++i)
+		{
+			const uint8_t *data8 = room + arr + i * 16;
+			struct ActorQueryEntry entry = where;
+			
+			entry.id = u16r(data8 + 0);
+			entry.pos[0] = s16r(data8 + 2);
+			entry.pos[1] = s16r(data8 + 4);
+			entry.pos[2] = s16r(data8 + 6);
+			entry.xrot = s16r(data8 + 8);
+			entry.yrot = s16r(data8 + 10);
+			entry.zrot = s16r(data8 + 12);
+			entry.params = u16r(data8 + 14);
+			entry.index = i;
+			
+			sb_push(*dst, ActorQueryMakeReadable(entry, isMm));
+		}
+	}
+}
+
+// header 0, then the alternate headers the way TRY_ALTERNATE_HEADERS finds
+// them: all of them if the list says how many there are, otherwise up to the
+// first entry that isn't a room header; a blank entry still takes a number
+static void ActorQueryScanRoom(
+	const uint8_t *room
+	, uint32_t size
+	, struct ActorQueryEntry where
+	, bool isMm
+	, sb_array(struct ActorQueryEntry, *dst)
+)
+{
+	uint32_t altHeaders = 0;
+	int altHeadersCount = 0;
+	uint32_t list;
+	
+	where.header = 0;
+	ActorQueryScanRoomHeader(room, size, 0, where, isMm, dst, &altHeaders, &altHeadersCount);
+	
+	if ((altHeaders >> 24) != 0x03)
+		return;
+	
+	list = altHeaders & 0x00ffffff;
+	for (int i = 0; list + (i + 1) * 4 <= size && i + 1 < MAX_SCENE_ROOM_HEADERS; ++i)
+	{
+		uint32_t w = u32r(room + list + i * 4);
+		uint32_t offset = w & 0x00ffffff;
+		
+		if (altHeadersCount && i >= altHeadersCount)
+			break;
+		
+		if (w == 0)
+			continue;
+		
+		if ((w >> 24) != 0x03 || size < 8 || offset >= size - 8 || (w & 0x7) || room[offset] != 0x16)
+		{
+			if (altHeadersCount)
+				continue;
+			break;
+		}
+		
+		where.header = i + 1;
+		ActorQueryScanRoomHeader(room, size, offset, where, isMm, dst, 0, 0);
+	}
+}
+
+// rooms that can't be read are skipped and counted, so the rest of the
+// scene's rooms still make it into the index
+static const char *ActorQueryScanScene(struct ActorQueryScanJob *job, int index, sb_array(struct ActorQueryEntry, *dst), int *numRooms, int *numRoomsFailed)
+{
+	struct Project *project = job->index->project;
+	const struct ProjectScene *scene = &project->scenes[index];
+	struct File *sceneFile = 0;
+	const uint8_t *sceneData;
+	const uint8_t *sceneEnd;
+	const uint8_t *roomList;
+	struct ActorQueryEntry where = { .scene = index };
+	const char *error = 0;
+	bool isMm = false;
+	
+	if (project->type == PROJECT_TYPE_ROM)
+	{
+		if (scene->endAddress <= scene->startAddress || scene->endAddress > project->file->size)
+			return "scene is outside the rom";
+		sceneData = ((const uint8_t*)project->file->data) + scene->startAddress;
+		sceneEnd = ((const uint8_t*)project->file->data) + scene->endAddress;
+	}
+	else
+	{
+		if (!scene->filename || !(sceneFile = FileTryFromFilename(scene->filename)))
+			return "scene file not found";
+		sceneData = sceneFile->data;
+		sceneEnd = sceneFile->dataEnd;
+	}
+	
+	for (const uint8_t *cmd = sceneData; cmd + 8 <= sceneEnd && *cmd != 0x14; cmd += 8)
+		if (*cmd == 0x1B)
+			isMm = true;
+	
+	// the list is checked to fit inside the scene, so its count can be trusted
+	if (!(roomList = ProjectSceneRoomList(sceneData, sceneEnd, numRooms)))
+		error = "scene has no room list";
+	
+	for (int i = 0; !error && i < *numRooms; ++i)
+	{
+		where.room = i;
+		
+		if (project->type == PROJECT_TYPE_ROM)
+		{
+			uint32_t start = u32r(roomList + i * 8);
+			uint32_t end = u32r(roomList + i * 8 + 4);
+			
+			if (end <= start || end > project->file->size)
+			{
+				LogWarn("scene %d room %d: %08x-%08x is outside the rom", index, i, start, end);
+				*numRoomsFailed += 1;
+			}
+			else
+				ActorQueryScanRoom(((const uint8_t*)project->file->data) + start, end - start, where, isMm, dst);
+		}
+		else
+		{
+			char *roomFilename = ScenePredictRoomFilename(scene->filename, i);
+			struct File *roomFile = roomFilename ? FileTryFromFilename(roomFilename) : 0;
+			
+			if (!roomFile)
+			{
+				LogWarn("scene %d room %d: %s", index, i, roomFilename ? FileGetError() : "room file not found");
+				*numRoomsFailed += 1;
+			}
+			else
+			{
+				ActorQueryScanRoom(roomFile->data, roomFile->size, where, isMm, dst);
+				FileFree(roomFile);
+			}
+			free(roomFilename);
+		}
+	}
+	
+	if (sceneFile)
+		FileFree(sceneFile);
+	
+	return error;
+}
+
+static void *ActorQueryScanWorker(void *udata)
+{
+	struct ActorQueryScanJob *job = udata;
+	int numScenes = sb_count(job->index->project->scenes);
+	
+	for (;;)
+	{
+		int index;
+		
+		pthread_mutex_lock(&job->lock);
+		index = job->next++;
+		pthread_mutex_unlock(&job->lock);
+		
+		if (index >= numScenes)
+			break;
+		
+		// each scene writes only its own slot
+		job->errors[index] = ActorQueryScanScene(job, index, &job->results[index], &job->numRooms[index], &job->numRoomsFailed[index]);
+	}
+	
+	return 0;
+}
+
+#endif // endregion
+
+#if 1 // region: expressions
+
+static void ActorQueryError(struct ActorQuery *q, const char *fmt, ...)
+{
+	char *dst = q->index->error;
+	int len;
+	
+	if (q->hasError)
+		return;
+	
+	va_list args;
+	va_start(args, fmt);
+	
+	len = vsnprintf(dst, sizeof(q->index->error), fmt, args);
+	
+	va_end(args);
+	
+	if (len >= 0 && len < sizeof(q->index->error))
+		snprintf(dst + len, sizeof(q->index->error) - len, " at column %d", (int)(q->at - q->expression) + 1);
+	
+	q->hasError = true;
+}
+
+static int ActorQueryPush(struct ActorQuery *q, struct ActorQueryNode node)
+{
+	sb_push(q->nodes, node);
+	
+	return sb_count(q->nodes) - 1;
+}
+
+static void ActorQuerySkipSpace(struct ActorQuery *q)
+{
+	while (isspace(*q->at))
+		q->at += 1;
+}
+
+static int ActorQueryParseBinary(struct ActorQuery *q, int minPrecedence);
+
+static int ActorQueryParseUnary(struct ActorQuery *q)
+{
+	ActorQuerySkipSpace(q);
+	
+	if (q->hasError)
+		return -1;
+	
+	if (*q->at == '!' || *q->at == '~' || *q->at == '-')
+	{
+		enum ActorQueryOp op = (*q->at == '!') ? ACTOR_QUERY_OP_NOT
+			: (*q->at == '~') ? ACTOR_QUERY_OP_BITNOT
+			: ACTOR_QUERY_OP_NEGATE
+		;
+		
+		q->at += 1;
+		int a = ActorQueryParseUnary(q);
+		
+		return ActorQueryPush(q, (struct ActorQueryNode){ .op = op, .a = a });
+	}
+	
+	if (*q->at == '(')
+	{
+		q->at += 1;
+		int a = ActorQueryParseBinary(q, 1);
+		
+		ActorQuerySkipSpace(q);
+		if (*q->at != ')')
+			ActorQueryError(q, "expected ')'");
+		else
+			q->at += 1;
+		
+		return a;
+	}
+	
+	if (isdigit(*q->at))
+	{
+		char *end;
+		int64_t value = strtoll(q->at, &end, 0);
+		
+		if (isalnum(*end) || *end == '_')
+			ActorQueryError(q, "bad number");
+		q->at = end;
+		
+		return ActorQueryPush(q, (struct ActorQueryNode){ .op = ACTOR_QUERY_OP_CONST, .value = value });
+	}
+	
+	if (isalpha(*q->at) || *q->at == '_')
+	{
+		const char *name = q->at;
+		int len = 0;
+		
+		while (isalnum(name[len]) || name[len] == '_')
+			++len;
+		
+		for (int i = 0; i < ACTOR_QUERY_VAR_COUNT; ++i)
+		{
+			if (strlen(gVarNames[i]) == len && !strncasecmp(name, gVarNames[i], len))
+			{
+				q->at += len;
+				return ActorQueryPush(q, (struct ActorQueryNode){ .op = ACTOR_QUERY_OP_VAR, .value = i });
+			}
+		}
+		
+		sb_foreach(q->index->fieldNames, {
+			if (strlen(*each) == len && !strncasecmp(name, *each, len))
+			{
+				q->at += len;
+				return ActorQueryPush(q, (struct ActorQueryNode){ .op = ACTOR_QUERY_OP_FIELD, .value = eachIndex });
+			}
+		});
+		
+		ActorQueryError(q, "unknown name '%.*s'", len, name);
+		return -1;
+	}
+	
+	if (*q->at)
+		ActorQueryError(q, "unexpected '%c'", *q->at);
+	else
+		ActorQueryError(q, "expression ends early");
+	
+	return -1;
+}
+
+static int ActorQueryParseBinary(struct ActorQuery *q, int minPrecedence)
+{
+	int a = ActorQueryParseUnary(q);
+	
+	for (;;)
+	{
+		int which = -1;
+		
+		ActorQuerySkipSpace(q);
+		
+		if (q->hasError)
+			return -1;
+		
+		for (int i = 0; i < sizeof(gBinaryOps) / sizeof(*gBinaryOps); ++i)
+		{
+			if (!strncmp(q->at, gBinaryOps[i].token, strlen(gBinaryOps[i].token)))
+			{
+				which = i;
+				break;
+			}
+		}
+		
+		if (which < 0 || gBinaryOps[which].precedence < minPrecedence)
+			break;
+		
+		q->at += strlen(gBinaryOps[which].token);
+		int b = ActorQueryParseBinary(q, gBinaryOps[which].precedence + 1);
+		
+		a = ActorQueryPush(q, (struct ActorQueryNode){ .op = gBinaryOps[which].op, .a = a, .b = b });
+	}
+	
+	return a;
+}
+
+static int64_t ActorQueryGetVar(const struct ActorQueryEntry *entry, enum ActorQueryVar var)
+{
+	switch (var)
+	{
+		case ACTOR_QUERY_VAR_ID: return entry->id;
+		case ACTOR_QUERY_VAR_PARAMS: return entry->params;
+		case ACTOR_QUERY_VAR_XROT: return entry->xrot;
+		case ACTOR_QUERY_VAR_YROT: return entry->yrot;
+		case ACTOR_QUERY_VAR_ZROT: return entry->zrot;
+		case ACTOR_QUERY_VAR_X: return entry->pos[0];
+		case ACTOR_QUERY_VAR_Y: return entry->pos[1];
+		case ACTOR_QUERY_VAR_Z: return entry->pos[2];
+		case ACTOR_QUERY_VAR_SCENE: return entry->scene;
+		case ACTOR_QUERY_VAR_ROOM: return entry->room;
+		case ACTOR_QUERY_VAR_HEADER: return entry->header;
+		case ACTOR_QUERY_VAR_INDEX: return entry->index;
+		case ACTOR_QUERY_VAR_COUNT: break;
+	}
+	
+	return 0;
+}
+
+// same as the actor database's Property::Extract()
+static int64_t ActorQueryGetField(const struct ActorQueryIndex *index, const struct ActorQueryEntry *entry, int name)
+{
+	for (uint32_t i = index->fieldsById[entry->id]; i < index->fieldsById[entry->id + 1]; ++i)
+	{
+		const struct ActorQueryField *field = &index->fields[i];
+		uint16_t mask = field->mask;
+		uint16_t result;
+		
+		if (field->name != name)
+			continue;
+		
+		switch (field->target)
+		{
+			case ACTOR_QUERY_TARGET_PARAMS: result = entry->params; break;
+			case ACTOR_QUERY_TARGET_XROT: result = entry->xrot; break;
+			case ACTOR_QUERY_TARGET_YROT: result = entry->yrot; break;
+			case ACTOR_QUERY_TARGET_ZROT: result = entry->zrot; break;
+			default: return -1;
+		}
+		
+		result &= mask;
+		while (!(mask & 1))
+			mask >>= 1, result >>= 1;
+		
+		return result;
+	}
+	
+	return -1;
+}
+
+static int64_t ActorQueryEval(const struct ActorQuery *q, int node, const struct ActorQueryEntry *entry)
+{
+	const struct ActorQueryNode *n = &q->nodes[node];
+	int64_t a;
+	int64_t b;
+	
+	switch (n->op)
+	{
+		case ACTOR_QUERY_OP_CONST: return n->value;
+		case ACTOR_QUERY_OP_VAR: return ActorQueryGetVar(entry, n->value);
+		case ACTOR_QUERY_OP_FIELD: return ActorQueryGetField(q->index, entry, n->value);
+		case ACTOR_QUERY_OP_NOT: return !ActorQueryEval(q, n->a, entry);
+		case ACTOR_QUERY_OP_BITNOT: return ~ActorQueryEval(q, n->a, entry);
+		case ACTOR_QUERY_OP_NEGATE: return -ActorQueryEval(q, n->a, entry);
+		case ACTOR_QUERY_OP_AND: return ActorQueryEval(q, n->a, entry) && ActorQueryEval(q, n->b, entry);
+		case ACTOR_QUERY_OP_OR: return ActorQueryEval(q, n->a, entry) || ActorQueryEval(q, n->b, entry);
+		default: break;
+	}
+	
+	a = ActorQueryEval(q, n->a, entry);
+	b = ActorQueryEval(q, n->b, entry);
+	
+	switch (n->op)
+	{
+		case ACTOR_QUERY_OP_MUL: return a * b;
+		case ACTOR_QUERY_OP_DIV: return b ? a / b : 0;
+		case ACTOR_QUERY_OP_MOD: return b ? a % b : 0;
+		case ACTOR_QUERY_OP_ADD: return a + b;
+		case ACTOR_QUERY_OP_SUB: return a - b;
+		case ACTOR_QUERY_OP_SHL: return (b < 0 || b > 62) ? 0 : (int64_t)((uint64_t)a << b);
+		case ACTOR_QUERY_OP_SHR: return (b < 0 || b > 62) ? (a < 0 ? -1 : 0) : a >> b;
+		case ACTOR_QUERY_OP_LT: return a < b;
+		case ACTOR_QUERY_OP_LE: return a <= b;
+		case ACTOR_QUERY_OP_GT: return a > b;
+		case ACTOR_QUERY_OP_GE: return a >= b;
+		case ACTOR_QUERY_OP_EQ: return a == b;
+		case ACTOR_QUERY_OP_NE: return a != b;
+		case ACTOR_QUERY_OP_BITAND: return a & b;
+		case ACTOR_QUERY_OP_BITXOR: return a ^ b;
+		case ACTOR_QUERY_OP_BITOR: return a | b;
+		default: break;
+	}
+	
+	return 0;
+}
+
+// the ids an expression can match, ascending, or false if it doesn't
+// narrow them down and every actor has to be tried
+static bool ActorQueryIds(const struct ActorQuery *q, int node, sb_array(uint16_t, *ids))
+{
+	const struct ActorQueryNode *n = &q->nodes[node];
+	
+	if (n->op == ACTOR_QUERY_OP_EQ)
+	{
+		const struct ActorQueryNode *var = &q->nodes[n->a];
+		const struct ActorQueryNode *value = &q->nodes[n->b];
+		
+		if (value->op == ACTOR_QUERY_OP_VAR)
+			var = value, value = &q->nodes[n->a];
+		
+		if (var->op != ACTOR_QUERY_OP_VAR
+			|| var->value != ACTOR_QUERY_VAR_ID
+			|| value->op != ACTOR_QUERY_OP_CONST
+		)
+			return false;
+		
+		if (value->value >= 0 && value->value < ACTOR_QUERY_NUM_IDS)
+			sb_push(*ids, value->value);
+		
+		return true;
+	}
+	
+	if (n->op == ACTOR_QUERY_OP_AND || n->op == ACTOR_QUERY_OP_OR)
+	{
+		sb_array(uint16_t, a) = 0;
+		sb_array(uint16_t, b) = 0;
+		bool hasA = ActorQueryIds(q, n->a, &a);
+		bool hasB = ActorQueryIds(q, n->b, &b);
+		bool result = true;
+		int i = 0;
+		int k = 0;
+		
+		if (hasA && hasB)
+		{
+			// both lists are sorted, so walk them together
+			while (i < sb_count(a) || k < sb_count(b))
+			{
+				bool takeA = i < sb_count(a) && (k >= sb_count(b) || a[i] <= b[k]);
+				bool takeB = k < sb_count(b) && (i >= sb_count(a) || b[k] <= a[i]);
+				uint16_t id = takeA ? a[i] : b[k];
+				
+				if (n->op == ACTOR_QUERY_OP_OR || (takeA && takeB))
+					sb_push(*ids, id);
+				
+				i += takeA;
+				k += takeB;
+			}
+		}
+		else if (n->op == ACTOR_QUERY_OP_AND && (hasA || hasB))
+		{
+			sb_foreach(hasA ? a : b, { sb_push(*ids, *each); });
+		}
+		else
+			result = false;
+		
+		sb_free(a);
+		sb_free(b);
+		
+		return result;
+	}
+	
+	return false;
+}
+
+static int ActorQueryFieldCompare(const void *a, const void *b)
+{
+	const struct ActorQueryField *fa = a;
+	const struct ActorQueryField *fb = b;
+	
+	return (int)fa->id - (int)fb->id;
+}
+
+static void ActorQueryIndexFields(struct ActorQueryIndex *index)
+{
+	if (index->fieldsById)
+		return;
+	
+	index->fieldsById = Calloc(ACTOR_QUERY_NUM_IDS + 1, sizeof(*index->fieldsById));
+	
+	if (sb_count(index->fields))
+		qsort(index->fields, sb_count(index->fields), sizeof(*index->fields), ActorQueryFieldCompare);
+	
+	sb_foreach(index->fields, { index->fieldsById[each->id + 1] += 1; });
+	for (int i = 0; i < ACTOR_QUERY_NUM_IDS; ++i)
+		index->fieldsById[i + 1] += index->fieldsById[i];
+}
+
+// counting sort by id, which keeps each id's actors in list order
+static void ActorQueryIndexEntries(struct ActorQueryIndex *index, sb_array(struct ActorQueryEntry, *lists), int numLists)
+{
+	uint32_t *next;
+	
+	index->byId = Calloc(ACTOR_QUERY_NUM_IDS + 1, sizeof(*index->byId));
+	
+	for (int i = 0; i < numLists; ++i)
+		sb_foreach(lists[i], { index->byId[each->id + 1] += 1; });
+	for (int i = 0; i < ACTOR_QUERY_NUM_IDS; ++i)
+		index->byId[i + 1] += index->byId[i];
+	
+	index->stats.numActors = index->byId[ACTOR_QUERY_NUM_IDS];
+	
+	if (index->stats.numActors)
+		(void)sb_add(index->entries, index->stats.numActors);
+	
+	next = Calloc(ACTOR_QUERY_NUM_IDS, sizeof(*next));
+	memcpy(next, index->byId, ACTOR_QUERY_NUM_IDS * sizeof(*next));
+	for (int i = 0; i < numLists; ++i)
+		sb_foreach(lists[i], { index->entries[next[each->id]++] = *each; });
+	
+	free(next);
+}
+
+#endif // endregion
+
+struct ActorQueryIndex *ActorQueryIndexFromEntries(const struct ActorQueryEntry *entries, int count)
+{
+	struct ActorQueryIndex *index = Calloc(1, sizeof(*index));
+	sb_array(struct ActorQueryEntry, list) = 0;
+	
+	if (count)
+		memcpy(sb_add(list, count), entries, count * sizeof(*entries));
+	
+	ActorQueryIndexEntries(index, &list, 1);
+	sb_free(list);
+	
+	return index;
+}
+
+struct ActorQueryIndex *ActorQueryIndexNew(struct Project *project, int jobs)
+{
+	struct ActorQueryIndex *index = Calloc(1, sizeof(*index));
+	struct ActorQueryScanJob job = { .index = index };
+	pthread_t threads[ACTOR_QUERY_MAX_JOBS];
+	int numScenes = sb_count(project->scenes);
+	double start = ActorQueryTime();
+	
+	index->project = project;
+	
+	if (numScenes)
+	{
+		job.results = Calloc(numScenes, sizeof(*job.results));
+		job.numRooms = Calloc(numScenes, sizeof(*job.numRooms));
+		job.numRoomsFailed = Calloc(numScenes, sizeof(*job.numRoomsFailed));
+		job.errors = Calloc(numScenes, sizeof(*job.errors));
+		jobs = MAX(1, MIN(jobs, MIN(ACTOR_QUERY_MAX_JOBS, numScenes)));
+		pthread_mutex_init(&job.lock, 0);
+		
+		LogDebug("indexing actors of %d scenes using %d jobs", numScenes, jobs);
+		for (int i = 0; i < jobs; ++i)
+			if (pthread_create(&threads[i], 0, ActorQueryScanWorker, &job))
+				Die("failed to create worker thread");
+		for (int i = 0; i < jobs; ++i)
+			pthread_join(threads[i], 0);
+		
+		pthread_mutex_destroy(&job.lock);
+	}
+	
+	for (int i = 0; i < numScenes; ++i)
+	{
+		if (job.errors[i])
+		{
+			LogWarn("scene %d: %s", i, job.errors[i]);
+			index->stats.numFailed += 1;
+		}
+		
+		index->stats.numRooms += job.numRooms[i];
+		index->stats.numRoomsFailed += job.numRoomsFailed[i];
+	}
+	
+	index->stats.numScenes = numScenes;
+	ActorQueryIndexEntries(index, job.results, numScenes);
+	
+	for (int i = 0; i < numScenes; ++i)
+		sb_free(job.results[i]);
+	free(job.results);
+	free(job.numRooms);
+	free(job.numRoomsFailed);
+	free(job.errors);
+	
+	index->stats.seconds = ActorQueryTime() - start;
+	
+	return index;
+}
+
+void ActorQueryIndexFree(struct ActorQueryIndex *index)
+{
+	if (!index)
+		return;
+	
+	sb_foreach(index->fieldNames, { free(*each); });
+	sb_free(index->fieldNames);
+	sb_free(index->fields);
+	sb_free(index->entries);
+	free(index->fieldsById);
+	free(index->byId);
+	free(index);
+}
+
+const struct ActorQueryStats *ActorQueryIndexGetStats(struct ActorQueryIndex *index)
+{
+	return &index->stats;
+}
+
+void ActorQueryIndexAddField(struct ActorQueryIndex *index, uint16_t id, const char *name, enum ActorQueryTarget target, uint16_t mask)
+{
+	int nameIndex = -1;
+	
+	if (!mask || !name || !*name)
+		return;
+	
+	sb_foreach(index->fieldNames, {
+		if (!strcasecmp(*each, name))
+		{
+			nameIndex = eachIndex;
+			break;
+		}
+	});
+	
+	if (nameIndex < 0)
+	{
+		nameIndex = sb_count(index->fieldNames);
+		sb_push(index->fieldNames, Strdup(name));
+	}
+	
+	sb_push(index->fields, ((struct ActorQueryField){
+		.id = id,
+		.mask = mask,
+		.name = nameIndex,
+		.target = target
+	}));
+	
+	free(index->fieldsById);
+	index->fieldsById = 0;
+}
+
+const char *ActorQueryRun(struct ActorQueryIndex *index, const char *expression, sb_array(struct ActorQueryEntry, *matches))
+{
+	struct ActorQuery q = {
+		.index = index,
+		.expression = expression,
+		.at = expression,
+	};
+	sb_array(uint16_t, ids) = 0;
+	int root;
+	
+	ActorQueryIndexFields(index);
+	
+	root = ActorQueryParseBinary(&q, 1);
+	ActorQuerySkipSpace(&q);
+	if (*q.at)
+		ActorQueryError(&q, "unexpected '%c'", *q.at);
+	
+	if (q.hasError)
+	{
+		sb_free(q.nodes);
+		return index->error;
+	}
+	
+	if (ActorQueryIds(&q, root, &ids))
+	{
+		sb_foreach(ids, {
+			for (uint32_t i = index->byId[*each]; i < index->byId[*each + 1]; ++i)
+				if (ActorQueryEval(&q, root, &index->entries[i]))
+					sb_push(*matches, index->entries[i]);
+		});
+	}
+	else
+	{
+		sb_foreach(index->entries, {
+			if (ActorQueryEval(&q, root, each))
+				sb_push(*matches, *each);
+		});
+	}
+	
+	sb_free(ids);
+	sb_free(q.nodes);
+	
+	return 0;
+}
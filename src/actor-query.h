@@ -0,0 +1,74 @@
+//
+// actor-query.h
+//
+// find actors across every scene in a project
+//
+
+#ifndef ACTOR_QUERY_H_INCLUDED
+#define ACTOR_QUERY_H_INCLUDED
+
+#include <stdint.h>
+
+#include "stretchy_buffer.h"
+
+struct Project;
+struct ActorQueryIndex;
+
+// where a named property's bits live, same as the database's "target"
+enum ActorQueryTarget
+{
+	ACTOR_QUERY_TARGET_PARAMS,
+	ACTOR_QUERY_TARGET_XROT,
+	ACTOR_QUERY_TARGET_YROT,
+	ACTOR_QUERY_TARGET_ZROT,
+};
+
+// one actor placed in a room header; rotations
+// are made readable the same way the editor does
+struct ActorQueryEntry
+{
+	uint16_t id;
+	uint16_t params;
+	uint16_t xrot;
+	uint16_t yrot;
+	uint16_t zrot;
+	int16_t pos[3];
+	uint16_t scene; // in Project.scenes
+	uint8_t room;
+	uint8_t header;
+	uint16_t index; // in the room header's actor list
+};
+
+struct ActorQueryStats
+{
+	int numScenes;
+	int numRooms;
+	int numActors;
+	int numFailed; // scenes that couldn't be read
+	int numRoomsFailed; // rooms that couldn't be read, in scenes that could
+	double seconds; // spent building the index
+};
+
+// reads the actor lists of every scene in the project using up to
+// 'jobs' threads, then indexes them by actor id; the project must
+// outlive the index
+struct ActorQueryIndex *ActorQueryIndexNew(struct Project *project, int jobs);
+// the same, over actors that were gathered some other way (such as by a test)
+struct ActorQueryIndex *ActorQueryIndexFromEntries(const struct ActorQueryEntry *entries, int count);
+void ActorQueryIndexFree(struct ActorQueryIndex *index);
+const struct ActorQueryStats *ActorQueryIndexGetStats(struct ActorQueryIndex *index);
+
+// lets queries refer to some bits of an actor's params or rotation by name
+void ActorQueryIndexAddField(struct ActorQueryIndex *index, uint16_t id, const char *name, enum ActorQueryTarget target, uint16_t mask);
+
+// appends the actors matching a c-like expression, such as
+//  id == 0x000A && (params >> 5 & 0x7F) == 0x2F
+// which can use id, params, xrot, yrot, zrot, x, y, z, scene, room, header,
+// index, and any field names; an actor without the named field reads it as
+// -1; matches are grouped by actor id; returns an error message, or 0
+const char *ActorQueryRun(struct ActorQueryIndex *index, const char *expression, sb_array(struct ActorQueryEntry, *matches));
+
+// toml-interop.cpp
+void TomlActorQueryAddFields(struct ActorQueryIndex *index, struct Project *project);
+
+#endif // ACTOR_QUERY_H_INCLUDED
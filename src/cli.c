@@ -0,0 +1,774 @@
+//
+// cli.c
+//
+// headless batch commands, for running conversions and analysis over many
+// inputs without ever opening a window:
+//
+//   z64scene Batch <command> [--jobs n] [--out folder] [--verbose] inputs...
+//
+// each input (or each pair of them, for Migrate) is one unit of work that
+// prints one json object, and the results are gathered into one document
+// on stdout in the order the inputs were given
+//
+// when there is more than one unit, each runs in a child process of its
+// own, --jobs of them at a time: a unit that gives up using Die() then
+// only takes itself down instead of the whole batch, and process-wide
+// state (the editor's actor databases) can't leak from one into the next;
+// a lone unit runs in this process
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#define popen _popen
+#define pclose _pclose
+#else
+#include <sys/wait.h>
+#endif
+
+#include "cli.h"
+#include "actor-query.h"
+#include "logging.h"
+#include "project.h"
+#include "fast64.h"
+#include "misc.h"
+
+#define CLI_MAX_JOBS 64
+
+struct CliOptions;
+
+struct CliCommand
+{
+	const char *name;
+	const char *usage;
+	int inputsPerUnit;
+	bool needsOutFolder;
+	bool isSerial; // units share fixed temporary files, so they take turns
+	
+	// appends the unit's own fields to json, returns an error or 0
+	const char *(*run)(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json));
+};
+
+struct CliOptions
+{
+	const char *exe;
+	const struct CliCommand *command;
+	const char *outFolder;
+	sb_array(char *, inputs);
+	sb_array(uint16_t, ids); // Actors --id, any of these
+	sb_array(char *, wheres); // Query --where, each its own query
+	int jobs;
+	int unit; // for --child
+	bool isChild; // runs exactly one unit, and prints only its result
+	bool isVerbose;
+};
+
+// what a round trip must keep the same
+struct CliSceneCounts
+{
+	int rooms;
+	int headers;
+	int actors;
+	int spawns;
+	int doorways;
+	uint32_t bytes;
+};
+
+#if 1 // region: private functions
+
+static void CliMkdir(const char *path)
+{
+	mkdir(
+		path
+		#ifndef _WIN32
+		, 0777
+		#endif
+	);
+}
+
+static void CliAppend(sb_array(char, *json), const char *fmt, ...)
+{
+	va_list args;
+	int len;
+	
+	va_start(args, fmt);
+	len = vsnprintf(0, 0, fmt, args);
+	va_end(args);
+	
+	va_start(args, fmt);
+	vsnprintf(sb_add(*json, len + 1), len + 1, fmt, args);
+	va_end(args);
+	
+	(void)sb_pop(*json); // the terminator, re-added with the next append
+}
+
+static void CliAppendString(sb_array(char, *json), const char *str)
+{
+	sb_push(*json, '"');
+	
+	for (const uint8_t *c = (const uint8_t*)str; c && *c; ++c)
+	{
+		switch (*c)
+		{
+			case '"': CliAppend(json, "\\\""); break;
+			case '\\': CliAppend(json, "\\\\"); break;
+			case '\n': CliAppend(json, "\\n"); break;
+			case '\r': CliAppend(json, "\\r"); break;
+			case '\t': CliAppend(json, "\\t"); break;
+			default:
+				if (*c < 0x20)
+					CliAppend(json, "\\u%04x", *c);
+				else
+					sb_push(*json, *c);
+				break;
+		}
+	}
+	
+	sb_push(*json, '"');
+}
+
+// json has no nan or inf, so those go in as strings
+static void CliAppendNumber(sb_array(char, *json), const char *fmt, double value)
+{
+	if (isfinite(value))
+		CliAppend(json, fmt, value);
+	else
+		CliAppendString(json, isnan(value) ? "nan" : value < 0 ? "-inf" : "inf");
+}
+
+// one argument of a command line that goes through the shell
+static void CliAppendArg(sb_array(char, *cmd), const char *arg)
+{
+#ifdef _WIN32
+	sb_push(*cmd, ' ');
+	sb_push(*cmd, '"');
+	for (const char *c = arg; *c; ++c)
+	{
+		if (*c == '"')
+			sb_push(*cmd, '\\');
+		sb_push(*cmd, *c);
+	}
+	sb_push(*cmd, '"');
+#else
+	sb_push(*cmd, ' ');
+	sb_push(*cmd, '\'');
+	for (const char *c = arg; *c; ++c)
+	{
+		if (*c == '\'')
+			CliAppend(cmd, "'\\''");
+		else
+			sb_push(*cmd, *c);
+	}
+	sb_push(*cmd, '\'');
+#endif
+}
+
+// out/unit/name_scene.zscene, so that rooms saved alongside it are found
+// again when it's loaded back in, and units with like names can't collide
+static char *CliOutPath(struct CliOptions *opt, int unit, const char *input)
+{
+	const char *name = MAX(strrchr(input, '/'), strrchr(input, '\\'));
+	char *result = Calloc(1, strlen(opt->outFolder) + strlen(input) + 64);
+	char *stem;
+	char *end;
+	
+	name = name ? name + 1 : input;
+	CliMkdir(opt->outFolder);
+	sprintf(result, "%s/%d", opt->outFolder, unit);
+	CliMkdir(result);
+	
+	stem = result + strlen(result) + 1;
+	sprintf(stem - 1, "/%s", name);
+	if ((end = strstr(stem, "_scene")) || (end = strrchr(stem, '.')))
+		*end = '\0';
+	strcat(stem, "_scene.zscene");
+	
+	return result;
+}
+
+static void CliCountScene(struct Scene *scene, struct CliSceneCounts *dst)
+{
+	*dst = (struct CliSceneCounts){
+		.rooms = sb_count(scene->rooms),
+		.headers = sb_count(scene->headers),
+		.bytes = scene->file->size,
+	};
+	
+	sb_foreach(scene->headers, {
+		dst->spawns += sb_count(each->spawns);
+		dst->doorways += sb_count(each->doorways);
+	})
+	
+	sb_foreach_named(scene->rooms, room, {
+		dst->bytes += room->file->size;
+		sb_foreach(room->headers, { dst->actors += sb_count(each->instances); })
+	})
+}
+
+static void CliAppendCounts(sb_array(char, *json), const struct CliSceneCounts *counts)
+{
+	CliAppend(json, ", \"rooms\": %d, \"headers\": %d, \"actors\": %d, \"spawns\": %d, \"doorways\": %d, \"bytes\": %u"
+		, counts->rooms
+		, counts->headers
+		, counts->actors
+		, counts->spawns
+		, counts->doorways
+		, counts->bytes
+	);
+}
+
+// saves the scene and reports where it went
+static const char *CliSaveScene(struct Scene *scene, const char *out, sb_array(char, *json))
+{
+	if (SceneToFilename(scene, out))
+		return QuickFmt("failed to save scene: %s", FileGetError());
+	
+	CliAppend(json, ", \"output\": ");
+	CliAppendString(json, out);
+	
+	return 0;
+}
+
+// { "inputs": [...], "ok": true, ... }, on one line
+static char *CliResult(struct CliOptions *opt, char **inputs, const char *error, sb_array(char, fields))
+{
+	sb_array(char, json) = 0;
+	char *result;
+	
+	CliAppend(&json, "{ \"inputs\": [");
+	for (int i = 0; i < opt->command->inputsPerUnit; ++i)
+	{
+		CliAppend(&json, "%s", i ? ", " : "");
+		CliAppendString(&json, inputs[i]);
+	}
+	CliAppend(&json, "], \"ok\": %s", error ? "false" : "true");
+	if (error)
+	{
+		CliAppend(&json, ", \"error\": ");
+		CliAppendString(&json, error);
+	}
+	else if (fields)
+		memcpy(sb_add(json, sb_count(fields)), fields, sb_count(fields));
+	CliAppend(&json, " }");
+	sb_push(json, '\0');
+	
+	result = Strdup(json);
+	sb_free(json);
+	
+	return result;
+}
+
+#endif // endregion
+
+#if 1 // region: commands
+
+// loads, saves, then loads the saved scene again to check nothing went missing
+static const char *CliRoundTrip(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	struct Scene *scene = SceneFromFilenamePredictRooms(inputs[0]);
+	struct CliSceneCounts before;
+	struct CliSceneCounts after;
+	char *out = CliOutPath(opt, unit, inputs[0]);
+	const char *error;
+	
+	CliCountScene(scene, &before);
+	error = CliSaveScene(scene, out, json);
+	SceneFree(scene);
+	
+	if (!error)
+	{
+		scene = SceneFromFilenamePredictRooms(out);
+		CliCountScene(scene, &after);
+		SceneFree(scene);
+		
+		CliAppendCounts(json, &after);
+		CliAppend(json, ", \"bytesIn\": %u", before.bytes);
+		
+		if (before.rooms != after.rooms
+			|| before.headers != after.headers
+			|| before.actors != after.actors
+			|| before.spawns != after.spawns
+			|| before.doorways != after.doorways
+		)
+			error = QuickFmt("saved scene reads back differently:"
+				" rooms %d -> %d, headers %d -> %d, actors %d -> %d, spawns %d -> %d, doorways %d -> %d"
+				, before.rooms, after.rooms
+				, before.headers, after.headers
+				, before.actors, after.actors
+				, before.spawns, after.spawns
+				, before.doorways, after.doorways
+			);
+	}
+	
+	free(out);
+	
+	return error;
+}
+
+// the first scene takes the visual and collision data of the second
+static const char *CliMigrate(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	struct Scene *dst = SceneFromFilenamePredictRooms(inputs[0]);
+	struct Scene *src = SceneFromFilenamePredictRooms(inputs[1]);
+	char *out = CliOutPath(opt, unit, inputs[0]);
+	struct CliSceneCounts counts;
+	const char *error;
+	
+	if (!(error = SceneMigrateVisualAndCollisionData(dst, src))
+		&& !(error = CliSaveScene(dst, out, json))
+	)
+	{
+		CliCountScene(dst, &counts);
+		CliAppendCounts(json, &counts);
+	}
+	
+	SceneFree(dst);
+	SceneFree(src);
+	free(out);
+	
+	return error;
+}
+
+// compiles a scene exported by fast64, then saves it where it was asked for
+static const char *CliImportFast64(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	char *path = Strdup(inputs[0]); // gets its slashes fixed in place
+	struct CliSceneCounts counts;
+	struct Scene *scene;
+	const char *error;
+	char *out;
+	
+	// for the path to the mips64 binutils
+	WindowLoadSettings();
+	
+	error = Fast64_Compile(path);
+	free(path);
+	if (error)
+		return error;
+	
+	scene = SceneFromFilenamePredictRooms(ExePath(WHERE_TMP "test_scene.zscene"));
+	out = CliOutPath(opt, unit, inputs[0]);
+	if (!(error = CliSaveScene(scene, out, json)))
+	{
+		CliCountScene(scene, &counts);
+		CliAppendCounts(json, &counts);
+	}
+	SceneFree(scene);
+	free(out);
+	
+	return error;
+}
+
+// every scene and room in a rom, as files and a manifest.json
+static const char *CliExtract(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	char *out = Calloc(1, strlen(opt->outFolder) + 64);
+	const char *error;
+	int numScenes;
+	
+	CliMkdir(opt->outFolder);
+	sprintf(out, "%s/%d", opt->outFolder, unit);
+	
+	if (!(error = ProjectExtractScenesFromFilename(inputs[0], out, opt->jobs, &numScenes)))
+	{
+		CliAppend(json, ", \"output\": ");
+		CliAppendString(json, out);
+		CliAppend(json, ", \"scenes\": %d", numScenes);
+	}
+	
+	free(out);
+	
+	return error;
+}
+
+// every actor placed in the scene's rooms, or only those with --id
+static const char *CliActors(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	struct Scene *scene = SceneFromFilenamePredictRooms(inputs[0]);
+	const char *comma = "";
+	
+	CliAppend(json, ", \"actors\": [");
+	sb_foreach_named(scene->rooms, room, {
+		sb_foreach_named(room->headers, header, {
+			sb_foreach_named(header->instances, inst, {
+				if (sb_count(opt->ids) && !sb_contains_copy(opt->ids, inst->id))
+					continue;
+				CliAppend(json, "%s{ \"room\": %d, \"header\": %d, \"index\": %d"
+					", \"id\": %d, \"params\": %d, \"pos\": ["
+					, comma, roomIndex, headerIndex, instIndex
+					, inst->id, inst->params
+				);
+				CliAppendNumber(json, "%g", inst->pos.x);
+				CliAppend(json, ", ");
+				CliAppendNumber(json, "%g", inst->pos.y);
+				CliAppend(json, ", ");
+				CliAppendNumber(json, "%g", inst->pos.z);
+				CliAppend(json, "], \"rot\": [%d, %d, %d] }"
+					, inst->xrot, inst->yrot, inst->zrot
+				);
+				comma = ", ";
+			})
+		})
+	})
+	CliAppend(json, "]");
+	
+	SceneFree(scene);
+	
+	return 0;
+}
+
+// every actor in a project matching each --where expression; the
+// project is indexed once, so every expression after the first is cheap
+static const char *CliQuery(struct CliOptions *opt, int unit, char **inputs, sb_array(char, *json))
+{
+	struct Project *project = ProjectNewFromFilename(inputs[0]);
+	struct ActorQueryIndex *index;
+	const struct ActorQueryStats *stats;
+	sb_array(struct ActorQueryEntry, matches) = 0;
+	const char *error = 0;
+	
+	if (!project)
+		return FileGetError();
+	
+	index = ActorQueryIndexNew(project, opt->jobs);
+	stats = ActorQueryIndexGetStats(index);
+	TomlActorQueryAddFields(index, project);
+	
+	CliAppend(json, ", \"scenes\": %d, \"rooms\": %d, \"actors\": %d, \"unreadable\": %d, \"unreadableRooms\": %d, \"indexMs\": "
+		, stats->numScenes
+		, stats->numRooms
+		, stats->numActors
+		, stats->numFailed
+		, stats->numRoomsFailed
+	);
+	CliAppendNumber(json, "%.3f", stats->seconds * 1000);
+	
+	CliAppend(json, ", \"queries\": [");
+	for (int i = 0; !error && i < MAX(1, sb_count(opt->wheres)); ++i)
+	{
+		const char *where = sb_count(opt->wheres) ? opt->wheres[i] : "1";
+		clock_t start = clock();
+		const char *comma = "";
+		
+		sb_clear(matches);
+		// the message is kept in the index, which goes away before it's printed
+		if ((error = ActorQueryRun(index, where, &matches)))
+		{
+			error = QuickFmt("%s: %s", where, error);
+			break;
+		}
+		
+		CliAppend(json, "%s{ \"where\": ", i ? ", " : "");
+		CliAppendString(json, where);
+		CliAppend(json, ", \"ms\": ");
+		CliAppendNumber(json, "%.3f", (double)(clock() - start) * 1000 / CLOCKS_PER_SEC);
+		CliAppend(json, ", \"matches\": [");
+		sb_foreach(matches, {
+			const struct ProjectScene *scene = &project->scenes[each->scene];
+			
+			CliAppend(json, "%s{ \"scene\": %d, \"name\": ", comma, each->scene);
+			CliAppendString(json, scene->name ? scene->name : QuickFmt("%08x", scene->startAddress));
+			CliAppend(json, ", \"room\": %d, \"header\": %d, \"index\": %d"
+				", \"id\": %d, \"params\": %d"
+				", \"pos\": [%d, %d, %d], \"rot\": [%d, %d, %d] }"
+				, each->room, each->header, each->index
+				, each->id, each->params
+				, each->pos[0], each->pos[1], each->pos[2]
+				, each->xrot, each->yrot, each->zrot
+			);
+			comma = ", ";
+		})
+		CliAppend(json, "] }");
+	}
+	CliAppend(json, "]");
+	
+	sb_free(matches);
+	ActorQueryIndexFree(index);
+	ProjectFree(project);
+	
+	return error;
+}
+
+static const struct CliCommand gCliCommands[] = {
+	{ "RoundTrip", "--out folder in.zscene...", 1, true, false, CliRoundTrip },
+	{ "Migrate", "--out folder dst.zscene src.zscene [dst.zscene src.zscene]...", 2, true, false, CliMigrate },
+	{ "ImportFast64", "--out folder path/to/assets/scenes/x/x_scene.c...", 1, true, true, CliImportFast64 },
+	{ "Extract", "--out folder rom.z64...", 1, true, false, CliExtract },
+	{ "Actors", "[--id 0x0000]... in.zscene...", 1, false, false, CliActors },
+	{ "Query", "[--where expression]... project...", 1, false, false, CliQuery },
+};
+
+#endif // endregion
+
+#if 1 // region: running units
+
+// the unit running in this process, if any, for CliDieHook()
+static struct
+{
+	struct CliOptions *opt;
+	int index;
+} sCliRunning;
+
+static void CliPrintResults(struct CliOptions *opt, char **results, int numUnits, int numFailed)
+{
+	fprintf(stdout, "{\n");
+	fprintf(stdout, "\t\"command\": \"%s\",\n", opt->command->name);
+	fprintf(stdout, "\t\"jobs\": %d,\n", opt->jobs);
+	fprintf(stdout, "\t\"failed\": %d,\n", numFailed);
+	fprintf(stdout, "\t\"results\": [\n");
+	for (int i = 0; i < numUnits; ++i)
+		fprintf(stdout, "\t\t%s%s\n", results[i], (i + 1 < numUnits) ? "," : "");
+	fprintf(stdout, "\t]\n");
+	fprintf(stdout, "}\n");
+}
+
+// a unit that gives up using Die() still gets its record printed,
+// with the message as its error
+static void CliDieHook(const char *message)
+{
+	struct CliOptions *opt = sCliRunning.opt;
+	char *result = CliResult(opt, opt->inputs + sCliRunning.index * opt->command->inputsPerUnit, message, 0);
+	
+	if (opt->isChild)
+		fprintf(stdout, "%s\n", result);
+	else
+		CliPrintResults(opt, &result, 1, 1);
+	fflush(stdout);
+}
+
+// index picks the inputs, while the unit number a child was given
+// is what its outputs are named after
+static char *CliRunUnit(struct CliOptions *opt, int index, bool *isOk)
+{
+	char **inputs = opt->inputs + index * opt->command->inputsPerUnit;
+	sb_array(char, fields) = 0;
+	const char *error;
+	char *result;
+	
+	sCliRunning.opt = opt;
+	sCliRunning.index = index;
+	DieSetHook(CliDieHook);
+	error = opt->command->run(opt, opt->isChild ? opt->unit : index, inputs, &fields);
+	DieSetHook(0);
+	result = CliResult(opt, inputs, error, fields);
+	*isOk = !error;
+	sb_free(fields);
+	
+	return result;
+}
+
+static FILE *CliSpawnUnit(struct CliOptions *opt, int unit)
+{
+	sb_array(char, cmd) = 0;
+	FILE *fp;
+
+#ifdef _WIN32
+	sb_push(cmd, '"'); // cmd.exe drops the outer pair of quotes
+#endif
+	CliAppendArg(&cmd, opt->exe);
+	CliAppendArg(&cmd, "Batch");
+	CliAppendArg(&cmd, opt->command->name);
+	CliAppendArg(&cmd, "--child");
+	CliAppendArg(&cmd, QuickFmt("%d", unit));
+	if (opt->outFolder)
+	{
+		CliAppendArg(&cmd, "--out");
+		CliAppendArg(&cmd, opt->outFolder);
+	}
+	sb_foreach(opt->ids, {
+		CliAppendArg(&cmd, "--id");
+		CliAppendArg(&cmd, QuickFmt("0x%04x", *each));
+	})
+	sb_foreach(opt->wheres, {
+		CliAppendArg(&cmd, "--where");
+		CliAppendArg(&cmd, *each);
+	})
+	if (opt->isVerbose)
+		CliAppendArg(&cmd, "--verbose");
+	for (int i = 0; i < opt->command->inputsPerUnit; ++i)
+		CliAppendArg(&cmd, opt->inputs[unit * opt->command->inputsPerUnit + i]);
+#ifdef _WIN32
+	sb_push(cmd, '"');
+#endif
+	sb_push(cmd, '\0');
+	
+	fflush(stdout);
+	fp = popen(cmd, "r");
+	sb_free(cmd);
+	
+	return fp;
+}
+
+// waits for the child to finish, and takes its result
+static char *CliCollectUnit(struct CliOptions *opt, int index, FILE *fp, bool *isOk)
+{
+	sb_array(char, output) = 0;
+	const char *error = 0;
+	char *result;
+	int status = -1;
+	int c;
+	
+	if (fp)
+	{
+		while ((c = fgetc(fp)) != EOF)
+			sb_push(output, c);
+		status = pclose(fp);
+	#ifndef _WIN32
+		if (status != -1 && WIFEXITED(status))
+			status = WEXITSTATUS(status);
+	#endif
+	}
+	
+	while (sb_count(output) && strchr("\r\n", sb_last(output)))
+		(void)sb_pop(output);
+	sb_push(output, '\0');
+	
+	// a child that died says so in its own record, which says why
+	if (!fp)
+		error = "failed to start child process";
+	else if (*output != '{' || (status && !strstr(output, "\"ok\": false")))
+		error = QuickFmt("child process exited with status %d", status);
+	
+	// the child reports how it went, unless it didn't get that far
+	if (error)
+		result = CliResult(opt, opt->inputs + index * opt->command->inputsPerUnit, error, 0);
+	else
+		result = Strdup(output);
+	*isOk = !error && !strstr(output, "\"ok\": false");
+	
+	sb_free(output);
+	
+	return result;
+}
+
+static void CliUsage(void)
+{
+	fprintf(stderr, "usage: z64scene Batch <command> [--jobs n] [--verbose] ...\n");
+	for (int i = 0; i < sizeof(gCliCommands) / sizeof(*gCliCommands); ++i)
+		fprintf(stderr, "  %s %s\n", gCliCommands[i].name, gCliCommands[i].usage);
+	exit(EXIT_FAILURE);
+}
+
+static void CliParseOptions(struct CliOptions *opt, int argc, char *argv[])
+{
+	if (argc < 1)
+		CliUsage();
+	
+	for (int i = 0; i < sizeof(gCliCommands) / sizeof(*gCliCommands); ++i)
+		if (!strcmp(argv[0], gCliCommands[i].name))
+			opt->command = &gCliCommands[i];
+	
+	if (!opt->command)
+		CliUsage();
+	
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *arg = argv[i];
+		const char *next = (i + 1 < argc) ? argv[i + 1] : 0;
+		
+		if (!strcmp(arg, "--verbose"))
+			opt->isVerbose = true;
+		else if (next && !strcmp(arg, "--jobs"))
+			opt->jobs = atoi(argv[++i]);
+		else if (next && !strcmp(arg, "--out"))
+			opt->outFolder = argv[++i];
+		else if (next && !strcmp(arg, "--id"))
+			sb_push(opt->ids, strtol(argv[++i], 0, 0));
+		else if (next && !strcmp(arg, "--where"))
+			sb_push(opt->wheres, argv[++i]);
+		else if (next && !strcmp(arg, "--child"))
+		{
+			opt->isChild = true;
+			opt->unit = atoi(argv[++i]);
+		}
+		else if (!strncmp(arg, "--", 2))
+			CliUsage();
+		else
+			sb_push(opt->inputs, argv[i]);
+	}
+	
+	if (!sb_count(opt->inputs)
+		|| sb_count(opt->inputs) % opt->command->inputsPerUnit
+		|| (opt->command->needsOutFolder && !opt->outFolder)
+	)
+		CliUsage();
+	
+	if (opt->jobs <= 0)
+		opt->jobs = 1;
+	opt->jobs = MIN(opt->jobs, CLI_MAX_JOBS);
+}
+
+#endif // endregion
+
+int CliMain(int argc, char *argv[], const char *exe)
+{
+	struct CliOptions opt = { .exe = exe };
+	sb_array(char *, results) = 0;
+	FILE *running[CLI_MAX_JOBS];
+	int numUnits;
+	int numFailed = 0;
+	bool isOk;
+	
+	CliParseOptions(&opt, argc, argv);
+	numUnits = sb_count(opt.inputs) / opt.command->inputsPerUnit;
+	
+	// json goes to stdout, so keep stderr down to what's worth reading
+	if (!opt.isVerbose)
+		LogLevelSet(LOG_LEVEL_WARN);
+	
+	// a child is given its unit's inputs only
+	if (opt.isChild)
+	{
+		char *result;
+		
+		SceneWriterSetJobs(1); // the parent is already using every core
+		result = CliRunUnit(&opt, 0, &isOk);
+		fprintf(stdout, "%s\n", result);
+		free(result);
+		SceneWriterCleanup();
+		
+		return EXIT_SUCCESS;
+	}
+	
+	(void)sb_add(results, numUnits);
+	
+	// a lone unit still gets the jobs for itself (Extract uses them)
+	if (numUnits == 1)
+	{
+		results[0] = CliRunUnit(&opt, 0, &isOk);
+		numFailed += !isOk;
+	}
+	else
+	{
+		int jobs = opt.command->isSerial ? 1 : opt.jobs;
+		
+		// keep up to jobs children going, oldest collected first
+		for (int next = 0, first = 0; first < numUnits; ++first)
+		{
+			for ( ; next < numUnits && next - first < jobs; ++next)
+				running[next % CLI_MAX_JOBS] = CliSpawnUnit(&opt, next);
+			
+			results[first] = CliCollectUnit(&opt, first, running[first % CLI_MAX_JOBS], &isOk);
+			numFailed += !isOk;
+		}
+	}
+	
+	CliPrintResults(&opt, results, numUnits, numFailed);
+	
+	sb_foreach(results, { free(*each); })
+	sb_free(results);
+	sb_free(opt.inputs);
+	sb_free(opt.ids);
+	sb_free(opt.wheres);
+	SceneWriterCleanup();
+	
+	return numFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
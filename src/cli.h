@@ -0,0 +1,14 @@
+//
+// cli.h
+//
+// headless batch commands
+//
+
+#ifndef CLI_H_INCLUDED
+#define CLI_H_INCLUDED
+
+// z64scene Batch <command> [options] inputs...
+// where argv[0] is the command; prints json to stdout, returns the exit code
+int CliMain(int argc, char *argv[], const char *exe);
+
+#endif // CLI_H_INCLUDED
@@ -8,6 +8,7 @@
 #include "logging.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <ctype.h>
 
 // debugging helper when testing exhaustively
@@ -581,6 +582,57 @@ void CutsceneOotToWorkblob(
 	WorkblobPop();
 }
 
+// the size of each entry in a command's list, which depends on its type
+static size_t CsCmdOotEntrySize(const CsCmdOot *cmd)
+{
+	const char *cmdName = CutsceneCmdOotAsString(cmd->type);
+	
+	if (strstr(cmdName, "ACTOR_CUE") || cmd->type == CS_CMD_OOT_PLAYER_CUE)
+		return sizeof(*cmd->actorCue);
+	if (strstr(cmdName, "_CAM_"))
+		return sizeof(*cmd->cam);
+	
+	switch (cmd->type)
+	{
+		case CS_CMD_OOT_MISC: return sizeof(*cmd->misc);
+		case CS_CMD_OOT_LIGHT_SETTING: return sizeof(*cmd->lightSetting);
+		case CS_CMD_OOT_START_SEQ: return sizeof(*cmd->startSeq);
+		case CS_CMD_OOT_STOP_SEQ: return sizeof(*cmd->stopSeq);
+		case CS_CMD_OOT_FADE_OUT_SEQ: return sizeof(*cmd->fadeOutSeq);
+		case CS_CMD_OOT_RUMBLE_CONTROLLER: return sizeof(*cmd->rumble);
+		case CS_CMD_OOT_TIME: return sizeof(*cmd->time);
+		case CS_CMD_OOT_TEXT: return sizeof(*cmd->text);
+		case CS_CMD_OOT_DESTINATION: return sizeof(*cmd->destination);
+		case CS_CMD_OOT_TRANSITION: return sizeof(*cmd->transition);
+		default: return sizeof(*cmd->unimplemented);
+	}
+}
+
+// hands each run of editable bytes to watch(), for the undo journal;
+// lists are only ever edited in place, so the runs stay put
+void CutsceneOotWatch(struct CutsceneOot *cs, void watch(void *addr, size_t size))
+{
+	if (!cs)
+		return;
+	
+	watch(&cs->frameCount, sizeof(cs->frameCount));
+	watch(cs->commands, sb_count(cs->commands) * sizeof(*cs->commands));
+	
+	sb_foreach(cs->commands, {
+		// is a union, so this counts any list
+		watch(each->misc, sb_count(each->misc) * CsCmdOotEntrySize(each));
+		
+		if (strstr(CutsceneCmdOotAsString(each->type), "_CAM_"))
+		{
+			CsCmdOotCam *cams = each->cam;
+			
+			sb_foreach(cams, {
+				watch(each->points, sb_count(each->points) * sizeof(*each->points));
+			})
+		}
+	})
+}
+
 AS_STRING_FUNC(CutsceneCmdOot, ENUM_CS_CMD_OOT)
 
 #endif // endregion
@@ -1318,6 +1370,62 @@ uint32_t CutsceneListMmToWorkblob(
 	return WorkblobPop();
 }
 
+// the size of each entry in a command's list, which depends on its type
+static size_t CsCmdMmEntrySize(const CsCmdMm *cmd)
+{
+	if (strstr(CutsceneCmdMmAsString(cmd->type), "ACTOR_CUE") || cmd->type == CS_CMD_MM_PLAYER_CUE)
+		return sizeof(*cmd->actorCue);
+	
+	switch (cmd->type)
+	{
+		case CS_CMD_MM_MISC: return sizeof(*cmd->misc);
+		case CS_CMD_MM_LIGHT_SETTING: return sizeof(*cmd->lightSetting);
+		case CS_CMD_MM_START_SEQ: return sizeof(*cmd->startSeq);
+		case CS_CMD_MM_STOP_SEQ: return sizeof(*cmd->stopSeq);
+		case CS_CMD_MM_FADE_OUT_SEQ: return sizeof(*cmd->fadeOutSeq);
+		case CS_CMD_MM_START_AMBIENCE: return sizeof(*cmd->startAmbience);
+		case CS_CMD_MM_FADE_OUT_AMBIENCE: return sizeof(*cmd->fadeOutAmbience);
+		case CS_CMD_MM_SFX_REVERB_INDEX_2: return sizeof(*cmd->sfxReverbIndexTo2);
+		case CS_CMD_MM_SFX_REVERB_INDEX_1: return sizeof(*cmd->sfxReverbIndexTo1);
+		case CS_CMD_MM_MODIFY_SEQ: return sizeof(*cmd->modifySeq);
+		case CS_CMD_MM_RUMBLE: return sizeof(*cmd->rumble);
+		case CS_CMD_MM_TRANSITION_GENERAL: return sizeof(*cmd->transitionGeneral);
+		case CS_CMD_MM_TIME: return sizeof(*cmd->time);
+		case CS_CMD_MM_CAMERA_SPLINE: return sizeof(*cmd->cameraSplineBytes);
+		case CS_CMD_MM_DESTINATION: return sizeof(*cmd->destination);
+		case CS_CMD_MM_CHOOSE_CREDITS_SCENES: return sizeof(*cmd->chooseCreditsScene);
+		case CS_CMD_MM_TEXT: return sizeof(*cmd->text);
+		case CS_CMD_MM_TRANSITION: return sizeof(*cmd->transition);
+		case CS_CMD_MM_MOTION_BLUR: return sizeof(*cmd->motionBlur);
+		case CS_CMD_MM_GIVE_TATL: return sizeof(*cmd->giveTatl);
+		default: return sizeof(*cmd->unimplemented);
+	}
+}
+
+// same as CutsceneOotWatch()
+void CutsceneMmWatch(struct CutsceneMm *cs, void watch(void *addr, size_t size))
+{
+	if (!cs)
+		return;
+	
+	watch(&cs->frameCount, sizeof(cs->frameCount));
+	watch(cs->commands, sb_count(cs->commands) * sizeof(*cs->commands));
+	
+	// is a union, so this counts any list
+	sb_foreach(cs->commands, {
+		watch(each->misc, sb_count(each->misc) * CsCmdMmEntrySize(each));
+	})
+}
+
+void CutsceneListMmWatch(struct CutsceneListMm *list, void watch(void *addr, size_t size))
+{
+	watch(list, sb_count(list) * sizeof(*list));
+	
+	sb_foreach(list, {
+		CutsceneMmWatch(each->script, watch);
+	})
+}
+
 AS_STRING_FUNC(CutsceneCmdMm, ENUM_CutsceneCmdMm)
 
 #endif // endregion
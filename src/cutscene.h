@@ -982,6 +982,7 @@ void CutsceneOotToWorkblob(
 	, void WorkblobThisExactlyBegin(uint32_t wantThisSize)
 	, void WorkblobThisExactlyEnd(void)
 );
+void CutsceneOotWatch(struct CutsceneOot *cs, void watch(void *addr, size_t size));
 
 void CutsceneMmFree(struct CutsceneMm *cs);
 void CutsceneListMmFree(struct CutsceneListMm *sbArr);
@@ -1006,6 +1007,8 @@ uint32_t CutsceneListMmToWorkblob(
 	, void WorkblobThisExactlyBegin(uint32_t wantThisSize)
 	, void WorkblobThisExactlyEnd(void)
 );
+void CutsceneMmWatch(struct CutsceneMm *cs, void watch(void *addr, size_t size));
+void CutsceneListMmWatch(struct CutsceneListMm *list, void watch(void *addr, size_t size));
 
 #endif // endregion
 
@@ -59,7 +59,174 @@ typedef uint16_t qu102_t;
 	((uint32_t)(((uint32_t)(v) >> (s)) & ((0x01 << (w)) - 1)))
 #define ShiftR SHIFTR
 
-static struct DataBlobSegment gSegments[16];
+#define DATA_BLOB_ARENA_BLOCK_SIZE 0x10000
+#define DATA_BLOB_ARENA_MIN_REFS 4
+
+struct DataBlobArena
+{
+	sb_array(void *, blocks);
+	uint8_t *cursor; // free space left in the newest block
+	size_t remaining;
+	int refCount;
+};
+
+// what the display list walkers know of the rdp's texture state, which
+// carries over from one display list to the next like it does in game
+struct DataBlobMeshTracker
+{
+	struct {
+		int fmt;
+		int siz;
+		uint32_t width;
+		uint32_t dram;
+		void *dramRef;
+	} timg;
+	
+	struct {
+		// SetTile
+		int fmt;
+		int siz;
+		int line;
+		uint16_t tmem;
+		int pal;
+		int cms;
+		int cmt;
+		int masks;
+		int maskt;
+		int shifts;
+		int shiftt;
+		// SetTileSize
+		qu102_t uls;
+		qu102_t ult;
+		qu102_t lrs;
+		qu102_t lrt;
+	} tileDescriptors[8];
+	
+	struct DataBlob *palBlob;
+	sb_array(struct DataBlob *, needsPalettes); // color-indexed textures w/o palettes
+};
+
+struct DataBlobMeshTrackerNew
+{
+	struct {
+		uint32_t Dram;
+		void *DramRef;
+		int Width;
+		int Height;
+		int RealWidth;
+		int RealHeight;
+		float ShiftS;
+		float ShiftT;
+		float S_Scale;
+		float T_Scale;
+		float TextureHRatio;
+		float TextureWRatio;
+		// SetTile
+		int TexFormat;
+		int TexFormatUOT;
+		int TexelSize;
+		int LineSize;
+		int CMT;
+		int CMS;
+		int MaskS;
+		int MaskT;
+		int TShiftS;
+		int TShiftT;
+		// SetTileSize
+		qu102_t ULS;
+		qu102_t ULT;
+		qu102_t LRS;
+		qu102_t LRT;
+	} textures[2];
+	int CurrentTex;
+	bool MultiTexCoord;
+	bool MultiTexture;
+	uint32_t gRdpHalf1;
+	void *gRdpHalf1w1addr;
+	
+	struct DataBlob *palBlob;
+	sb_array(struct DataBlob *, needsPalettes); // color-indexed textures w/o palettes
+};
+
+// see DataBlobContextBind()
+struct DataBlobContext
+{
+	struct DataBlobSegment segments[16];
+	struct DataBlobArena *arena; // see DataBlobArenaBind()
+	struct DataBlobMeshTracker mesh;
+	struct DataBlobMeshTrackerNew meshNew;
+};
+
+// each thread starts out using a context of its own
+static _Thread_local struct DataBlobContext gDefaultContext;
+static _Thread_local struct DataBlobContext *gContext;
+static struct DataBlobAllocCounts gAllocCounts; // shared by every thread
+
+// scenes can be parsed on any thread, so the counts are bumped atomically
+#define DATA_BLOB_COUNT(FIELD) __atomic_add_fetch(&gAllocCounts.FIELD, 1, __ATOMIC_RELAXED)
+
+static struct DataBlobContext *DataBlobContextCurrent(void)
+{
+	if (!gContext)
+		gContext = &gDefaultContext;
+	
+	return gContext;
+}
+
+static void *DataBlobArenaAlloc(struct DataBlobArena *arena, size_t size)
+{
+	void *result;
+	
+	size = (size + 15) & ~15;
+	
+	if (size > arena->remaining)
+	{
+		size_t blockSize = MAX(size, DATA_BLOB_ARENA_BLOCK_SIZE);
+		
+		sb_push(arena->blocks, Calloc(1, blockSize));
+		arena->cursor = sb_last(arena->blocks);
+		arena->remaining = blockSize;
+		DATA_BLOB_COUNT(arenaBlocks);
+	}
+	
+	result = arena->cursor;
+	arena->cursor += size;
+	arena->remaining -= size;
+	
+	return result;
+}
+
+// ref arrays carved from an arena keep the stretchy buffer layout, so
+// sb_count(), sb_foreach() and sb_remove() work on them as usual, but
+// they must only ever grow through here
+static void DataBlobAddRef(struct DataBlob *blob, void *ref)
+{
+	if (!blob->arena)
+	{
+		if (stb__sbneedgrow(blob->refs, 1))
+			DATA_BLOB_COUNT(heapRefArrays);
+		sb_push(blob->refs, ref);
+		return;
+	}
+	
+	if (stb__sbneedgrow(blob->refs, 1))
+	{
+		const int defaults[] = SB_HEADER_DEFAULTS;
+		int count = sb_count(blob->refs);
+		int capacity = MAX(DATA_BLOB_ARENA_MIN_REFS, count * 2);
+		int *raw = DataBlobArenaAlloc(blob->arena, sizeof(defaults) + sizeof(*blob->refs) * capacity);
+		
+		memcpy(raw, defaults, sizeof(defaults));
+		raw[0] = capacity;
+		raw[1] = count;
+		if (count)
+			memcpy(raw + SB_HEADER_COUNT, blob->refs, sizeof(*blob->refs) * count);
+		blob->refs = (void*)(raw + SB_HEADER_COUNT);
+		DATA_BLOB_COUNT(arenaRefArrays);
+	}
+	
+	sb_push(blob->refs, ref);
+}
 
 struct DataBlob *DataBlobNew(
 	const void *refData
@@ -70,7 +237,28 @@ struct DataBlob *DataBlobNew(
 	, void *ref
 )
 {
-	struct DataBlob *blob = calloc(1, sizeof(*blob));
+	struct DataBlobContext *ctx = DataBlobContextCurrent();
+	struct DataBlobArena *arena = 0;
+	struct DataBlob *blob;
+	
+	// only blobs that live in the scene and room lists go in the arena;
+	// those on the external segments are freed separately, between scenes
+	if (ctx->arena
+		&& (type == DATA_BLOB_TYPE_EOF
+			|| (segmentAddr >> 24) == 0x02
+			|| (segmentAddr >> 24) == 0x03
+		)
+	)
+	{
+		arena = ctx->arena;
+		blob = DataBlobArenaAlloc(arena, sizeof(*blob));
+		DATA_BLOB_COUNT(arenaBlobs);
+	}
+	else
+	{
+		blob = calloc(1, sizeof(*blob));
+		DATA_BLOB_COUNT(heapBlobs);
+	}
 	
 	*blob = (struct DataBlob) {
 		.next = next
@@ -79,23 +267,27 @@ struct DataBlob *DataBlobNew(
 		, .sizeBytes = sizeBytes
 		, .type = type
 		, .alignBytes = 8
+		, .arena = arena
 	};
 	
 	if (ref)
-		sb_push(blob->refs, ref);
+		DataBlobAddRef(blob, ref);
 	
 	return blob;
 }
 
 void DatablobFree(struct DataBlob *blob)
 {
-	sb_free(blob->refs);
-	
 	sb_free(blob->callbacks.postsort);
 	
 	if (blob->ownsRefData)
 		free((void*)blob->refData);
 	
+	// the rest goes when the arena does
+	if (blob->arena)
+		return;
+	
+	sb_free(blob->refs);
 	free(blob);
 }
 
@@ -319,7 +511,7 @@ struct DataBlob *DataBlobPush(
 			
 			// keep track of references to ram segment
 			if (ref && !sb_contains_ref(each->refs, ref))
-				sb_push(each->refs, ref);
+				DataBlobAddRef(each, ref);
 			
 			// already at beginning of list
 			if (each == listHead)
@@ -380,12 +572,14 @@ void DataBlobListTouchBlob(struct DataBlob **listHead, struct DataBlob *blob)
 
 void DataBlobSegmentClearAll(void)
 {
-	memset(gSegments, 0, sizeof(gSegments));
+	struct DataBlobContext *ctx = DataBlobContextCurrent();
+	
+	memset(ctx->segments, 0, sizeof(ctx->segments));
 }
 
 void DataBlobSegmentSetup(int segmentIndex, const void *data, const void *dataEnd, struct DataBlob *head)
 {
-	struct DataBlobSegment *seg = &gSegments[segmentIndex];
+	struct DataBlobSegment *seg = DataBlobSegmentGet(segmentIndex);
 	
 	LogDebug("DataBlobSegmentSetup(%d): %p - %p (%08x)"
 		, segmentIndex, data, dataEnd, (uint32_t)(dataEnd - data)
@@ -398,10 +592,23 @@ void DataBlobSegmentSetup(int segmentIndex, const void *data, const void *dataEn
 
 struct DataBlobSegment *DataBlobSegmentGet(int segmentIndex)
 {
-	if (segmentIndex >= ARRLEN(gSegments))
+	struct DataBlobContext *ctx = DataBlobContextCurrent();
+	
+	if (segmentIndex >= ARRLEN(ctx->segments))
 		return 0;
 	
-	return &gSegments[segmentIndex];
+	return &ctx->segments[segmentIndex];
+}
+
+// or 0 if the segment holds no data
+static struct DataBlobSegment *DataBlobSegmentGetPopulated(uint32_t segAddr)
+{
+	struct DataBlobSegment *seg = DataBlobSegmentGet(segAddr >> 24);
+	
+	if (!seg || seg->data == 0)
+		return 0;
+	
+	return seg;
 }
 
 struct DataBlob *DataBlobSegmentGetHead(int segmentIndex)
@@ -448,25 +655,23 @@ struct DataBlob *DataBlobSegmentPush(
 
 const void *DataBlobSegmentAddressToRealAddress(uint32_t segAddr)
 {
+	struct DataBlobSegment *seg = DataBlobSegmentGetPopulated(segAddr);
+	
 	// skip unpopulated segments
-	if ((segAddr >> 24) >= ARRLEN(gSegments)
-		|| gSegments[segAddr >> 24].data == 0
-	)
+	if (!seg)
 		return 0;
 	
-	return ((const uint8_t*)gSegments[segAddr >> 24].data) + (segAddr & 0x00ffffff);
+	return ((const uint8_t*)seg->data) + (segAddr & 0x00ffffff);
 }
 
 const void *DataBlobSegmentAddressBoundsEnd(uint32_t segAddr)
 {
+	struct DataBlobSegment *seg = DataBlobSegmentGetPopulated(segAddr);
+	
 	// skip unpopulated segments
-	if ((segAddr >> 24) >= ARRLEN(gSegments)
-		|| gSegments[segAddr >> 24].data == 0
-	)
+	if (!seg)
 		return 0;
 	
-	struct DataBlobSegment *seg = DataBlobSegmentGet(segAddr >> 24);
-	
 	return seg->dataEnd;
 }
 
@@ -476,9 +681,7 @@ const void *DataBlobSegmentAddressBoundsEnd(uint32_t segAddr)
 void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 {
 	// skip unpopulated segments
-	if ((segAddr >> 24) >= ARRLEN(gSegments)
-		|| gSegments[segAddr >> 24].data == 0
-	)
+	if (!DataBlobSegmentGetPopulated(segAddr))
 		return;
 	
 	// last 8 commands
@@ -489,37 +692,7 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 #define HISTORY_GET(n) \
 	history[(i - 1 - (n) < 0) ? (i - 1 - (n) + ARRLEN(history)) : (i - 1 - (n))]
 	
-	// texture engine state tracker
-	static struct {
-		int fmt;
-		int siz;
-		uint32_t width;
-		uint32_t dram;
-		void *dramRef;
-	} timg = { 0 };
-	
-	static struct {
-		// SetTile
-		int fmt;
-		int siz;
-		int line;
-		uint16_t tmem;
-		int pal;
-		int cms;
-		int cmt;
-		int masks;
-		int maskt;
-		int shifts;
-		int shiftt;
-		// SetTileSize
-		qu102_t uls;
-		qu102_t ult;
-		qu102_t lrs;
-		qu102_t lrt;
-	} tileDescriptors[8] = { 0 };
-	
-	static struct DataBlob *palBlob = 0;
-	static sb_array(struct DataBlob *, needsPalettes); // color-indexed textures w/o palettes
+	struct DataBlobMeshTracker *state = &DataBlobContextCurrent()->mesh;
 	
 	bool exit = false;
 	for (const uint8_t *data = DataBlobSegmentAddressToRealAddress(segAddr); !exit; )
@@ -601,28 +774,28 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 			 */
 			
 			case G_SETTIMG:
-				timg.fmt =   SHIFTR(w0, 21, 3);
-				timg.siz =   SHIFTR(w0, 19, 2);
-				timg.width = SHIFTR(w0, 0, 12) + 1;
-				timg.dram =  w1;
-				timg.dramRef = w1addr;
+				state->timg.fmt =   SHIFTR(w0, 21, 3);
+				state->timg.siz =   SHIFTR(w0, 19, 2);
+				state->timg.width = SHIFTR(w0, 0, 12) + 1;
+				state->timg.dram =  w1;
+				state->timg.dramRef = w1addr;
 				break;
 			
 			case G_SETTILE:
 				{
 					int tile = SHIFTR(w1, 24, 3);
 					
-					tileDescriptors[tile].fmt =   SHIFTR(w0, 21, 3);
-					tileDescriptors[tile].siz =   SHIFTR(w0, 19, 2);
-					tileDescriptors[tile].line =  SHIFTR(w0,  9, 9);
-					tileDescriptors[tile].tmem =  SHIFTR(w0,  0, 9);
-					tileDescriptors[tile].pal =   SHIFTR(w1, 20, 4);
-					tileDescriptors[tile].cms =   SHIFTR(w1,  8, 2);
-					tileDescriptors[tile].cmt =   SHIFTR(w1, 18, 2);
-					tileDescriptors[tile].masks =  SHIFTR(w1,  4, 4);
-					tileDescriptors[tile].maskt =  SHIFTR(w1, 14, 4);
-					tileDescriptors[tile].shifts = SHIFTR(w1,  0, 4);
-					tileDescriptors[tile].shiftt = SHIFTR(w1, 10, 4);
+					state->tileDescriptors[tile].fmt =   SHIFTR(w0, 21, 3);
+					state->tileDescriptors[tile].siz =   SHIFTR(w0, 19, 2);
+					state->tileDescriptors[tile].line =  SHIFTR(w0,  9, 9);
+					state->tileDescriptors[tile].tmem =  SHIFTR(w0,  0, 9);
+					state->tileDescriptors[tile].pal =   SHIFTR(w1, 20, 4);
+					state->tileDescriptors[tile].cms =   SHIFTR(w1,  8, 2);
+					state->tileDescriptors[tile].cmt =   SHIFTR(w1, 18, 2);
+					state->tileDescriptors[tile].masks =  SHIFTR(w1,  4, 4);
+					state->tileDescriptors[tile].maskt =  SHIFTR(w1, 14, 4);
+					state->tileDescriptors[tile].shifts = SHIFTR(w1,  0, 4);
+					state->tileDescriptors[tile].shiftt = SHIFTR(w1, 10, 4);
 				}
 				break;
 			
@@ -635,10 +808,10 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 				{
 					int tile = SHIFTR(w1, 24, 3);
 					
-					tileDescriptors[tile].uls =  SHIFTR(w0, 12, 12);
-					tileDescriptors[tile].ult =  SHIFTR(w0,  0, 12);
-					tileDescriptors[tile].lrs =  SHIFTR(w1, 12, 12);
-					tileDescriptors[tile].lrt =  SHIFTR(w1,  0, 12);
+					state->tileDescriptors[tile].uls =  SHIFTR(w0, 12, 12);
+					state->tileDescriptors[tile].ult =  SHIFTR(w0,  0, 12);
+					state->tileDescriptors[tile].lrs =  SHIFTR(w1, 12, 12);
+					state->tileDescriptors[tile].lrt =  SHIFTR(w1,  0, 12);
 				}
 				
 				if (HISTORY_GET(0) == G_SETTILE &&
@@ -650,10 +823,10 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 				{
 					int tile = SHIFTR(w1, 24, 3);
 					// gsDPLoadTextureBlock / gsDPLoadMultiBlock
-					uint32_t addr = timg.dram;
-					int siz = tileDescriptors[tile].siz;
-					uint32_t width = qu102_I(tileDescriptors[tile].lrs) + 1;
-					uint32_t height = qu102_I(tileDescriptors[tile].lrt) + 1;
+					uint32_t addr = state->timg.dram;
+					int siz = state->tileDescriptors[tile].siz;
+					uint32_t width = qu102_I(state->tileDescriptors[tile].lrs) + 1;
+					uint32_t height = qu102_I(state->tileDescriptors[tile].lrt) + 1;
 					
 					if ((realAddr = DataBlobSegmentAddressToRealAddress(addr)))
 					{
@@ -669,15 +842,15 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 						if (size > 4096)
 							LogDebug("warning: width height %d x %d", width, height);
 						
-						blob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_TEXTURE, timg.dramRef);
+						blob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_TEXTURE, state->timg.dramRef);
 						blob->data.texture.w = width;
 						blob->data.texture.h = height;
 						blob->data.texture.siz = siz;
-						blob->data.texture.fmt = tileDescriptors[tile].fmt;
+						blob->data.texture.fmt = state->tileDescriptors[tile].fmt;
 						if (blob->data.texture.fmt == G_IM_FMT_CI
 							&& blob->data.texture.pal == 0
 						)
-							sb_push(needsPalettes, blob);
+							sb_push(state->needsPalettes, blob);
 						//ret = DisplayList_CopyData(obj1, addr, size, obj2, &newAddr, "Texture/Multi Block");
 						//if (ret != 0)
 						//	goto err;
@@ -690,18 +863,18 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 					HISTORY_GET(1) == G_SETTILE &&
 					HISTORY_GET(2) == G_RDPTILESYNC &&
 					HISTORY_GET(3) == G_SETTIMG &&
-				   (timg.fmt == G_IM_FMT_RGBA || timg.fmt == G_IM_FMT_IA) &&
-					timg.siz == G_IM_SIZ_16b)
+				   (state->timg.fmt == G_IM_FMT_RGBA || state->timg.fmt == G_IM_FMT_IA) &&
+					state->timg.siz == G_IM_SIZ_16b)
 				{
 					// gsDPLoadTLUT / gsDPLoadTLUT_pal16 / gsDPLoadTLUT_pal256
-					uint32_t addr = timg.dram;
+					uint32_t addr = state->timg.dram;
 					uint32_t count = SHIFTR(w1, 14, 10) + 1;
 					
 					if ((realAddr = DataBlobSegmentAddressToRealAddress(addr)))
 					{
 						size_t size = ALIGN8(G_SIZ_BYTES(G_IM_SIZ_16b) * count);
 						
-						palBlob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_PALETTE, timg.dramRef);
+						state->palBlob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_PALETTE, state->timg.dramRef);
 						//ret = DisplayList_CopyData(obj1, addr, size, obj2, &newAddr, "TLUT");
 						//if (ret != 0)
 						//	goto err;
@@ -713,13 +886,13 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 			// this as an opportunity to resolve palette address
 			case G_TRI1:
 			case G_TRI2:
-				if (sb_count(needsPalettes))
+				if (sb_count(state->needsPalettes))
 				{
-					sb_foreach(needsPalettes, {
-						(*each)->data.texture.pal = palBlob;
+					sb_foreach(state->needsPalettes, {
+						(*each)->data.texture.pal = state->palBlob;
 					});
 					
-					sb_clear(needsPalettes);
+					sb_clear(state->needsPalettes);
 				}
 				break;
 			
@@ -770,9 +943,7 @@ void DataBlobSegmentsPopulateFromMesh(uint32_t segAddr, void *originator)
 void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 {
 	// skip unpopulated segments
-	if ((segAddr >> 24) >= ARRLEN(gSegments)
-		|| gSegments[segAddr >> 24].data == 0
-	)
+	if (!DataBlobSegmentGetPopulated(segAddr))
 		return;
 	
 	// last 8 commands
@@ -803,45 +974,8 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 #define HISTORY_GET(n) \
 	history[(i - 1 - (n) < 0) ? (i - 1 - (n) + ARRLEN(history)) : (i - 1 - (n))]
 	
-	static struct {
-		uint32_t Dram;
-		void *DramRef;
-		int Width;
-		int Height;
-		int RealWidth;
-		int RealHeight;
-		float ShiftS;
-		float ShiftT;
-		float S_Scale;
-		float T_Scale;
-		float TextureHRatio;
-		float TextureWRatio;
-		// SetTile
-		int TexFormat;
-		int TexFormatUOT;
-		int TexelSize;
-		int LineSize;
-		int CMT;
-		int CMS;
-		int MaskS;
-		int MaskT;
-		int TShiftS;
-		int TShiftT;
-		// SetTileSize
-		qu102_t ULS;
-		qu102_t ULT;
-		qu102_t LRS;
-		qu102_t LRT;
-	} textures[2];
-	#define Textures(X) textures[X]
-	static int CurrentTex;
-	static bool MultiTexCoord; (void)MultiTexCoord;
-	static bool MultiTexture; (void)MultiTexture;
-	static uint32_t gRdpHalf1 = 0;
-	static void *gRdpHalf1w1addr = 0;
-	
-	static struct DataBlob *palBlob = 0;
-	static sb_array(struct DataBlob *, needsPalettes); // color-indexed textures w/o palettes
+	struct DataBlobMeshTrackerNew *state = &DataBlobContextCurrent()->meshNew;
+	#define Textures(X) state->textures[X]
 	
 	int Pow2(int val)
 	{
@@ -940,7 +1074,7 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 			{
 				int width = Textures(id).RealWidth;
 				int height = Textures(id).RealHeight;
-				int siz = Textures(CurrentTex).TexelSize;
+				int siz = Textures(state->CurrentTex).TexelSize;
 				size_t size = 0;
 				
 				// old method was returning 0 here
@@ -976,7 +1110,7 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 			
 			LogDebug("%d %d - %d", width, height, Textures(id).LineSize);
 			
-			int siz = Textures(CurrentTex).TexelSize;
+			int siz = Textures(state->CurrentTex).TexelSize;
 			size_t size = G_SIZ_BYTES(siz) * width * height;
 			
 			// old method was returning 0 here
@@ -1149,18 +1283,18 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 				bool palMode = data[8] == G_RDPTILESYNC;
 				if (HISTORY_GET(0) == G_SETTILESIZE)
 				{
-					CurrentTex = 1;
+					state->CurrentTex = 1;
 					if (true) // GLExtensions.GLMultiTexture And GLExtensions.GLFragProg
-						MultiTexCoord = true;
+						state->MultiTexCoord = true;
 					else if (false)
-						MultiTexCoord = false;
-					MultiTexture = true;
+						state->MultiTexCoord = false;
+					state->MultiTexture = true;
 				}
 				else
 				{
-					CurrentTex = 0;
-					MultiTexCoord = false;
-					MultiTexture = false;
+					state->CurrentTex = 0;
+					state->MultiTexCoord = false;
+					state->MultiTexture = false;
 				}
 				if (palMode)
 				{
@@ -1169,8 +1303,8 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 				}
 				else
 				{
-					Textures(CurrentTex).Dram = w1;
-					Textures(CurrentTex).DramRef = w1addr;
+					Textures(state->CurrentTex).Dram = w1;
+					Textures(state->CurrentTex).DramRef = w1addr;
 				}
 				break;
 			}
@@ -1180,23 +1314,23 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 				{
 					//int tile = SHIFTR(w1, 24, 3);
 					
-					Textures(CurrentTex).TexFormatUOT = (w0 >> 16) & 0xff; // uot
-					Textures(CurrentTex).TexFormat =   SHIFTR(w0, 21, 3);
-					Textures(CurrentTex).TexelSize =   SHIFTR(w0, 19, 2);
-					Textures(CurrentTex).LineSize =  SHIFTR(w0,  9, 9);
+					Textures(state->CurrentTex).TexFormatUOT = (w0 >> 16) & 0xff; // uot
+					Textures(state->CurrentTex).TexFormat =   SHIFTR(w0, 21, 3);
+					Textures(state->CurrentTex).TexelSize =   SHIFTR(w0, 19, 2);
+					Textures(state->CurrentTex).LineSize =  SHIFTR(w0,  9, 9);
 					//tileDescriptors[tile].tmem =  SHIFTR(w0,  0, 9); // unused
 					//tileDescriptors[tile].pal =   SHIFTR(w1, 20, 4); // unused
-					Textures(CurrentTex).CMT = ShiftR(w1, 18, 2);
-					Textures(CurrentTex).CMS = ShiftR(w1, 8, 2);
-					Textures(CurrentTex).MaskS = ShiftR(w1, 4, 4);
-					Textures(CurrentTex).MaskT = ShiftR(w1, 14, 4);
-					Textures(CurrentTex).TShiftS = ShiftR(w1, 0, 4);
-					Textures(CurrentTex).TShiftT = ShiftR(w1, 10, 4);
+					Textures(state->CurrentTex).CMT = ShiftR(w1, 18, 2);
+					Textures(state->CurrentTex).CMS = ShiftR(w1, 8, 2);
+					Textures(state->CurrentTex).MaskS = ShiftR(w1, 4, 4);
+					Textures(state->CurrentTex).MaskT = ShiftR(w1, 14, 4);
+					Textures(state->CurrentTex).TShiftS = ShiftR(w1, 0, 4);
+					Textures(state->CurrentTex).TShiftT = ShiftR(w1, 10, 4);
 					
 					// getting linesize of 8 on a 32x32 rgba truecolor texture,
 					// should be 16, so maybe this math is required?
-					if (Textures(CurrentTex).TexelSize == G_IM_SIZ_32b)
-						Textures(CurrentTex).LineSize *= 2;
+					if (Textures(state->CurrentTex).TexelSize == G_IM_SIZ_32b)
+						Textures(state->CurrentTex).LineSize *= 2;
 				}
 				break;
 			
@@ -1212,29 +1346,29 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 			
 			case G_SETTILESIZE: {
 				{
-					Textures(CurrentTex).ULS =  SHIFTR(w0, 12, 12);
-					Textures(CurrentTex).ULT =  SHIFTR(w0,  0, 12);
-					Textures(CurrentTex).LRS =  SHIFTR(w1, 12, 12);
-					Textures(CurrentTex).LRT =  SHIFTR(w1,  0, 12);
-					Textures(CurrentTex).Width =  ((Textures(CurrentTex).LRS - Textures(CurrentTex).ULS) + 1);
-					Textures(CurrentTex).Height = ((Textures(CurrentTex).LRT - Textures(CurrentTex).ULT) + 1);
+					Textures(state->CurrentTex).ULS =  SHIFTR(w0, 12, 12);
+					Textures(state->CurrentTex).ULT =  SHIFTR(w0,  0, 12);
+					Textures(state->CurrentTex).LRS =  SHIFTR(w1, 12, 12);
+					Textures(state->CurrentTex).LRT =  SHIFTR(w1,  0, 12);
+					Textures(state->CurrentTex).Width =  ((Textures(state->CurrentTex).LRS - Textures(state->CurrentTex).ULS) + 1);
+					Textures(state->CurrentTex).Height = ((Textures(state->CurrentTex).LRT - Textures(state->CurrentTex).ULT) + 1);
 				}
 				
-				CalculateTexSize(CurrentTex);
+				CalculateTexSize(state->CurrentTex);
 				
 				// gsDPLoadTextureBlock / gsDPLoadMultiBlock
-				uint32_t addr = Textures(CurrentTex).Dram;
-				int siz = Textures(CurrentTex).TexelSize;
-				uint32_t width = Textures(CurrentTex).RealWidth;
-				uint32_t height = Textures(CurrentTex).RealHeight;
+				uint32_t addr = Textures(state->CurrentTex).Dram;
+				int siz = Textures(state->CurrentTex).TexelSize;
+				uint32_t width = Textures(state->CurrentTex).RealWidth;
+				uint32_t height = Textures(state->CurrentTex).RealHeight;
 				
 				// allows texture data blobs from unpopulated external segments, for flipbooks
 				if ((realAddr = DataBlobSegmentAddressToRealAddress(addr)) || true)
 				{
-					int lineSize = Textures(CurrentTex).LineSize;
+					int lineSize = Textures(state->CurrentTex).LineSize;
 					size_t lineSizeBytes = lineSize * sizeof(uint64_t);
-					int trueWidth = (Textures(CurrentTex).Width >> 2) + 1; // width of tex within file
-					int trueHeight = (Textures(CurrentTex).Height >> 2) + 1; // height of tex within file
+					int trueWidth = (Textures(state->CurrentTex).Width >> 2) + 1; // width of tex within file
+					int trueHeight = (Textures(state->CurrentTex).Height >> 2) + 1; // height of tex within file
 					
 					if (trueWidth < 0) trueWidth = width;
 					if (trueHeight < 0) trueHeight = height;
@@ -1263,7 +1397,7 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 					if (size > 4096)
 						LogDebug("warning: width height %d x %d", trueWidth, trueHeight);
 					
-					blob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_TEXTURE, Textures(CurrentTex).DramRef);
+					blob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_TEXTURE, Textures(state->CurrentTex).DramRef);
 					
 					// extra safety
 					if (!blob)
@@ -1275,13 +1409,13 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 						blob->data.texture.w = width;
 						blob->data.texture.h = height;
 						blob->data.texture.siz = siz;
-						blob->data.texture.fmt = Textures(CurrentTex).TexFormat;
+						blob->data.texture.fmt = Textures(state->CurrentTex).TexFormat;
 						blob->data.texture.lineSize = lineSize;
 						
 						if (blob->data.texture.fmt == G_IM_FMT_CI
 							&& blob->data.texture.pal == 0
 						)
-							sb_push(needsPalettes, blob);
+							sb_push(state->needsPalettes, blob);
 					}
 					if (sizeBytesClamped > blob->data.texture.sizeBytesClamped)
 						blob->data.texture.sizeBytesClamped = sizeBytesClamped;
@@ -1298,7 +1432,7 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 					{
 						size_t size = ALIGN8(G_SIZ_BYTES(G_IM_SIZ_16b) * count);
 						
-						palBlob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_PALETTE, Textures(0).DramRef);
+						state->palBlob = DataBlobSegmentPush(realAddr, size, addr, DATA_BLOB_TYPE_PALETTE, Textures(0).DramRef);
 					}
 				}
 				break;
@@ -1322,25 +1456,25 @@ void DataBlobSegmentsPopulateFromMeshNew(uint32_t segAddr, void *originator)
 			}
 			
 			case G_RDPHALF_1:
-				gRdpHalf1 = w1;
-				gRdpHalf1w1addr = w1addr;
+				state->gRdpHalf1 = w1;
+				state->gRdpHalf1w1addr = w1addr;
 				break;
 			
 			case G_BRANCH_Z:
-				DataBlobSegmentsPopulateFromMeshNew(gRdpHalf1, gRdpHalf1w1addr);
+				DataBlobSegmentsPopulateFromMeshNew(state->gRdpHalf1, state->gRdpHalf1w1addr);
 				break;
 			
 			// game should be ready to draw at this point, so use
 			// this as an opportunity to resolve palette address
 			case G_TRI1:
 			case G_TRI2:
-				if (sb_count(needsPalettes))
+				if (sb_count(state->needsPalettes))
 				{
-					sb_foreach(needsPalettes, {
-						(*each)->data.texture.pal = palBlob;
+					sb_foreach(state->needsPalettes, {
+						(*each)->data.texture.pal = state->palBlob;
 					});
 					
-					sb_clear(needsPalettes);
+					sb_clear(state->needsPalettes);
 				}
 				break;
 			
@@ -1529,3 +1663,96 @@ void DataBlobPrintAll(struct DataBlob *blobs)
 	for (struct DataBlob *blob = blobs; blob; blob = blob->next)
 		DataBlobPrint(blob);
 }
+
+struct DataBlobArena *DataBlobArenaNew(void)
+{
+	struct DataBlobArena *arena = Calloc(1, sizeof(*arena));
+	
+	arena->refCount = 1;
+	
+	return arena;
+}
+
+// blobs can be handed from one scene to another, so a scene that took
+// some keeps the arena they came from alive until it is freed too
+struct DataBlobArena *DataBlobArenaRetain(struct DataBlobArena *arena)
+{
+	arena->refCount += 1;
+	
+	return arena;
+}
+
+// the blobs' own allocations (refData, callbacks) must already have been
+// released using DatablobFree() or DatablobFreeList()
+void DataBlobArenaRelease(struct DataBlobArena *arena)
+{
+	if (!arena || --arena->refCount > 0)
+		return;
+	
+	if (DataBlobContextCurrent()->arena == arena)
+		DataBlobContextCurrent()->arena = 0;
+	
+	sb_foreach(arena->blocks, { free(*each); })
+	sb_free(arena->blocks);
+	free(arena);
+}
+
+// new scene and room blobs are carved from this arena until it is unbound
+// again using DataBlobArenaBind(0)
+void DataBlobArenaBind(struct DataBlobArena *arena)
+{
+	DataBlobContextCurrent()->arena = arena;
+}
+
+struct DataBlobContext *DataBlobContextNew(void)
+{
+	return Calloc(1, sizeof(struct DataBlobContext));
+}
+
+// the blobs on its segments are not freed, as they belong to whoever set
+// the segments up; it is unbound if it's the calling thread's current one
+void DataBlobContextFree(struct DataBlobContext *ctx)
+{
+	if (!ctx)
+		return;
+	
+	if (gContext == ctx)
+		gContext = 0;
+	
+	sb_free(ctx->mesh.needsPalettes);
+	sb_free(ctx->meshNew.needsPalettes);
+	free(ctx);
+}
+
+// segment setup, lookups and pushes, the arena binding and what the display
+// list walkers track all go through the calling thread's current context
+// from here on, so a scene parsed on one thread can't disturb another's;
+// passing 0 returns to the thread's own default context, and the context
+// that was bound before is returned so it can be restored afterwards
+struct DataBlobContext *DataBlobContextBind(struct DataBlobContext *ctx)
+{
+	struct DataBlobContext *prev = DataBlobContextCurrent();
+	
+	gContext = ctx;
+	
+	return (prev == &gDefaultContext) ? 0 : prev;
+}
+
+struct DataBlob *DataBlobContextGetHead(struct DataBlobContext *ctx, int segmentIndex)
+{
+	if (!ctx || segmentIndex < 0 || segmentIndex >= ARRLEN(ctx->segments))
+		return 0;
+	
+	return ctx->segments[segmentIndex].head;
+}
+
+void DataBlobGetAllocCounts(struct DataBlobAllocCounts *dst)
+{
+	*dst = (struct DataBlobAllocCounts){
+		.heapBlobs = __atomic_load_n(&gAllocCounts.heapBlobs, __ATOMIC_RELAXED),
+		.heapRefArrays = __atomic_load_n(&gAllocCounts.heapRefArrays, __ATOMIC_RELAXED),
+		.arenaBlobs = __atomic_load_n(&gAllocCounts.arenaBlobs, __ATOMIC_RELAXED),
+		.arenaRefArrays = __atomic_load_n(&gAllocCounts.arenaRefArrays, __ATOMIC_RELAXED),
+		.arenaBlocks = __atomic_load_n(&gAllocCounts.arenaBlocks, __ATOMIC_RELAXED),
+	};
+}
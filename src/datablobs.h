@@ -74,6 +74,7 @@ struct DataBlob
 	enum DataBlobSubtype subtype;
 	bool ownsRefData;
 	sb_array(void*, refs); // references to this datablob
+	struct DataBlobArena *arena; // what this was carved from, or 0 if on the heap
 	
 	union {
 		struct {
@@ -108,6 +109,25 @@ struct TextureBlob
 };
 #define TextureBlobStack(DATA, FILE) (struct TextureBlob){ DATA, FILE }
 
+// a scene's blobs and their ref arrays are carved out of arenas like these,
+// which free everything in them at once; see DataBlobArenaBind()
+struct DataBlobArena;
+
+// the segment table and arena binding that the DataBlobSegment*() functions
+// use, along with the texture state tracked while walking display lists;
+// each scene gets its own, see DataBlobContextBind()
+struct DataBlobContext;
+
+// how blobs have been allocated since startup
+struct DataBlobAllocCounts
+{
+	int heapBlobs;
+	int heapRefArrays; // each allocation or reallocation
+	int arenaBlobs;
+	int arenaRefArrays;
+	int arenaBlocks; // the only allocations the arenas make
+};
+
 // functions
 struct DataBlob *DataBlobNew(
 	const void *refData
@@ -151,5 +171,14 @@ void DataBlobApplyUpdatedSegmentAddresses(struct DataBlob *blob);
 void DataBlobApplyOriginalSegmentAddresses(struct DataBlob *blob);
 uint8_t *DataBlobToTruecolor(struct DataBlob *blob, int *width, int *height, uint8_t *optionalDst);
 void DataBlobListMakeTextureBank(struct DataBlob *listHead, FILE *file, FILE *recipe, char *texpath);
+struct DataBlobArena *DataBlobArenaNew(void);
+struct DataBlobArena *DataBlobArenaRetain(struct DataBlobArena *arena);
+void DataBlobArenaRelease(struct DataBlobArena *arena);
+void DataBlobArenaBind(struct DataBlobArena *arena);
+void DataBlobGetAllocCounts(struct DataBlobAllocCounts *dst);
+struct DataBlobContext *DataBlobContextNew(void);
+void DataBlobContextFree(struct DataBlobContext *ctx);
+struct DataBlobContext *DataBlobContextBind(struct DataBlobContext *ctx);
+struct DataBlob *DataBlobContextGetHead(struct DataBlobContext *ctx, int segmentIndex);
 
 #endif
@@ -0,0 +1,2743 @@
+/*
+ * fast64-compile.c
+ *
+ * in-process compiler for the subset of C that Fast64 emits
+ *
+ * scene and room sources are nothing more than static arrays of
+ * gsSP/gsDP macros, Vtx, u64 texture includes, and scene command
+ * macros, so they are tokenized, preprocessed, and laid out here
+ * following the same rules as the z64ovl.ld linker script in fast64.c
+ * (.data followed by .rodata, starting at ENTRY_POINT), then written
+ * as a big-endian binary; this replaces the mips64 gcc/ld/objcopy
+ * round trip and the process spawns that came with it
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+
+#include "logging.h"
+#include "fast64.h"
+#include "file.h"
+#include "misc.h"
+
+#define CC_MAX_INCLUDE_DEPTH 32
+#define CC_MAX_MACRO_ARGS 32
+#define CC_MAX_GBI_ARGS 16
+#define CC_MAX_GBI_EXPANSION 16
+#define CC_SIZEOF_GFX 8
+
+#define CC_ALIGN(X, A) (((X) + ((A) - 1)) & ~((A) - 1))
+#define CC_ARRAY_COUNT(X) (sizeof(X) / sizeof(*(X)))
+
+// display list commands are written out word by word
+_Static_assert(sizeof(GbiGfx) == CC_SIZEOF_GFX, "GbiGfx must be two 32-bit words");
+
+#if 1 // region: types
+
+enum CcTokenType
+{
+	CC_TOKEN_EOF,
+	CC_TOKEN_IDENT,
+	CC_TOKEN_NUMBER,
+	CC_TOKEN_STRING,
+	CC_TOKEN_CHAR,
+	CC_TOKEN_PUNCT,
+};
+
+struct CcToken
+{
+	const char *text;
+	const char *file;
+	int len;
+	int line;
+	uint8_t type;
+	bool bol; // first token on its line
+	bool space; // preceded by whitespace
+};
+
+struct CcMacro
+{
+	sb_array(struct CcToken, params);
+	sb_array(struct CcToken, body);
+	bool isFunction;
+	bool isVariadic;
+	bool isActive; // currently being expanded
+};
+
+struct CcHashEntry
+{
+	char *key;
+	void *udata;
+	int64_t value;
+};
+
+struct CcHash
+{
+	struct CcHashEntry *entries;
+	int capacity; // power of two
+	int count;
+};
+
+struct CcValue
+{
+	int64_t i;
+	double f;
+	uint32_t stride; // non-zero for addresses, size of what they point to
+	bool isFloat;
+	bool isDouble;
+};
+
+struct CcObject
+{
+	char *name;
+	const char *item; // layout of one element
+	uint32_t address;
+	int elementSize;
+	int align;
+	int declaredCount; // from [N], 0 if unsized
+	int count;
+	int initStart; // token index of initializer, or -1
+	bool isArray;
+	bool isConst;
+};
+
+struct Cc
+{
+	jmp_buf *bail;
+	sb_array(struct CcToken, tokens);
+	sb_array(struct CcObject *, objects);
+	sb_array(char *, strings); // owned text referenced by tokens
+	sb_array(uint8_t, conds); // #if stack, see CcIsEmitting()
+	struct CcHash macros;
+	struct CcHash values; // linker symbols
+	struct CcHash objectsByName;
+	const struct CcToken *in; // parser input
+	int inCount;
+	int pos;
+	int includeDepth;
+	const char *root;
+	uint32_t base;
+	uint8_t *image;
+	uint32_t imageSize;
+	bool dryRun; // unresolved identifiers are 0 and nothing is written
+	bool quiet; // failures longjmp without a message
+	bool isCondition; // unresolved identifiers are 0 (#if)
+};
+
+// layout of one element of a type, as a string of items:
+//  b/h/w/d  8/16/32/64-bit integer (or 32-bit pointer for w)
+//  f        32-bit float
+//  g        display list command (Gfx)
+//  x        padding byte (not initialized)
+//  {...}    brace-enclosed aggregate (struct, union member, array member)
+// unions are described by their first member, as that is the one a
+// brace-enclosed initializer targets
+#define CC_LIGHTS "{{{{bbb}b{bbb}b}}{{{{bbb}b{bbb}b{bbb}b}xxxx}}}"
+#define CC_ENVLIGHTSETTINGS "{{bbb}{bbb}{bbb}{bbb}{bbb}{bbb}hh}"
+#define CC_ROOMSHAPE "{bbww}"
+#define CC_ROOMSHAPECULLABLEENTRY "{{hhh}hww}"
+static const struct CcType
+{
+	const char *name;
+	const char *item;
+	int align; // 0 = derived from the layout
+} sCcTypes[] = {
+	{ "u8", "b" }, { "s8", "b" }, { "uint8_t", "b" }, { "int8_t", "b" },
+	{ "u16", "h" }, { "s16", "h" }, { "uint16_t", "h" }, { "int16_t", "h" },
+	{ "u32", "w" }, { "s32", "w" }, { "uint32_t", "w" }, { "int32_t", "w" },
+	{ "uintptr_t", "w" }, { "intptr_t", "w" },
+	{ "u64", "d" }, { "s64", "d" }, { "uint64_t", "d" }, { "int64_t", "d" },
+	{ "f32", "f" },
+	{ "Gfx", "g" },
+	{ "Vtx", "{{{hhh}h{hh}{bbbb}}}", 8 },
+	{ "Lights0", CC_LIGHTS, 8 },
+	{ "Lights1", CC_LIGHTS, 8 },
+	{ "Vec3s", "{hhh}" },
+	{ "Vec3i", "{www}" },
+	{ "Vec3f", "{fff}" },
+	{ "SceneCmd", "{bbw}" },
+	{ "RomFile", "{ww}" },
+	{ "ActorEntry", "{h{hhh}{hhh}h}" },
+	{ "TransitionActorEntry", "{{{bb}{bb}}h{hhh}hh}" },
+	{ "Spawn", "{bb}" },
+	{ "EntranceEntry", "{bb}" },
+	{ "EnvLightSettings", CC_ENVLIGHTSETTINGS },
+	{ "LightSettings", CC_ENVLIGHTSETTINGS },
+	{ "SurfaceType", "{ww}" },
+	{ "CollisionPoly", "{h{hhh}{hhh}h}" },
+	{ "CollisionHeader", "{{hhh}{hhh}hwhwwwhw}" },
+	{ "BgCamInfo", "{hhw}" },
+	{ "CamData", "{hhw}" },
+	{ "WaterBox", "{hhhhhw}" },
+	{ "Path", "{bw}" },
+	{ "RoomShapeNormal", CC_ROOMSHAPE },
+	{ "RoomShapeCullable", CC_ROOMSHAPE },
+	{ "MeshHeader0", CC_ROOMSHAPE },
+	{ "MeshHeader2", CC_ROOMSHAPE },
+	{ "PolygonType0", CC_ROOMSHAPE },
+	{ "PolygonType2", CC_ROOMSHAPE },
+	{ "RoomShapeDListsEntry", "{ww}" },
+	{ "PolygonDlist", "{ww}" },
+	{ "RoomShapeCullableEntry", CC_ROOMSHAPECULLABLEENTRY },
+	{ "PolygonDlist2", CC_ROOMSHAPECULLABLEENTRY },
+};
+
+// scene commands and the other decomp macros Fast64 output relies on;
+// these mirror the definitions in the decomp's headers, which are not
+// parsed beyond the constants they provide (see CcLoadDecompConstants)
+static const char *sCcBuiltins = R"(
+#define NULL 0
+#define true 1
+#define false 0
+#define ALIGNED8 __attribute__((aligned(8)))
+#define ALIGNED(n) __attribute__((aligned(n)))
+#define _SHIFTL(v, s, w) (((u32)(v) & ((0x01 << (w)) - 1)) << (s))
+#define CMD_BBBB(a, b, c, d) (_SHIFTL(a, 24, 8) | _SHIFTL(b, 16, 8) | _SHIFTL(c, 8, 8) | _SHIFTL(d, 0, 8))
+#define CMD_BBH(a, b, c) (_SHIFTL(a, 24, 8) | _SHIFTL(b, 16, 8) | _SHIFTL(c, 0, 16))
+#define CMD_HBB(a, b, c) (_SHIFTL(a, 16, 16) | _SHIFTL(b, 8, 8) | _SHIFTL(c, 0, 8))
+#define CMD_HH(a, b) (_SHIFTL(a, 16, 16) | _SHIFTL(b, 0, 16))
+#define CMD_W(a) (a)
+#define CMD_PTR(a) (u32)(a)
+#define SEGMENT_ROM_START(name) _ ## name ## SegmentRomStart
+#define SEGMENT_ROM_END(name) _ ## name ## SegmentRomEnd
+#define ROM_FILE(name) { SEGMENT_ROM_START(name), SEGMENT_ROM_END(name) }
+#define ROM_FILE_EMPTY(name) { 0, 0 }
+#define ROM_FILE_UNSET { 0, 0 }
+#define M_PI 3.14159265358979323846f
+#define SHT_MAX 32767.0f
+#define COLPOLY_SNORMAL(x) ((s16)((x) * SHT_MAX))
+#define TRUNCF_BINANG(f) (s16)(s32)(f)
+#define DEG_TO_BINANG(degrees) TRUNCF_BINANG((degrees) * (0x8000 / 180.0f))
+#define RAD_TO_BINANG(radians) TRUNCF_BINANG((radians) * (0x8000 / M_PI))
+#define gdSPDefLights0(ar, ag, ab) \
+	{ {{ {ar, ag, ab}, 0, {ar, ag, ab}, 0 }}, {{{ {0, 0, 0}, 0, {0, 0, 0}, 0, {0, 0, 0}, 0 }}} }
+#define gdSPDefLights1(ar, ag, ab, r1, g1, b1, x1, y1, z1) \
+	{ {{ {ar, ag, ab}, 0, {ar, ag, ab}, 0 }}, {{{ {r1, g1, b1}, 0, {r1, g1, b1}, 0, {x1, y1, z1}, 0 }}} }
+#define SCENE_CMD_SPAWN_LIST(numSpawns, spawnList) { 0x00, numSpawns, CMD_PTR(spawnList) }
+#define SCENE_CMD_ACTOR_LIST(numActors, actorList) { 0x01, numActors, CMD_PTR(actorList) }
+#define SCENE_CMD_UNUSED_02(unk, data) { 0x02, 0, CMD_PTR(data) }
+#define SCENE_CMD_COL_HEADER(colHeader) { 0x03, 0, CMD_PTR(colHeader) }
+#define SCENE_CMD_ROOM_LIST(numRooms, roomList) { 0x04, numRooms, CMD_PTR(roomList) }
+#define SCENE_CMD_WIND_SETTINGS(xDir, yDir, zDir, strength) { 0x05, 0, CMD_BBBB(xDir, yDir, zDir, strength) }
+#define SCENE_CMD_ENTRANCE_LIST(entranceList) { 0x06, 0, CMD_PTR(entranceList) }
+#define SCENE_CMD_SPECIAL_FILES(naviQuestHintFileId, keepObjectId) { 0x07, naviQuestHintFileId, CMD_W(keepObjectId) }
+#define SCENE_CMD_ROOM_BEHAVIOR(curRoomUnk3, curRoomUnk2, showInvisActors, disableWarpSongs) \
+	{ 0x08, curRoomUnk3, curRoomUnk2 | _SHIFTL(showInvisActors, 8, 1) | _SHIFTL(disableWarpSongs, 10, 1) }
+#define SCENE_CMD_UNK_09() { 0x09, 0, CMD_W(0) }
+#define SCENE_CMD_ROOM_SHAPE(roomShape) { 0x0A, 0, CMD_PTR(roomShape) }
+#define SCENE_CMD_MESH(meshHeader) { 0x0A, 0, CMD_PTR(meshHeader) }
+#define SCENE_CMD_OBJECT_LIST(numObjects, objectList) { 0x0B, numObjects, CMD_PTR(objectList) }
+#define SCENE_CMD_LIGHT_LIST(numLights, lightList) { 0x0C, numLights, CMD_PTR(lightList) }
+#define SCENE_CMD_PATH_LIST(pathList) { 0x0D, 0, CMD_PTR(pathList) }
+#define SCENE_CMD_TRANSITION_ACTOR_LIST(numTransitionActors, transitionActorList) \
+	{ 0x0E, numTransitionActors, CMD_PTR(transitionActorList) }
+#define SCENE_CMD_ENV_LIGHT_SETTINGS(numLightSettings, lightSettingsList) { 0x0F, numLightSettings, CMD_PTR(lightSettingsList) }
+#define SCENE_CMD_TIME_SETTINGS(hour, min, timeSpeed) { 0x10, 0, CMD_BBBB(hour, min, timeSpeed, 0) }
+#define SCENE_CMD_SKYBOX_SETTINGS(skyboxId, skyboxConfig, envLightMode) { 0x11, 0, CMD_BBBB(skyboxId, skyboxConfig, envLightMode, 0) }
+#define SCENE_CMD_SKYBOX_DISABLES(disableSky, disableSunMoon) { 0x12, 0, CMD_BBBB(disableSky, disableSunMoon, 0, 0) }
+#define SCENE_CMD_EXIT_LIST(exitList) { 0x13, 0, CMD_PTR(exitList) }
+#define SCENE_CMD_END() { 0x14, 0, CMD_W(0) }
+#define SCENE_CMD_SOUND_SETTINGS(specId, natureAmbienceId, seqId) { 0x15, specId, CMD_BBBB(0, 0, natureAmbienceId, seqId) }
+#define SCENE_CMD_ECHO_SETTINGS(echo) { 0x16, 0, CMD_BBBB(0, 0, 0, echo) }
+#define SCENE_CMD_CUTSCENE_DATA(cutsceneData) { 0x17, 0, CMD_PTR(cutsceneData) }
+#define SCENE_CMD_ALTERNATE_HEADER_LIST(alternateHeaderList) { 0x18, 0, CMD_PTR(alternateHeaderList) }
+#define SCENE_CMD_MISC_SETTINGS(sceneCamType, worldMapLocation) { 0x19, sceneCamType, CMD_W(worldMapLocation) }
+)";
+
+#endif // endregion
+
+#if 1 // region: private helpers
+
+static struct CcToken sCcEof = { .text = "end of file", .len = 11, .file = "", .type = CC_TOKEN_EOF };
+static char sCcError[2048];
+
+// constants scanned from the decomp's include/ folder, kept across
+// compilations since the scene and every room share the same root
+static struct
+{
+	char *root;
+	struct CcHash constants;
+} sCcDecomp;
+
+static void CcFail(struct Cc *cc, const struct CcToken *at, const char *fmt, ...) __attribute__ ((format (printf, 3, 4), noreturn));
+
+static void CcFail(struct Cc *cc, const struct CcToken *at, const char *fmt, ...)
+{
+	if (!cc->quiet)
+	{
+		va_list args;
+		int len = 0;
+
+		if (!at)
+			at = (cc->in && cc->pos < cc->inCount) ? &cc->in[cc->pos] : &sCcEof;
+		if (at->file && *at->file)
+			len = snprintf(sCcError, sizeof(sCcError), "%s:%d: ", at->file, at->line);
+
+		va_start(args, fmt);
+			vsnprintf(sCcError + len, sizeof(sCcError) - len, fmt, args);
+		va_end(args);
+	}
+
+	longjmp(*cc->bail, 1);
+}
+
+static char *CcStrndup(const char *str, int len)
+{
+	char *result = malloc(len + 1);
+
+	memcpy(result, str, len);
+	result[len] = '\0';
+
+	return result;
+}
+
+// keeps a string alive for as long as the compiler
+static char *CcOwn(struct Cc *cc, char *str)
+{
+	sb_push(cc->strings, str);
+
+	return str;
+}
+
+static char *CcReadText(const char *path)
+{
+	FILE *fp = fopen(path, "rb");
+	char *result;
+	long size;
+
+	if (!fp)
+		return 0;
+
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	result = malloc(size + 1);
+	if (size > 0 && fread(result, 1, size, fp) != (size_t)size)
+	{
+		free(result);
+		fclose(fp);
+		return 0;
+	}
+	result[size] = '\0';
+	fclose(fp);
+
+	return result;
+}
+
+static bool CcTokenIs(const struct CcToken *tok, const char *text)
+{
+	return tok->type != CC_TOKEN_EOF
+		&& !strncmp(tok->text, text, tok->len)
+		&& !text[tok->len]
+	;
+}
+
+static bool CcTokenIsUpperIdent(const struct CcToken *tok)
+{
+	if (tok->type != CC_TOKEN_IDENT || !isupper(tok->text[0]))
+		return false;
+
+	for (int i = 0; i < tok->len; ++i)
+		if (!isupper(tok->text[i]) && !isdigit(tok->text[i]) && tok->text[i] != '_')
+			return false;
+
+	return true;
+}
+
+static uint32_t CcHashString(const char *str, int len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (int i = 0; i < len; ++i)
+		hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+
+	return hash;
+}
+
+static struct CcHashEntry *CcHashFind(struct CcHash *hash, const char *key, int len, bool create)
+{
+	if (create && (hash->count + 1) * 2 > hash->capacity)
+	{
+		struct CcHash grown = { .capacity = MAX(256, hash->capacity * 2) };
+
+		grown.entries = Calloc(grown.capacity, sizeof(*grown.entries));
+		for (int i = 0; i < hash->capacity; ++i)
+		{
+			struct CcHashEntry *old = &hash->entries[i];
+			uint32_t slot;
+
+			if (!old->key)
+				continue;
+
+			for (slot = CcHashString(old->key, strlen(old->key)) & (grown.capacity - 1)
+				; grown.entries[slot].key
+				; slot = (slot + 1) & (grown.capacity - 1)
+			);
+			grown.entries[slot] = *old;
+		}
+		grown.count = hash->count;
+		free(hash->entries);
+		*hash = grown;
+	}
+
+	if (!hash->capacity)
+		return 0;
+
+	for (uint32_t slot = CcHashString(key, len) & (hash->capacity - 1)
+		; ; slot = (slot + 1) & (hash->capacity - 1)
+	)
+	{
+		struct CcHashEntry *entry = &hash->entries[slot];
+
+		if (!entry->key)
+		{
+			if (!create)
+				return 0;
+
+			entry->key = CcStrndup(key, len);
+			hash->count += 1;
+			return entry;
+		}
+
+		if (!strncmp(entry->key, key, len) && !entry->key[len])
+			return entry;
+	}
+}
+
+static void CcHashFree(struct CcHash *hash, void (*freeUdata)(void *udata))
+{
+	for (int i = 0; i < hash->capacity; ++i)
+	{
+		struct CcHashEntry *entry = &hash->entries[i];
+
+		if (!entry->key)
+			continue;
+
+		if (freeUdata && entry->udata)
+			freeUdata(entry->udata);
+		free(entry->key);
+	}
+
+	free(hash->entries);
+	memset(hash, 0, sizeof(*hash));
+}
+
+static void CcMacroFree(void *udata)
+{
+	struct CcMacro *macro = udata;
+
+	sb_free(macro->params);
+	sb_free(macro->body);
+	free(macro);
+}
+
+#endif // endregion
+
+#if 1 // region: lexer
+
+static bool CcIsIdentChar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+static void CcLex(struct Cc *cc, const char *src, const char *file, sb_array(struct CcToken, *out))
+{
+	static const char *puncts[] = {
+		"...", "<<=", ">>=",
+		"##", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||", "->", "++", "--",
+		"+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=",
+	};
+	bool bol = true;
+	bool space = false;
+	int line = 1;
+
+	while (*src)
+	{
+		struct CcToken tok = { .text = src, .file = file, .line = line, .bol = bol, .space = space };
+
+		// whitespace, line continuations, comments
+		if (*src == '\n')
+		{
+			bol = true;
+			space = true;
+			++line;
+			++src;
+			continue;
+		}
+		if (isspace((unsigned char)*src))
+		{
+			space = true;
+			++src;
+			continue;
+		}
+		if (*src == '\\' && (src[1] == '\n' || (src[1] == '\r' && src[2] == '\n')))
+		{
+			src += (src[1] == '\r') ? 3 : 2;
+			space = true;
+			++line;
+			continue;
+		}
+		if (src[0] == '/' && src[1] == '/')
+		{
+			while (*src && *src != '\n')
+				++src;
+			space = true;
+			continue;
+		}
+		if (src[0] == '/' && src[1] == '*')
+		{
+			for (src += 2; *src && !(src[0] == '*' && src[1] == '/'); ++src)
+				if (*src == '\n')
+					++line;
+			if (*src)
+				src += 2;
+			space = true;
+			continue;
+		}
+
+		if (isalpha((unsigned char)*src) || *src == '_')
+		{
+			tok.type = CC_TOKEN_IDENT;
+			while (CcIsIdentChar(*src))
+				++src;
+		}
+		else if (isdigit((unsigned char)*src) || (*src == '.' && isdigit((unsigned char)src[1])))
+		{
+			// preprocessing number
+			tok.type = CC_TOKEN_NUMBER;
+			for (++src; ; ++src)
+			{
+				if (strchr("eEpP", src[-1]) && (*src == '+' || *src == '-'))
+					continue;
+				if (!CcIsIdentChar(*src) && *src != '.')
+					break;
+			}
+		}
+		else if (*src == '"' || *src == '\'')
+		{
+			char quote = *src;
+
+			tok.type = (quote == '"') ? CC_TOKEN_STRING : CC_TOKEN_CHAR;
+			for (++src; *src && *src != quote && *src != '\n'; ++src)
+				if (*src == '\\' && src[1])
+					++src;
+			if (*src != quote)
+			{
+				tok.len = 1;
+				CcFail(cc, &tok, "unterminated literal");
+			}
+			++src;
+		}
+		else
+		{
+			tok.type = CC_TOKEN_PUNCT;
+			src += 1;
+			for (int i = 0; i < CC_ARRAY_COUNT(puncts); ++i)
+			{
+				if (!strncmp(tok.text, puncts[i], strlen(puncts[i])))
+				{
+					src = tok.text + strlen(puncts[i]);
+					break;
+				}
+			}
+		}
+
+		tok.len = src - tok.text;
+		sb_push(*out, tok);
+		bol = false;
+		space = false;
+	}
+}
+
+#endif // endregion
+
+#if 1 // region: expressions
+
+static const struct CcToken *CcPeek(struct Cc *cc)
+{
+	return (cc->pos < cc->inCount) ? &cc->in[cc->pos] : &sCcEof;
+}
+
+static const struct CcToken *CcNext(struct Cc *cc)
+{
+	const struct CcToken *tok = CcPeek(cc);
+
+	if (cc->pos < cc->inCount)
+		cc->pos += 1;
+
+	return tok;
+}
+
+static bool CcPeekIs(struct Cc *cc, const char *text)
+{
+	return CcTokenIs(CcPeek(cc), text);
+}
+
+static bool CcAccept(struct Cc *cc, const char *text)
+{
+	if (!CcPeekIs(cc, text))
+		return false;
+
+	cc->pos += 1;
+	return true;
+}
+
+static void CcExpect(struct Cc *cc, const char *text)
+{
+	const struct CcToken *tok = CcPeek(cc);
+
+	if (!CcAccept(cc, text))
+		CcFail(cc, tok, "expected '%s' before '%.*s'", text, tok->len, tok->text);
+}
+
+static const struct CcToken *CcExpectIdent(struct Cc *cc)
+{
+	const struct CcToken *tok = CcNext(cc);
+
+	if (tok->type != CC_TOKEN_IDENT)
+		CcFail(cc, tok, "expected identifier before '%.*s'", tok->len, tok->text);
+
+	return tok;
+}
+
+static bool CcLookupValue(struct Cc *cc, const struct CcToken *tok, int64_t *value)
+{
+	struct CcHashEntry *entry;
+
+	if ((entry = CcHashFind(&cc->values, tok->text, tok->len, false))
+		|| (entry = CcHashFind(&sCcDecomp.constants, tok->text, tok->len, false))
+	)
+	{
+		*value = entry->value;
+		return true;
+	}
+
+	return false;
+}
+
+static struct CcObject *CcLookupObject(struct Cc *cc, const struct CcToken *tok)
+{
+	struct CcHashEntry *entry = CcHashFind(&cc->objectsByName, tok->text, tok->len, false);
+
+	return entry ? entry->udata : 0;
+}
+
+static const struct CcType *CcLookupType(const struct CcToken *tok)
+{
+	for (int i = 0; i < CC_ARRAY_COUNT(sCcTypes); ++i)
+		if (CcTokenIs(tok, sCcTypes[i].name))
+			return &sCcTypes[i];
+
+	return 0;
+}
+
+static bool CcIsPrimitiveKeyword(const struct CcToken *tok)
+{
+	static const char *keywords[] = {
+		"void", "char", "short", "int", "long", "float", "double", "signed", "unsigned",
+	};
+
+	for (int i = 0; i < CC_ARRAY_COUNT(keywords); ++i)
+		if (CcTokenIs(tok, keywords[i]))
+			return true;
+
+	return false;
+}
+
+static bool CcIsTypeName(const struct CcToken *tok)
+{
+	return tok->type == CC_TOKEN_IDENT
+		&& (CcLookupType(tok) || CcIsPrimitiveKeyword(tok) || CcTokenIs(tok, "const"))
+	;
+}
+
+static struct CcValue CcInt(int64_t i)
+{
+	return (struct CcValue){ .i = i };
+}
+
+static int64_t CcToInt(struct CcValue v)
+{
+	return v.isFloat ? (int64_t)v.f : v.i;
+}
+
+static double CcToFloat(struct CcValue v)
+{
+	return v.isFloat ? v.f : (double)v.i;
+}
+
+static bool CcIsTrue(struct CcValue v)
+{
+	return v.isFloat ? (v.f != 0) : (v.i != 0);
+}
+
+static struct CcValue CcParseExpr(struct Cc *cc);
+static struct CcValue CcParseUnary(struct Cc *cc, bool addressOf);
+
+static struct CcValue CcParseNumber(struct Cc *cc, const struct CcToken *tok)
+{
+	struct CcValue result = {0};
+	char buf[128];
+	char *end;
+	bool isHex;
+	int len = tok->len;
+
+	if (len >= sizeof(buf))
+		CcFail(cc, tok, "number too long");
+
+	memcpy(buf, tok->text, len);
+	buf[len] = '\0';
+	isHex = buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X');
+
+	if (!isHex && (strpbrk(buf, ".eE") || strchr("fF", buf[len - 1])))
+	{
+		result.isFloat = true;
+		result.isDouble = true;
+		if (strchr("fF", buf[len - 1]))
+		{
+			buf[--len] = '\0';
+			result.isDouble = false;
+		}
+		else if (strchr("lL", buf[len - 1]))
+			buf[--len] = '\0';
+		result.f = strtod(buf, &end);
+		if (!result.isDouble)
+			result.f = (float)result.f;
+	}
+	else
+	{
+		result.i = strtoull(buf, &end, 0);
+		while (*end && strchr("uUlL", *end))
+			++end;
+	}
+
+	if (*end)
+		CcFail(cc, tok, "invalid number '%s'", buf);
+
+	return result;
+}
+
+static struct CcValue CcParseChar(struct Cc *cc, const struct CcToken *tok)
+{
+	const char *c = tok->text + 1;
+
+	if (*c != '\\')
+		return CcInt((uint8_t)*c);
+
+	switch (c[1])
+	{
+		case 'n': return CcInt('\n');
+		case 't': return CcInt('\t');
+		case 'r': return CcInt('\r');
+		case '0': return CcInt(strtol(c + 1, 0, 8));
+		case 'x': return CcInt(strtol(c + 2, 0, 16));
+		default: return CcInt((uint8_t)c[1]);
+	}
+}
+
+// after a '(' that begins a cast, returns the converted operand
+static struct CcValue CcParseCast(struct Cc *cc)
+{
+	const struct CcToken *start = CcPeek(cc);
+	struct CcValue v;
+	bool isPointer = false;
+	bool isUnsigned = false;
+	bool isFloat = false;
+	bool isDouble = false;
+	bool isStruct = false;
+	int width = 32;
+	int longs = 0;
+
+	while (!CcAccept(cc, ")"))
+	{
+		const struct CcToken *tok = CcNext(cc);
+		const struct CcType *type;
+
+		if (CcTokenIs(tok, "*"))
+			isPointer = true;
+		else if (CcTokenIs(tok, "const") || CcTokenIs(tok, "signed"))
+			continue;
+		else if (CcTokenIs(tok, "unsigned"))
+			isUnsigned = true;
+		else if (CcTokenIs(tok, "char"))
+			width = 8;
+		else if (CcTokenIs(tok, "short"))
+			width = 16;
+		else if (CcTokenIs(tok, "long"))
+			width = (++longs == 2) ? 64 : 32;
+		else if (CcTokenIs(tok, "float"))
+			isFloat = true;
+		else if (CcTokenIs(tok, "double"))
+			isFloat = isDouble = true;
+		else if (CcTokenIs(tok, "int") || CcTokenIs(tok, "void"))
+			continue;
+		else if ((type = CcLookupType(tok)))
+		{
+			if (type->item[1])
+				isStruct = true;
+			else switch (type->item[0])
+			{
+				case 'b': width = 8; break;
+				case 'h': width = 16; break;
+				case 'w': width = 32; break;
+				case 'd': width = 64; break;
+				case 'f': isFloat = true; break;
+				default: isStruct = true; break;
+			}
+			isUnsigned = (tok->text[0] == 'u');
+		}
+		else
+			CcFail(cc, tok, "unsupported cast to '%.*s'", tok->len, tok->text);
+	}
+
+	v = CcParseUnary(cc, false);
+
+	if (isPointer)
+		return CcInt((uint32_t)CcToInt(v));
+
+	if (isStruct)
+		CcFail(cc, start, "unsupported cast to aggregate type");
+
+	if (isFloat)
+	{
+		double f = CcToFloat(v);
+
+		return (struct CcValue){
+			.f = isDouble ? f : (float)f,
+			.isFloat = true,
+			.isDouble = isDouble,
+		};
+	}
+
+	int64_t i = CcToInt(v);
+	switch (width)
+	{
+		case 8: return CcInt(isUnsigned ? (int64_t)(uint8_t)i : (int64_t)(int8_t)i);
+		case 16: return CcInt(isUnsigned ? (int64_t)(uint16_t)i : (int64_t)(int16_t)i);
+		case 32: return CcInt(isUnsigned ? (int64_t)(uint32_t)i : (int64_t)(int32_t)i);
+		default: return CcInt(i);
+	}
+}
+
+static struct CcValue CcParsePrimary(struct Cc *cc, bool addressOf)
+{
+	const struct CcToken *tok = CcNext(cc);
+	struct CcObject *obj;
+	struct CcValue result;
+	int64_t value;
+
+	switch (tok->type)
+	{
+		case CC_TOKEN_NUMBER:
+			return CcParseNumber(cc, tok);
+
+		case CC_TOKEN_CHAR:
+			return CcParseChar(cc, tok);
+
+		case CC_TOKEN_PUNCT:
+			if (CcTokenIs(tok, "("))
+			{
+				if (CcIsTypeName(CcPeek(cc)))
+					return CcParseCast(cc);
+
+				result = CcParseExpr(cc);
+				CcExpect(cc, ")");
+				return result;
+			}
+			break;
+
+		case CC_TOKEN_IDENT:
+			if (CcTokenIs(tok, "ARRAY_COUNT") || CcTokenIs(tok, "ARRAY_COUNTU"))
+			{
+				const struct CcToken *name;
+
+				CcExpect(cc, "(");
+				name = CcExpectIdent(cc);
+				CcExpect(cc, ")");
+
+				if ((obj = CcLookupObject(cc, name)) && obj->isArray)
+					return CcInt(obj->count);
+				if (cc->dryRun)
+					return CcInt(0);
+				CcFail(cc, name, "'%.*s' is not an array", name->len, name->text);
+			}
+
+			if ((obj = CcLookupObject(cc, tok)))
+			{
+				result = CcInt(obj->address);
+				result.stride = obj->elementSize;
+
+				// &array[index]
+				if (CcAccept(cc, "["))
+				{
+					if (!addressOf || !obj->isArray)
+						CcFail(cc, tok, "reading from '%.*s' is not supported", tok->len, tok->text);
+					result.i += CcToInt(CcParseExpr(cc)) * obj->elementSize;
+					CcExpect(cc, "]");
+				}
+				else if (addressOf && !obj->isArray)
+					result.stride = obj->elementSize;
+
+				if (CcPeekIs(cc, ".") || CcPeekIs(cc, "->"))
+					CcFail(cc, tok, "member access is not supported");
+
+				return result;
+			}
+
+			if (CcLookupValue(cc, tok, &value))
+				return CcInt(value);
+
+			if (cc->dryRun || cc->isCondition)
+			{
+				// skip the arguments of whatever this is
+				if (CcAccept(cc, "("))
+					for (int depth = 1; depth && CcPeek(cc)->type != CC_TOKEN_EOF; )
+					{
+						if (CcAccept(cc, "(")) ++depth;
+						else if (CcAccept(cc, ")")) --depth;
+						else CcNext(cc);
+					}
+				return CcInt(0);
+			}
+
+			CcFail(cc, tok, "undefined identifier '%.*s'", tok->len, tok->text);
+			break;
+
+		default:
+			break;
+	}
+
+	CcFail(cc, tok, "expected expression before '%.*s'", tok->len, tok->text);
+}
+
+static int CcSizeofType(struct Cc *cc, const struct CcToken *tok);
+
+static struct CcValue CcParseUnary(struct Cc *cc, bool addressOf)
+{
+	struct CcValue v;
+
+	if (CcAccept(cc, "-"))
+	{
+		v = CcParseUnary(cc, false);
+		if (v.isFloat)
+			v.f = -v.f;
+		else
+			v.i = -v.i;
+		v.stride = 0;
+		return v;
+	}
+	if (CcAccept(cc, "+"))
+		return CcParseUnary(cc, false);
+	if (CcAccept(cc, "~"))
+		return CcInt(~CcToInt(CcParseUnary(cc, false)));
+	if (CcAccept(cc, "!"))
+		return CcInt(!CcIsTrue(CcParseUnary(cc, false)));
+	if (CcAccept(cc, "&"))
+		return CcParseUnary(cc, true);
+	if (CcAccept(cc, "sizeof"))
+	{
+		const struct CcToken *tok;
+		struct CcObject *obj;
+		bool paren = CcAccept(cc, "(");
+		int size;
+
+		tok = CcExpectIdent(cc);
+		if ((obj = CcLookupObject(cc, tok)))
+			size = obj->elementSize * (obj->isArray ? obj->count : 1);
+		else
+			size = CcSizeofType(cc, tok);
+		while (paren && CcAccept(cc, "*"))
+			size = 4;
+		if (paren)
+			CcExpect(cc, ")");
+
+		return CcInt(size);
+	}
+
+	return CcParsePrimary(cc, addressOf);
+}
+
+static int CcBinaryPrecedence(const struct CcToken *tok)
+{
+	static const struct { const char *op; int prec; } ops[] = {
+		{ "||", 1 }, { "&&", 2 }, { "|", 3 }, { "^", 4 }, { "&", 5 },
+		{ "==", 6 }, { "!=", 6 },
+		{ "<", 7 }, { ">", 7 }, { "<=", 7 }, { ">=", 7 },
+		{ "<<", 8 }, { ">>", 8 },
+		{ "+", 9 }, { "-", 9 },
+		{ "*", 10 }, { "/", 10 }, { "%", 10 },
+	};
+
+	if (tok->type != CC_TOKEN_PUNCT)
+		return 0;
+
+	for (int i = 0; i < CC_ARRAY_COUNT(ops); ++i)
+		if (CcTokenIs(tok, ops[i].op))
+			return ops[i].prec;
+
+	return 0;
+}
+
+static struct CcValue CcApplyBinary(struct Cc *cc, const struct CcToken *op, struct CcValue a, struct CcValue b)
+{
+	char o0 = op->text[0];
+	char o1 = (op->len > 1) ? op->text[1] : '\0';
+
+	// address arithmetic is scaled by the size of what is pointed to
+	if ((o0 == '+' || o0 == '-') && !o1 && (a.stride || b.stride) && !a.isFloat && !b.isFloat)
+	{
+		if (o0 == '-' && a.stride && b.stride)
+			return CcInt((a.i - b.i) / a.stride);
+		if (a.stride)
+			return (struct CcValue){ .i = (o0 == '+') ? a.i + b.i * a.stride : a.i - b.i * a.stride, .stride = a.stride };
+		if (o0 == '+')
+			return (struct CcValue){ .i = b.i + a.i * b.stride, .stride = b.stride };
+	}
+
+	if (a.isFloat || b.isFloat)
+	{
+		double x = CcToFloat(a);
+		double y = CcToFloat(b);
+		bool isDouble = a.isDouble || b.isDouble;
+		struct CcValue r = { .isFloat = true, .isDouble = isDouble };
+
+		switch (o0)
+		{
+			case '+': r.f = x + y; break;
+			case '-': r.f = x - y; break;
+			case '*': r.f = x * y; break;
+			case '/': r.f = x / y; break;
+			case '<': return CcInt(o1 == '=' ? x <= y : x < y);
+			case '>': return CcInt(o1 == '=' ? x >= y : x > y);
+			case '=': return CcInt(x == y);
+			case '!': return CcInt(x != y);
+			case '&':
+			case '|':
+				if (o1 == o0)
+					return CcInt((o0 == '&') ? (x && y) : (x || y));
+				CcFail(cc, op, "invalid operands to '%.*s'", op->len, op->text);
+			default:
+				CcFail(cc, op, "invalid operands to '%.*s'", op->len, op->text);
+		}
+
+		// single precision math stays single precision, like gcc would do it
+		if (!isDouble)
+			r.f = (float)r.f;
+
+		return r;
+	}
+
+	int64_t x = a.i;
+	int64_t y = b.i;
+
+	switch (o0)
+	{
+		case '+': return CcInt(x + y);
+		case '-': return CcInt(x - y);
+		case '*': return CcInt(x * y);
+		case '/':
+		case '%':
+			if (!y)
+			{
+				if (cc->dryRun)
+					return CcInt(0);
+				CcFail(cc, op, "division by zero");
+			}
+			return CcInt((o0 == '/') ? x / y : x % y);
+		case '<':
+			if (o1 == '<') return CcInt((uint64_t)x << y);
+			return CcInt(o1 == '=' ? x <= y : x < y);
+		case '>':
+			if (o1 == '>') return CcInt(x >> y);
+			return CcInt(o1 == '=' ? x >= y : x > y);
+		case '=': return CcInt(x == y);
+		case '!': return CcInt(x != y);
+		case '&': return CcInt(o1 == '&' ? x && y : x & y);
+		case '|': return CcInt(o1 == '|' ? x || y : x | y);
+		case '^': return CcInt(x ^ y);
+	}
+
+	CcFail(cc, op, "unsupported operator '%.*s'", op->len, op->text);
+}
+
+static struct CcValue CcParseBinary(struct Cc *cc, int minPrecedence)
+{
+	struct CcValue lhs = CcParseUnary(cc, false);
+
+	for (;;)
+	{
+		const struct CcToken *op = CcPeek(cc);
+		int prec = CcBinaryPrecedence(op);
+
+		if (!prec || prec < minPrecedence)
+			return lhs;
+
+		cc->pos += 1;
+		lhs = CcApplyBinary(cc, op, lhs, CcParseBinary(cc, prec + 1));
+	}
+}
+
+static struct CcValue CcParseExpr(struct Cc *cc)
+{
+	struct CcValue cond = CcParseBinary(cc, 1);
+	struct CcValue a;
+	struct CcValue b;
+
+	if (!CcAccept(cc, "?"))
+		return cond;
+
+	a = CcParseExpr(cc);
+	CcExpect(cc, ":");
+	b = CcParseExpr(cc);
+
+	return CcIsTrue(cond) ? a : b;
+}
+
+static void CcSetInput(struct Cc *cc, const struct CcToken *in, int inCount)
+{
+	cc->in = in;
+	cc->inCount = inCount;
+	cc->pos = 0;
+}
+
+// evaluates a standalone token list, returns false on failure
+static bool CcTryEvaluate(struct Cc *cc, const struct CcToken *toks, int count, int64_t *value)
+{
+	const struct CcToken *in = cc->in;
+	int inCount = cc->inCount;
+	int pos = cc->pos;
+	bool quiet = cc->quiet;
+	jmp_buf *bail = cc->bail;
+	jmp_buf tryBail;
+	volatile bool ok = false;
+
+	cc->bail = &tryBail;
+	cc->quiet = true;
+	if (!setjmp(tryBail))
+	{
+		CcSetInput(cc, toks, count);
+		*value = CcToInt(CcParseExpr(cc));
+		ok = (CcPeek(cc)->type == CC_TOKEN_EOF);
+	}
+
+	cc->bail = bail;
+	cc->quiet = quiet;
+	cc->in = in;
+	cc->inCount = inCount;
+	cc->pos = pos;
+
+	return ok;
+}
+
+#endif // endregion
+
+#if 1 // region: preprocessor
+
+static void CcPreprocessText(struct Cc *cc, const char *text, const char *file);
+
+static struct CcMacro *CcLookupMacro(struct Cc *cc, const struct CcToken *tok)
+{
+	struct CcHashEntry *entry;
+
+	if (tok->type != CC_TOKEN_IDENT)
+		return 0;
+
+	entry = CcHashFind(&cc->macros, tok->text, tok->len, false);
+
+	return entry ? entry->udata : 0;
+}
+
+static int CcMacroParam(const struct CcMacro *macro, const struct CcToken *tok)
+{
+	if (tok->type != CC_TOKEN_IDENT)
+		return -1;
+
+	sb_foreach(macro->params, {
+		if (each->len == tok->len && !memcmp(each->text, tok->text, tok->len))
+			return eachIndex;
+	})
+
+	return -1;
+}
+
+static bool CcIsEmitting(struct Cc *cc)
+{
+	// 1 = taking this branch, 0 = not yet taken, 2 = already taken or parent skipped
+	sb_foreach(cc->conds, {
+		if (*each != 1)
+			return false;
+	})
+
+	return true;
+}
+
+static struct CcToken CcPaste(struct Cc *cc, const struct CcToken *a, const struct CcToken *b)
+{
+	struct CcToken result = *a;
+	char *text = malloc(a->len + b->len + 1);
+
+	memcpy(text, a->text, a->len);
+	memcpy(text + a->len, b->text, b->len);
+	text[a->len + b->len] = '\0';
+
+	result.text = CcOwn(cc, text);
+	result.len = a->len + b->len;
+	if (isdigit((unsigned char)*text))
+		result.type = CC_TOKEN_NUMBER;
+	else if (CcIsIdentChar(*text))
+		result.type = CC_TOKEN_IDENT;
+
+	return result;
+}
+
+static struct CcToken CcStringize(struct Cc *cc, const struct CcToken *toks, int count)
+{
+	struct CcToken result = { .type = CC_TOKEN_STRING };
+	int len = 2;
+	char *text;
+
+	for (int i = 0; i < count; ++i)
+		len += toks[i].len + 1;
+
+	text = CcOwn(cc, Calloc(1, len + 1));
+	strcat(text, "\"");
+	for (int i = 0; i < count; ++i)
+	{
+		if (i && toks[i].space)
+			strcat(text, " ");
+		strncat(text, toks[i].text, toks[i].len);
+	}
+	strcat(text, "\"");
+
+	result.text = text;
+	result.len = strlen(text);
+	if (count)
+	{
+		result.file = toks[0].file;
+		result.line = toks[0].line;
+	}
+
+	return result;
+}
+
+static void CcExpand(struct Cc *cc, const struct CcToken *toks, int count, int *index, sb_array(struct CcToken, *out));
+
+static void CcExpandAll(struct Cc *cc, const struct CcToken *toks, int count, sb_array(struct CcToken, *out))
+{
+	for (int i = 0; i < count; )
+		CcExpand(cc, toks, count, &i, out);
+}
+
+// expands the token at toks[*index] (and its arguments) into 'out'
+static void CcExpand(struct Cc *cc, const struct CcToken *toks, int count, int *index, sb_array(struct CcToken, *out))
+{
+	const struct CcToken *tok = &toks[*index];
+	struct CcMacro *macro = CcLookupMacro(cc, tok);
+	sb_array(struct CcToken, result) = 0;
+	int argStart[CC_MAX_MACRO_ARGS];
+	int argEnd[CC_MAX_MACRO_ARGS];
+	int argc = 0;
+
+	if (!macro
+		|| macro->isActive
+		|| (macro->isFunction && (*index + 1 >= count || !CcTokenIs(&toks[*index + 1], "(")))
+	)
+	{
+		sb_push(*out, *tok);
+		*index += 1;
+		return;
+	}
+
+	*index += 1;
+
+	// gather arguments
+	if (macro->isFunction)
+	{
+		int params = sb_count(macro->params);
+		int depth = 0;
+
+		*index += 1;
+		argStart[0] = *index;
+		for (;; *index += 1)
+		{
+			const struct CcToken *each;
+
+			if (*index >= count)
+				CcFail(cc, tok, "unterminated invocation of macro '%.*s'", tok->len, tok->text);
+
+			each = &toks[*index];
+			if (CcTokenIs(each, "("))
+				++depth;
+			else if (CcTokenIs(each, ")") && depth-- == 0)
+			{
+				argEnd[argc++] = *index;
+				*index += 1;
+				break;
+			}
+			else if (CcTokenIs(each, ",") && !depth
+				&& !(macro->isVariadic && argc + 1 >= params)
+			)
+			{
+				if (argc + 1 >= CC_MAX_MACRO_ARGS)
+					CcFail(cc, tok, "too many arguments to macro '%.*s'", tok->len, tok->text);
+				argEnd[argc++] = *index;
+				argStart[argc] = *index + 1;
+			}
+		}
+
+		// FOO() has no arguments rather than a single empty one
+		if (!params && argc == 1 && argStart[0] == argEnd[0])
+			argc = 0;
+
+		// empty __VA_ARGS__
+		if (macro->isVariadic && argc == params - 1)
+		{
+			argStart[argc] = argEnd[argc] = argEnd[argc - 1];
+			argc += 1;
+		}
+
+		if (argc != params)
+			CcFail(cc, tok, "macro '%.*s' expects %d arguments, got %d"
+				, tok->len, tok->text, params, argc
+			);
+	}
+
+	// substitute arguments
+	for (int k = 0; k < sb_count(macro->body); ++k)
+	{
+		const struct CcToken *each = &macro->body[k];
+		sb_array(struct CcToken, item) = 0;
+		int param = macro->isFunction ? CcMacroParam(macro, each) : -1;
+		bool pasteBefore = k > 0 && CcTokenIs(&macro->body[k - 1], "##");
+		bool pasteAfter = k + 1 < sb_count(macro->body) && CcTokenIs(&macro->body[k + 1], "##");
+
+		if (CcTokenIs(each, "##"))
+			continue;
+
+		if (macro->isFunction && CcTokenIs(each, "#") && k + 1 < sb_count(macro->body)
+			&& (param = CcMacroParam(macro, &macro->body[k + 1])) >= 0
+		)
+		{
+			sb_push(result, CcStringize(cc, toks + argStart[param], argEnd[param] - argStart[param]));
+			++k;
+			continue;
+		}
+
+		if (param < 0)
+			sb_push(item, *each);
+		else if (pasteBefore || pasteAfter)
+			for (int i = argStart[param]; i < argEnd[param]; ++i)
+				sb_push(item, toks[i]);
+		else
+			CcExpandAll(cc, toks + argStart[param], argEnd[param] - argStart[param], &item);
+
+		if (pasteBefore && sb_count(item) && sb_count(result))
+		{
+			struct CcToken pasted = CcPaste(cc, &sb_last(result), &item[0]);
+
+			sb_last(result) = pasted;
+			for (int i = 1; i < sb_count(item); ++i)
+				sb_push(result, item[i]);
+		}
+		else
+			sb_foreach(item, { sb_push(result, *each); })
+
+		sb_free(item);
+	}
+
+	// rescan
+	macro->isActive = true;
+	CcExpandAll(cc, result, sb_count(result), out);
+	macro->isActive = false;
+
+	sb_free(result);
+}
+
+static void CcDefine(struct Cc *cc, const struct CcToken *toks, int count)
+{
+	struct CcMacro *macro;
+	struct CcHashEntry *entry;
+	int i = 1;
+
+	if (count < 1 || toks[0].type != CC_TOKEN_IDENT)
+		CcFail(cc, toks, "invalid #define");
+
+	macro = Calloc(1, sizeof(*macro));
+
+	if (count > 1 && CcTokenIs(&toks[1], "(") && !toks[1].space)
+	{
+		macro->isFunction = true;
+		for (i = 2; i < count && !CcTokenIs(&toks[i], ")"); ++i)
+		{
+			if (CcTokenIs(&toks[i], ","))
+				continue;
+
+			if (CcTokenIs(&toks[i], "..."))
+			{
+				struct CcToken va = toks[i];
+
+				va.type = CC_TOKEN_IDENT;
+				va.text = "__VA_ARGS__";
+				va.len = strlen(va.text);
+				macro->isVariadic = true;
+				sb_push(macro->params, va);
+			}
+			else
+				sb_push(macro->params, toks[i]);
+		}
+		i += 1;
+	}
+
+	for (; i < count; ++i)
+		sb_push(macro->body, toks[i]);
+
+	entry = CcHashFind(&cc->macros, toks[0].text, toks[0].len, true);
+	if (entry->udata)
+		CcMacroFree(entry->udata);
+	entry->udata = macro;
+}
+
+static bool CcEvaluateCondition(struct Cc *cc, const struct CcToken *toks, int count)
+{
+	static const struct CcToken one = { .text = "1", .len = 1, .type = CC_TOKEN_NUMBER };
+	static const struct CcToken zero = { .text = "0", .len = 1, .type = CC_TOKEN_NUMBER };
+	sb_array(struct CcToken, resolved) = 0;
+	sb_array(struct CcToken, expanded) = 0;
+	const struct CcToken *in = cc->in;
+	int inCount = cc->inCount;
+	int pos = cc->pos;
+	bool result;
+
+	// resolve 'defined' before anything gets expanded
+	for (int i = 0; i < count; ++i)
+	{
+		if (CcTokenIs(&toks[i], "defined"))
+		{
+			bool paren = i + 1 < count && CcTokenIs(&toks[i + 1], "(");
+			int name = i + 1 + paren;
+
+			if (name >= count)
+				CcFail(cc, &toks[i], "invalid use of 'defined'");
+
+			sb_push(resolved, CcLookupMacro(cc, &toks[name]) ? one : zero);
+			i = name + paren;
+		}
+		else
+			sb_push(resolved, toks[i]);
+	}
+
+	CcExpandAll(cc, resolved, sb_count(resolved), &expanded);
+
+	cc->isCondition = true;
+	CcSetInput(cc, expanded, sb_count(expanded));
+	result = CcIsTrue(CcParseExpr(cc));
+	cc->isCondition = false;
+	cc->in = in;
+	cc->inCount = inCount;
+	cc->pos = pos;
+
+	sb_free(resolved);
+	sb_free(expanded);
+
+	return result;
+}
+
+// headers from the decomp's include/ and src/ trees are represented by
+// the constants scanned out of them, everything else gets compiled
+static char *CcFindInclude(struct Cc *cc, const char *name, const char *fromFile, bool *isDecompHeader)
+{
+	const char *searchPaths[] = { "include", "assets", "src", "." };
+	char *path = malloc(strlen(fromFile) + strlen(cc->root) + strlen(name) + 32);
+	const char *slash = strrchr(fromFile, '/');
+
+	*isDecompHeader = false;
+
+	sprintf(path, "%.*s%s", slash ? (int)(slash - fromFile + 1) : 0, fromFile, name);
+	if (FileExists(path))
+		return path;
+
+	for (int i = 0; i < CC_ARRAY_COUNT(searchPaths); ++i)
+	{
+		sprintf(path, "%s/%s/%s", cc->root, searchPaths[i], name);
+		if (FileExists(path))
+		{
+			*isDecompHeader = (i <= 2 && i != 1);
+			return path;
+		}
+	}
+
+	free(path);
+	return 0;
+}
+
+static void CcInclude(struct Cc *cc, const struct CcToken *toks, int count)
+{
+	const struct CcToken *tok = &toks[0];
+	bool isHeader;
+	bool isDecompHeader;
+	char *name;
+	char *path;
+	char *text;
+
+	// <system> headers
+	if (count < 1 || tok->type != CC_TOKEN_STRING)
+		return;
+
+	name = CcStrndup(tok->text + 1, tok->len - 2);
+	isHeader = strlen(name) > 2 && !strcmp(name + strlen(name) - 2, ".h");
+	path = CcFindInclude(cc, name, tok->file, &isDecompHeader);
+
+	if (!path)
+	{
+		if (isHeader)
+		{
+			free(name);
+			return;
+		}
+		CcFail(cc, tok, "cannot find include file '%s'", name);
+	}
+	free(name);
+
+	if (isHeader && isDecompHeader)
+	{
+		free(path);
+		return;
+	}
+
+	if (cc->includeDepth >= CC_MAX_INCLUDE_DEPTH)
+		CcFail(cc, tok, "#include nested too deeply");
+
+	if (!(text = CcReadText(path)))
+		CcFail(cc, tok, "failed to read '%s'", path);
+
+	CcOwn(cc, path);
+	cc->includeDepth += 1;
+	CcPreprocessText(cc, CcOwn(cc, text), path);
+	cc->includeDepth -= 1;
+}
+
+static void CcDirective(struct Cc *cc, const struct CcToken *toks, int count)
+{
+	const struct CcToken *name = &toks[0];
+	bool isEmitting = CcIsEmitting(cc);
+	uint8_t *top = sb_count(cc->conds) ? &sb_last(cc->conds) : 0;
+
+	if (!count) // null directive
+		return;
+
+	if (CcTokenIs(name, "ifdef") || CcTokenIs(name, "ifndef"))
+	{
+		bool isDefined = count > 1 && CcLookupMacro(cc, &toks[1]);
+
+		if (!isEmitting)
+			sb_push(cc->conds, 2);
+		else
+			sb_push(cc->conds, (isDefined == CcTokenIs(name, "ifdef")) ? 1 : 0);
+	}
+	else if (CcTokenIs(name, "if"))
+	{
+		if (!isEmitting)
+			sb_push(cc->conds, 2);
+		else
+			sb_push(cc->conds, CcEvaluateCondition(cc, toks + 1, count - 1) ? 1 : 0);
+	}
+	else if (CcTokenIs(name, "elif"))
+	{
+		if (!top)
+			CcFail(cc, name, "#elif without #if");
+		if (*top == 1)
+			*top = 2;
+		else if (*top == 0)
+		{
+			*top = 1; // evaluate with this level taken so the parent decides
+			if (!CcIsEmitting(cc) || !CcEvaluateCondition(cc, toks + 1, count - 1))
+				*top = 0;
+		}
+	}
+	else if (CcTokenIs(name, "else"))
+	{
+		if (!top)
+			CcFail(cc, name, "#else without #if");
+		*top = (*top == 0) ? 1 : 2;
+	}
+	else if (CcTokenIs(name, "endif"))
+	{
+		if (!top)
+			CcFail(cc, name, "#endif without #if");
+		(void)sb_pop(cc->conds);
+	}
+	else if (!isEmitting)
+		return;
+	else if (CcTokenIs(name, "define"))
+		CcDefine(cc, toks + 1, count - 1);
+	else if (CcTokenIs(name, "undef"))
+	{
+		struct CcHashEntry *entry;
+
+		if (count > 1 && (entry = CcHashFind(&cc->macros, toks[1].text, toks[1].len, false)) && entry->udata)
+		{
+			CcMacroFree(entry->udata);
+			entry->udata = 0;
+		}
+	}
+	else if (CcTokenIs(name, "include"))
+		CcInclude(cc, toks + 1, count - 1);
+	else if (CcTokenIs(name, "error"))
+		CcFail(cc, name, "#error encountered");
+	// #pragma, #line, #warning, etc are ignored
+}
+
+static void CcPreprocessText(struct Cc *cc, const char *text, const char *file)
+{
+	sb_array(struct CcToken, toks) = 0;
+	int conds = sb_count(cc->conds);
+
+	CcLex(cc, text, file, &toks);
+
+	for (int i = 0; i < sb_count(toks); )
+	{
+		const struct CcToken *tok = &toks[i];
+		int before;
+
+		if (tok->bol && CcTokenIs(tok, "#"))
+		{
+			int end = i + 1;
+
+			while (end < sb_count(toks) && !toks[end].bol)
+				++end;
+
+			CcDirective(cc, toks + i + 1, end - (i + 1));
+			i = end;
+			continue;
+		}
+
+		if (!CcIsEmitting(cc))
+		{
+			++i;
+			continue;
+		}
+
+		// expansions report errors where the macro was invoked
+		before = sb_count(cc->tokens);
+		CcExpand(cc, toks, sb_count(toks), &i, &cc->tokens);
+		for (int k = before; k < sb_count(cc->tokens); ++k)
+		{
+			cc->tokens[k].file = tok->file;
+			cc->tokens[k].line = tok->line;
+		}
+	}
+
+	if (sb_count(cc->conds) != conds)
+		CcFail(cc, sb_count(toks) ? &sb_last(toks) : 0, "unterminated #if in '%s'", file);
+
+	sb_free(toks);
+}
+
+#endif // endregion
+
+#if 1 // region: decomp constants
+
+struct CcPendingEnum
+{
+	sb_array(struct CcToken, names);
+	sb_array(int, exprStart);
+	sb_array(int, exprEnd); // exprStart == exprEnd means previous + 1
+	const struct CcToken *toks;
+	int resolved;
+	int64_t next;
+};
+
+struct CcPendingDefine
+{
+	const struct CcToken *name;
+	const struct CcToken *body;
+	int bodyCount;
+};
+
+static void CcSetConstant(const struct CcToken *name, int64_t value)
+{
+	struct CcHashEntry *entry;
+
+	// first definition wins, the builtin gbi constants are added first
+	if (CcHashFind(&sCcDecomp.constants, name->text, name->len, false))
+		return;
+
+	entry = CcHashFind(&sCcDecomp.constants, name->text, name->len, true);
+	entry->value = value;
+}
+
+static void CcSetBuiltinConstant(const char *name, int64_t value)
+{
+	struct CcToken tok = { .text = name, .len = strlen(name), .type = CC_TOKEN_IDENT };
+
+	CcSetConstant(&tok, value);
+}
+
+static void CcLoadGbiConstants(void)
+{
+	#define GBI(X) CcSetBuiltinConstant(#X, X);
+	#define GBI_RM(X) GBI(G_RM_##X) GBI(G_RM_##X##2)
+	#define GBI_SIZ(X) GBI(G_IM_SIZ_##X) GBI(G_IM_SIZ_##X##_LOAD_BLOCK) \
+		GBI(G_IM_SIZ_##X##_INCR) GBI(G_IM_SIZ_##X##_SHIFT) GBI(G_IM_SIZ_##X##_BYTES)
+
+	GBI(G_ON) GBI(G_OFF)
+
+	GBI(G_ZBUFFER) GBI(G_SHADE) GBI(G_CULL_FRONT) GBI(G_CULL_BACK) GBI(G_CULL_BOTH)
+	GBI(G_FOG) GBI(G_LIGHTING) GBI(G_TEXTURE_GEN) GBI(G_TEXTURE_GEN_LINEAR)
+	GBI(G_LOD) GBI(G_SHADING_SMOOTH) GBI(G_CLIPPING)
+
+	GBI(G_SETOTHERMODE_H) GBI(G_SETOTHERMODE_L)
+	GBI(G_MDSFT_ALPHACOMPARE) GBI(G_MDSFT_ZSRCSEL) GBI(G_MDSFT_RENDERMODE)
+	GBI(G_MDSFT_ALPHADITHER) GBI(G_MDSFT_RGBDITHER) GBI(G_MDSFT_COMBKEY)
+	GBI(G_MDSFT_TEXTCONV) GBI(G_MDSFT_TEXTFILT) GBI(G_MDSFT_TEXTLUT)
+	GBI(G_MDSFT_TEXTLOD) GBI(G_MDSFT_TEXTDETAIL) GBI(G_MDSFT_TEXTPERSP)
+	GBI(G_MDSFT_CYCLETYPE) GBI(G_MDSFT_PIPELINE)
+	GBI(G_PM_1PRIMITIVE) GBI(G_PM_NPRIMITIVE)
+	GBI(G_CYC_1CYCLE) GBI(G_CYC_2CYCLE) GBI(G_CYC_COPY) GBI(G_CYC_FILL)
+	GBI(G_TP_NONE) GBI(G_TP_PERSP)
+	GBI(G_TD_CLAMP) GBI(G_TD_SHARPEN) GBI(G_TD_DETAIL)
+	GBI(G_TL_TILE) GBI(G_TL_LOD)
+	GBI(G_TT_NONE) GBI(G_TT_RGBA16) GBI(G_TT_IA16)
+	GBI(G_TF_POINT) GBI(G_TF_AVERAGE) GBI(G_TF_BILERP)
+	GBI(G_TC_CONV) GBI(G_TC_FILTCONV) GBI(G_TC_FILT)
+	GBI(G_CK_NONE) GBI(G_CK_KEY)
+	GBI(G_CD_MAGICSQ) GBI(G_CD_BAYER) GBI(G_CD_NOISE) GBI(G_CD_DISABLE) GBI(G_CD_ENABLE)
+	GBI(G_AD_PATTERN) GBI(G_AD_NOTPATTERN) GBI(G_AD_NOISE) GBI(G_AD_DISABLE)
+	GBI(G_AC_NONE) GBI(G_AC_THRESHOLD) GBI(G_AC_DITHER)
+	GBI(G_ZS_PIXEL) GBI(G_ZS_PRIM)
+
+	GBI(G_IM_FMT_RGBA) GBI(G_IM_FMT_YUV) GBI(G_IM_FMT_CI) GBI(G_IM_FMT_IA) GBI(G_IM_FMT_I)
+	GBI_SIZ(4b) GBI_SIZ(8b) GBI_SIZ(16b) GBI_SIZ(32b)
+
+	GBI(G_TX_NOMIRROR) GBI(G_TX_WRAP) GBI(G_TX_MIRROR) GBI(G_TX_CLAMP)
+	GBI(G_TX_NOMASK) GBI(G_TX_NOLOD) GBI(G_TX_RENDERTILE) GBI(G_TX_LOADTILE)
+	GBI(G_TX_LDBLK_MAX_TXL) GBI(G_TX_DXT_FRAC)
+
+	GBI(G_MTX_MODELVIEW) GBI(G_MTX_PROJECTION) GBI(G_MTX_MUL) GBI(G_MTX_LOAD)
+	GBI(G_MTX_NOPUSH) GBI(G_MTX_PUSH)
+
+	// render modes are built from function-like macros, which the
+	// decomp constants scan skips, so provide them from gbi.h
+	GBI_RM(AA_ZB_OPA_SURF) GBI_RM(RA_ZB_OPA_SURF) GBI_RM(AA_ZB_XLU_SURF)
+	GBI_RM(AA_ZB_OPA_DECAL) GBI_RM(RA_ZB_OPA_DECAL) GBI_RM(AA_ZB_XLU_DECAL)
+	GBI_RM(AA_ZB_OPA_INTER) GBI_RM(RA_ZB_OPA_INTER) GBI_RM(AA_ZB_XLU_INTER)
+	GBI_RM(AA_ZB_XLU_LINE) GBI_RM(AA_ZB_DEC_LINE) GBI_RM(AA_ZB_TEX_EDGE)
+	GBI_RM(AA_ZB_TEX_INTER) GBI_RM(AA_ZB_SUB_SURF) GBI_RM(AA_ZB_PCL_SURF)
+	GBI_RM(AA_ZB_OPA_TERR) GBI_RM(AA_ZB_TEX_TERR) GBI_RM(AA_ZB_SUB_TERR)
+	GBI_RM(AA_OPA_SURF) GBI_RM(RA_OPA_SURF) GBI_RM(AA_XLU_SURF)
+	GBI_RM(AA_XLU_LINE) GBI_RM(AA_DEC_LINE) GBI_RM(AA_TEX_EDGE)
+	GBI_RM(AA_SUB_SURF) GBI_RM(AA_PCL_SURF) GBI_RM(AA_OPA_TERR)
+	GBI_RM(AA_TEX_TERR) GBI_RM(AA_SUB_TERR)
+	GBI_RM(ZB_OPA_SURF) GBI_RM(ZB_XLU_SURF) GBI_RM(ZB_OPA_DECAL)
+	GBI_RM(ZB_XLU_DECAL) GBI_RM(ZB_CLD_SURF) GBI_RM(ZB_OVL_SURF) GBI_RM(ZB_PCL_SURF)
+	GBI_RM(OPA_SURF) GBI_RM(XLU_SURF) GBI_RM(TEX_EDGE) GBI_RM(CLD_SURF) GBI_RM(PCL_SURF)
+	GBI_RM(ADD) GBI_RM(NOOP) GBI_RM(VISCVG) GBI_RM(OPA_CI)
+	GBI(G_RM_FOG_SHADE_A) GBI(G_RM_FOG_PRIM_A) GBI(G_RM_PASS)
+
+	#undef GBI_SIZ
+	#undef GBI_RM
+	#undef GBI
+}
+
+static void CcScanHeader(struct Cc *cc, const char *path, bool isTable
+	, sb_array(struct CcToken *, *lists)
+	, sb_array(struct CcPendingDefine, *defines)
+	, sb_array(struct CcPendingEnum, *enums)
+)
+{
+	sb_array(struct CcToken, toks) = 0;
+	char *text = CcReadText(path);
+	int tableIndex = 0;
+	int count;
+
+	if (!text)
+		return;
+
+	CcLex(cc, CcOwn(cc, text), path, &toks);
+	sb_push(*lists, toks);
+	count = sb_count(toks);
+
+	for (int i = 0; i < count; )
+	{
+		const struct CcToken *tok = &toks[i];
+
+		// object-like #define
+		if (tok->bol && CcTokenIs(tok, "#"))
+		{
+			int end = i + 1;
+
+			while (end < count && !toks[end].bol)
+				++end;
+
+			if (end - i > 3
+				&& CcTokenIs(&toks[i + 1], "define")
+				&& toks[i + 2].type == CC_TOKEN_IDENT
+				&& !(CcTokenIs(&toks[i + 3], "(") && !toks[i + 3].space)
+			)
+				sb_push(*defines, ((struct CcPendingDefine){
+					.name = &toks[i + 2],
+					.body = &toks[i + 3],
+					.bodyCount = end - (i + 3),
+				}));
+
+			i = end;
+			continue;
+		}
+
+		// x-macro tables: DEFINE_ACTOR(EnTest, ACTOR_EN_TEST, ...) etc, the
+		// first all-caps argument is the enum value, counting from zero
+		if (isTable
+			&& tok->type == CC_TOKEN_IDENT
+			&& tok->len > 7 && !strncmp(tok->text, "DEFINE_", 7)
+			&& i + 1 < count && CcTokenIs(&toks[i + 1], "(")
+		)
+		{
+			bool found = false;
+
+			for (i += 2; i < count && !CcTokenIs(&toks[i], ")"); ++i)
+			{
+				if (!found && CcTokenIsUpperIdent(&toks[i]))
+				{
+					CcSetConstant(&toks[i], tableIndex);
+					found = true;
+				}
+			}
+			tableIndex += 1;
+			continue;
+		}
+
+		if (CcTokenIs(tok, "enum"))
+		{
+			struct CcPendingEnum pending = { .toks = toks };
+			int depth = 0;
+
+			i += 1;
+			if (i < count && toks[i].type == CC_TOKEN_IDENT)
+				i += 1;
+			if (i >= count || !CcTokenIs(&toks[i], "{"))
+				continue;
+
+			for (i += 1; i < count && toks[i].type == CC_TOKEN_IDENT; )
+			{
+				int start;
+
+				sb_push(pending.names, toks[i]);
+				i += 1;
+				start = i;
+				if (i < count && CcTokenIs(&toks[i], "="))
+					for (start = ++i; i < count; ++i)
+					{
+						// skip preprocessor lines inside the expression
+						if (CcTokenIs(&toks[i], "(")) ++depth;
+						else if (CcTokenIs(&toks[i], ")")) --depth;
+						else if (!depth && (CcTokenIs(&toks[i], ",") || CcTokenIs(&toks[i], "}")))
+							break;
+					}
+				sb_push(pending.exprStart, start);
+				sb_push(pending.exprEnd, i);
+
+				if (i < count && CcTokenIs(&toks[i], ","))
+					i += 1;
+
+				// preprocessor lines between enumerators (x-macro includes, #if)
+				while (i < count && toks[i].bol && CcTokenIs(&toks[i], "#"))
+					for (i += 1; i < count && !toks[i].bol; ++i)
+						;
+			}
+
+			if (sb_count(pending.names))
+				sb_push(*enums, pending);
+			continue;
+		}
+
+		++i;
+	}
+}
+
+static void CcLoadDecompConstants(struct Cc *cc, const char *root)
+{
+	sb_array(struct CcToken *, lists) = 0;
+	sb_array(struct CcPendingDefine, defines) = 0;
+	sb_array(struct CcPendingEnum, enums) = 0;
+	sb_array(char *, files);
+	char *includePath;
+	bool progress = true;
+
+	if (sCcDecomp.root && !strcmp(sCcDecomp.root, root))
+		return;
+
+	free(sCcDecomp.root);
+	CcHashFree(&sCcDecomp.constants, 0);
+	sCcDecomp.root = Strdup(root);
+
+	CcLoadGbiConstants();
+
+	includePath = malloc(strlen(root) + 16);
+	sprintf(includePath, "%s/include", root);
+	if (!FileExists(includePath))
+	{
+		LogWarn("no '%s' folder, only gbi constants are available", includePath);
+		free(includePath);
+		return;
+	}
+	files = FileListFromDirectory(includePath, 0, true, false, false);
+	free(includePath);
+
+	sb_foreach(files, {
+		const char *path = *each;
+
+		if (strlen(path) > 2 && !strcmp(path + strlen(path) - 2, ".h"))
+			CcScanHeader(cc, path, strstr(path, "/tables/") != 0, &lists, &defines, &enums);
+	})
+	FileListFree(files);
+
+	// resolve everything that is a constant expression, in whatever order
+	// the dependencies allow; function-like macros etc never resolve
+	while (progress)
+	{
+		progress = false;
+
+		sb_foreach(defines, {
+			int64_t value;
+
+			if (!each->name)
+				continue;
+
+			if (CcTryEvaluate(cc, each->body, each->bodyCount, &value))
+			{
+				CcSetConstant(each->name, value);
+				each->name = 0;
+				progress = true;
+			}
+		})
+
+		sb_foreach(enums, {
+			while (each->resolved < sb_count(each->names))
+			{
+				int k = each->resolved;
+				int64_t value = each->next;
+
+				if (each->exprStart[k] != each->exprEnd[k]
+					&& !CcTryEvaluate(cc, each->toks + each->exprStart[k]
+						, each->exprEnd[k] - each->exprStart[k], &value
+					)
+				)
+					break;
+
+				CcSetConstant(&each->names[k], value);
+				each->next = value + 1;
+				each->resolved += 1;
+				progress = true;
+			}
+		})
+	}
+
+	LogDebug("scanned %d constants from '%s/include'", sCcDecomp.constants.count, root);
+
+	sb_foreach(enums, {
+		sb_free(each->names);
+		sb_free(each->exprStart);
+		sb_free(each->exprEnd);
+	})
+	sb_foreach(lists, { sb_free(*each); })
+	sb_free(enums);
+	sb_free(defines);
+	sb_free(lists);
+}
+
+// linker script syntax, as generated by Fast64_CompileSceneAndRooms()
+static void CcLoadLinkerSymbols(struct Cc *cc, const char *syms)
+{
+	char name[256];
+	long long value;
+
+	for (const char *line = syms; line && *line; line = strchr(line, '\n'), line += !!line)
+	{
+		struct CcHashEntry *entry;
+
+		if (sscanf(line, " %255[A-Za-z0-9_] = %lli", name, &value) != 2)
+			continue;
+
+		entry = CcHashFind(&cc->values, name, strlen(name), true);
+		entry->value = value;
+
+		if (!strcmp(name, "ENTRY_POINT"))
+			cc->base = (uint32_t)value;
+	}
+}
+
+#endif // endregion
+
+#if 1 // region: initializers
+
+static const char *CcLayoutSkip(const char *layout)
+{
+	int depth = 0;
+
+	if (*layout != '{')
+		return layout + 1;
+
+	for (;; ++layout)
+	{
+		if (*layout == '{')
+			++depth;
+		else if (*layout == '}' && !--depth)
+			return layout + 1;
+	}
+}
+
+static void CcLayoutMeasure(const char *layout, const char *end, int *sizeBytes, int *alignBytes)
+{
+	int size = 0;
+	int align = 1;
+
+	while (layout < end)
+	{
+		const char *next = CcLayoutSkip(layout);
+		int itemSize;
+		int itemAlign;
+
+		switch (*layout)
+		{
+			case '{': CcLayoutMeasure(layout + 1, next - 1, &itemSize, &itemAlign); break;
+			case 'b': itemSize = itemAlign = 1; break;
+			case 'x': itemSize = itemAlign = 1; break;
+			case 'h': itemSize = itemAlign = 2; break;
+			case 'w': itemSize = itemAlign = 4; break;
+			case 'f': itemSize = itemAlign = 4; break;
+			case 'd': itemSize = itemAlign = 8; break;
+			case 'g': itemSize = itemAlign = CC_SIZEOF_GFX; break;
+			default: Die("bad layout '%s'", layout);
+		}
+
+		size = CC_ALIGN(size, itemAlign) + itemSize;
+		align = MAX(align, itemAlign);
+		layout = next;
+	}
+
+	*sizeBytes = CC_ALIGN(size, align);
+	*alignBytes = align;
+}
+
+static int CcSizeofType(struct Cc *cc, const struct CcToken *tok)
+{
+	const struct CcType *type = CcLookupType(tok);
+	int size;
+	int align;
+
+	if (!type)
+		CcFail(cc, tok, "unknown type '%.*s'", tok->len, tok->text);
+
+	CcLayoutMeasure(type->item, CcLayoutSkip(type->item), &size, &align);
+
+	return size;
+}
+
+static void CcStore(struct Cc *cc, uint8_t *out, char item, struct CcValue v)
+{
+	uint64_t bits;
+	int width;
+
+	if (!out || cc->dryRun)
+		return;
+
+	switch (item)
+	{
+		case 'f': {
+			float f = CcToFloat(v);
+			uint32_t u;
+			memcpy(&u, &f, sizeof(u));
+			bits = u;
+			width = 4;
+			break;
+		}
+		case 'b': bits = CcToInt(v); width = 1; break;
+		case 'h': bits = CcToInt(v); width = 2; break;
+		case 'w': bits = CcToInt(v); width = 4; break;
+		case 'd': bits = CcToInt(v); width = 8; break;
+		default: CcFail(cc, 0, "bad layout item '%c'", item);
+	}
+
+	for (int i = 0; i < width; ++i)
+		out[i] = bits >> ((width - 1 - i) * 8);
+}
+
+static void CcStoreGfx(uint8_t *out, const GbiGfx *gfx, int count)
+{
+	for (int i = 0; i < count; ++i, out += CC_SIZEOF_GFX)
+	{
+		uint32_t words[2];
+
+		memcpy(words, &gfx[i], sizeof(words));
+		for (int k = 0; k < 2; ++k)
+		{
+			out[k * 4 + 0] = words[k] >> 24;
+			out[k * 4 + 1] = words[k] >> 16;
+			out[k * 4 + 2] = words[k] >> 8;
+			out[k * 4 + 3] = words[k];
+		}
+	}
+}
+
+// writes the command(s) a gbi macro expands to, returns how many, or -1 if
+// the macro isn't recognized; *expectArgc receives the expected arity
+static int CcGbi(const char *name, const uint32_t *a, int argc, uint8_t *out, int *expectArgc)
+{
+	#define GBI(NAME, ARGC, ...) \
+		if (!strcmp(name, #NAME)) { \
+			*expectArgc = ARGC; \
+			if (argc != ARGC) return 0; \
+			GbiGfx gfx[] = { __VA_ARGS__ }; \
+			CcStoreGfx(out, gfx, CC_ARRAY_COUNT(gfx)); \
+			return CC_ARRAY_COUNT(gfx); \
+		}
+
+	GBI(gsSPEndDisplayList, 0, gsSPEndDisplayList())
+	GBI(gsSPDisplayList, 1, gsSPDisplayList(a[0]))
+	GBI(gsSPBranchList, 1, gsSPBranchList(a[0]))
+	GBI(gsSPVertex, 3, gsSPVertex(a[0], a[1], a[2]))
+	GBI(gsSP1Triangle, 4, gsSP1Triangle(a[0], a[1], a[2], a[3]))
+	GBI(gsSP2Triangles, 8, gsSP2Triangles(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]))
+	GBI(gsSP1Quadrangle, 5, gsSP1Quadrangle(a[0], a[1], a[2], a[3], a[4]))
+	GBI(gsSPCullDisplayList, 2, gsSPCullDisplayList(a[0], a[1]))
+	GBI(gsSPTexture, 5, gsSPTexture(a[0], a[1], a[2], a[3], a[4]))
+	GBI(gsSPLoadGeometryMode, 1, gsSPLoadGeometryMode(a[0]))
+	GBI(gsSPSetGeometryMode, 1, gsSPSetGeometryMode(a[0]))
+	GBI(gsSPClearGeometryMode, 1, gsSPClearGeometryMode(a[0]))
+	GBI(gsSPGeometryMode, 2, gsSPGeometryMode(a[0], a[1]))
+	GBI(gsSPSetOtherMode, 4, gsSPSetOtherMode(a[0], a[1], a[2], a[3]))
+	GBI(gsSPMatrix, 2, gsSPMatrix(a[0], a[1]))
+	GBI(gsSPPopMatrix, 1, gsSPPopMatrix(a[0]))
+	GBI(gsSPSegment, 2, gsSPSegment(a[0], a[1]))
+	GBI(gsSPFogPosition, 2, gsSPFogPosition(a[0], a[1]))
+	// &name.l[0] and &name.a, see the Lights0/Lights1 layout
+	GBI(gsSPSetLights0, 1, gsSPNumLights(NUMLIGHTS_0), gsSPLight(a[0] + 8, 1), gsSPLight(a[0], 2))
+	GBI(gsSPSetLights1, 1, gsSPNumLights(NUMLIGHTS_1), gsSPLight(a[0] + 8, 1), gsSPLight(a[0], 2))
+	GBI(gsDPNoOp, 0, gsDPNoOp())
+	GBI(gsDPPipeSync, 0, gsDPPipeSync())
+	GBI(gsDPLoadSync, 0, gsDPLoadSync())
+	GBI(gsDPTileSync, 0, gsDPTileSync())
+	GBI(gsDPFullSync, 0, gsDPFullSync())
+	GBI(gsDPSetRenderMode, 2, gsDPSetRenderMode(a[0], a[1]))
+	GBI(gsDPSetOtherMode, 2, gsDPSetOtherMode(a[0], a[1]))
+	GBI(gsDPSetPrimColor, 6, gsDPSetPrimColor(a[0], a[1], a[2], a[3], a[4], a[5]))
+	GBI(gsDPSetEnvColor, 4, gsDPSetEnvColor(a[0], a[1], a[2], a[3]))
+	GBI(gsDPSetFogColor, 4, gsDPSetFogColor(a[0], a[1], a[2], a[3]))
+	GBI(gsDPSetBlendColor, 4, gsDPSetBlendColor(a[0], a[1], a[2], a[3]))
+	GBI(gsDPSetPrimDepth, 2, gsDPSetPrimDepth(a[0], a[1]))
+	GBI(gsDPSetTextureImage, 4, gsDPSetTextureImage(a[0], a[1], a[2], a[3]))
+	GBI(gsDPSetTile, 12, gsDPSetTile(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]))
+	GBI(gsDPLoadBlock, 5, gsDPLoadBlock(a[0], a[1], a[2], a[3], a[4]))
+	GBI(gsDPLoadTile, 5, gsDPLoadTile(a[0], a[1], a[2], a[3], a[4]))
+	GBI(gsDPSetTileSize, 5, gsDPSetTileSize(a[0], a[1], a[2], a[3], a[4]))
+	GBI(gsDPLoadTLUTCmd, 2, gsDPLoadTLUTCmd(a[0], a[1]))
+	GBI(gsDPLoadTLUT, 3, gsDPLoadTLUT(a[0], a[1], a[2]))
+	GBI(gsDPLoadTLUT_pal16, 2, gsDPLoadTLUT_pal16(a[0], a[1]))
+	GBI(gsDPLoadTLUT_pal256, 1, gsDPLoadTLUT_pal256(a[0]))
+	GBI(gsDPSetTextureLUT, 1, gsDPSetTextureLUT(a[0]))
+	GBI(gsDPSetCycleType, 1, gsDPSetCycleType(a[0]))
+	GBI(gsDPSetTexturePersp, 1, gsDPSetTexturePersp(a[0]))
+	GBI(gsDPSetTextureFilter, 1, gsDPSetTextureFilter(a[0]))
+	GBI(gsDPSetTextureConvert, 1, gsDPSetTextureConvert(a[0]))
+	GBI(gsDPSetTextureLOD, 1, gsDPSetTextureLOD(a[0]))
+	GBI(gsDPSetTextureDetail, 1, gsDPSetTextureDetail(a[0]))
+	GBI(gsDPSetCombineKey, 1, gsDPSetCombineKey(a[0]))
+	GBI(gsDPSetColorDither, 1, gsDPSetColorDither(a[0]))
+	GBI(gsDPSetAlphaDither, 1, gsDPSetAlphaDither(a[0]))
+	GBI(gsDPSetAlphaCompare, 1, gsDPSetAlphaCompare(a[0]))
+	GBI(gsDPSetDepthSource, 1, gsDPSetDepthSource(a[0]))
+
+	#undef GBI
+
+	*expectArgc = -1;
+	return -1;
+}
+
+// gsDPSetCombineLERP pastes its arguments onto G_CCMUX_/G_ACMUX_, so it
+// can't be invoked with evaluated arguments like the macros in CcGbi()
+static int CcGbiCombineLERP(struct Cc *cc, uint8_t *out)
+{
+	#define CCMUX(X) { #X, G_CCMUX_##X }
+	#define ACMUX(X) { #X, G_ACMUX_##X }
+	static const struct { const char *name; int value; } ccmux[] = {
+		CCMUX(COMBINED), CCMUX(TEXEL0), CCMUX(TEXEL1), CCMUX(PRIMITIVE),
+		CCMUX(SHADE), CCMUX(ENVIRONMENT), CCMUX(CENTER), CCMUX(SCALE),
+		CCMUX(COMBINED_ALPHA), CCMUX(TEXEL0_ALPHA), CCMUX(TEXEL1_ALPHA),
+		CCMUX(PRIMITIVE_ALPHA), CCMUX(SHADE_ALPHA), CCMUX(ENV_ALPHA),
+		CCMUX(LOD_FRACTION), CCMUX(PRIM_LOD_FRAC), CCMUX(NOISE),
+		CCMUX(K4), CCMUX(K5), CCMUX(1), CCMUX(0),
+	}, acmux[] = {
+		ACMUX(COMBINED), ACMUX(TEXEL0), ACMUX(TEXEL1), ACMUX(PRIMITIVE),
+		ACMUX(SHADE), ACMUX(ENVIRONMENT), ACMUX(LOD_FRACTION),
+		ACMUX(PRIM_LOD_FRAC), ACMUX(1), ACMUX(0),
+	};
+	#undef CCMUX
+	#undef ACMUX
+	uint32_t m[16];
+	GbiGfx gfx;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		const struct CcToken *tok;
+		bool isAlpha = (i & 4);
+		bool found = false;
+
+		if (i)
+			CcExpect(cc, ",");
+		tok = CcNext(cc);
+
+		for (int k = 0; !found && k < (isAlpha ? CC_ARRAY_COUNT(acmux) : CC_ARRAY_COUNT(ccmux)); ++k)
+		{
+			if (CcTokenIs(tok, isAlpha ? acmux[k].name : ccmux[k].name))
+			{
+				m[i] = isAlpha ? acmux[k].value : ccmux[k].value;
+				found = true;
+			}
+		}
+
+		if (!found)
+			CcFail(cc, tok, "unknown combiner input '%.*s'", tok->len, tok->text);
+	}
+	CcExpect(cc, ")");
+
+	if (!out)
+		return 1;
+
+	// a0 b0 c0 d0 Aa0 Ab0 Ac0 Ad0 a1 b1 c1 d1 Aa1 Ab1 Ac1 Ad1
+	gfx = (GbiGfx){
+		_SHIFTL(G_SETCOMBINE, 24, 8)
+			| _SHIFTL(GCCc0w0(m[0], m[2], m[4], m[6]) | GCCc1w0(m[8], m[10]), 0, 24),
+		(unsigned int)(GCCc0w1(m[1], m[3], m[5], m[7])
+			| GCCc1w1(m[9], m[12], m[14], m[11], m[13], m[15]))
+	};
+	CcStoreGfx(out, &gfx, 1);
+
+	return 1;
+}
+
+static int CcInitGfx(struct Cc *cc, uint8_t *out)
+{
+	const struct CcToken *tok = CcExpectIdent(cc);
+	uint32_t args[CC_MAX_GBI_ARGS];
+	char name[64];
+	int argc = 0;
+	int expectArgc;
+	int count;
+
+	CcExpect(cc, "(");
+
+	if (CcTokenIs(tok, "gsDPSetCombineLERP"))
+		return CcGbiCombineLERP(cc, out);
+
+	if (!CcPeekIs(cc, ")"))
+	{
+		do
+		{
+			if (argc >= CC_ARRAY_COUNT(args))
+				CcFail(cc, tok, "too many arguments to '%.*s'", tok->len, tok->text);
+			args[argc++] = CcToInt(CcParseExpr(cc));
+		} while (CcAccept(cc, ","));
+	}
+	CcExpect(cc, ")");
+
+	snprintf(name, sizeof(name), "%.*s", tok->len, tok->text);
+	count = CcGbi(name, args, argc, out, &expectArgc);
+	if (count < 0)
+		CcFail(cc, tok, "unsupported display list macro '%s'", name);
+	if (argc != expectArgc)
+		CcFail(cc, tok, "'%s' expects %d arguments, got %d", name, expectArgc, argc);
+
+	return count;
+}
+
+static void CcInitMembers(struct Cc *cc, const char *layout, const char *end, uint8_t *out);
+
+// initializes one layout item at 'out' (which is 0 when only measuring)
+static void CcInitItem(struct Cc *cc, const char *item, uint8_t *out)
+{
+	struct CcValue v;
+
+	if (*item == '{')
+	{
+		const char *end = CcLayoutSkip(item) - 1;
+
+		if (CcAccept(cc, "{"))
+		{
+			CcInitMembers(cc, item + 1, end, out);
+			CcAccept(cc, ",");
+			CcExpect(cc, "}");
+		}
+		else // brace elision
+			CcInitMembers(cc, item + 1, end, out);
+
+		return;
+	}
+
+	if (*item == 'g')
+	{
+		uint8_t tmp[CC_SIZEOF_GFX * CC_MAX_GBI_EXPANSION];
+
+		if (CcInitGfx(cc, tmp) != 1)
+			CcFail(cc, 0, "expected a single display list command");
+		if (out && !cc->dryRun)
+			memcpy(out, tmp, CC_SIZEOF_GFX);
+		return;
+	}
+
+	if (CcAccept(cc, "{"))
+	{
+		v = CcParseExpr(cc);
+		CcAccept(cc, ",");
+		CcExpect(cc, "}");
+	}
+	else
+		v = CcParseExpr(cc);
+
+	CcStore(cc, out, *item, v);
+}
+
+static void CcInitMembers(struct Cc *cc, const char *layout, const char *end, uint8_t *out)
+{
+	int offset = 0;
+	bool isFirst = true;
+
+	while (layout < end)
+	{
+		const char *next = CcLayoutSkip(layout);
+		int size;
+		int align;
+
+		CcLayoutMeasure(layout, next, &size, &align);
+		offset = CC_ALIGN(offset, align);
+
+		if (*layout != 'x')
+		{
+			if (!isFirst && !CcAccept(cc, ","))
+				return;
+
+			// remaining members are zero
+			if (CcPeekIs(cc, "}"))
+				return;
+
+			CcInitItem(cc, layout, out ? out + offset : 0);
+			isFirst = false;
+		}
+
+		offset += size;
+		layout = next;
+	}
+}
+
+// parses an object's initializer, returns the number of elements
+static int CcInitObject(struct Cc *cc, struct CcObject *obj, uint8_t *out)
+{
+	int count = 0;
+
+	if (!obj->isArray)
+	{
+		CcInitItem(cc, obj->item, out);
+		return 1;
+	}
+
+	CcExpect(cc, "{");
+	while (!CcPeekIs(cc, "}"))
+	{
+		const struct CcToken *at = CcPeek(cc);
+		int limit = obj->declaredCount ? obj->declaredCount : obj->count;
+		int n = 1;
+
+		if (*obj->item == 'g')
+		{
+			uint8_t tmp[CC_SIZEOF_GFX * CC_MAX_GBI_EXPANSION];
+
+			n = CcInitGfx(cc, tmp);
+			if (out && (!limit || count + n <= limit))
+				memcpy(out + count * CC_SIZEOF_GFX, tmp, n * CC_SIZEOF_GFX);
+		}
+		else if (out && (!limit || count < limit))
+			CcInitItem(cc, obj->item, out + count * obj->elementSize);
+		else
+			CcInitItem(cc, obj->item, 0);
+
+		count += n;
+		if (limit && count > limit)
+			CcFail(cc, at, "too many initializers for '%s'", obj->name);
+
+		if (!CcAccept(cc, ","))
+			break;
+	}
+	CcExpect(cc, "}");
+
+	return count;
+}
+
+#endif // endregion
+
+#if 1 // region: declarations
+
+static void CcSkipStatement(struct Cc *cc)
+{
+	int depth = 0;
+
+	for (;;)
+	{
+		const struct CcToken *tok = CcNext(cc);
+
+		if (tok->type == CC_TOKEN_EOF)
+			return;
+		else if (CcTokenIs(tok, "{") || CcTokenIs(tok, "("))
+			++depth;
+		else if (CcTokenIs(tok, "}") || CcTokenIs(tok, ")"))
+			--depth;
+		else if (!depth && CcTokenIs(tok, ";"))
+			return;
+	}
+}
+
+// __attribute__((...)), honors aligned(N)
+static void CcSkipAttribute(struct Cc *cc, int *align)
+{
+	int depth = 0;
+
+	do
+	{
+		const struct CcToken *tok = CcNext(cc);
+
+		if (tok->type == CC_TOKEN_EOF)
+			CcFail(cc, tok, "unterminated __attribute__");
+
+		if ((CcTokenIs(tok, "aligned") || CcTokenIs(tok, "__aligned__")) && CcAccept(cc, "("))
+		{
+			*align = CcToInt(CcParseExpr(cc));
+			CcExpect(cc, ")");
+		}
+		else if (CcTokenIs(tok, "("))
+			++depth;
+		else if (CcTokenIs(tok, ")"))
+			--depth;
+	} while (depth);
+}
+
+static const char *CcPrimitiveItem(struct Cc *cc, const struct CcToken **words, int count)
+{
+	int longs = 0;
+	const char *item = "w";
+
+	for (int i = 0; i < count; ++i)
+	{
+		const struct CcToken *tok = words[i];
+
+		if (CcTokenIs(tok, "char")) item = "b";
+		else if (CcTokenIs(tok, "short")) item = "h";
+		else if (CcTokenIs(tok, "long")) item = (++longs == 2) ? "d" : "w";
+		else if (CcTokenIs(tok, "float")) item = "f";
+		else if (CcTokenIs(tok, "double") || CcTokenIs(tok, "void"))
+			CcFail(cc, tok, "unsupported type '%.*s'", tok->len, tok->text);
+	}
+
+	return item;
+}
+
+static void CcDeclare(struct Cc *cc, struct CcObject *obj, const struct CcToken *at)
+{
+	struct CcHashEntry *entry = CcHashFind(&cc->objectsByName, obj->name, strlen(obj->name), true);
+	struct CcObject *old = entry->udata;
+
+	if (old)
+	{
+		// tentative definition followed by the real one
+		if (old->initStart >= 0)
+			CcFail(cc, at, "redefinition of '%s'", obj->name);
+
+		sb_foreach(cc->objects, {
+			if (*each == old) {
+				sb_remove(cc->objects, eachIndex);
+				break;
+			}
+		})
+		free(old->name);
+		free(old);
+	}
+
+	entry->udata = obj;
+	sb_push(cc->objects, obj);
+}
+
+// first pass: find every object, its type, and how many elements it has
+static void CcParseDeclarations(struct Cc *cc)
+{
+	CcSetInput(cc, cc->tokens, sb_count(cc->tokens));
+
+	while (CcPeek(cc)->type != CC_TOKEN_EOF)
+	{
+		const struct CcToken *words[4];
+		const struct CcType *type = 0;
+		int numWords = 0;
+		int align = 0;
+		bool isConst = false;
+
+		if (CcAccept(cc, ";"))
+			continue;
+
+		// specifiers
+		for (;;)
+		{
+			const struct CcToken *tok = CcPeek(cc);
+
+			if (tok->type != CC_TOKEN_IDENT)
+				break;
+
+			if (CcTokenIs(tok, "static") || CcTokenIs(tok, "volatile")
+				|| CcTokenIs(tok, "inline") || CcTokenIs(tok, "register")
+			)
+				CcNext(cc);
+			else if (CcTokenIs(tok, "const"))
+			{
+				isConst = true;
+				CcNext(cc);
+			}
+			else if (CcTokenIs(tok, "__attribute__"))
+				CcSkipAttribute(cc, &align);
+			else if (CcTokenIs(tok, "extern") || CcTokenIs(tok, "typedef"))
+			{
+				CcSkipStatement(cc);
+				goto L_next;
+			}
+			else if (!type && CcIsPrimitiveKeyword(tok))
+			{
+				if (numWords >= CC_ARRAY_COUNT(words))
+					CcFail(cc, tok, "unsupported type");
+				words[numWords++] = CcNext(cc);
+			}
+			else if (!type && !numWords)
+			{
+				if (!(type = CcLookupType(tok)))
+					CcFail(cc, tok, "unsupported type '%.*s'", tok->len, tok->text);
+				CcNext(cc);
+			}
+			else
+				break;
+		}
+
+		if (!type && !numWords)
+			CcFail(cc, 0, "expected declaration");
+
+		// declarators
+		do
+		{
+			struct CcObject *obj;
+			const struct CcToken *name;
+			bool isConstPointer = false;
+			int pointers = 0;
+			int objAlign = align;
+
+			while (CcAccept(cc, "*"))
+			{
+				++pointers;
+				for (isConstPointer = false; ; )
+				{
+					if (CcAccept(cc, "const"))
+						isConstPointer = true;
+					else if (!CcAccept(cc, "volatile"))
+						break;
+				}
+			}
+
+			name = CcExpectIdent(cc);
+
+			if (CcPeekIs(cc, "("))
+			{
+				// prototypes are fine, function bodies are not
+				for (int depth = 0; CcPeek(cc)->type != CC_TOKEN_EOF; )
+				{
+					const struct CcToken *tok = CcNext(cc);
+
+					if (CcTokenIs(tok, "("))
+						++depth;
+					else if (CcTokenIs(tok, ")") && !--depth)
+						break;
+				}
+				if (CcPeekIs(cc, "{"))
+					CcFail(cc, name, "function definitions are not supported");
+				CcSkipStatement(cc);
+				goto L_next;
+			}
+
+			obj = Calloc(1, sizeof(*obj));
+			obj->name = CcStrndup(name->text, name->len);
+			obj->initStart = -1;
+			obj->isConst = pointers ? isConstPointer : isConst;
+			obj->item = pointers ? "w" : type ? type->item : CcPrimitiveItem(cc, words, numWords);
+			CcLayoutMeasure(obj->item, CcLayoutSkip(obj->item), &obj->elementSize, &obj->align);
+			if (!pointers && type && type->align)
+				obj->align = type->align;
+			CcDeclare(cc, obj, name);
+
+			while (CcAccept(cc, "["))
+			{
+				if (obj->isArray)
+					CcFail(cc, name, "multidimensional arrays are not supported");
+				obj->isArray = true;
+				if (!CcPeekIs(cc, "]"))
+					obj->declaredCount = CcToInt(CcParseExpr(cc));
+				CcExpect(cc, "]");
+			}
+
+			while (CcPeekIs(cc, "__attribute__"))
+				CcSkipAttribute(cc, &objAlign);
+
+			// mips gcc gives aggregates and char arrays word alignment
+			if (*obj->item == '{' || (obj->isArray && *obj->item == 'b'))
+				obj->align = MAX(obj->align, 4);
+			obj->align = MAX(obj->align, objAlign);
+
+			obj->count = obj->isArray ? obj->declaredCount : 1;
+			if (CcAccept(cc, "="))
+			{
+				int count;
+
+				obj->initStart = cc->pos;
+				cc->dryRun = true;
+				count = CcInitObject(cc, obj, 0);
+				cc->dryRun = false;
+
+				if (obj->isArray && !obj->declaredCount)
+					obj->count = count;
+			}
+			else if (obj->isArray && !obj->declaredCount)
+				CcFail(cc, name, "array size missing in '%s'", obj->name);
+		} while (CcAccept(cc, ","));
+
+		CcExpect(cc, ";");
+	L_next:;
+	}
+}
+
+// mirrors z64ovl.ld in fast64.c: empty .text, then .data, then .rodata
+static void CcLayout(struct Cc *cc)
+{
+	uint32_t addr = cc->base;
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		bool wantConst = (pass == 1);
+
+		addr = CC_ALIGN(addr, 16);
+		sb_foreach(cc->objects, {
+			struct CcObject *obj = *each;
+
+			if (obj->isConst != wantConst)
+				continue;
+
+			addr = CC_ALIGN(addr, obj->align);
+			obj->address = addr;
+			addr += obj->elementSize * obj->count;
+		})
+		addr = CC_ALIGN(addr, 16);
+	}
+
+	cc->imageSize = addr - cc->base;
+	cc->image = Calloc(1, cc->imageSize + 1);
+}
+
+// second pass: every address is known, so write the initializers
+static void CcEmit(struct Cc *cc)
+{
+	sb_foreach(cc->objects, {
+		struct CcObject *obj = *each;
+
+		if (obj->initStart < 0)
+			continue;
+
+		cc->pos = obj->initStart;
+		CcInitObject(cc, obj, cc->image + (obj->address - cc->base));
+	})
+}
+
+static void CcFree(struct Cc *cc)
+{
+	sb_foreach(cc->objects, {
+		free((*each)->name);
+		free(*each);
+	})
+	sb_foreach(cc->strings, { free(*each); })
+	sb_free(cc->objects);
+	sb_free(cc->strings);
+	sb_free(cc->tokens);
+	sb_free(cc->conds);
+	CcHashFree(&cc->macros, CcMacroFree);
+	CcHashFree(&cc->values, 0);
+	CcHashFree(&cc->objectsByName, 0);
+	free(cc->image);
+	free(cc);
+}
+
+#endif // endregion
+
+#if 1 // region: public api
+
+const char *Fast64_CompileSourceNative(const char *syms, const char *root, const char *source, const char *out, char **symsOut)
+{
+	struct Cc *cc = Calloc(1, sizeof(*cc));
+	const char *error = 0;
+	jmp_buf bail;
+	char *text;
+
+	cc->bail = &bail;
+	cc->root = root;
+	if (setjmp(bail))
+	{
+		error = sCcError;
+		goto L_cleanup;
+	}
+
+	if (!(text = CcReadText(source)))
+		CcFail(cc, &sCcEof, "failed to read '%s'", source);
+
+	CcLoadDecompConstants(cc, root);
+	CcLoadLinkerSymbols(cc, syms);
+	CcPreprocessText(cc, sCcBuiltins, "<builtin>");
+	CcPreprocessText(cc, CcOwn(cc, text), source);
+	CcParseDeclarations(cc);
+	CcLayout(cc);
+	CcEmit(cc);
+
+	struct File *file = FileFromData(cc->image, cc->imageSize, false);
+	if (FileToFilename(file, ExePath(out)))
+	{
+		snprintf(sCcError, sizeof(sCcError), "%s", FileGetError());
+		error = sCcError;
+	}
+	FileFree(file);
+
+	if (!error && symsOut)
+	{
+		size_t len = 1;
+		char *dump;
+
+		sb_foreach(cc->objects, { len += strlen((*each)->name) + sizeof(" = 0x00000000;\n"); })
+		dump = malloc(len);
+		*dump = '\0';
+		len = 0;
+		sb_foreach(cc->objects, {
+			len += sprintf(dump + len, "%s = 0x%08X;\n", (*each)->name, (*each)->address);
+		})
+		*symsOut = dump;
+	}
+
+	LogDebug("compiled '%s' -> '%s' (%d objects, 0x%X bytes)"
+		, source, out, sb_count(cc->objects), cc->imageSize
+	);
+
+L_cleanup:
+	CcFree(cc);
+	return error;
+}
+
+#endif // endregion
@@ -188,6 +188,28 @@ static const char *ErrorCompilerLog(const char *source)
 	return error;
 }
 
+// appends to a malloc'd string, growing it to fit; returns the new pointer
+static char *Fast64_Append(char *str, const char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+static char *Fast64_Append(char *str, const char *fmt, ...)
+{
+	size_t len = strlen(str);
+	va_list args;
+	int more;
+	
+	va_start(args, fmt);
+		more = vsnprintf(0, 0, fmt, args);
+	va_end(args);
+	
+	str = realloc(str, len + more + 1);
+	
+	va_start(args, fmt);
+		vsnprintf(str + len, more + 1, fmt, args);
+	va_end(args);
+	
+	return str;
+}
+
 static bool IsSceneRoomSource(const char *path)
 {
 	if (strstr(path, ".inc") // skip .inc and .inc.c files
@@ -406,7 +428,7 @@ static const char *Fast64_CompileTextures(sb_array(char *, imagePaths))
 	return 0;
 }
 
-static const char *Fast64_CompileSource(const char *syms, const char *root, const char *source, const char *out)
+static const char *Fast64_CompileSourceToolchain(const char *syms, const char *root, const char *source, const char *out)
 {
 	const char *error = 0;
 	char command[4096];
@@ -454,13 +476,68 @@ static const char *Fast64_CompileSource(const char *syms, const char *root, cons
 	return error;
 }
 
+// symbols of the most recently linked .elf, as a malloc'd linker script
+static const char *Fast64_DumpToolchainSymbols(const char *source, char **symsOut)
+{
+	char command[4096];
+	char *syms;
+	
+	sprintf(command,
+		"\"%s""mips64-objdump\"" EXE_SUFFIX " -t \"%s\" > \"%s\"",
+		MIPS64_BINUTILS_PATH, WHERE_TMP_ELF, WHERE_COMPILER_LOG
+	);
+	if (system(command))
+		return ErrorCompilerLog(source);
+	
+	struct File *file = FileFromFilename(WHERE_COMPILER_LOG);
+	syms = malloc(file->size * 2 + 1);
+	*syms = '\0';
+	STRTOK_LOOP((char*)file->data, "\r\n") {
+		unsigned int addr;
+		const char *name;
+		
+		if (!strstr(each, " O ")
+			|| !isdigit(*each)
+			|| sscanf(each, "%X", &addr) != 1
+			|| !(name = strrchr(each, ' '))
+		)
+			continue;
+		
+		strcatf(syms, "%s = 0x%08X;\n", name + 1, addr);
+	}
+	FileFree(file);
+	*symsOut = syms;
+	
+	return 0;
+}
+
+// the native compiler handles everything Fast64 emits; the mips64
+// toolchain, if one is configured, remains as a fallback for sources
+// that have been edited by hand into something it doesn't understand
+static const char *Fast64_CompileSource(const char *syms, const char *root, const char *source, const char *out, char **symsOut)
+{
+	const char *error;
+	
+	if (!(error = Fast64_CompileSourceNative(syms, root, source, out, symsOut)))
+		return 0;
+	
+	if (!*gIni.path.mips64)
+		return Error("%s", error);
+	
+	LogWarn("%s, falling back to mips64-gcc", error);
+	if ((error = Fast64_CompileSourceToolchain(syms, root, source, out)))
+		return error;
+	
+	return symsOut ? Fast64_DumpToolchainSymbols(source, symsOut) : 0;
+}
+
 const char *Fast64_CompileSceneAndRooms(const char *root, sb_array(char *, sourcePaths))
 {
 	const char *error = 0;
-	static char *syms = 0;
-	
-	if (!syms)
-		syms = malloc(16 * 1024); // 16 kib
+	char *syms = 0;
+	char *sceneSyms = 0;
+	char *roomSyms = 0;
+	char fn[1024];
 	
 	// find and compile the scene
 	const char *scenePath = 0;
@@ -474,59 +551,36 @@ const char *Fast64_CompileSceneAndRooms(const char *root, sb_array(char *, sourc
 	if (!scenePath && (error = "failed to find scene"))
 		goto L_earlyExit;
 	
-	// get symbols
+	// get symbols, each once
 	struct File *file = FileFromFilename(scenePath);
-	char sym[256];
-	strcpy(syms, "ENTRY_POINT = 0x02000000;\n");
-	for (const char *tmp = file->data; tmp; )
+	const char *text = file->data;
+	syms = Strdup("ENTRY_POINT = 0x02000000;\n");
+	for (const char *tmp = text; (tmp = strstr(tmp, "SegmentRom")); )
 	{
-		tmp = strstr(tmp, "SegmentRom");
+		const char *start = tmp;
+		char *line;
 		
-		if (!tmp)
-			break;
-		while (isalnum(*tmp) || (*tmp == '_'))
-			--tmp;
+		while (start > text && (isalnum(start[-1]) || start[-1] == '_'))
+			--start;
+		while (isalnum(*tmp) || *tmp == '_')
+			++tmp;
 		
-		// symbol
-		int i = 0;
-		for (i = 0, ++tmp; isalnum(*tmp) || *tmp == '_'; ++i, ++tmp)
-			sym[i] = *tmp;
-		sym[i] = '\0';
-		strcatf(syms, "%s = 0;\n", sym);
+		// every line but the first follows a newline
+		line = Fast64_Append(Strdup(""), "\n%.*s = ", (int)(tmp - start), start);
+		if (!strstr(syms, line))
+			syms = Fast64_Append(syms, "%s0;\n", line + 1);
+		free(line);
 	}
 	FileFree(file);
 	
-	if ((error = Fast64_CompileSource(syms, root, scenePath, WHERE_TMP "test_scene.zscene")))
+	if ((error = Fast64_CompileSource(syms, root, scenePath, WHERE_TMP "test_scene.zscene", &sceneSyms)))
 		goto L_earlyExit;
 	
-	// dump symbols
-	sprintf(syms,
-		"\"%s""mips64-objdump\"" EXE_SUFFIX " -t \"%s\" > \"%s\"",
-		MIPS64_BINUTILS_PATH, WHERE_TMP_ELF, WHERE_COMPILER_LOG
-	);
-	if (system(syms))
-		return ErrorCompilerLog(scenePath);
-	
-	// get symbols
-	strcpy(syms, "ENTRY_POINT = 0x03000000;\n");
-	file = FileFromFilename(WHERE_COMPILER_LOG);
-	STRTOK_LOOP((char*)file->data, "\r\n") {
-		unsigned int addr;
-		const char *name;
-		
-		if (!strstr(each, " O ")
-			|| !isdigit(*each)
-			|| sscanf(each, "%X", &addr) != 1
-			|| !(name = strrchr(each, ' '))
-		)
-			continue;
-		
-		strcatf(syms, "%s = 0x%08X;\n", name + 1, addr);
-	}
-	FileFree(file);
+	// rooms can reference anything the scene defines
+	roomSyms = malloc(strlen(sceneSyms) + 64);
+	sprintf(roomSyms, "ENTRY_POINT = 0x03000000;\n%s", sceneSyms);
 	
 	// find and compile the rooms
-	char *fn = syms + strlen(syms) + 1;
 	sb_foreach(sourcePaths, {
 		const char *path = *each;
 		const char *room;
@@ -535,13 +589,16 @@ const char *Fast64_CompileSceneAndRooms(const char *root, sb_array(char *, sourc
 			continue;
 		if ((room = strstr(path, "_room_"))) {
 			sscanf(room, "_room_%d", &idx);
-			sprintf(fn, "%s" "test_room_%d.zmap", WHERE_TMP, idx);
-			if ((error = Fast64_CompileSource(syms, root, path, fn)))
+			snprintf(fn, sizeof(fn), "%s" "test_room_%d.zmap", WHERE_TMP, idx);
+			if ((error = Fast64_CompileSource(roomSyms, root, path, fn, 0)))
 				goto L_earlyExit;
 		}
 	})
 	
 L_earlyExit:
+	free(syms);
+	free(sceneSyms);
+	free(roomSyms);
 	return error;
 }
 
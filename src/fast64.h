@@ -10,5 +10,10 @@
 #include "stretchy_buffer.h"
 
 const char *Fast64_Compile(const char *path);
+// compiles the scene and its rooms to WHERE_TMP, test_scene.zscene and test_room_%d.zmap
+const char *Fast64_CompileSceneAndRooms(const char *root, sb_array(char *, sourcePaths));
+
+// fast64-compile.c
+const char *Fast64_CompileSourceNative(const char *syms, const char *root, const char *source, const char *out, char **symsOut);
 
 #endif // Z64SCENE_FAST64_H_INCLUDED
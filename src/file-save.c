@@ -0,0 +1,439 @@
+//
+// file-save.c
+//
+// atomic, crash-safe saving of a set of files
+//
+// every file in a group is first written to a temp file beside its
+// destination and flushed to disk, the temp files being written in
+// parallel; only once all of them made it are they renamed into place,
+// with each file being replaced moved aside as a backup first
+//
+// a journal beside the first file lists the renames while they happen,
+// so a save interrupted partway through can be rolled back when the
+// files are next loaded, instead of leaving a mismatched set on disk;
+// the journal is a text file with one line per file and an end marker:
+//
+//   z64scene-save 1
+//   <1 if the file existed before, else 0> <filename>
+//   end
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#include "file-save.h"
+#include "file.h"
+#include "logging.h"
+#include "misc.h"
+
+#define FILE_SAVE_MAX_JOBS 8
+#define FILE_SAVE_PATH_MAX 2048
+#define FILE_SAVE_JOURNAL_MAGIC "z64scene-save 1"
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+struct FileSaveEntry
+{
+	char *filename;
+	void *data; // the pieces that aren't borrowed, joined
+	sb_array(struct FileSpan, spans);
+	size_t size;
+	bool existed;
+	const char *error;
+};
+
+struct FileSaveGroup
+{
+	sb_array(struct FileSaveEntry, entries);
+	int next; // index of the next entry to claim, shared by all workers
+	pthread_mutex_t lock;
+};
+
+#if 1 // region: private functions
+
+static const char *FileSavePath(char dst[FILE_SAVE_PATH_MAX], const char *filename, const char *suffix)
+{
+	snprintf(dst, FILE_SAVE_PATH_MAX, "%s%s", filename, suffix);
+	
+	return dst;
+}
+
+// the journal lives in the same folder as the files it covers
+static const char *FileSaveJournalPath(char dst[FILE_SAVE_PATH_MAX], const char *filename)
+{
+	const char *slash = MAX(strrchr(filename, '/'), strrchr(filename, '\\'));
+	int folderLength = slash ? slash - filename + 1 : 0;
+	
+	snprintf(dst, FILE_SAVE_PATH_MAX, "%.*s%s", folderLength, filename, FILE_SAVE_JOURNAL_FILENAME);
+	
+	return dst;
+}
+
+// flush through to the disk, not just to the os
+static int FileSaveSync(FILE *fp)
+{
+	if (fflush(fp))
+		return -1;
+	
+	#ifdef _WIN32
+		return _commit(_fileno(fp));
+	#else
+		return fsync(fileno(fp));
+	#endif
+}
+
+// every piece in order, as few calls as the os allows
+static bool FileSaveWriteSpans(FILE *fp, const struct FileSpan *spans, int numSpans)
+{
+	#ifdef _WIN32
+		for (int i = 0; i < numSpans; ++i)
+			if (fwrite(spans[i].data, 1, spans[i].size, fp) != spans[i].size)
+				return false;
+		
+		return true;
+	#else
+		struct iovec iov[MIN(IOV_MAX, 1024)];
+		int fd = fileno(fp);
+		size_t skip = 0; // bytes of the first piece already written
+		
+		// anything buffered would end up after the pieces
+		if (fflush(fp))
+			return false;
+		
+		while (numSpans)
+		{
+			int count = 0;
+			ssize_t wrote;
+			
+			for ( ; count < numSpans && count < (int)(sizeof(iov) / sizeof(*iov)); ++count)
+				iov[count] = (struct iovec){ (void*)spans[count].data, spans[count].size };
+			iov[0].iov_base = ((uint8_t*)iov[0].iov_base) + skip;
+			iov[0].iov_len -= skip;
+			
+			if ((wrote = writev(fd, iov, count)) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			
+			// a short write can stop partway through a piece
+			for (wrote += skip; numSpans && (size_t)wrote >= spans->size; --numSpans, ++spans)
+				wrote -= spans->size;
+			skip = wrote;
+		}
+		
+		return true;
+	#endif
+}
+
+static const char *FileSaveWriteTemp(const struct FileSaveEntry *entry)
+{
+	char path[FILE_SAVE_PATH_MAX];
+	FILE *fp;
+	bool ok;
+	
+	if (!(fp = fopen(FileSavePath(path, entry->filename, FILE_SAVE_TEMP_SUFFIX), "wb")))
+		return "failed to open temp file for writing";
+	
+	ok = FileSaveWriteSpans(fp, entry->spans, sb_count(entry->spans)) && !FileSaveSync(fp);
+	
+	if (fclose(fp) || !ok)
+		return "failed to write temp file";
+	
+	return 0;
+}
+
+static void *FileSaveWorker(void *udata)
+{
+	struct FileSaveGroup *group = udata;
+	int numEntries = sb_count(group->entries);
+	
+	for (;;)
+	{
+		int index;
+		
+		pthread_mutex_lock(&group->lock);
+		index = group->next++;
+		pthread_mutex_unlock(&group->lock);
+		
+		if (index >= numEntries)
+			break;
+		
+		group->entries[index].error = FileSaveWriteTemp(&group->entries[index]);
+	}
+	
+	return 0;
+}
+
+static const char *FileSaveWriteTemps(struct FileSaveGroup *group)
+{
+	pthread_t threads[FILE_SAVE_MAX_JOBS];
+	int jobs = MIN(sb_count(group->entries), FILE_SAVE_MAX_JOBS);
+	
+	group->next = 0;
+	pthread_mutex_init(&group->lock, 0);
+	for (int i = 0; i < jobs; ++i)
+		if (pthread_create(&threads[i], 0, FileSaveWorker, group))
+			Die("failed to create worker thread");
+	for (int i = 0; i < jobs; ++i)
+		pthread_join(threads[i], 0);
+	pthread_mutex_destroy(&group->lock);
+	
+	sb_foreach(group->entries, {
+		if (each->error)
+			return each->filename;
+	})
+	
+	return 0;
+}
+
+static bool FileSaveWriteJournal(const char *journalPath, struct FileSaveGroup *group)
+{
+	FILE *fp = fopen(journalPath, "w");
+	bool ok;
+	
+	if (!fp)
+		return false;
+	
+	fprintf(fp, "%s\n", FILE_SAVE_JOURNAL_MAGIC);
+	sb_foreach(group->entries, {
+		fprintf(fp, "%d %s\n", each->existed, each->filename);
+	})
+	fprintf(fp, "end\n");
+	ok = !FileSaveSync(fp);
+	
+	return !fclose(fp) && ok;
+}
+
+static void FileSaveRemoveTemps(struct FileSaveGroup *group)
+{
+	char path[FILE_SAVE_PATH_MAX];
+	
+	sb_foreach(group->entries, {
+		remove(FileSavePath(path, each->filename, FILE_SAVE_TEMP_SUFFIX));
+	})
+}
+
+// puts back whatever was there before the group started renaming
+static void FileSaveRollback(struct FileSaveGroup *group)
+{
+	char path[FILE_SAVE_PATH_MAX];
+	
+	sb_foreach(group->entries, {
+		if (each->existed)
+		{
+			// no backup means this file was never replaced
+			if (FileExists(FileSavePath(path, each->filename, FILE_SAVE_BACKUP_SUFFIX)))
+			{
+				remove(each->filename);
+				if (rename(path, each->filename))
+					LogError("failed to restore '%s' from '%s'", each->filename, path);
+			}
+		}
+		else
+			remove(each->filename);
+	})
+	
+	FileSaveRemoveTemps(group);
+}
+
+#endif // endregion
+
+struct FileSaveGroup *FileSaveGroupNew(void)
+{
+	return Calloc(1, sizeof(struct FileSaveGroup));
+}
+
+void FileSaveGroupAdd(struct FileSaveGroup *group, struct File *file, const char *filename)
+{
+	struct FileSpan span = { file->data, file->size };
+	
+	FileSaveGroupAddSpans(group, &span, 1, filename);
+}
+
+void FileSaveGroupAddSpans(struct FileSaveGroup *group, const struct FileSpan *spans, int numSpans, const char *filename)
+{
+	struct FileSaveEntry *entry = 0;
+	size_t ownedBytes = 0;
+	uint8_t *owned;
+	
+	sb_foreach(group->entries, {
+		if (!strcmp(each->filename, filename))
+		{
+			entry = each;
+			free(entry->data);
+			sb_clear(entry->spans);
+			break;
+		}
+	})
+	
+	if (!entry)
+	{
+		sb_push(group->entries, ((struct FileSaveEntry){ .filename = Strdup(filename) }));
+		entry = &sb_last(group->entries);
+	}
+	
+	for (int i = 0; i < numSpans; ++i)
+		if (!spans[i].isBorrowed)
+			ownedBytes += spans[i].size;
+	
+	entry->size = 0;
+	entry->data = owned = Calloc(1, MAX(1, ownedBytes));
+	
+	for (int i = 0; i < numSpans; ++i)
+	{
+		struct FileSpan span = spans[i];
+		
+		if (!span.size)
+			continue;
+		
+		if (!span.isBorrowed)
+		{
+			span.data = memcpy(owned, span.data, span.size);
+			owned += span.size;
+		}
+		
+		sb_push(entry->spans, span);
+		entry->size += span.size;
+	}
+}
+
+void FileSaveGroupFree(struct FileSaveGroup *group)
+{
+	if (!group)
+		return;
+	
+	sb_foreach(group->entries, {
+		free(each->filename);
+		free(each->data);
+		sb_free(each->spans);
+	})
+	sb_free(group->entries);
+	free(group);
+}
+
+int FileSaveGroupCommit(struct FileSaveGroup *group)
+{
+	char journalPath[FILE_SAVE_PATH_MAX];
+	char path[FILE_SAVE_PATH_MAX];
+	const char *failed;
+	
+	if (!sb_count(group->entries))
+	{
+		FileSaveGroupFree(group);
+		return EXIT_SUCCESS;
+	}
+	
+	// nothing has been touched until all the temp files are written
+	if ((failed = FileSaveWriteTemps(group)))
+	{
+		FileSetError("failed to write '%s', nothing was saved", failed);
+		FileSaveRemoveTemps(group);
+		FileSaveGroupFree(group);
+		return EXIT_FAILURE;
+	}
+	
+	// stale backups would be mistaken for this save's during a rollback
+	sb_foreach(group->entries, {
+		each->existed = FileExists(each->filename);
+		remove(FileSavePath(path, each->filename, FILE_SAVE_BACKUP_SUFFIX));
+	})
+	FileSaveJournalPath(journalPath, group->entries[0].filename);
+	if (!FileSaveWriteJournal(journalPath, group))
+	{
+		FileSetError("failed to write save journal '%s', nothing was saved", journalPath);
+		remove(journalPath);
+		FileSaveRemoveTemps(group);
+		FileSaveGroupFree(group);
+		return EXIT_FAILURE;
+	}
+	
+	// move each old file aside, then the new one into its place
+	sb_foreach(group->entries, {
+		char temp[FILE_SAVE_PATH_MAX];
+		
+		FileSavePath(path, each->filename, FILE_SAVE_BACKUP_SUFFIX);
+		FileSavePath(temp, each->filename, FILE_SAVE_TEMP_SUFFIX);
+		
+		if ((each->existed && rename(each->filename, path))
+			|| rename(temp, each->filename)
+		)
+		{
+			FileSetError("failed to replace '%s', nothing was saved", each->filename);
+			FileSaveRollback(group);
+			remove(journalPath);
+			FileSaveGroupFree(group);
+			return EXIT_FAILURE;
+		}
+	})
+	
+	// the save is complete once the journal is gone
+	remove(journalPath);
+	sb_foreach(group->entries, {
+		if (each->existed)
+			remove(FileSavePath(path, each->filename, FILE_SAVE_BACKUP_SUFFIX));
+	})
+	
+	FileSaveGroupFree(group);
+	
+	return EXIT_SUCCESS;
+}
+
+bool FileSaveGroupRecover(const char *filename)
+{
+	char journalPath[FILE_SAVE_PATH_MAX];
+	char line[FILE_SAVE_PATH_MAX + 8];
+	struct FileSaveGroup *group;
+	bool isComplete = false;
+	FILE *fp;
+	
+	if (!(fp = fopen(FileSaveJournalPath(journalPath, filename), "r")))
+		return false;
+	
+	group = FileSaveGroupNew();
+	if (fgets(line, sizeof(line), fp) && !strncmp(line, FILE_SAVE_JOURNAL_MAGIC, strlen(FILE_SAVE_JOURNAL_MAGIC)))
+	{
+		while (fgets(line, sizeof(line), fp))
+		{
+			line[strcspn(line, "\r\n")] = '\0';
+			
+			if (!strcmp(line, "end"))
+			{
+				isComplete = true;
+				break;
+			}
+			
+			if ((*line == '0' || *line == '1') && line[1] == ' ' && line[2])
+				sb_push(group->entries, ((struct FileSaveEntry){
+					.filename = Strdup(line + 2),
+					.existed = *line == '1',
+				}));
+		}
+	}
+	fclose(fp);
+	
+	LogWarn("rolling back interrupted save of %d files, see '%s'", sb_count(group->entries), journalPath);
+	
+	// an incomplete journal means renaming never started
+	if (isComplete)
+		FileSaveRollback(group);
+	else
+		FileSaveRemoveTemps(group);
+	
+	remove(journalPath);
+	FileSaveGroupFree(group);
+	
+	return true;
+}
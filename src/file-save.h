@@ -0,0 +1,48 @@
+//
+// file-save.h
+//
+// atomic, crash-safe saving of a set of files
+//
+
+#ifndef FILE_SAVE_H_INCLUDED
+#define FILE_SAVE_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct File;
+struct FileSaveGroup;
+
+// one piece of a file's contents, see FileSaveGroupAddSpans()
+struct FileSpan
+{
+	const void *data;
+	size_t size;
+	bool isBorrowed; // if true, only referenced, so it must outlive the group
+};
+
+// journal left beside the first file of a save while it is being renamed into place
+#define FILE_SAVE_JOURNAL_FILENAME ".z64scene-save.journal"
+#define FILE_SAVE_TEMP_SUFFIX ".tmp"
+#define FILE_SAVE_BACKUP_SUFFIX ".bak"
+
+struct FileSaveGroup *FileSaveGroupNew(void);
+
+// the contents are copied, so the file may be reused right away; adding
+// the same filename twice replaces the earlier contents
+void FileSaveGroupAdd(struct FileSaveGroup *group, struct File *file, const char *filename);
+
+// same, for contents made of pieces, which are written out one after the
+// other with vectored io instead of being joined first; only the pieces
+// that aren't borrowed are copied
+void FileSaveGroupAddSpans(struct FileSaveGroup *group, const struct FileSpan *spans, int numSpans, const char *filename);
+
+// writes every file or none of them, then frees the group; on failure,
+// returns EXIT_FAILURE with the reason in FileGetError()
+int FileSaveGroupCommit(struct FileSaveGroup *group);
+void FileSaveGroupFree(struct FileSaveGroup *group);
+
+// rolls back a save that was interrupted in the folder containing filename
+bool FileSaveGroupRecover(const char *filename);
+
+#endif // FILE_SAVE_H_INCLUDED
@@ -16,7 +16,7 @@
 	static char X##Data[] = "\0\0" #X; \
 	static char *X = X##Data + FILE_LIST_FILE_ID_PREFIX_LEN;
 
-static char sFileError[2048];
+static __thread char sFileError[2048]; // per thread, as workers load files too
 FILE_LIST_DEFINE_PREFIX(FileListHasPrefixId)
 FILE_LIST_DEFINE_PREFIX(FileListAttribIsHead) // owns the strings it references
 FILE_LIST_DEFINE_PREFIX(FileListAttribIsSortedById) // specifies file list is sorted by id
@@ -58,21 +58,36 @@ struct File *FileNew(const char *filename, size_t size)
 	return result;
 }
 
-struct File *FileFromFilename(const char *filename)
+struct File *FileTryFromFilename(const char *filename)
 {
-	struct File *result = Calloc(1, sizeof(*result));
+	struct File *result;
 	FILE *fp;
-	
-	if (!filename || !*filename) Die("empty filename");
-	if (!(fp = fopen(filename, "rb"))) Die("failed to open '%s' for reading", filename);
-	if (fseek(fp, 0, SEEK_END)) Die("error moving read head '%s'", filename);
-	if (!(result->size = ftell(fp))) Die("error reading '%s', empty?", filename);
-	if (fseek(fp, 0, SEEK_SET)) Die("error moving read head '%s'", filename);
+	long size;
+	
+	if (!filename || !*filename) { FileSetError("empty filename"); return 0; }
+	if (!(fp = fopen(filename, "rb"))) { FileSetError("failed to open '%s' for reading", filename); return 0; }
+	if (fseek(fp, 0, SEEK_END)
+		|| (size = ftell(fp)) <= 0
+		|| fseek(fp, 0, SEEK_SET)
+	)
+	{
+		fclose(fp);
+		FileSetError("error reading '%s', empty?", filename);
+		return 0;
+	}
+	result = Calloc(1, sizeof(*result));
+	result->size = size;
 	result->data = Calloc(1, result->size + 1); // zero terminator on strings
 	result->dataEnd = ((uint8_t*)result->data) + result->size;
 	if (fread(result->data, 1, result->size, fp) != result->size)
-		Die("error reading contents of '%s'", filename);
-	if (fclose(fp)) Die("error closing file '%s' after reading", filename);
+	{
+		fclose(fp);
+		free(result->data);
+		free(result);
+		FileSetError("error reading contents of '%s'", filename);
+		return 0;
+	}
+	if (fclose(fp)) LogWarn("error closing file '%s' after reading", filename);
 	result->filename = Strdup(filename);
 	// slash direction normalization
 	for (char *tmp = result->filename; *tmp; ++tmp)
@@ -88,6 +103,16 @@ struct File *FileFromFilename(const char *filename)
 	return result;
 }
 
+struct File *FileFromFilename(const char *filename)
+{
+	struct File *result = FileTryFromFilename(filename);
+	
+	if (!result)
+		Die("%s", FileGetError());
+	
+	return result;
+}
+
 struct File *FileFromData(void *data, size_t size, bool ownsData)
 {
 	struct File *result = Calloc(1, sizeof(*result));
@@ -23,6 +23,7 @@ struct File
 bool FileExists(const char *filename);
 struct File *FileNew(const char *filename, size_t size);
 struct File *FileFromFilename(const char *filename);
+struct File *FileTryFromFilename(const char *filename); // 0 with the reason in FileGetError() on failure
 struct File *FileFromData(void *data, size_t size, bool ownsData);
 int FileToFilename(struct File *file, const char *filename);
 const char *FileGetError(void);
@@ -306,6 +306,16 @@ void GizmoRemoveChildren(struct Gizmo *gizmo)
 	sb_clear(gizmo->children);
 }
 
+int GizmoGetNumChildren(struct Gizmo *gizmo)
+{
+	return sb_count(gizmo->children);
+}
+
+Vec3f *GizmoGetChild(struct Gizmo *gizmo, int index)
+{
+	return gizmo->children[index].pos;
+}
+
 void GizmoSetPosition(struct Gizmo *gizmo, float x, float y, float z)
 {
 	gizmo->pos = (Vec3f){x, y, z};
@@ -12,6 +12,8 @@ struct Gizmo *GizmoNew(void);
 void GizmoFree(struct Gizmo *gizmo);
 void GizmoAddChild(struct Gizmo *gizmo, Vec3f *childPos);
 void GizmoRemoveChildren(struct Gizmo *gizmo);
+int GizmoGetNumChildren(struct Gizmo *gizmo);
+Vec3f *GizmoGetChild(struct Gizmo *gizmo, int index);
 bool GizmoHasFocus(struct Gizmo *gizmo);
 bool GizmoIsHovered(struct Gizmo *gizmo);
 void GizmoSetPosition(struct Gizmo *gizmo, float x, float y, float z);
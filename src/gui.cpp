@@ -6,7 +6,9 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <functional>
+#include <unordered_map>
 #include <climits>
+#include <pthread.h>
 #include "misc.h"
 #include "gui.h"
 #include "toml-parsers.hpp"
@@ -20,6 +22,9 @@ extern "C" {
 #include "project.h"
 #include "logging.h"
 #include "window.h"
+#include "journal.h"
+#include "object-index.h"
+#include "mesh-cache.h"
 
 #include "examples/anim_util.h"
 #include "src/webp/decode.h"
@@ -33,6 +38,9 @@ extern "C" {
 #define CLAMP(VALUE, MIN, MAX) (((VALUE) < (MIN)) ? (MIN) : ((VALUE) > (MAX)) ? (MAX) : (VALUE))
 #define WRAP(VALUE, MIN, MAX) (((VALUE) < (MIN)) ? (MAX) : ((VALUE) > (MAX)) ? (MIN) : (VALUE))
 
+// ambient, diffuse a, diffuse b, fog color, fog distance
+#define ENV_STRIP_BANDS 5
+
 // allows using mousewheel while hovering the last-drawn combo box to quickly change its value
 #define IMGUI_COMBO_HOVER_ONCHANGE(CURRENT, HOWMANY, ONCHANGE) \
 	if (ImGui::IsItemHovered() && ImGui::GetIO().MouseWheel) \
@@ -76,6 +84,7 @@ extern "C" {
 		current -= 1; \
 		int SWAPDIR = -1; (void)SWAPDIR; \
 		ON_RAISE_LOWER \
+		JournalClear(); \
 	} \
 	\
 	ImGui::SameLine(); \
@@ -91,12 +100,14 @@ extern "C" {
 		current += 1; \
 		int SWAPDIR = 1; (void)SWAPDIR; \
 		ON_RAISE_LOWER \
+		JournalClear(); \
 	} \
 	\
 	ImGui::SameLine(); \
 	if (ImGui::Button("Add " TYPENAME "##" NAMESPACE)) \
 	{ \
 		ON_ADD \
+		JournalClear(); \
 	} \
 	\
 	ImGui::SameLine(); \
@@ -110,6 +121,7 @@ extern "C" {
 		ON_DELETE \
 		\
 		sb_remove(LIST, current - LIST); \
+		JournalClear(); \
 		\
 		if (current > &sb_last(LIST)) \
 			current -= 1; \
@@ -146,6 +158,17 @@ DECL_POPUP(AddNewObjectSearch)
 
 #define GUI_ERROR_POPUP_ID "Error##GuiMainErrorMessage"
 
+// rgba, as the rest of the program has it, to what imgui expects
+static inline uint32_t ByteswapColor(uint32_t color)
+{
+	uint32_t newcolor = 0;
+	newcolor |= ((color >> 0) & 0xff) << 24;
+	newcolor |= ((color >> 8) & 0xff) << 16;
+	newcolor |= ((color >> 16) & 0xff) << 8;
+	newcolor |= ((color >> 24) & 0xff) << 0;
+	return newcolor;
+}
+
 #endif
 
 #if 1 // region: private types
@@ -300,6 +323,13 @@ public:
 	{
 		lines.emplace_back(x1, y1, x2, y2, color, thickness);
 	}
+	
+	void PushLines(const struct GuiLine *src, int count)
+	{
+		lines.reserve(lines.size() + count);
+		for (int i = 0; i < count; ++i)
+			lines.emplace_back(src[i].x1, src[i].y1, src[i].x2, src[i].y2, ByteswapColor(src[i].color), src[i].thickness);
+	}
 
 	void FlushLines(void)
 	{
@@ -327,12 +357,13 @@ struct LinkedStringFunc
 static GuiSettings gGuiSettings;
 static Scene *gScene;
 static GuiInterop *gGui;
+static pthread_t gGuiThread; // the one that set gGui, see GuiIsMainThread()
 
 #endif
 
 #if 1 // region: private functions
 
-std::map<std::string, uint32_t> GetObjectSymbolAddresses(uint16_t objId)
+const std::map<std::string, uint32_t> &GetObjectSymbolAddresses(uint16_t objId)
 {
 	return gGuiSettings.objectDatabase.GetEntry(objId).symbolAddresses;
 }
@@ -377,6 +408,60 @@ static void HelpMarker(const char *desc)
 	}
 }
 
+// the color of one band of the day strip, for the given time of day
+static ZeldaRGB EnvStripBand(const ZeldaLight *light, int band)
+{
+	switch (band)
+	{
+		case 0: return light->ambient;
+		case 1: return light->diffuse_a;
+		case 2: return light->diffuse_b;
+		case 3: return light->fog;
+		
+		// fog distance, brighter is farther
+		default: {
+			uint8_t v = (light->fog_near & 0x3ff) * 255 / 0x3ff;
+			ZeldaRGB gray = { v, v, v };
+			return gray;
+		}
+	}
+}
+
+// one pixel per game minute, and one band per color that changes with it;
+// returns an error message, or 0
+static const char *EnvStripExport(const char *fn, const ZeldaLight *table, int count)
+{
+	const int bandHeight = 16;
+	int height = ENV_STRIP_BANDS * bandHeight;
+	uint8_t *pixels = (uint8_t*)malloc(count * height * 4);
+	int isWritten;
+	
+	if (!pixels)
+		return "not enough memory for the day strip";
+	
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < count; ++x)
+		{
+			ZeldaRGB color = EnvStripBand(&table[x], y / bandHeight);
+			uint8_t *dst = pixels + (y * count + x) * 4;
+			
+			dst[0] = color.r;
+			dst[1] = color.g;
+			dst[2] = color.b;
+			dst[3] = 0xff;
+		}
+	}
+	
+	isWritten = stbi_write_png(fn, count, height, 4, pixels, 0);
+	free(pixels);
+	
+	if (!isWritten)
+		return "failed to write the day strip, is the folder writable?";
+	
+	return 0;
+}
+
 // copied from 'textures' tab, may consolidate that to use this function later
 static int DataBlobToGlTexture(struct DataBlob *blob, GLuint *glResult)
 {
@@ -666,6 +751,10 @@ void TryMigrateVisualAndCollisionDataFrom(struct Scene *newScene)
 	// clear scene render cache
 	WindowClearCache();
 	
+	// the history points into data that was just swapped out and is
+	// about to be freed along with newScene
+	JournalClear();
+	
 	// fallback: save and reload amalgamated scene
 	// (consider this if stale pointers ever cause issues)
 	//const char *where = WHERE_TMP "amalgamated_scene.zscene";
@@ -867,70 +956,239 @@ static bool PickColor4U8(const char* label, uint8_t *rgba, ImGuiColorEditFlags f
 	VAR = CONCAT(tmp, __LINE__); \
 }
 
-// determine which objects are missing, and which are potentially unused
-static void RefreshObjectStats(void)
+// object dependency reference counts for the actors and doors in view,
+// maintained incrementally so that edits don't rescan every instance
+static struct ObjectRefs
+{
+	std::unordered_map<uint16_t, int> actorCounts; // actor id -> how many placed
+	std::unordered_map<uint16_t, int> objectRefs; // object id -> how many actors need it
+	int numInstances; // the actors and doors counted, to catch edits made some other way
+} sObjectRefs;
+
+// add or remove 'delta' placements of an actor, returns objects affected
+static void ObjectRefsApplyActor(uint16_t actorId, int delta, std::vector<uint16_t> &touched)
 {
-	sb_array(ObjectEntry, haveObjects) = *(gGui->objectList);
-	sb_array(ObjectEntry, missingObjects) = gGui->missingObjects;
-	sb_array(ObjectEntry, unusedObjects) = gGui->unusedObjects;
+	auto &type = gGuiSettings.actorDatabase.GetEntry(actorId);
 	
-	sb_clear(missingObjects);
-	sb_clear(unusedObjects);
+	if (!(sObjectRefs.actorCounts[actorId] += delta))
+		sObjectRefs.actorCounts.erase(actorId);
 	
-	LogDebug("RefreshObjectStats()");
+	if (type.isEmpty)
+		return;
+	
+	for (auto needObject : type.objects) {
+		if (needObject <= 0x0001) // filter global obj dep
+			continue;
+		if (gGui->sceneHeader->specialFiles // filter subkeep obj deps
+			&& needObject == gGui->sceneHeader->specialFiles->subkeepObjectId
+		) {
+			gGui->subkeepChildren += delta;
+			continue;
+		}
+		sObjectRefs.objectRefs[needObject] += delta;
+		touched.push_back(needObject);
+	}
+}
+
+// bring one object's entries in the object/missing/unused lists up to date
+static void ObjectRefsSyncObject(uint16_t objectId)
+{
+	auto it = sObjectRefs.objectRefs.find(objectId);
+	int refs = (it == sObjectRefs.objectRefs.end()) ? 0 : it->second;
+	ObjectEntry *have = ObjectListContains(*(gGui->objectList), objectId);
+	ObjectEntry *missing = ObjectListContains(gGui->missingObjects, objectId);
+	ObjectEntry *unused = ObjectListContains(gGui->unusedObjects, objectId);
 	
-	sb_foreach(haveObjects, {
-		each->children = 0;
+	if (have)
+	{
+		have->children = refs;
+		if (refs == 0 && !unused)
+			sb_push(gGui->unusedObjects, *have);
+		else if (refs && unused)
+			sb_remove(gGui->unusedObjects, unused - gGui->unusedObjects);
+	}
+	else if (refs)
+	{
+		if (!missing)
+			missing = &sb_push(gGui->missingObjects, ((ObjectEntry){
+				.id = objectId,
+				.type = OBJECT_ENTRY_TYPE_IMPLIED,
+			}));
+		missing->children = refs;
+	}
+	
+	if (missing && (have || !refs))
+		sb_remove(gGui->missingObjects, missing - gGui->missingObjects);
+	
+	if (it != sObjectRefs.objectRefs.end() && refs == 0)
+		sObjectRefs.objectRefs.erase(it);
+}
+
+// after object list edits; cost is the object lists, not the instances
+static void ObjectRefsSyncObjectLists(void)
+{
+	sb_clear(gGui->missingObjects);
+	sb_clear(gGui->unusedObjects);
+	
+	sb_foreach(*(gGui->objectList), {
+		auto it = sObjectRefs.objectRefs.find(each->id);
+		each->children = (it == sObjectRefs.objectRefs.end()) ? 0 : it->second;
+		if (each->children == 0)
+			sb_push(gGui->unusedObjects, *each);
 	})
-	gGui->subkeepChildren = 0;
 	
-	for (int i = 0; i < 2; ++i)
+	for (auto &it : sObjectRefs.objectRefs)
+		if (it.second && !ObjectListContains(*(gGui->objectList), it.first))
+			sb_push(gGui->missingObjects, ((ObjectEntry){
+				.id = it.first,
+				.children = it.second,
+				.type = OBJECT_ENTRY_TYPE_IMPLIED,
+			}));
+}
+
+// placement counts of every actor id in the lists in view
+static std::unordered_map<uint16_t, int> ObjectRefsCountActors(void)
+{
+	std::unordered_map<uint16_t, int> counts;
+	
+	sb_foreach(*(gGui->actorList), { counts[each->id] += 1; })
+	sb_foreach(*(gGui->doorList), { counts[each->id] += 1; })
+	
+	return counts;
+}
+
+// whether inst lives in the actor or door list in view
+static bool ObjectRefsIsCounted(const Instance *inst)
+{
+	for (auto list : { gGui->actorList, gGui->doorList })
+		if (list && *list && inst >= *list && inst < *list + sb_count(*list))
+			return true;
+	
+	return false;
+}
+
+// one placement of an actor came or went
+static void ObjectRefsChangeInstances(uint16_t actorId, int delta)
+{
+	std::vector<uint16_t> touched;
+	
+	ObjectRefsApplyActor(actorId, delta, touched);
+	sObjectRefs.numInstances += delta;
+	
+	for (auto id : touched)
+		ObjectRefsSyncObject(id);
+}
+
+// an instance's actor id was edited
+static void ObjectRefsChangeActorId(uint16_t oldId, uint16_t newId)
+{
+	std::vector<uint16_t> touched;
+	
+	ObjectRefsApplyActor(oldId, -1, touched);
+	ObjectRefsApplyActor(newId, 1, touched);
+	
+	for (auto id : touched)
+		ObjectRefsSyncObject(id);
+}
+
+// an undo or redo rewrote some bytes; if they cover the id of an actor
+// or door in view, selected or not, its dependencies move with it
+static void ObjectRefsOnJournalApply(void *addr, size_t size, const void *replaced)
+{
+	for (auto list : { gGui->actorList, gGui->doorList })
 	{
-		sb_array(Instance, list);
+		if (!list || !*list)
+			continue;
 		
-		switch (i) {
-			case 0: list = *(gGui->actorList); break;
-			case 1: list = *(gGui->doorList); break;
-		}
+		Instance *first = *list;
+		const uint8_t *addr8 = (const uint8_t*)addr;
 		
-		sb_foreach_named(list, actor, {
-			auto &type = gGuiSettings.actorDatabase.GetEntry(actor->id);
-			
-			if (type.isEmpty)
-				continue;
-			
-			for (auto needObject : type.objects) {
-				if (needObject <= 0x0001) // filter global obj dep
-					continue;
-				if (gGui->sceneHeader->specialFiles // filter subkeep obj deps
-					&& needObject == gGui->sceneHeader->specialFiles->subkeepObjectId
-				) {
-					gGui->subkeepChildren += 1;
-					continue;
-				}
-				ObjectEntry *used = ObjectListContains(haveObjects, needObject);
-				if (used) {
-					used->children += 1;
-					continue;
-				}
-				ObjectEntry *missing = ObjectListContains(missingObjects, needObject);
-				if (!missing)
-					missing = &sb_push(missingObjects, ((ObjectEntry){
-						.id = needObject,
-						.type = OBJECT_ENTRY_TYPE_IMPLIED,
-					}));
-				missing->children += 1;
-			}
-		})
+		if (addr8 < (const uint8_t*)first || addr8 >= (const uint8_t*)(first + sb_count(*list)))
+			continue;
+		
+		Instance *inst = first + (addr8 - (const uint8_t*)first) / sizeof(*first);
+		const uint8_t *idBytes = (const uint8_t*)&inst->id;
+		uint16_t oldId = inst->id;
+		uint8_t *oldBytes = (uint8_t*)&oldId;
+		
+		for (size_t i = 0; i < sizeof(oldId); ++i)
+			if (idBytes + i >= addr8 && idBytes + i < addr8 + size)
+				oldBytes[i] = ((const uint8_t*)replaced)[idBytes + i - addr8];
+		
+		if (oldId != inst->id)
+			ObjectRefsChangeActorId(oldId, inst->id);
+		
+		return;
 	}
+}
+
+// determine which objects are missing, and which are potentially unused
+static void RefreshObjectStats(void)
+{
+	std::vector<uint16_t> touched;
 	
-	sb_foreach(haveObjects, {
-		if (each->children == 0)
-			sb_push(unusedObjects, *each);
-	})
+	LogDebug("RefreshObjectStats()");
+	
+	sObjectRefs.actorCounts.clear();
+	sObjectRefs.objectRefs.clear();
+	gGui->subkeepChildren = 0;
+	
+	for (auto &it : ObjectRefsCountActors())
+		ObjectRefsApplyActor(it.first, it.second, touched);
+	sObjectRefs.numInstances = sb_count(*gGui->actorList) + sb_count(*gGui->doorList);
+	
+	ObjectRefsSyncObjectLists();
+}
+
+extern "C" void GuiInstanceAdded(const struct Instance *inst)
+{
+	if (ObjectRefsIsCounted(inst))
+		ObjectRefsChangeInstances(inst->id, 1);
+}
+
+extern "C" void GuiInstanceRemoved(const struct Instance *inst)
+{
+	if (ObjectRefsIsCounted(inst))
+		ObjectRefsChangeInstances(inst->id, -1);
+}
+
+extern "C" void GuiInstanceIdChanged(const struct Instance *inst, uint16_t oldId)
+{
+	if (ObjectRefsIsCounted(inst) && inst->id != oldId)
+		ObjectRefsChangeActorId(oldId, inst->id);
+}
+
+// called every frame, does as little work as each kind of edit allows;
+// instances being added, removed, or given another id (by the ui or by
+// undo and redo) adjust the counts where that happens, see GuiInstance*()
+static void UpdateObjectStats(void)
+{
+	bool rebuild = false;
+	bool objectsChanged = false;
+	
+	// a different header, scene, subkeep, or actor database
+	ON_CHANGE(gGui->doorList) rebuild = true;
+	ON_CHANGE(gGui->actorList) rebuild = true;
+	ON_CHANGE(gGui->objectList) rebuild = true;
+	ON_CHANGE(gGui->sceneHeader->specialFiles) rebuild = true;
+	if (gGui->sceneHeader->specialFiles) { ON_CHANGE(gGui->sceneHeader->specialFiles->subkeepObjectId) rebuild = true; }
+	ON_CHANGE(gGuiSettings.actorDatabase.entries.size()) rebuild = true;
+	
+	// instances added or removed without telling us
+	if (sObjectRefs.numInstances != sb_count(*gGui->actorList) + sb_count(*gGui->doorList))
+	{
+		LogDebug("instance counts changed elsewhere, recounting");
+		rebuild = true;
+	}
+	
+	// object list edits
+	ON_CHANGE(*(gGui->objectList)) objectsChanged = true;
+	ON_CHANGE(sb_count(*gGui->objectList)) objectsChanged = true;
 	
-	gGui->unusedObjects = unusedObjects;
-	gGui->missingObjects = missingObjects;
+	if (rebuild)
+		RefreshObjectStats();
+	else if (objectsChanged)
+		ObjectRefsSyncObjectLists();
 }
 
 static ActorDatabase::Entry &InstanceTypeSearch(void)
@@ -1129,6 +1387,7 @@ static Instance *InstanceTab(sb_array(struct Instance, *instanceList), const cha
 	ImGui::SeparatorText("Data");
 	
 	// id w/ search
+	uint16_t oldId = inst->id;
 	PickHexValueU16("ID##Instance", &inst->id);
 	ImGui::SameLine();
 	if (ImGui::Button("Search##Instance"))
@@ -1142,6 +1401,7 @@ static Instance *InstanceTab(sb_array(struct Instance, *instanceList), const cha
 		
 		ImGui::EndPopup();
 	}
+	GuiInstanceIdChanged(inst, oldId);
 	
 	// params
 	PickHexValueU16("Params##Instance", &inst->params);
@@ -1285,13 +1545,68 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 	new LinkedStringFunc{
 		"Rooms"
 		, [](){
-			ImGui::TextWrapped("TODO: 'Rooms' tab");
+			static SceneWriteStats estimate = {};
+			static Scene *estimateScene = 0;
+			static double estimateTime = 0;
+			
+			if (!gScene)
+				return;
+			
+			// a dry run serializes everything, so only refresh it once a second
+			if (gScene != estimateScene || ImGui::GetTime() - estimateTime >= 1)
+			{
+				SceneEstimateSizes(gScene, &estimate);
+				estimateScene = gScene;
+				estimateTime = ImGui::GetTime();
+			}
+			
+			HELP_SEPARATOR("File Sizes", "Estimated from what saving now would write,\ncompared to the files as they were loaded.")
+			ImGui::Text("Scene: 0x%x bytes (was 0x%x)", estimate.sceneSize, (uint32_t)gScene->file->size);
+			sb_foreach(gScene->rooms, {
+				if (eachIndex >= sb_count(estimate.roomSizes))
+					break;
+				ImGui::Text("Room %d: 0x%x bytes (was 0x%x)"
+					, eachIndex
+					, estimate.roomSizes[eachIndex]
+					, each->file ? (uint32_t)each->file->size : 0
+				);
+				if (each->romEnd && estimate.roomSizes[eachIndex] > each->romEnd - each->romStart)
+				{
+					ImGui::SameLine();
+					HelpMarker("This room has outgrown its space in the rom,\nso saving will move it elsewhere in the rom.");
+				}
+			})
+			
+			if (sb_count(estimate.roomSizes) != sb_count(gScene->rooms))
+				return;
+			
+			uint32_t memory = SceneRoomMemory(gScene, estimate.roomSizes);
+			uint32_t memoryLoaded = SceneRoomMemory(gScene, 0);
+			
+			HELP_SEPARATOR("Room Memory", "The game reserves enough memory for the\nlargest room, or for the two rooms on\neither side of any doorway, whichever\nis more.")
+			ImGui::Text("0x%x bytes (was 0x%x)", memory, memoryLoaded);
+			if (memory > memoryLoaded)
+				ImGui::TextWrapped(
+					"Warning:\n""This scene now needs more room memory than "
+					"it did when it was loaded, so make sure the game "
+					"still has enough free memory to run it."
+				);
 		}
 	},
 	new LinkedStringFunc{
 		TABNAME_DOORS
 		, [](){
 			
+			ImGui::Checkbox("Show all rooms##DoorwayVis", &gGui->showAllRooms);
+			ImGui::SameLine();
+			HelpMarker(
+				"Every room is drawn by default. Uncheck this to draw\n"
+				"only the rooms that can be seen from the room the\n"
+				"camera is in, through doorways."
+			);
+			ImGui::SameLine();
+			ImGui::TextDisabled("(%d of %d drawn)", gGui->numRoomsDrawn, sb_count(gScene->rooms));
+			
 			Instance *inst = InstanceTab(gGui->doorList, "Doorway", INSTANCE_TAB_DOOR);
 			
 			if (!inst)
@@ -1358,6 +1673,8 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 					{
 						ZeldaLight *light = &gGui->sceneHeader->lights[gGui->env.envPreviewEach];
 						
+						JournalWatch(light, sizeof(*light));
+						
 						// TODO using color to represent direction vector for now
 						ImGuiColorEditFlags flags = ImGuiColorEditFlags_NoInputs;
 						PickColor3U8("Ambient Light##EnvEditor", &light->ambient, flags);
@@ -1374,6 +1691,61 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 					int time = gGui->env.envPreviewTime;
 					ImGui::SliderInt("Drag to edit##EnvironmentTime", &time, 0, 0xffff, "0x%04x", ImGuiSliderFlags_AlwaysClamp);
 					gGui->env.envPreviewTime = CLAMP(time, 0, 0xffff);
+					
+					if (!gGui->env.envTable)
+						break;
+					
+					// the whole day at a glance, click or drag it to scrub through
+					{
+						const ZeldaLight *table = gGui->env.envTable;
+						int count = gGui->env.envTableCount;
+						ImVec2 ul = ImGui::GetCursorScreenPos();
+						ImVec2 dim = ImVec2(ImGui::CalcItemWidth(), ENV_STRIP_BANDS * 8);
+						ImDrawList *drawList = ImGui::GetWindowDrawList();
+						
+						ImGui::InvisibleButton("##EnvironmentStrip", dim);
+						if (ImGui::IsItemActive())
+						{
+							float x = (ImGui::GetIO().MousePos.x - ul.x) / dim.x;
+							gGui->env.envPreviewTime = CLAMP(x * 0x10000, 0, 0xffff);
+						}
+						
+						for (int x = 0; x < (int)dim.x; ++x)
+						{
+							const ZeldaLight *light = &table[x * count / (int)dim.x];
+							
+							for (int band = 0; band < ENV_STRIP_BANDS; ++band)
+							{
+								ZeldaRGB color = EnvStripBand(light, band);
+								float y = ul.y + band * dim.y / ENV_STRIP_BANDS;
+								
+								drawList->AddRectFilled(
+									ImVec2(ul.x + x, y)
+									, ImVec2(ul.x + x + 1, y + dim.y / ENV_STRIP_BANDS)
+									, IM_COL32(color.r, color.g, color.b, 0xff)
+								);
+							}
+						}
+						
+						float now = ul.x + gGui->env.envPreviewTime * dim.x / 0x10000;
+						drawList->AddLine(ImVec2(now, ul.y), ImVec2(now, ul.y + dim.y), 0xffffffff, 2.0f);
+						
+						ImGui::SameLine();
+						HelpMarker(
+							"Top to bottom: ambient, diffuse A, diffuse B, fog color, fog distance.\n"
+							"Click or drag to preview that time of day."
+						);
+						
+						if (ImGui::Button("Export Day Strip##EnvironmentTime"))
+						{
+							const char *fn = noc_file_dialog_open(NOC_FILE_DIALOG_SAVE, "png\0*.png\0", NULL, "day-strip.png");
+							
+							const char *error;
+							
+							if (fn && (error = EnvStripExport(fn, table, count)))
+								GuiErrorPopup(error);
+						}
+					}
 					break;
 				}
 			}
@@ -1425,6 +1797,7 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 					.pos = gGui->newSpawnPos,
 					INSTANCE_DEFAULT_PATHPOINT
 				}));
+				JournalClear();
 			}
 			
 			if (numPaths == 0)
@@ -1649,6 +2022,7 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 				{
 					sb_remove(gGui->sceneHeader->paths, selectedPath - gGui->sceneHeader->paths);
 					selectedPath = 0;
+					JournalClear();
 				}
 				ImGui::TreePop();
 			}
@@ -2074,7 +2448,7 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 					int segment = useSegment + ANIMATED_MAT_SEGMENT_OFFSET;
 					AnimatedMaterial tmp = AnimatedMaterialNewFromDefault(AnimatedMatType(useType), useSegment);
 					tmp.datablob = DataBlobListFindBlobWithOriginalSegmentAddress(
-						DataBlobSegmentGetHead(segment)
+						DataBlobContextGetHead(gScene->blobContext, segment)
 						, segment << 24
 					);
 					sb_push(list, tmp);
@@ -2118,7 +2492,7 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 				int segment = changeSegment + ANIMATED_MAT_SEGMENT_OFFSET;
 				LogDebug("change segment to %02x", segment);
 				my->datablob = DataBlobListFindBlobWithOriginalSegmentAddress(
-					DataBlobSegmentGetHead(segment)
+					DataBlobContextGetHead(gScene->blobContext, segment)
 					, segment << 24
 				);
 				if (my->segment < 0)
@@ -2372,6 +2746,7 @@ static const LinkedStringFunc *gSidebarTabs[] = {
 							);
 							AnimatedImageFree(anim);
 							params->durationFrames = sb_count(params->textureIndexList);
+							MeshCacheInvalidateAll();
 						}
 					}
 					
@@ -2579,6 +2954,42 @@ static const LinkedStringFunc *gSidebarTabsZobj[] = {
 				ImGui::EndCombo();
 			}
 			IMGUI_COMBO_HOVER(gGui->zobjCurrentAnim, numAnims);
+			
+			// for auditing many animations at once
+			ImGui::SeparatorText("Animation Sheet");
+			ImGui::Checkbox("Play all animations##ZobjAnimSheet", &gGui->zobjShowAnimSheet);
+			ImGui::SameLine();
+			HelpMarker(
+				"Plays every animation side by side in a grid,\n"
+				"and lists how long each one takes to evaluate\n"
+				"and draw per frame. Click one in the list to\n"
+				"select it."
+			);
+			if (!gGui->zobjShowAnimSheet)
+				return;
+			if (ImGui::InputInt("Spacing##ZobjAnimSheet", &gGui->zobjAnimSheetSpacing, 50, 500))
+				gGui->zobjAnimSheetSpacing = MAX(gGui->zobjAnimSheetSpacing, 0);
+			if (ImGui::BeginListBox("##ZobjAnimSheetCosts"))
+			{
+				int cols = ceilf(sqrtf(numAnims));
+				
+				for (int i = 0; i < sb_count(gGui->zobjAnimCostUsec) && i < numAnims; ++i)
+				{
+					anim = &obj->animations[i];
+					snprintf(previewText, sizeof(previewText)
+						, "%08x  (%d, %d)  %d frames  %.1f us"
+						, anim->segAddr
+						, i % cols
+						, i / cols
+						, anim->numFrames
+						, gGui->zobjAnimCostUsec[i]
+					);
+					
+					if (ImGui::Selectable(previewText, gGui->zobjCurrentAnim == i))
+						gGui->zobjCurrentAnim = i;
+				}
+				ImGui::EndListBox();
+			}
 		}
 	},
 	gSidebarTabs[10], // textures
@@ -2759,6 +3170,7 @@ static void DrawSidebar(void)
 						.pos = gGui->newSpawnPos,
 						INSTANCE_DEFAULT_PATHPOINT
 					}));
+					JournalClear();
 				}
 				if (ImGui::MenuItem("Paste Here", "Ctrl+V"))
 				{
@@ -2809,6 +3221,7 @@ static void DrawSidebar(void)
 				);
 				gGui->selectedInstance = &path->points[gGui->rightClickedLineIndex + 1];
 				gGui->instanceList = &path->points;
+				JournalClear();
 			}
 		}
 		
@@ -2842,7 +3255,11 @@ static void DrawSidebar(void)
 			newInst.mm.halfDayBits = 0xffff; // default = appear on all days (oot and mm)
 			
 			if (gGui->instanceList)
+			{
 				gGui->selectedInstance = &sb_push(*(gGui->instanceList), newInst);
+				GuiInstanceAdded(gGui->selectedInstance);
+				JournalClear();
+			}
 			else
 				LogDebug("instanceList == 0, can't add");
 		}
@@ -2924,7 +3341,8 @@ static void DrawSettings(void)
 	if (ImGui::TreeNode("Paths"))
 	{
 		PickFile("##mips64-gcc", gIni.path.mips64, sizeof(gIni.path.mips64), filterExe,
-			"This is the full path to your installation of mips64-gcc"
+			"This is the full path to your installation of mips64-gcc (optional,\n"
+			"only used when a Fast64 export can't be compiled without it)"
 		);
 		ImGui::TreePop();
 	}
@@ -2949,7 +3367,7 @@ static void DrawMenuBar(void)
 				{
 					WindowNewSceneFromObjex(0, 0, true);
 				}
-				if (gIni.path.mips64[0] && ImGui::MenuItem("Scene from Fast64"))
+				if (ImGui::MenuItem("Scene from Fast64"))
 				{
 					WindowNewSceneFromFast64(0, 0, true);
 				}
@@ -2967,7 +3385,7 @@ static void DrawMenuBar(void)
 					gScene = newScene;
 				}
 			}
-			if (ImGui::MenuItem("Save", "Ctrl+S", false, gScene && gScene->file->ownsData))
+			if (ImGui::MenuItem("Save", "Ctrl+S", false, gScene && (gScene->file->ownsData || gScene->romFilename)))
 			{
 				WindowSaveScene();
 			}
@@ -2981,6 +3399,16 @@ static void DrawMenuBar(void)
 			}
 			ImGui::EndMenu();
 		}
+		if (ImGui::BeginMenu("Edit"))
+		{
+			struct JournalStats stats = JournalGetStats();
+			
+			if (ImGui::MenuItem("Undo", "Ctrl+Z", false, stats.numUndoable > 0))
+				WindowTryUndo(true);
+			if (ImGui::MenuItem("Redo", "Ctrl+Y", false, stats.numRedoable > 0))
+				WindowTryRedo(true);
+			ImGui::EndMenu();
+		}
 		if (ImGui::BeginMenu("Profile"))
 		{
 			if (ImGui::MenuItem("Load zzrtl/z64rom project"))
@@ -3024,7 +3452,7 @@ static void DrawMenuBar(void)
 				if (fn && (newScene = SceneFromFilenamePredictRooms(fn)))
 					TryMigrateVisualAndCollisionDataFrom(newScene);
 			}
-			if (gScene && gIni.path.mips64[0] && ImGui::MenuItem("Replace Visuals & Collision w/ Fast64"))
+			if (gScene && ImGui::MenuItem("Replace Visuals & Collision w/ Fast64"))
 			{
 				struct Scene *newScene = 0;
 				
@@ -3203,6 +3631,8 @@ static void DrawMenuBar(void)
 
 extern "C" void GuiInit(GLFWwindow *window)
 {
+	gGuiThread = pthread_self();
+	
 	// Decide GL+GLSL versions
 	#if defined(IMGUI_IMPL_OPENGL_ES2)
 	// GL ES 2.0 + GLSL 100
@@ -3241,6 +3671,9 @@ extern "C" void GuiInit(GLFWwindow *window)
 	// apply settings
 	SetStyleTheme();
 	
+	// undo and redo can change the ids of instances that aren't selected
+	JournalSetApplyCallback(ObjectRefsOnJournalApply);
+	
 	//JsonTest();
 	//TomlTest();
 	//gGuiSettings.actorDatabase = TomlLoadActorDatabase("toml/game/oot/actors.toml");
@@ -3265,6 +3698,15 @@ extern "C" void GuiCleanup(void)
 extern "C" void GuiSetInterop(struct GuiInterop *interop)
 {
 	gGui = interop;
+	gGuiThread = pthread_self();
+}
+
+// the editor's state, its actor and object databases included, is
+// only ever touched by the thread running the gui; workers parsing
+// or writing scenes check this before reaching for any of it
+extern "C" bool GuiIsMainThread(void)
+{
+	return gGui && pthread_equal(gGuiThread, pthread_self());
 }
 
 extern "C" void GuiDraw(GLFWwindow *window, struct Scene *scene, struct GuiInterop *interop)
@@ -3301,14 +3743,7 @@ extern "C" void GuiDraw(GLFWwindow *window, struct Scene *scene, struct GuiInter
 		gGui->texanimList = &(sceneHeader->mm.sceneSetupData);
 		
 		// now that door/spawn/actor/object lists are non-zero, watch for changes
-		bool refreshObjects = false;
-		ON_CHANGE(sb_count(*gGui->doorList)) refreshObjects = true;
-		ON_CHANGE(sb_count(*gGui->actorList)) refreshObjects = true;
-		ON_CHANGE(sb_count(*gGui->objectList)) refreshObjects = true;
-		ON_CHANGE(gGui->sceneHeader->specialFiles) refreshObjects = true;
-		if(gGui->sceneHeader->specialFiles) { ON_CHANGE(gGui->sceneHeader->specialFiles->subkeepObjectId) refreshObjects = true; }
-		if (refreshObjects)
-			RefreshObjectStats();
+		UpdateObjectStats();
 	}
 	
 	if (gGuiSettings.showSidebar)
@@ -3380,23 +3815,18 @@ extern "C" int GuiHasFocusKeyboard(void)
 
 extern "C" void GuiPushLine(int x1, int y1, int x2, int y2, uint32_t color, float thickness)
 {
-	// byteswap
-	uint32_t newcolor = 0;
-	newcolor |= ((color >> 0) & 0xff) << 24;
-	newcolor |= ((color >> 8) & 0xff) << 16;
-	newcolor |= ((color >> 16) & 0xff) << 8;
-	newcolor |= ((color >> 24) & 0xff) << 0;
-	gGuiSettings.PushLine(x1, y1, x2, y2, newcolor, thickness);
+	gGuiSettings.PushLine(x1, y1, x2, y2, ByteswapColor(color), thickness);
+}
+
+// for many lines at once, colors are the same as GuiPushLine()
+extern "C" void GuiPushLines(const struct GuiLine *lines, int count)
+{
+	gGuiSettings.PushLines(lines, count);
 }
 
 extern "C" void GuiPushPointX(int x, int y, uint32_t color, float thickness, int radius)
 {
-	// byteswap
-	uint32_t newcolor = 0;
-	newcolor |= ((color >> 0) & 0xff) << 24;
-	newcolor |= ((color >> 8) & 0xff) << 16;
-	newcolor |= ((color >> 16) & 0xff) << 8;
-	newcolor |= ((color >> 24) & 0xff) << 0;
+	uint32_t newcolor = ByteswapColor(color);
 	gGuiSettings.PushLine(x - radius, y - radius, x + radius, y + radius, newcolor, thickness);
 	gGuiSettings.PushLine(x + radius, y - radius, x - radius, y + radius, newcolor, thickness);
 }
@@ -3504,8 +3934,8 @@ extern "C" void GuiLoadBaseDatabases(const char *gameId)
 {
 	char tmp[256];
 	
-	// unsafe
-	if (!gGui)
+	// unsafe, and not for worker threads
+	if (!GuiIsMainThread())
 		return;
 	
 	// don't override databases if a project is already loaded
@@ -3530,7 +3960,26 @@ extern "C" void GuiErrorPopup(const char *message)
 
 extern "C" void GuiLoadProject(const char *fn)
 {
-	gGuiSettings.project = ProjectNewFromFilename(fn);
+	Project *project = ProjectNewFromFilename(fn);
+	
+	// the popup keeps the message, which FileGetError() may not
+	if (!project)
+	{
+		static char error[1024];
+		
+		snprintf(error, sizeof(error), "%s", FileGetError());
+		GuiErrorPopup(error);
+		return;
+	}
+	gGuiSettings.project = project;
+	
+	// object analysis from previous sessions
+	{
+		char tmp[1024];
+		
+		snprintf(tmp, sizeof(tmp), "%s/" OBJECT_INDEX_FILENAME, gGuiSettings.project->folder);
+		ObjectIndexOpen(tmp);
+	}
 	
 	// game (oot or mm) comes from project
 	LogDebug("project->game = '%s'", gGuiSettings.project->game);
@@ -31,6 +31,17 @@ enum RenderGroup
 	RENDERGROUP_MASK_GROUP = 0xff000000,
 };
 
+// see GuiPushLines()
+struct GuiLine
+{
+	int x1;
+	int y1;
+	int x2;
+	int y2;
+	uint32_t color;
+	float thickness;
+};
+
 enum GuiEnvPreviewMode
 {
 	GUI_ENV_PREVIEW_EACH,
@@ -53,6 +64,8 @@ struct GuiInterop
 		int envPreviewMode;
 		int envPreviewEach;
 		uint16_t envPreviewTime;
+		const struct ZeldaLight *envTable; // blended for every game minute, or 0
+		int envTableCount;
 	} env;
 	
 	struct SceneHeader *sceneHeader;
@@ -83,6 +96,8 @@ struct GuiInterop
 	uint16_t halfDayBits;
 	bool isMM;
 	bool hideUnselectedPaths;
+	bool showAllRooms; // even those RoomVisCompute() says can't be seen
+	int numRoomsDrawn;
 	
 	bool clipboardHasInstance;
 	struct Instance clipboardInstance;
@@ -96,6 +111,9 @@ struct GuiInterop
 	int zobjCurrentSkel;
 	int zobjCurrentAnim;
 	enum ZobjViewMode zobjViewMode;
+	bool zobjShowAnimSheet; // every animation at once, in a grid
+	int zobjAnimSheetSpacing;
+	sb_array(float, zobjAnimCostUsec); // per animation, while the sheet is shown
 };
 
 #ifdef __cplusplus
@@ -110,6 +128,7 @@ CPP_FUNC_PREFIX int GuiHasFocus(void);
 CPP_FUNC_PREFIX int GuiHasFocusMouse(void);
 CPP_FUNC_PREFIX int GuiHasFocusKeyboard(void);
 CPP_FUNC_PREFIX void GuiPushLine(int x1, int y1, int x2, int y2, uint32_t color, float thickness);
+CPP_FUNC_PREFIX void GuiPushLines(const struct GuiLine *lines, int count);
 CPP_FUNC_PREFIX void GuiPushPointX(int x, int y, uint32_t color, float thickness, int radius);
 CPP_FUNC_PREFIX void GuiPushModal(const char *message);
 CPP_FUNC_PREFIX struct ActorRenderCode *GuiGetActorRenderCode(uint16_t id);
@@ -119,8 +138,15 @@ CPP_FUNC_PREFIX int GuiGetActorObjectIdFromSlot(uint16_t actorId, int slot);
 CPP_FUNC_PREFIX struct Object *GuiGetObjectDataFromId(int objectId);
 CPP_FUNC_PREFIX void GuiLoadBaseDatabases(const char *gameId);
 CPP_FUNC_PREFIX void GuiSetInterop(struct GuiInterop *interop);
+CPP_FUNC_PREFIX bool GuiIsMainThread(void);
 CPP_FUNC_PREFIX void GuiErrorPopup(const char *message);
 CPP_FUNC_PREFIX void GuiLoadProject(const char *fn);
+// keep the object dependency counts current without rescanning every
+// instance; call after adding, before removing, and after changing an
+// id; instances outside the actor and door lists in view are ignored
+CPP_FUNC_PREFIX void GuiInstanceAdded(const struct Instance *inst);
+CPP_FUNC_PREFIX void GuiInstanceRemoved(const struct Instance *inst);
+CPP_FUNC_PREFIX void GuiInstanceIdChanged(const struct Instance *inst, uint16_t oldId);
 
 #endif /* Z64SCENE_GUI_H_INCLUDED */
 
@@ -0,0 +1,414 @@
+//
+// journal.c
+//
+// undo/redo journal of field-level edits
+//
+// rather than instrumenting every ui widget, the regions that can be
+// edited (the selected instance, the light being edited, gizmo children)
+// are watched each frame and diffed against a shadow copy; each changed
+// run of bytes becomes a delta holding the old and new bytes, and the
+// deltas of one frame (or one continuous interaction) make up a step
+//
+// steps live back to back in a single byte buffer, so undoing or redoing
+// a step only touches that step's deltas, regardless of history length;
+// when the buffer exceeds its budget, the oldest steps are dropped
+//
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "journal.h"
+#include "logging.h"
+#include "stretchy_buffer.h"
+
+// changed runs closer than this are stored as one delta
+#define JOURNAL_MERGE_GAP 8
+#define JOURNAL_ALIGN(X) (((X) + 7) & ~7)
+
+struct JournalDelta
+{
+	uint8_t *addr;
+	uint32_t size;
+	// followed by uint8_t old[size], new[size]
+};
+
+struct JournalStep
+{
+	uint32_t offset; // into sJournal.data
+	uint32_t length;
+	int numDeltas;
+};
+
+struct JournalRegion
+{
+	uint8_t *addr;
+	uint32_t size;
+	uint32_t shadowOffset;
+	bool isWatched;
+};
+
+static struct
+{
+	sb_array(uint8_t, data);
+	sb_array(struct JournalStep, steps);
+	sb_array(struct JournalRegion, regions);
+	sb_array(uint8_t, shadow);
+	struct JournalStep pending;
+	bool hasPending;
+	int cursor; // steps before this index are applied
+	int numEvicted;
+	size_t budget;
+	JournalApplyFunc onApply;
+} sJournal = { .budget = JOURNAL_DEFAULT_BUDGET };
+
+#if 1 // region: private functions
+
+static inline uint8_t *JournalDeltaOld(struct JournalDelta *delta)
+{
+	return (uint8_t*)(delta + 1);
+}
+
+static inline uint8_t *JournalDeltaNew(struct JournalDelta *delta)
+{
+	return JournalDeltaOld(delta) + delta->size;
+}
+
+static inline uint32_t JournalDeltaBytes(uint32_t size)
+{
+	return JOURNAL_ALIGN(sizeof(struct JournalDelta) + size * 2);
+}
+
+static inline struct JournalDelta *JournalDeltaAt(uint32_t offset)
+{
+	return (struct JournalDelta*)(sJournal.data + offset);
+}
+
+static void JournalTruncateRedo(void)
+{
+	if (sJournal.cursor >= sb_count(sJournal.steps))
+		return;
+
+	uint32_t end = sJournal.steps[sJournal.cursor].offset;
+
+	sb_trim(sJournal.steps, sJournal.cursor);
+	sb_trim(sJournal.data, end);
+}
+
+static void JournalEvictOldest(void)
+{
+	size_t used = sb_count(sJournal.data);
+	size_t target = sJournal.budget - sJournal.budget / 4;
+	int numDrop = 0;
+	uint32_t dropBytes = 0;
+
+	if (used <= sJournal.budget)
+		return;
+
+	// drop in bulk so the memmove is amortized across many steps
+	while (numDrop < sb_count(sJournal.steps) && used - dropBytes > target)
+		dropBytes += sJournal.steps[numDrop++].length;
+
+	// only undo history is dropped, redo steps and pending deltas stay
+	if (numDrop > sJournal.cursor)
+		numDrop = sJournal.cursor;
+	if (!numDrop)
+		return;
+	if (numDrop < sb_count(sJournal.steps))
+		dropBytes = sJournal.steps[numDrop].offset;
+	else
+		dropBytes = sJournal.hasPending ? sJournal.pending.offset : used;
+
+	memmove(sJournal.data, sJournal.data + dropBytes, used - dropBytes);
+	sb_trim(sJournal.data, used - dropBytes);
+	memmove(sJournal.steps, sJournal.steps + numDrop, (sb_count(sJournal.steps) - numDrop) * sizeof(*sJournal.steps));
+	sb_trim(sJournal.steps, sb_count(sJournal.steps) - numDrop);
+	sb_foreach(sJournal.steps, { each->offset -= dropBytes; })
+
+	if (sJournal.hasPending)
+		sJournal.pending.offset -= dropBytes;
+	sJournal.cursor -= numDrop;
+	sJournal.numEvicted += numDrop;
+}
+
+static void JournalPushDelta(uint8_t *addr, const uint8_t *oldBytes, uint32_t size)
+{
+	uint32_t offset;
+	struct JournalDelta *delta;
+
+	// first delta of a new step
+	if (!sJournal.hasPending)
+	{
+		JournalTruncateRedo();
+		sJournal.pending = (struct JournalStep){ .offset = sb_count(sJournal.data) };
+		sJournal.hasPending = true;
+	}
+
+	offset = sb_count(sJournal.data);
+	(void)sb_add(sJournal.data, JournalDeltaBytes(size));
+	delta = JournalDeltaAt(offset);
+	delta->addr = addr;
+	delta->size = size;
+	memcpy(JournalDeltaOld(delta), oldBytes, size);
+	memcpy(JournalDeltaNew(delta), addr, size);
+
+	sJournal.pending.length += JournalDeltaBytes(size);
+	sJournal.pending.numDeltas += 1;
+}
+
+static void JournalDiffRegion(struct JournalRegion *region)
+{
+	uint8_t *shadow = sJournal.shadow + region->shadowOffset;
+	uint8_t *addr = region->addr;
+	uint32_t size = region->size;
+
+	for (uint32_t i = 0; i < size; )
+	{
+		uint32_t start;
+		uint32_t end;
+
+		if (shadow[i] == addr[i])
+		{
+			++i;
+			continue;
+		}
+
+		// extend the run across small gaps of unchanged bytes
+		for (start = i, end = i + 1, i += 1; i < size && i - end < JOURNAL_MERGE_GAP; ++i)
+			if (shadow[i] != addr[i])
+				end = i + 1;
+
+		JournalPushDelta(addr + start, shadow + start, end - start);
+		memcpy(shadow + start, addr + start, end - start);
+		i = end;
+	}
+}
+
+static void JournalCommitPending(void)
+{
+	if (!sJournal.hasPending)
+		return;
+
+	sb_push(sJournal.steps, sJournal.pending);
+	sJournal.cursor = sb_count(sJournal.steps);
+	sJournal.hasPending = false;
+
+	JournalEvictOldest();
+}
+
+// drop regions that weren't watched this frame, compacting the shadow
+static void JournalPruneRegions(void)
+{
+	sb_array(uint8_t, shadow) = 0;
+	int numKept = 0;
+
+	sb_foreach(sJournal.regions, {
+		if (!each->isWatched)
+			continue;
+
+		uint32_t offset = sb_count(shadow);
+
+		memcpy(sb_add(shadow, each->size), sJournal.shadow + each->shadowOffset, each->size);
+		each->shadowOffset = offset;
+		each->isWatched = false;
+		sJournal.regions[numKept++] = *each;
+	})
+
+	sb_trim(sJournal.regions, numKept);
+	sb_free(sJournal.shadow);
+	sJournal.shadow = shadow;
+}
+
+// make shadows reflect memory after the journal itself changed it
+static void JournalResyncShadows(void)
+{
+	sb_foreach(sJournal.regions, {
+		memcpy(sJournal.shadow + each->shadowOffset, each->addr, each->size);
+	})
+}
+
+// returns false if memory no longer holds what the step expects, which
+// means something outside the journal's knowledge changed it
+static bool JournalStepMatches(struct JournalStep *step, bool isUndo)
+{
+	for (uint32_t offset = step->offset; offset < step->offset + step->length; )
+	{
+		struct JournalDelta *delta = JournalDeltaAt(offset);
+
+		if (memcmp(delta->addr, isUndo ? JournalDeltaNew(delta) : JournalDeltaOld(delta), delta->size))
+			return false;
+
+		offset += JournalDeltaBytes(delta->size);
+	}
+
+	return true;
+}
+
+#endif // endregion
+
+void JournalWatch(void *addr, size_t size)
+{
+	uint8_t *addr8 = addr;
+
+	if (!addr || !size)
+		return;
+
+	sb_foreach(sJournal.regions, {
+		if (addr8 == each->addr && size == each->size)
+		{
+			each->isWatched = true;
+			return;
+		}
+		
+		// contained in something already watched this frame
+		if (each->isWatched && addr8 >= each->addr && addr8 + size <= each->addr + each->size)
+			return;
+	})
+
+	struct JournalRegion region = {
+		.addr = addr,
+		.size = size,
+		.shadowOffset = sb_count(sJournal.shadow),
+		.isWatched = true,
+	};
+
+	memcpy(sb_add(sJournal.shadow, size), addr, size);
+	sb_push(sJournal.regions, region);
+}
+
+void JournalEndFrame(bool isContinuous)
+{
+	// regions going out of view get their final changes recorded
+	sb_foreach(sJournal.regions, {
+		if (!each->isWatched)
+			JournalDiffRegion(each);
+	})
+
+	if (!isContinuous)
+	{
+		sb_foreach(sJournal.regions, {
+			if (each->isWatched)
+				JournalDiffRegion(each);
+		})
+
+		JournalCommitPending();
+	}
+
+	JournalPruneRegions();
+}
+
+bool JournalUndo(void)
+{
+	struct JournalStep *step;
+	sb_array(uint32_t, offsets) = 0;
+
+	JournalCommitPending();
+
+	if (sJournal.cursor <= 0)
+		return false;
+
+	step = &sJournal.steps[sJournal.cursor - 1];
+
+	if (!JournalStepMatches(step, true))
+	{
+		LogWarn("undo history no longer matches the scene, clearing it");
+		JournalClear();
+		return false;
+	}
+
+	// deltas are restored newest to oldest
+	for (uint32_t offset = step->offset; offset < step->offset + step->length; )
+	{
+		sb_push(offsets, offset);
+		offset += JournalDeltaBytes(JournalDeltaAt(offset)->size);
+	}
+	sb_foreach_backwards(offsets, {
+		struct JournalDelta *delta = JournalDeltaAt(*each);
+		memcpy(delta->addr, JournalDeltaOld(delta), delta->size);
+		if (sJournal.onApply)
+			sJournal.onApply(delta->addr, delta->size, JournalDeltaNew(delta));
+	})
+	sb_free(offsets);
+
+	sJournal.cursor -= 1;
+	JournalResyncShadows();
+
+	return true;
+}
+
+bool JournalRedo(void)
+{
+	struct JournalStep *step;
+
+	JournalCommitPending();
+
+	if (sJournal.cursor >= sb_count(sJournal.steps))
+		return false;
+
+	step = &sJournal.steps[sJournal.cursor];
+
+	if (!JournalStepMatches(step, false))
+	{
+		LogWarn("redo history no longer matches the scene, clearing it");
+		JournalClear();
+		return false;
+	}
+
+	for (uint32_t offset = step->offset; offset < step->offset + step->length; )
+	{
+		struct JournalDelta *delta = JournalDeltaAt(offset);
+
+		memcpy(delta->addr, JournalDeltaNew(delta), delta->size);
+		if (sJournal.onApply)
+			sJournal.onApply(delta->addr, delta->size, JournalDeltaOld(delta));
+		offset += JournalDeltaBytes(delta->size);
+	}
+
+	sJournal.cursor += 1;
+	JournalResyncShadows();
+
+	return true;
+}
+
+void JournalClear(void)
+{
+	sb_free(sJournal.data);
+	sb_free(sJournal.steps);
+	sb_free(sJournal.regions);
+	sb_free(sJournal.shadow);
+	sJournal.data = 0;
+	sJournal.steps = 0;
+	sJournal.regions = 0;
+	sJournal.shadow = 0;
+	sJournal.hasPending = false;
+	sJournal.cursor = 0;
+	sJournal.numEvicted = 0;
+}
+
+void JournalSetBudget(size_t bytes)
+{
+	sJournal.budget = bytes;
+
+	JournalEvictOldest();
+}
+
+void JournalSetApplyCallback(JournalApplyFunc func)
+{
+	sJournal.onApply = func;
+}
+
+struct JournalStats JournalGetStats(void)
+{
+	struct JournalStats stats = {
+		.numSteps = sb_count(sJournal.steps),
+		.numUndoable = sJournal.cursor,
+		.numRedoable = sb_count(sJournal.steps) - sJournal.cursor,
+		.bytesUsed = sb_count(sJournal.data),
+		.bytesBudget = sJournal.budget,
+		.numEvicted = sJournal.numEvicted,
+	};
+
+	sb_foreach(sJournal.steps, { stats.numDeltas += each->numDeltas; })
+
+	return stats;
+}
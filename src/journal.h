@@ -0,0 +1,42 @@
+//
+// journal.h
+//
+// undo/redo journal of field-level edits
+//
+
+#ifndef Z64SCENE_JOURNAL_H_INCLUDED
+#define Z64SCENE_JOURNAL_H_INCLUDED
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define JOURNAL_DEFAULT_BUDGET (4 * 1024 * 1024) // 4 mib
+
+struct JournalStats
+{
+	int numSteps;
+	int numUndoable;
+	int numRedoable;
+	int numDeltas;
+	size_t bytesUsed; // delta storage
+	size_t bytesBudget;
+	int numEvicted; // steps dropped to stay within budget
+};
+
+// call every frame for each region the ui or gizmo may edit
+void JournalWatch(void *addr, size_t size);
+// diffs the watched regions; edits made while continuous is true
+// (e.g. a gizmo drag) are coalesced into a single step
+void JournalEndFrame(bool isContinuous);
+bool JournalUndo(void);
+bool JournalRedo(void);
+// forget everything, needed whenever the watched memory is reallocated
+void JournalClear(void);
+void JournalSetBudget(size_t bytes);
+// called for each delta an undo or redo writes back, with the bytes it
+// replaced, for anyone keeping totals over the watched memory
+typedef void (*JournalApplyFunc)(void *addr, size_t size, const void *replaced);
+void JournalSetApplyCallback(JournalApplyFunc func);
+struct JournalStats JournalGetStats(void);
+
+#endif // Z64SCENE_JOURNAL_H_INCLUDED
@@ -6,6 +6,7 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
 
@@ -13,6 +14,7 @@
 #include "test.h"
 #include "project.h"
 #include "logging.h"
+#include "cli.h"
 
 extern void WindowMainLoop(const char *sceneFn);
 extern void GuiTest(struct Project *project);
@@ -23,6 +25,27 @@ int main(int argc, char *argv[])
 	
 	ExePath(argv[0]);
 	
+	// bulk extraction: z64scene ExtractScenes rom.z64 out/ [jobs]
+	if (argc > 1 && !strcmp(argv[1], "ExtractScenes"))
+	{
+		const char *error;
+		
+		if (argc < 4)
+			Die("ExtractScenes: not enough args: rom.z64 outFolder [jobs]");
+		
+		error = ProjectExtractScenesFromFilename(argv[2], argv[3], argc > 4 ? atoi(argv[4]) : 4, 0);
+		
+		if (error)
+			Die("ExtractScenes: %s", error);
+		
+		LogDebug("successfully extracted scenes to '%s'", argv[3]);
+		return 0;
+	}
+	
+	// headless batch commands: z64scene Batch <command> [options] inputs...
+	if (argc > 1 && !strcmp(argv[1], "Batch"))
+		return CliMain(argc - 2, argv + 2, argv[0]);
+	
 	// tests
 #ifndef NDEBUG
 	// test wren
@@ -51,6 +74,13 @@ int main(int argc, char *argv[])
 			TestFast64toScene(which);
 			return 0; // exit immediately after test
 		}
+		// test: compiles fast64 output and compares it to known good binaries
+		else if (!strcmp(which, "TestFast64Compile"))
+		{
+			if (!(which = argv[2])) Die("TestFast64Compile: not enough args: test/fast64");
+			TestFast64Compile(which);
+			return 0; // exit immediately after test
+		}
 		else if (!strcmp(which, "TestSaveLoadCycles"))
 		{
 			if (!(which = argv[2])) Die("TestSaveLoadCycles: not enough args");
@@ -88,10 +118,114 @@ int main(int argc, char *argv[])
 			TestSceneMigrate(argv[2], argv[3], argv[4]);
 			return 0; // exit immediately after test
 		}
+		// test: undo/redo journal, reports memory used per edit
+		else if (!strcmp(which, "TestJournal"))
+		{
+			TestJournal();
+			return 0; // exit immediately after test
+		}
+		// test: benchmarks passes over a large instance list
+		else if (!strcmp(which, "TestInstanceLayout"))
+		{
+			TestInstanceLayout();
+			return 0; // exit immediately after test
+		}
+		// test: makes instances on several threads at once
+		else if (!strcmp(which, "TestInstanceThreads"))
+		{
+			TestInstanceThreads();
+			return 0; // exit immediately after test
+		}
+		// test: benchmarks skeletal animation updates
+		else if (!strcmp(which, "TestSkelAnime"))
+		{
+			TestSkelAnime();
+			return 0; // exit immediately after test
+		}
+		// test: atomic saves of file groups, and their rollback
+		else if (!strcmp(which, "TestFileSave"))
+		{
+			TestFileSave();
+			return 0; // exit immediately after test
+		}
+		// test: patching files back into a rom
+		else if (!strcmp(which, "TestRomPatch"))
+		{
+			TestRomPatch();
+			return 0; // exit immediately after test
+		}
+		// test: extracting the scenes from a rom
+		else if (!strcmp(which, "TestProjectExtract"))
+		{
+			TestProjectExtract();
+			return 0; // exit immediately after test
+		}
+		// test: flattening room display lists for the mesh cache
+		else if (!strcmp(which, "TestMeshCache"))
+		{
+			TestMeshCache();
+			return 0; // exit immediately after test
+		}
+		// test: which rooms can be seen through doorways
+		else if (!strcmp(which, "TestRoomVisibility"))
+		{
+			TestRoomVisibility();
+			return 0; // exit immediately after test
+		}
+		// test: profiles saving a scene and checks the dry run size estimate
+		else if (!strcmp(which, "TestSceneWriteProfile"))
+		{
+			if (!(which = argv[2])) Die("TestSceneWriteProfile: not enough args");
+			TestSceneWriteProfile(which);
+			return 0; // exit immediately after test
+		}
+		// test: saves a scene on one thread and in parallel, and compares the files
+		else if (!strcmp(which, "TestSceneWriteJobs"))
+		{
+			if (!(which = argv[2])) Die("TestSceneWriteJobs: not enough args");
+			TestSceneWriteJobs(which);
+			return 0; // exit immediately after test
+		}
+		// test: saves a scene from spans and by copying every blob, and compares the files
+		else if (!strcmp(which, "TestSceneWriteSpans"))
+		{
+			if (!(which = argv[2])) Die("TestSceneWriteSpans: not enough args");
+			TestSceneWriteSpans(which);
+			return 0; // exit immediately after test
+		}
+		// test: opens an oot scene and an mm scene at once, checking the first is left as it was
+		else if (!strcmp(which, "TestSceneContexts"))
+		{
+			if (argc != 4)
+				Die("not enough args: oot.zscene mm.zscene (either order)");
+			TestSceneContexts(argv[2], argv[3]);
+			return 0; // exit immediately after test
+		}
+		// test: benchmarks object scanning over a project's zobj files
+		else if (!strcmp(which, "TestObjectScan"))
+		{
+			if (!(which = argv[2])) Die("TestObjectScan: not enough args");
+			TestObjectScan(which);
+			return 0; // exit immediately after test
+		}
+		// test: opens and closes every scene in a project, reporting allocations and memory use
+		else if (!strcmp(which, "TestSceneLoadUnload"))
+		{
+			if (!(which = argv[2])) Die("TestSceneLoadUnload: not enough args");
+			TestSceneLoadUnload(which);
+			return 0; // exit immediately after test
+		}
+		// test: every actor in a project matching an expression, or the example one
 		else if (!strcmp(which, "TestForEachActor"))
 		{
 			if (!(which = argv[2])) Die("TestForEachActor: not enough args");
-			TestForEachActor(which);
+			TestForEachActor(which, argv[3]);
+			return 0; // exit immediately after test
+		}
+		// test: parsing and running actor queries
+		else if (!strcmp(which, "TestActorQuery"))
+		{
+			TestActorQuery();
 			return 0; // exit immediately after test
 		}
 		else
@@ -104,6 +238,7 @@ int main(int argc, char *argv[])
 	if (false)
 	{
 		struct Project *project = ProjectNewFromFilename(argv[1]);
+		if (!project) Die("%s", FileGetError());
 		ExePath(argv[0]);
 		
 		FileListPrintAll(project->foldersObject);
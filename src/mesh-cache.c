@@ -0,0 +1,298 @@
+//
+// mesh-cache.c
+//
+// room display lists, flattened once and replayed every frame
+//
+// the viewer interprets every command of every room on every frame, so
+// each list a room draws is copied once into a list of its own: the lists
+// it calls from the scene and room files are inlined, and state that is
+// set to what it already was gets dropped; everything else is kept byte
+// for byte, segment addresses included, so it still draws with whatever
+// segments are bound at the time (texanim ones included)
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mesh-cache.h"
+#include "logging.h"
+#include "misc.h"
+
+#define F3DEX_GBI_2
+#include "gbi.h"
+
+// gbi extras
+/* dl push flag */
+#define G_DL_PUSH   0
+#define G_DL_NOPUSH 1
+
+#define ARRLEN(X) (sizeof(X) / sizeof(*(X)))
+#define SIZEOF_GFX 8
+#define MESH_CACHE_MAX_DEPTH 18 // the microcode's display list stack
+#define MESH_CACHE_MAX_COMMANDS 0x40000 // so a list that loops gives up
+
+#define READ_32_BE(BYTES, OFFSET) ( \
+	(((const uint8_t*)(BYTES))[OFFSET + 0] << 24) | \
+	(((const uint8_t*)(BYTES))[OFFSET + 1] << 16) | \
+	(((const uint8_t*)(BYTES))[OFFSET + 2] <<  8) | \
+	(((const uint8_t*)(BYTES))[OFFSET + 3] <<  0) \
+)
+
+struct MeshCacheList
+{
+	uint32_t segAddr;
+	uint8_t *gfx; // or 0 if it couldn't be flattened
+};
+
+struct MeshCache
+{
+	const void *sceneData;
+	const void *roomData;
+	int generation;
+	sb_array(struct MeshCacheList, lists); // sorted by segAddr
+};
+
+struct MeshCacheBuild
+{
+	const struct File *files[4]; // by segment, only 0x02 and 0x03 are inlined
+	sb_array(uint8_t, gfx);
+	int commandsIn;
+	bool failed;
+	
+	// the last command of each kind that was kept, for spotting repeats
+	uint8_t last[0x100][SIZEOF_GFX];
+	bool isSet[0x100];
+};
+
+static int gMeshCacheGeneration;
+static struct MeshCacheStats gMeshCacheStats;
+
+#if 1 // region: private functions
+
+static const uint8_t *MeshCacheResolve(struct MeshCacheBuild *build, uint32_t segAddr, const uint8_t **end)
+{
+	uint32_t segment = segAddr >> 24;
+	uint32_t offset = segAddr & 0x00ffffff;
+	const struct File *file;
+	
+	if (segment >= ARRLEN(build->files)
+		|| !(file = build->files[segment])
+		|| offset + SIZEOF_GFX > file->size
+	)
+		return 0;
+	
+	*end = ((const uint8_t*)file->data) + file->size;
+	
+	return ((const uint8_t*)file->data) + offset;
+}
+
+static void MeshCacheEmit(struct MeshCacheBuild *build, const uint8_t *cmd)
+{
+	memcpy(sb_add(build->gfx, SIZEOF_GFX), cmd, SIZEOF_GFX);
+}
+
+// only settings that each command replaces wholesale, or combines using
+// masks that give the same result when applied twice, can be repeats
+static bool MeshCacheIsRepeat(struct MeshCacheBuild *build, const uint8_t *cmd)
+{
+	int op = cmd[0];
+	
+	switch (op)
+	{
+		case G_RDPSETOTHERMODE:
+			build->isSet[G_SETOTHERMODE_L] = false;
+			build->isSet[G_SETOTHERMODE_H] = false;
+			break;
+		
+		case G_SETOTHERMODE_L:
+		case G_SETOTHERMODE_H:
+			build->isSet[G_RDPSETOTHERMODE] = false;
+			break;
+		
+		case G_GEOMETRYMODE:
+		case G_TEXTURE:
+		case G_SETCOMBINE:
+		case G_SETPRIMCOLOR:
+		case G_SETENVCOLOR:
+		case G_SETFOGCOLOR:
+		case G_SETBLENDCOLOR:
+			break;
+		
+		default:
+			return false;
+	}
+	
+	if (build->isSet[op] && !memcmp(build->last[op], cmd, SIZEOF_GFX))
+		return true;
+	
+	memcpy(build->last[op], cmd, SIZEOF_GFX);
+	build->isSet[op] = true;
+	
+	return false;
+}
+
+// copies the list at data into the build, until its end or a branch
+static void MeshCacheWalk(struct MeshCacheBuild *build, const uint8_t *data, const uint8_t *end, int depth)
+{
+	for ( ; !build->failed; data += SIZEOF_GFX)
+	{
+		uint8_t cmd[SIZEOF_GFX];
+		
+		if (data + SIZEOF_GFX > end || ++build->commandsIn > MESH_CACHE_MAX_COMMANDS)
+		{
+			build->failed = true;
+			return;
+		}
+		memcpy(cmd, data, SIZEOF_GFX);
+		
+		switch (cmd[0])
+		{
+			case G_ENDDL:
+				return;
+			
+			// culling an inlined list would end the ones that called it too,
+			// so those are drawn whole instead
+			case G_CULLDL:
+				if (depth)
+					continue;
+				break;
+			
+			// can't be followed ahead of time
+			case G_BRANCH_Z:
+			case G_LOAD_UCODE:
+				build->failed = true;
+				return;
+			
+			case G_DL: {
+				bool isBranch = cmd[1] == G_DL_NOPUSH;
+				const uint8_t *childEnd;
+				const uint8_t *child = MeshCacheResolve(build, READ_32_BE(cmd, 4), &childEnd);
+				
+				if (child && depth + 1 < MESH_CACHE_MAX_DEPTH)
+					MeshCacheWalk(build, child, childEnd, depth + 1);
+				else
+				{
+					// lists outside the scene and room can change anything,
+					// and are called so the rest of this one still draws
+					cmd[1] = G_DL_PUSH;
+					MeshCacheEmit(build, cmd);
+					memset(build->isSet, 0, sizeof(build->isSet));
+				}
+				
+				// a branch never comes back
+				if (isBranch)
+					return;
+				continue;
+			}
+			
+			default:
+				if (MeshCacheIsRepeat(build, cmd))
+					continue;
+				break;
+		}
+		
+		MeshCacheEmit(build, cmd);
+	}
+}
+
+static uint8_t *MeshCacheBuild(struct Room *room, const struct File *sceneFile, uint32_t segAddr)
+{
+	static const uint8_t endDl[SIZEOF_GFX] = { G_ENDDL };
+	struct MeshCacheBuild *build = Calloc(1, sizeof(*build));
+	const uint8_t *start;
+	const uint8_t *end;
+	uint8_t *result = 0;
+	
+	build->files[0x02] = sceneFile;
+	build->files[0x03] = room->file;
+	
+	if ((start = MeshCacheResolve(build, segAddr, &end)))
+		MeshCacheWalk(build, start, end, 0);
+	
+	if (!start || build->failed)
+	{
+		LogDebug("can't flatten display list %08x, drawing it as-is", segAddr);
+		gMeshCacheStats.fallbacks += 1;
+	}
+	else
+	{
+		MeshCacheEmit(build, endDl);
+		result = Memdup(build->gfx, sb_count(build->gfx));
+		gMeshCacheStats.lists += 1;
+		gMeshCacheStats.commandsIn += build->commandsIn;
+		gMeshCacheStats.commandsOut += sb_count(build->gfx) / SIZEOF_GFX;
+	}
+	
+	sb_free(build->gfx);
+	free(build);
+	
+	return result;
+}
+
+static void MeshCacheClear(struct MeshCache *cache)
+{
+	sb_foreach(cache->lists, { free(each->gfx); })
+	sb_clear(cache->lists);
+}
+
+#endif // endregion
+
+const void *MeshCacheGet(struct Room *room, const struct File *sceneFile, uint32_t segAddr)
+{
+	struct MeshCache *cache = room->meshCache;
+	int lo = 0;
+	int hi;
+	
+	if (!cache)
+		cache = room->meshCache = Calloc(1, sizeof(*cache));
+	
+	// the files were swapped for others, or changed in place
+	if (cache->sceneData != sceneFile->data
+		|| cache->roomData != room->file->data
+		|| cache->generation != gMeshCacheGeneration
+	)
+	{
+		MeshCacheClear(cache);
+		cache->sceneData = sceneFile->data;
+		cache->roomData = room->file->data;
+		cache->generation = gMeshCacheGeneration;
+	}
+	
+	for (hi = sb_count(cache->lists); lo < hi; )
+	{
+		int mid = (lo + hi) / 2;
+		
+		if (cache->lists[mid].segAddr < segAddr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	
+	if (lo < sb_count(cache->lists) && cache->lists[lo].segAddr == segAddr)
+		return cache->lists[lo].gfx;
+	
+	sb_insert(cache->lists, ((struct MeshCacheList){ segAddr, MeshCacheBuild(room, sceneFile, segAddr) }), lo);
+	
+	return cache->lists[lo].gfx;
+}
+
+void MeshCacheInvalidateAll(void)
+{
+	gMeshCacheGeneration += 1;
+}
+
+void MeshCacheFree(struct MeshCache *cache)
+{
+	if (!cache)
+		return;
+	
+	MeshCacheClear(cache);
+	sb_free(cache->lists);
+	free(cache);
+}
+
+void MeshCacheGetStats(struct MeshCacheStats *dst)
+{
+	*dst = gMeshCacheStats;
+}
@@ -0,0 +1,37 @@
+//
+// mesh-cache.h
+//
+// room display lists, flattened once and replayed every frame
+//
+
+#ifndef MESH_CACHE_H_INCLUDED
+#define MESH_CACHE_H_INCLUDED
+
+#include <stdint.h>
+
+struct File;
+struct Room;
+struct MeshCache;
+
+// totals since startup, for profiling
+struct MeshCacheStats
+{
+	int lists; // flattened
+	int fallbacks; // couldn't be flattened, drawn as-is
+	int commandsIn; // what drawing the original lists would walk
+	int commandsOut;
+};
+
+// returns the room or scene display list at segAddr with every static
+// list it calls inlined and repeated state changes dropped, built on first
+// use; returns 0 if it can't be flattened, in which case draw the original
+// (calls into the texanim segments are left as calls, so they stay animated)
+const void *MeshCacheGet(struct Room *room, const struct File *sceneFile, uint32_t segAddr);
+
+// every list is rebuilt on its next use, for when the data they came from
+// changes in place; see WindowClearCache()
+void MeshCacheInvalidateAll(void);
+void MeshCacheFree(struct MeshCache *cache);
+void MeshCacheGetStats(struct MeshCacheStats *dst);
+
+#endif // MESH_CACHE_H_INCLUDED
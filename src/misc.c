@@ -9,6 +9,9 @@
 #include "cutscene.h"
 #include "logging.h"
 #include "gui.h"
+#include "file-save.h"
+#include "mesh-cache.h"
+#include "room-vis.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -18,6 +21,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <bigendian.h>
+#include <pthread.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -101,8 +105,6 @@ void WindowSaveSettings(void)
 	fclose(fp);
 }
 
-static int gInstanceHandlerMm = false; // keeping as int b/c can == -1
-
 #define TRY_ALTERNATE_HEADERS(FUNC, PARAM, SEGMENT, FIRST) \
 if (altHeadersArray) { \
 	const uint8_t *headers = altHeadersArray; \
@@ -184,22 +186,34 @@ static void ScenePostsortSquashHeaders(void *udata, uint32_t blobSizeBytes);
 
 #if 1 // region: private data
 
+static void (*sDieHook)(const char *message);
 
 #endif // endregion
 
 void Die(const char *fmt, ...)
 {
+	void (*hook)(const char *message);
+	char message[2048];
 	va_list args;
 	va_start(args, fmt);
 	
-	vfprintf(stderr, fmt, args);
+	vsnprintf(message, sizeof(message), fmt, args);
 	
 	va_end(args);
-	fprintf(stderr, "\n");
+	fprintf(stderr, "%s\n", message);
+	
+	// only the first thread to give up gets to run it
+	if ((hook = __atomic_exchange_n(&sDieHook, 0, __ATOMIC_ACQ_REL)))
+		hook(message);
 	
 	exit(EXIT_FAILURE);
 }
 
+void DieSetHook(void hook(const char *message))
+{
+	__atomic_store_n(&sDieHook, hook, __ATOMIC_RELEASE);
+}
+
 const char *QuickFmt(const char *fmt, ...)
 {
 	static char buf[256];
@@ -353,10 +367,66 @@ void *Memmem(const void *haystack, size_t haystackLen, const void *needle, size_
 {
 	return MemmemAligned(haystack, haystackLen, needle, needleLen, 1);
 }
+// fast non-cryptographic hash, four independent lanes of 8-byte words
+uint64_t MemHash(const void *data, size_t size)
+{
+	const uint64_t k = 0x9E3779B97F4A7C15ull;
+	const uint8_t *bytes = data;
+	uint64_t lanes[4] = { k, k * 3, k * 5, k * 7 };
+	uint64_t result = size * k;
+	size_t i;
+	
+	for (i = 0; i + 32 <= size; i += 32)
+	{
+		for (int n = 0; n < 4; ++n)
+		{
+			uint64_t word;
+			
+			memcpy(&word, bytes + i + n * 8, sizeof(word));
+			lanes[n] = (lanes[n] ^ word) * k;
+			lanes[n] ^= lanes[n] >> 29;
+		}
+	}
+	
+	for (int n = 0; n < 4; ++n)
+		result = (result ^ lanes[n]) * k;
+	
+	for (; i < size; ++i)
+		result = (result ^ bytes[i]) * 0x100000001B3ull;
+	
+	return result ^ (result >> 32);
+}
 
-static struct Scene *sParsingScene = 0;
-static struct Room *sParsingRoom = 0;
-#define ParseSegmentAddressNoPush n64_segment_get // XXX for testing, don't use this macro in production
+// what this thread is parsing; segments 0x02 and 0x03 resolve into the
+// scene and room files here instead of through the global segment table,
+// so loading a scene doesn't disturb another thread or the viewer
+static _Thread_local struct Scene *sParsingScene = 0;
+static _Thread_local struct Room *sParsingRoom = 0;
+static _Thread_local bool sParsingMm = false; // rooms parse right after their scene
+static void *ParseSegmentGet(uint32_t segAddr)
+{
+	struct File *file = 0;
+	
+	switch (segAddr >> 24)
+	{
+		case 0x02:
+			file = sParsingScene ? sParsingScene->file : 0;
+			break;
+		
+		case 0x03:
+			file = sParsingRoom ? sParsingRoom->file : 0;
+			break;
+		
+		default:
+			return n64_segment_get(segAddr);
+	}
+	
+	if (!file)
+		return 0;
+	
+	return ((uint8_t*)file->data) + (segAddr & 0x00ffffff);
+}
+#define ParseSegmentAddressNoPush ParseSegmentGet // XXX for testing, don't use this macro in production
 sb_array(struct DataBlobPending, *GetPendingSegmentAddressList)(uint32_t segAddr);
 void *ParseSegmentAddress(uint32_t segAddr)
 {
@@ -376,7 +446,7 @@ void *ParseSegmentAddress(uint32_t segAddr)
 			sb_push(*blobsPending, (struct DataBlobPending) { .segAddr = segAddr });
 	}
 	
-	return n64_segment_get(segAddr);
+	return ParseSegmentGet(segAddr);
 }
 void HookSegmentAddressPostsort(uint32_t segAddr, void *udata, DataBlobCallbackFunc callback)
 {
@@ -508,15 +578,16 @@ struct Scene *SceneFromFilename(const char *filename)
 {
 	struct Scene *result = Calloc(1, sizeof(*result));
 	
+	// a save that didn't finish leaves the previous scene and rooms intact
+	FileSaveGroupRecover(filename);
 	result->file = FileFromFilename(filename);
 	
 	return private_SceneParseAfterLoad(result);
 }
 
-struct Scene *SceneFromFilenamePredictRooms(const char *filename)
+char *ScenePredictRoomFilename(const char *sceneFilename, int index)
 {
-	char *roomNameBuf = StrdupPad(filename, 100);
-	struct Scene *scene = SceneFromFilename(filename);
+	char *roomNameBuf = StrdupPad(sceneFilename, 100);
 	char *lastSlash = MAX(strrchr(roomNameBuf, '\\'), strrchr(roomNameBuf, '/'));
 	if (!lastSlash)
 		lastSlash = roomNameBuf;
@@ -526,37 +597,44 @@ struct Scene *SceneFromFilenamePredictRooms(const char *filename)
 	if (*lastSlash == '_')
 		lastSlash += 1;
 	
-	for (int i = 0; i < scene->headers[0].numRooms; ++i)
+	const char *variations[] = {
+		"room_%d.zmap",
+		"room_%02d.zmap",
+		"room_%d.zroom",
+		"room_%02d.zroom"
+	};
+	
+	for (int k = 0; k < sizeof(variations) / sizeof(*variations); ++k)
 	{
-		const char *variations[] = {
-			"room_%d.zmap",
-			"room_%02d.zmap",
-			"room_%d.zroom",
-			"room_%02d.zroom"
-		};
-		bool found = false;
+		sprintf(lastSlash, variations[k], index);
 		
-		for (int k = 0; k < sizeof(variations) / sizeof(*variations); ++k)
-		{
-			sprintf(lastSlash, variations[k], i);
-			
-			LogDebug("%s", roomNameBuf);
-			
-			if (FileExists(roomNameBuf))
-			{
-				SceneAddRoom(scene, RoomFromFilename(roomNameBuf));
-				found = true;
-				break;
-			}
-		}
+		LogDebug("%s", roomNameBuf);
+		
+		if (FileExists(roomNameBuf))
+			return roomNameBuf;
+	}
+	
+	free(roomNameBuf);
+	return 0;
+}
+
+struct Scene *SceneFromFilenamePredictRooms(const char *filename)
+{
+	struct Scene *scene = SceneFromFilename(filename);
+	
+	for (int i = 0; i < scene->headers[0].numRooms; ++i)
+	{
+		char *roomFilename = ScenePredictRoomFilename(filename, i);
 		
-		if (!found)
+		if (!roomFilename)
 			Die("could not find room_%d", i);
+		
+		SceneAddRoom(scene, RoomFromFilename(roomFilename));
+		free(roomFilename);
 	}
 	
 	SceneReady(scene);
 	
-	free(roomNameBuf);
 	return scene;
 }
 
@@ -569,6 +647,8 @@ struct Room *RoomFromRomOffset(struct File *rom, uint32_t romStart, uint32_t rom
 		, romEnd - romStart
 		, false
 	);
+	room->romStart = romStart;
+	room->romEnd = romEnd;
 	
 	return private_RoomParseAfterLoad(room);
 }
@@ -582,6 +662,10 @@ struct Scene *SceneFromRomOffset(struct File *rom, uint32_t romStart, uint32_t r
 		, romEnd - romStart
 		, false
 	);
+	scene->romStart = romStart;
+	scene->romEnd = romEnd;
+	if (rom->filename)
+		scene->romFilename = Strdup(rom->filename);
 	
 	private_SceneParseAfterLoad(scene);
 	struct SceneHeader *header = &scene->headers[0];
@@ -626,9 +710,20 @@ void SceneAddHeader(struct Scene *scene, struct SceneHeader *header)
 void SceneReadyDataBlobs(struct Scene *scene)
 {
 	static uint32_t eofRef = 0; // used so eof blobs have one ref each
+	struct DataBlobContext *prevContext;
+	
+	// parsed within a context of its own, so other scenes
+	// (on this thread or any other) keep their segments
+	if (!scene->blobContext)
+		scene->blobContext = DataBlobContextNew();
+	prevContext = DataBlobContextBind(scene->blobContext);
 	
 	FOR_EXTERNAL_SEGMENTS { DatablobFreeList(DataBlobSegmentGetHead(i)); }
 	
+	if (!scene->blobArenas)
+		sb_push(scene->blobArenas, DataBlobArenaNew());
+	DataBlobArenaBind(scene->blobArenas[0]);
+	
 	DataBlobSegmentSetup(2, scene->file->data, scene->file->dataEnd, scene->blobs);
 	
 	// allows texture data blobs from unpopulated external segments, for flipbooks
@@ -983,6 +1078,9 @@ void SceneReadyDataBlobs(struct Scene *scene)
 	sb_foreach(scene->rooms, {
 		LogDebug(" - %s: %d headers", each->file->shortname, sb_count(each->headers));
 	});
+	
+	DataBlobArenaBind(0);
+	DataBlobContextBind(prevContext);
 }
 
 void SceneReady(struct Scene *scene)
@@ -1084,6 +1182,7 @@ void FileFree(struct File *file)
 
 void RoomHeaderFree(struct RoomHeader *header)
 {
+	InstanceListFreeCold(header->instances);
 	sb_free(header->instances);
 	sb_free(header->objects);
 	sb_free(header->displayLists);
@@ -1115,10 +1214,14 @@ void RoomFree(struct Room *room)
 	sb_free(room->headers);
 	
 	DatablobFreeList(room->blobs);
+	MeshCacheFree(room->meshCache);
+	RoomVisFree(room->vis);
 }
 
 void SceneHeaderFree(struct SceneHeader *header)
 {
+	InstanceListFreeCold(header->spawns);
+	InstanceListFreeCold(header->doorways);
 	sb_free(header->spawns);
 	sb_free(header->lights);
 	sb_free(header->doorways);
@@ -1132,6 +1235,7 @@ void SceneHeaderFree(struct SceneHeader *header)
 	sb_free(header->actorCsCamInfo);
 	
 	sb_foreach(header->paths, {
+		InstanceListFreeCold(each->points);
 		sb_free(each->points);
 	})
 	sb_free(header->paths);
@@ -1163,6 +1267,15 @@ void SceneFree(struct Scene *scene)
 	DatablobFreeList(scene->blobs);
 	sb_free(scene->textureBlobs);
 	
+	// the flipbook textures on the external segments are this scene's alone
+	FOR_EXTERNAL_SEGMENTS { DatablobFreeList(DataBlobContextGetHead(scene->blobContext, i)); }
+	DataBlobContextFree(scene->blobContext);
+	
+	// rooms and blob lists are done with, so this is all that's left
+	sb_foreach(scene->blobArenas, { DataBlobArenaRelease(*each); })
+	sb_free(scene->blobArenas);
+	
+	free(scene->romFilename);
 	free(scene);
 }
 
@@ -1175,6 +1288,21 @@ void SceneAddRoom(struct Scene *scene, struct Room *room)
 	free(room);
 }
 
+// blobs are traded between the scenes, so each must keep the
+// other's arenas alive for as long as it is around
+static void SceneShareBlobArenas(struct Scene *a, struct Scene *b)
+{
+	int numA = sb_count(a->blobArenas);
+	int numB = sb_count(b->blobArenas);
+	
+	for (int i = 0; i < numB; ++i)
+		if (!sb_contains_copy(a->blobArenas, b->blobArenas[i]))
+			sb_push(a->blobArenas, DataBlobArenaRetain(b->blobArenas[i]));
+	for (int i = 0; i < numA; ++i)
+		if (!sb_contains_copy(b->blobArenas, a->blobArenas[i]))
+			sb_push(b->blobArenas, DataBlobArenaRetain(a->blobArenas[i]));
+}
+
 const char *SceneMigrateVisualAndCollisionData(struct Scene *dst, struct Scene *src)
 {
 	// safety
@@ -1243,7 +1371,7 @@ const char *SceneMigrateVisualAndCollisionData(struct Scene *dst, struct Scene *
 		sb_foreach_named(sceneHeader->mm.sceneSetupData, material, {
 			int segment = ABS_ALT(material->segment) + 7;
 			struct DataBlob *match = DataBlobListFindBlobWithOriginalSegmentAddress(
-				DataBlobSegmentGetHead(segment)
+				DataBlobContextGetHead(src->blobContext, segment)
 				, segment << 24
 			);
 			material->datablob = match;
@@ -1315,6 +1443,8 @@ const char *SceneMigrateVisualAndCollisionData(struct Scene *dst, struct Scene *
 	Swap(&dst->collisions, &src->collisions);
 	Swap(&dst->blobs, &src->blobs);
 	Swap(&dst->textureBlobs, &src->textureBlobs);
+	SceneShareBlobArenas(dst, src);
+	Swap(&dst->blobContext, &src->blobContext); // the flipbook textures went with the mesh
 	Swap(&dst->file, &src->file);
 	Swap(&dst->file->filename, &src->file->filename);
 	Swap(&dst->file->shortname, &src->file->shortname);
@@ -1591,12 +1721,131 @@ void CollisionHeaderFree(CollisionHeader *header)
 	free(header);
 }
 
-// not actually a uuid, but close enough
+// not actually a uuid, but close enough; instances can be made
+// on any thread, so the counter is atomic
 uint32_t InstanceNewUuid(void)
 {
 	static uint32_t s = 0;
 	
-	return ++s;
+	return __atomic_add_fetch(&s, 1, __ATOMIC_RELAXED);
+}
+
+// cold per-instance data, in an open addressing table keyed by uuid
+struct InstanceCold
+{
+	uint32_t uuid;
+	// [0] = instance, [n] = rendercode child n, null for an empty slot
+	sb_array(SkelAnime *, skelanimes);
+};
+static struct
+{
+	struct InstanceCold *slots;
+	uint32_t capacity; // power of two
+	uint32_t count;
+} sInstanceCold;
+static pthread_mutex_t sInstanceColdLock = PTHREAD_MUTEX_INITIALIZER; // guards the above
+
+static struct InstanceCold *InstanceColdFind(uint32_t uuid)
+{
+	if (!sInstanceCold.capacity)
+		return 0;
+	
+	uint32_t mask = sInstanceCold.capacity - 1;
+	
+	for (uint32_t i = (uuid * 0x9E3779B1u) & mask; ; i = (i + 1) & mask)
+	{
+		struct InstanceCold *slot = &sInstanceCold.slots[i];
+		
+		if (!slot->skelanimes || slot->uuid == uuid)
+			return slot;
+	}
+}
+
+static void InstanceColdGrow(void)
+{
+	struct InstanceCold *old = sInstanceCold.slots;
+	uint32_t oldCapacity = sInstanceCold.capacity;
+	
+	sInstanceCold.capacity = oldCapacity ? oldCapacity * 2 : 256;
+	sInstanceCold.slots = Calloc(sInstanceCold.capacity, sizeof(*sInstanceCold.slots));
+	
+	for (uint32_t i = 0; i < oldCapacity; ++i)
+		if (old[i].skelanimes)
+			*InstanceColdFind(old[i].uuid) = old[i];
+	
+	free(old);
+}
+
+SkelAnime *InstanceGetSkelAnime(const struct Instance *inst)
+{
+	struct InstanceCold *cold;
+	SkelAnime *result;
+	int index = inst->rendercodeChildIndex;
+	
+	pthread_mutex_lock(&sInstanceColdLock);
+	
+	if (sInstanceCold.count * 2 >= sInstanceCold.capacity)
+		InstanceColdGrow();
+	
+	cold = InstanceColdFind(inst->prev.uuid);
+	if (!cold->skelanimes)
+	{
+		cold->uuid = inst->prev.uuid;
+		sInstanceCold.count += 1;
+	}
+	
+	while (sb_count(cold->skelanimes) <= index)
+		sb_push(cold->skelanimes, 0);
+	if (!cold->skelanimes[index])
+		cold->skelanimes[index] = Calloc(1, sizeof(SkelAnime));
+	result = cold->skelanimes[index];
+	
+	pthread_mutex_unlock(&sInstanceColdLock);
+	
+	return result;
+}
+
+void InstanceFreeCold(const struct Instance *inst)
+{
+	struct InstanceCold *cold;
+	uint32_t mask;
+	uint32_t hole;
+	
+	pthread_mutex_lock(&sInstanceColdLock);
+	cold = InstanceColdFind(inst->prev.uuid);
+	mask = sInstanceCold.capacity - 1;
+	
+	if (!cold || !cold->skelanimes)
+	{
+		pthread_mutex_unlock(&sInstanceColdLock);
+		return;
+	}
+	
+	sb_foreach(cold->skelanimes, { free(*each); })
+	sb_free(cold->skelanimes);
+	
+	// backward shift deletion, so lookups never need tombstones
+	hole = cold - sInstanceCold.slots;
+	for (uint32_t i = (hole + 1) & mask; sInstanceCold.slots[i].skelanimes; i = (i + 1) & mask)
+	{
+		uint32_t home = (sInstanceCold.slots[i].uuid * 0x9E3779B1u) & mask;
+		
+		// entry can move into the hole if its home isn't between them
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			sInstanceCold.slots[hole] = sInstanceCold.slots[i];
+			hole = i;
+		}
+	}
+	sInstanceCold.slots[hole] = (struct InstanceCold){ 0 };
+	sInstanceCold.count -= 1;
+	
+	pthread_mutex_unlock(&sInstanceColdLock);
+}
+
+void InstanceListFreeCold(const struct Instance *list)
+{
+	sb_foreach(list, { InstanceFreeCold(each); })
 }
 
 // experimented with polymorphic instance types
@@ -1688,10 +1937,10 @@ void InstanceDeleteFromListGeneric(struct Instance **list, const void *src)
 }
 */
 
-struct Instance InstanceMakeWritable(struct Instance inst)
+struct Instance InstanceMakeWritable(struct Instance inst, bool isMm)
 {
 	// mm stuff
-	if (gInstanceHandlerMm)
+	if (isMm)
 	{
 		inst.id &= 0xfff;
 		#define HANDLE_AXIS(AXIS, MASK) \
@@ -1712,10 +1961,10 @@ struct Instance InstanceMakeWritable(struct Instance inst)
 	return inst;
 }
 
-struct Instance InstanceMakeReadable(struct Instance inst)
+struct Instance InstanceMakeReadable(struct Instance inst, bool isMm)
 {
 	// mm stuff
-	if (gInstanceHandlerMm)
+	if (isMm)
 	{
 		inst.mm.halfDayBits = ((inst.xrot & 0x7f) << 7) | (inst.zrot & 0x7f);
 		inst.mm.csId = inst.yrot & 0x7f;
@@ -1757,7 +2006,7 @@ static struct Instance private_InstanceParse(const void *data, enum InstanceTab
 		, .tab = tab
 	};
 	
-	return InstanceMakeReadable(inst);
+	return InstanceMakeReadable(inst, sParsingMm);
 }
 
 static struct ZeldaLight private_ZeldaLightParse(const void *data)
@@ -1968,7 +2217,7 @@ static void private_SceneParseAddHeader(struct Scene *scene, uint32_t addr)
 							.backCamera = arr[3],
 						}
 					};
-					doorway = InstanceMakeReadable(doorway);
+					doorway = InstanceMakeReadable(doorway, sParsingMm);
 					
 					sb_push(result->doorways, doorway);
 				}
@@ -2404,28 +2653,34 @@ static struct Scene *private_SceneParseAfterLoad(struct Scene *scene)
 	assert(file->data);
 	assert(file->size);
 	
-	n64_segment_set(0x02, file->data);
 	sParsingScene = scene;
 	
-	// just in case user alternates between MM and OoT scenes
-	gInstanceHandlerMm = false;
+	// each scene remembers its own, since MM and OoT scenes can be open at once
+	scene->isMm = false;
 	for (const uint8_t *tmp = file->data; *tmp != 0x14; tmp += 8)
 		if (*tmp == 0x1B)
-			gInstanceHandlerMm = true;
+			scene->isMm = true;
+	sParsingMm = scene->isMm;
 	
 	private_SceneParseAddHeader(scene, 0x02000000);
 	
-	ON_CHANGE_DEFAULT(gInstanceHandlerMm, -1)
+	// the editor's databases still follow whichever scene was opened
+	// last in the editor; scenes parsed on worker threads leave them be
+	if (GuiIsMainThread())
 	{
-		switch (gInstanceHandlerMm)
+		int isMm = scene->isMm;
+		ON_CHANGE_DEFAULT(isMm, -1)
 		{
-			case false:
-				GuiLoadBaseDatabases("oot");
-				break;
-			
-			case true:
-				GuiLoadBaseDatabases("mm");
-				break;
+			switch (isMm)
+			{
+				case false:
+					GuiLoadBaseDatabases("oot");
+					break;
+				
+				case true:
+					GuiLoadBaseDatabases("mm");
+					break;
+			}
 		}
 	}
 	
@@ -2442,7 +2697,6 @@ static struct Room *private_RoomParseAfterLoad(struct Room *room)
 	assert(file->data);
 	assert(file->size);
 	
-	n64_segment_set(0x03, file->data);
 	sParsingRoom = room;
 	
 	private_RoomParseAddHeader(room, 0x03000000);
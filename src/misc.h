@@ -460,7 +460,12 @@ struct Instance
 		} useDegreeRotationFor;
 	} mm;
 	
-	SkelAnime skelanime;
+	// nonzero for rendercode children, which share their parent's uuid
+	uint16_t  rendercodeChildIndex;
+	
+	// cold data (SkelAnime) lives in a side table keyed by prev.uuid,
+	// see InstanceGetSkelAnime(); this keeps the struct small so passes
+	// over instance lists stride over little more than the hot fields
 	sb_array(struct ObjectLimbOverride, limbOverrides);
 	sb_array(struct Instance, rendercodeChildren);
 	
@@ -513,6 +518,12 @@ struct Room
 	struct DataBlob *blobs;
 	sb_array(struct DataBlobPending, blobsPending);
 	sb_array(struct RoomHeader, headers);
+	struct MeshCache *meshCache; // see MeshCacheGet()
+	struct RoomVis *vis; // see RoomVisCompute()
+	
+	// where the room lives, if loaded from a rom
+	uint32_t romStart;
+	uint32_t romEnd;
 };
 
 struct ActorPath
@@ -558,26 +569,66 @@ struct Scene
 	struct DataBlob *blobs;
 	sb_array(struct DataBlobPending, blobsPending);
 	sb_array(struct TextureBlob, textureBlobs);
+	sb_array(struct DataBlobArena *, blobArenas); // [0] takes new blobs, the rest came with migrated ones
+	struct DataBlobContext *blobContext; // its segments, flipbook textures on 0x08 - 0x0F included
 	sb_array(struct Room, rooms);
 	sb_array(struct SceneHeader, headers);
 	CollisionHeader *collisions;
+	bool isMm; // actors pack their rotations the mm way, see InstanceMakeReadable()
+	
+	// set if loaded from a rom, for saving back into it
+	char *romFilename;
+	uint32_t romStart;
+	uint32_t romEnd;
 	
 	int test;
 };
+
+// where save time and output bytes go, see SceneWriterSetStats()
+#define SCENE_WRITE_STAT_COMMANDS 0x20 // header command ids are below this
+struct SceneWriteStat
+{
+	int count; // blobs appended, or commands that own data
+	uint32_t bytes; // new bytes in the output
+	uint32_t dedupBytes; // bytes saved by reusing identical data
+	uint32_t padBytes; // alignment padding
+	double seconds;
+};
+struct SceneWriteStats
+{
+	struct SceneWriteStat blobTypes[DATA_BLOB_TYPE_COUNT];
+	struct SceneWriteStat commands[SCENE_WRITE_STAT_COMMANDS];
+	struct SceneWriteStat headers; // header blocks themselves, alternate header lists
+	uint32_t sceneSize;
+	sb_array(uint32_t, roomSizes);
+	double seconds; // serializing
+	double commitSeconds; // writing the result out
+	size_t workBytes; // peak memory held by the writer
+};
 #endif /* types */
 
 #if 1 /* region: function prototypes */
 
 struct Scene *SceneFromFilename(const char *filename);
 struct Scene *SceneFromFilenamePredictRooms(const char *filename);
+char *ScenePredictRoomFilename(const char *sceneFilename, int index); // free() it, 0 if none
 struct Scene *SceneFromRomOffset(struct File *rom, uint32_t romStart, uint32_t romEnd);
-void SceneToFilename(struct Scene *scene, const char *filename);
+int SceneToFilename(struct Scene *scene, const char *filename); // reason in FileGetError() if nonzero
+int SceneToRom(struct Scene *scene, const char *romFilename);
+void SceneEstimateSizes(struct Scene *scene, struct SceneWriteStats *stats);
+uint32_t SceneRoomMemory(struct Scene *scene, const uint32_t *roomSizes);
+void SceneWriterSetStats(struct SceneWriteStats *stats);
+void SceneWriterSetJobs(int jobs);
+void SceneWriterSetBorrowing(bool borrow);
+void SceneWriteStatsLog(const struct SceneWriteStats *stats);
+void SceneWriteStatsFree(struct SceneWriteStats *stats);
 const char *SceneMigrateVisualAndCollisionData(struct Scene *dst, struct Scene *src);
 struct Room *RoomFromFilename(const char *filename);
 void ScenePopulateRoom(struct Scene *scene, int index, struct Room *room);
 void SceneReadyDataBlobs(struct Scene *scene);
 void SceneReady(struct Scene *scene);
 void Die(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
+void DieSetHook(void hook(const char *message)); // runs with the message before Die() exits, 0 for none
 const char *QuickFmt(const char *fmt, ...) __attribute__ ((format (printf, 1, 2)));
 void *Calloc(size_t howMany, size_t sizeEach);
 void SceneAddHeader(struct Scene *scene, struct SceneHeader *header);
@@ -597,6 +648,7 @@ char *StrToLower(char *str);
 void StrRemoveChar(char *charAt);
 void *MemmemAligned(const void *haystack, size_t haystackLen, const void *needle, size_t needleLen, size_t byteAlignment);
 void *Memmem(const void *haystack, size_t haystackLen, const void *needle, size_t needleLen);
+uint64_t MemHash(const void *data, size_t size); // for telling contents apart, not for security
 const char *ExePath(const char *path);
 int ArrayGetIndexofMaxInt(int *array, int arrayLength);
 struct DataBlob *MiscSkeletonDataBlobs(struct File *file, struct DataBlob *head, uint32_t segAddr);
@@ -606,8 +658,11 @@ void SceneWriterCleanup(void);
 struct Instance *InstanceAddToListGeneric(struct Instance **list, const void *src);
 void InstanceDeleteFromListGeneric(struct Instance **list, const void *src);
 uint32_t InstanceNewUuid(void);
-struct Instance InstanceMakeWritable(struct Instance inst);
-struct Instance InstanceMakeReadable(struct Instance inst);
+SkelAnime *InstanceGetSkelAnime(const struct Instance *inst);
+void InstanceFreeCold(const struct Instance *inst);
+void InstanceListFreeCold(const struct Instance *list);
+struct Instance InstanceMakeWritable(struct Instance inst, bool isMm);
+struct Instance InstanceMakeReadable(struct Instance inst, bool isMm);
 
 struct Scene *WindowOpenFile(const char *fn);
 #define WindowLoadSceneFromRom(FILE, START, END) WindowLoadSceneExt(0, FILE, START, END)
@@ -0,0 +1,448 @@
+//
+// object-index.c
+//
+// per-project sidecar index of object analysis results
+//
+// discovering the skeletons, animations and meshes in a zobj means
+// scanning it heuristically, and symbol files have to be tokenized; the
+// results of both are stored here, keyed by a hash of the file contents,
+// so files that haven't changed since a previous session are never
+// analyzed again
+//
+// the index is a single file (header, records, words, strings) that is
+// loaded with one read and written back on close if anything changed;
+// entries that go unused for OBJECT_INDEX_MAX_AGE sessions are dropped
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "object-index.h"
+#include "object.h"
+#include "logging.h"
+#include "file.h"
+#include "misc.h"
+
+#define OBJECT_INDEX_MAGIC "ZOIX"
+#define OBJECT_INDEX_VERSION 1
+#define OBJECT_INDEX_BYTE_ORDER 0x01020304
+
+enum ObjectIndexKind
+{
+	OBJECT_INDEX_KIND_ZOBJ,
+	OBJECT_INDEX_KIND_SYMS,
+};
+
+// words per item, stored back to back in that order
+#define OBJECT_INDEX_WORDS_SKELETON  3
+#define OBJECT_INDEX_WORDS_ANIMATION 4
+#define OBJECT_INDEX_WORDS_MESH      1
+#define OBJECT_INDEX_WORDS_SYM       2
+
+struct ObjectIndexHeader
+{
+	char magic[4];
+	uint32_t byteOrder; // written natively, so a mismatch means other endianness
+	uint32_t version;
+	uint32_t generation; // incremented each session
+	uint32_t numRecords;
+	uint32_t numWords;
+	uint32_t numStringBytes;
+	uint32_t pad;
+};
+
+struct ObjectIndexRecord
+{
+	uint64_t hash;
+	uint32_t fileSize;
+	uint32_t generation; // session in which this was last used
+	uint8_t kind;
+	uint8_t requestedSegment;
+	uint8_t segment;
+	uint8_t pad;
+	uint32_t firstWord;
+	uint32_t counts[3]; // skeletons, animations, meshes (or syms)
+	uint32_t pad1;
+};
+
+static struct
+{
+	char *filename;
+	sb_array(struct ObjectIndexRecord, records);
+	sb_array(uint32_t, words);
+	sb_array(char, strings);
+	uint32_t generation;
+	bool isDirty;
+} sIndex;
+
+#if 1 // region: private functions
+
+static struct ObjectIndexRecord *ObjectIndexFind(uint64_t hash, uint32_t size, int kind, int requestedSegment)
+{
+	sb_foreach(sIndex.records, {
+		if (each->hash == hash
+			&& each->fileSize == size
+			&& each->kind == kind
+			&& each->requestedSegment == requestedSegment
+		)
+		{
+			if (each->generation != sIndex.generation)
+			{
+				each->generation = sIndex.generation;
+				sIndex.isDirty = true;
+			}
+			
+			return each;
+		}
+	})
+	
+	return 0;
+}
+
+static struct ObjectIndexRecord *ObjectIndexAdd(uint64_t hash, uint32_t size, int kind, int requestedSegment)
+{
+	struct ObjectIndexRecord *record = ObjectIndexFind(hash, size, kind, requestedSegment);
+	
+	// re-adding replaces the old contents, whose words become garbage
+	// until the next save compacts them away
+	if (!record)
+	{
+		sb_push(sIndex.records, ((struct ObjectIndexRecord){
+			.hash = hash,
+			.fileSize = size,
+			.kind = kind,
+			.requestedSegment = requestedSegment,
+		}));
+		record = &sb_last(sIndex.records);
+	}
+	
+	record->generation = sIndex.generation;
+	record->firstWord = sb_count(sIndex.words);
+	memset(record->counts, 0, sizeof(record->counts));
+	sIndex.isDirty = true;
+	
+	return record;
+}
+
+// how many words a record's items take up
+static uint64_t ObjectIndexRecordNumWords(const struct ObjectIndexRecord *record)
+{
+	if (record->kind == OBJECT_INDEX_KIND_SYMS)
+		return (uint64_t)record->counts[0] * OBJECT_INDEX_WORDS_SYM;
+	
+	return (uint64_t)record->counts[0] * OBJECT_INDEX_WORDS_SKELETON
+		+ (uint64_t)record->counts[1] * OBJECT_INDEX_WORDS_ANIMATION
+		+ (uint64_t)record->counts[2] * OBJECT_INDEX_WORDS_MESH
+	;
+}
+
+// a damaged file mustn't send lookups outside the words or strings
+static bool ObjectIndexRecordIsValid(const struct ObjectIndexRecord *record)
+{
+	uint32_t numWords = sb_count(sIndex.words);
+	uint32_t numStringBytes = sb_count(sIndex.strings);
+	
+	if (record->kind != OBJECT_INDEX_KIND_ZOBJ
+		&& record->kind != OBJECT_INDEX_KIND_SYMS
+	)
+		return false;
+	
+	if (record->firstWord > numWords
+		|| ObjectIndexRecordNumWords(record) > numWords - record->firstWord
+	)
+		return false;
+	
+	// symbol names are offsets into the string pool, which must end
+	// in a terminator so each name does
+	if (record->kind == OBJECT_INDEX_KIND_SYMS)
+	{
+		const uint32_t *words = sIndex.words + record->firstWord;
+		
+		if (record->counts[0]
+			&& (!numStringBytes || sIndex.strings[numStringBytes - 1])
+		)
+			return false;
+		
+		for (uint32_t i = 0; i < record->counts[0]; ++i, words += OBJECT_INDEX_WORDS_SYM)
+			if (words[0] >= numStringBytes)
+				return false;
+	}
+	
+	return true;
+}
+
+static bool ObjectIndexLoad(const char *filename)
+{
+	struct File *file;
+	struct ObjectIndexHeader header;
+	const uint8_t *data;
+	size_t expected;
+	
+	if (!FileExists(filename))
+		return false;
+	
+	file = FileFromFilename(filename);
+	data = file->data;
+	
+	if (file->size < sizeof(header))
+		goto L_invalid;
+	
+	memcpy(&header, data, sizeof(header));
+	data += sizeof(header);
+	expected = sizeof(header)
+		+ (size_t)header.numRecords * sizeof(struct ObjectIndexRecord)
+		+ (size_t)header.numWords * sizeof(uint32_t)
+		+ header.numStringBytes
+	;
+	if (memcmp(header.magic, OBJECT_INDEX_MAGIC, sizeof(header.magic))
+		|| header.byteOrder != OBJECT_INDEX_BYTE_ORDER
+		|| header.version != OBJECT_INDEX_VERSION
+		|| file->size != expected
+	)
+		goto L_invalid;
+	
+	#define OBJECT_INDEX_READ(ARRAY, COUNT) \
+		if (COUNT) { \
+			memcpy(sb_add(ARRAY, COUNT), data, (COUNT) * sizeof(*(ARRAY))); \
+			data += (COUNT) * sizeof(*(ARRAY)); \
+		}
+	OBJECT_INDEX_READ(sIndex.records, header.numRecords)
+	OBJECT_INDEX_READ(sIndex.words, header.numWords)
+	OBJECT_INDEX_READ(sIndex.strings, header.numStringBytes)
+	#undef OBJECT_INDEX_READ
+	
+	sb_foreach(sIndex.records, {
+		if (!ObjectIndexRecordIsValid(each))
+			goto L_invalid;
+	})
+	
+	sIndex.generation = header.generation + 1;
+	FileFree(file);
+	return true;
+
+L_invalid:
+	LogWarn("ignoring invalid or outdated object index '%s'", filename);
+	FileFree(file);
+	sb_free(sIndex.records);
+	sb_free(sIndex.words);
+	sb_free(sIndex.strings);
+	sIndex.records = 0;
+	sIndex.words = 0;
+	sIndex.strings = 0;
+	return false;
+}
+
+// writes only the records used recently, compacting words and strings
+static void ObjectIndexSave(void)
+{
+	sb_array(struct ObjectIndexRecord, records) = 0;
+	sb_array(uint32_t, words) = 0;
+	sb_array(char, strings) = 0;
+	sb_array(uint8_t, out) = 0;
+	struct ObjectIndexHeader header = {
+		.magic = OBJECT_INDEX_MAGIC,
+		.byteOrder = OBJECT_INDEX_BYTE_ORDER,
+		.version = OBJECT_INDEX_VERSION,
+		.generation = sIndex.generation,
+	};
+	struct File *file;
+	
+	sb_foreach(sIndex.records, {
+		struct ObjectIndexRecord record = *each;
+		const uint32_t *src = sIndex.words + each->firstWord;
+		uint32_t numWords = ObjectIndexRecordNumWords(each);
+		
+		if (sIndex.generation - each->generation > OBJECT_INDEX_MAX_AGE)
+			continue;
+		
+		record.firstWord = sb_count(words);
+		if (numWords)
+			memcpy(sb_add(words, numWords), src, numWords * sizeof(*words));
+		
+		// symbol names move to the new string pool
+		if (each->kind == OBJECT_INDEX_KIND_SYMS)
+		{
+			for (uint32_t i = 0; i < each->counts[0]; ++i)
+			{
+				uint32_t *nameOffset = &words[record.firstWord + i * OBJECT_INDEX_WORDS_SYM];
+				const char *name = sIndex.strings + *nameOffset;
+				int len = strlen(name) + 1;
+				
+				*nameOffset = sb_count(strings);
+				memcpy(sb_add(strings, len), name, len);
+			}
+		}
+		
+		sb_push(records, record);
+	})
+	
+	header.numRecords = sb_count(records);
+	header.numWords = sb_count(words);
+	header.numStringBytes = sb_count(strings);
+	
+	memcpy(sb_add(out, sizeof(header)), &header, sizeof(header));
+	if (records)
+		memcpy(sb_add(out, sb_count(records) * sizeof(*records)), records, sb_count(records) * sizeof(*records));
+	if (words)
+		memcpy(sb_add(out, sb_count(words) * sizeof(*words)), words, sb_count(words) * sizeof(*words));
+	if (strings)
+		memcpy(sb_add(out, sb_count(strings)), strings, sb_count(strings));
+	
+	file = FileFromData(out, sb_count(out), false);
+	if (FileToFilename(file, sIndex.filename))
+		LogWarn("failed to write object index: %s", FileGetError());
+	else
+		LogDebug("wrote object index '%s', %d entries", sIndex.filename, sb_count(records));
+	FileFree(file);
+	
+	sb_free(out);
+	sb_free(records);
+	sb_free(words);
+	sb_free(strings);
+	
+	sIndex.isDirty = false;
+}
+
+#endif // endregion
+
+void ObjectIndexOpen(const char *filename)
+{
+	ObjectIndexClose();
+	
+	sIndex.filename = Strdup(filename);
+	
+	if (ObjectIndexLoad(filename))
+		LogDebug("loaded object index '%s', %d entries", filename, sb_count(sIndex.records));
+}
+
+void ObjectIndexClose(void)
+{
+	if (!sIndex.filename)
+		return;
+	
+	if (sIndex.isDirty)
+		ObjectIndexSave();
+	
+	free(sIndex.filename);
+	sb_free(sIndex.records);
+	sb_free(sIndex.words);
+	sb_free(sIndex.strings);
+	memset(&sIndex, 0, sizeof(sIndex));
+}
+
+bool ObjectIndexIsOpen(void)
+{
+	return sIndex.filename != 0;
+}
+
+bool ObjectIndexFindObject(uint64_t hash, uint32_t size, int requestedSegment, struct Object *dst)
+{
+	struct ObjectIndexRecord *record = ObjectIndexFind(hash, size, OBJECT_INDEX_KIND_ZOBJ, requestedSegment);
+	const uint32_t *words;
+	
+	if (!record)
+		return false;
+	
+	words = sIndex.words + record->firstWord;
+	dst->segment = record->segment;
+	
+	for (uint32_t i = 0; i < record->counts[0]; ++i, words += OBJECT_INDEX_WORDS_SKELETON)
+		sb_push(dst->skeletons, ((struct ObjectSkeleton){
+			.segAddr = words[0],
+			.limbAddrsSegAddr = words[1],
+			.limbCount = words[2] & 0xff,
+			.isLod = words[2] >> 8,
+		}));
+	
+	for (uint32_t i = 0; i < record->counts[1]; ++i, words += OBJECT_INDEX_WORDS_ANIMATION)
+		sb_push(dst->animations, ((struct ObjectAnimation){
+			.object = dst,
+			.segAddr = words[0],
+			.rotValSegAddr = words[1],
+			.rotIndexSegAddr = words[2],
+			.numFrames = words[3] & 0xffff,
+			.limit = words[3] >> 16,
+		}));
+	
+	for (uint32_t i = 0; i < record->counts[2]; ++i, words += OBJECT_INDEX_WORDS_MESH)
+		sb_push(dst->meshes, ((struct ObjectMesh){
+			.segAddr = words[0],
+		}));
+	
+	return true;
+}
+
+void ObjectIndexAddObject(uint64_t hash, uint32_t size, int requestedSegment, const struct Object *obj)
+{
+	struct ObjectIndexRecord *record;
+	
+	if (!ObjectIndexIsOpen())
+		return;
+	
+	record = ObjectIndexAdd(hash, size, OBJECT_INDEX_KIND_ZOBJ, requestedSegment);
+	record->segment = obj->segment;
+	record->counts[0] = sb_count(obj->skeletons);
+	record->counts[1] = sb_count(obj->animations);
+	record->counts[2] = sb_count(obj->meshes);
+	
+	sb_foreach(obj->skeletons, {
+		uint32_t *words = sb_add(sIndex.words, OBJECT_INDEX_WORDS_SKELETON);
+		words[0] = each->segAddr;
+		words[1] = each->limbAddrsSegAddr;
+		words[2] = each->limbCount | (each->isLod << 8);
+	})
+	
+	sb_foreach(obj->animations, {
+		uint32_t *words = sb_add(sIndex.words, OBJECT_INDEX_WORDS_ANIMATION);
+		words[0] = each->segAddr;
+		words[1] = each->rotValSegAddr;
+		words[2] = each->rotIndexSegAddr;
+		words[3] = each->numFrames | (each->limit << 16);
+	})
+	
+	sb_foreach(obj->meshes, {
+		*sb_add(sIndex.words, OBJECT_INDEX_WORDS_MESH) = each->segAddr;
+	})
+}
+
+sb_array(struct ObjectIndexSym, ObjectIndexFindSyms)(uint64_t hash, uint32_t size)
+{
+	struct ObjectIndexRecord *record = ObjectIndexFind(hash, size, OBJECT_INDEX_KIND_SYMS, 0);
+	sb_array(struct ObjectIndexSym, result) = 0;
+	const uint32_t *words;
+	
+	if (!record)
+		return 0;
+	
+	words = sIndex.words + record->firstWord;
+	sb_new_size(result, record->counts[0]);
+	
+	for (uint32_t i = 0; i < record->counts[0]; ++i, words += OBJECT_INDEX_WORDS_SYM)
+		sb_push(result, ((struct ObjectIndexSym){
+			.name = sIndex.strings + words[0],
+			.value = words[1],
+		}));
+	
+	return result;
+}
+
+void ObjectIndexAddSyms(uint64_t hash, uint32_t size, const struct ObjectIndexSym *syms, int count)
+{
+	struct ObjectIndexRecord *record;
+	
+	if (!ObjectIndexIsOpen())
+		return;
+	
+	record = ObjectIndexAdd(hash, size, OBJECT_INDEX_KIND_SYMS, 0);
+	record->counts[0] = count;
+	
+	for (int i = 0; i < count; ++i)
+	{
+		uint32_t *words = sb_add(sIndex.words, OBJECT_INDEX_WORDS_SYM);
+		int len = strlen(syms[i].name) + 1;
+		
+		words[0] = sb_count(sIndex.strings);
+		words[1] = syms[i].value;
+		memcpy(sb_add(sIndex.strings, len), syms[i].name, len);
+	}
+}
@@ -0,0 +1,44 @@
+//
+// object-index.h
+//
+// per-project sidecar index of object analysis results
+//
+
+#ifndef OBJECT_INDEX_H_INCLUDED
+#define OBJECT_INDEX_H_INCLUDED
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stretchy_buffer.h"
+
+struct Object;
+
+struct ObjectIndexSym
+{
+	const char *name;
+	uint32_t value;
+};
+
+// lives in the project folder
+#define OBJECT_INDEX_FILENAME ".z64scene-objects.idx"
+
+// sessions an entry may go unused before it is dropped from the index
+#define OBJECT_INDEX_MAX_AGE 16
+
+// opening an index closes (and saves) the previous one
+void ObjectIndexOpen(const char *filename);
+void ObjectIndexClose(void);
+bool ObjectIndexIsOpen(void);
+
+// objects are keyed by contents and by the segment requested at load
+bool ObjectIndexFindObject(uint64_t hash, uint32_t size, int requestedSegment, struct Object *dst);
+void ObjectIndexAddObject(uint64_t hash, uint32_t size, int requestedSegment, const struct Object *obj);
+
+// returns 0 if not indexed, otherwise a (possibly empty) list the caller
+// frees with sb_free; names point into the index, valid until the next add
+sb_array(struct ObjectIndexSym, ObjectIndexFindSyms)(uint64_t hash, uint32_t size);
+void ObjectIndexAddSyms(uint64_t hash, uint32_t size, const struct ObjectIndexSym *syms, int count);
+
+#endif // OBJECT_INDEX_H_INCLUDED
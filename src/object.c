@@ -1,291 +1,451 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "logging.h"
 #include "object.h"
+#include "object-index.h"
 #include "misc.h"
 
-static bool SegmentAddressIsValid(struct Object *obj, uint32_t segAddr, uint8_t alignment)
+// an object file is scanned once, front to back, and every aligned word
+// is offered to all of the detectors below; the segment the object lives
+// in isn't known until the whole file has been seen, so the skeleton and
+// animation detectors keep candidates from any segment, and those that
+// don't match the detected segment are dropped afterwards
+struct ObjectScan
+{
+	int segmentVotes[N64_SEGMENT_MAX];
+	sb_array(struct ObjectSkeleton, skeletons);
+	sb_array(struct ObjectAnimation, animations);
+	sb_array(uint32_t, dlistEnds); // offsets of G_ENDDL and hard G_DL
+};
+
+// the prefilter tests four consecutive word positions at once using
+// native-endian loads, so masks are built from big-endian byte order
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	#define OBJECT_SCAN_BYTES(B0, B1, B2, B3) \
+		(((uint32_t)(B0) << 24) | ((B1) << 16) | ((B2) << 8) | (B3))
+#else
+	#define OBJECT_SCAN_BYTES(B0, B1, B2, B3) \
+		(((uint32_t)(B3) << 24) | ((B2) << 16) | ((B1) << 8) | (B0))
+#endif
+#define OBJECT_SCAN_LANES 4
+typedef uint32_t ObjectScanVec __attribute__((vector_size(OBJECT_SCAN_LANES * sizeof(uint32_t))));
+
+// which detectors a word position may be of interest to
+enum ObjectScanWants
+{
+	OBJECT_SCAN_WANTS_SKELETON = 1 << 0,
+	OBJECT_SCAN_WANTS_ANIMATION = 1 << 1,
+	OBJECT_SCAN_WANTS_DLIST_END = 1 << 2,
+	OBJECT_SCAN_WANTS_VERTICES = 1 << 3,
+	OBJECT_SCAN_WANTS_ALL = 0xf,
+};
+
+static bool SegmentAddressIsValidFor(const struct File *file, int segment, uint32_t segAddr, uint8_t alignment)
 {
-	const struct File *file = obj->file;
 	const uint8_t *start = file->data;
 	const uint8_t *end = file->dataEnd;
 	const uint32_t u24 = 0x00ffffff; // for masking lower 24 bits
 	
 	return (
-		(segAddr >> 24) == obj->segment
+		(segAddr >> 24) == segment
 		&& !(segAddr & (alignment - 1))
 		&& start + (segAddr & u24) < end
 	);
 }
 
-static void ObjectParseAfterLoad(struct Object *obj)
+static bool SegmentAddressIsValid(struct Object *obj, uint32_t segAddr, uint8_t alignment)
 {
-	const struct File *file = obj->file;
-	const uint8_t *start = obj->file->data;
-	const uint8_t *end = obj->file->dataEnd;
-	const uint8_t *endAligned8 = start + (obj->file->size & 0xfffffff8); // 8 byte aligned
+	return SegmentAddressIsValidFor(obj->file, obj->segment, segAddr, alignment);
+}
+
+// skeleton header, with its limb list in any of the common segments
+static bool ObjectScanSkeleton(const struct File *file, const uint8_t *walk, struct ObjectSkeleton *result)
+{
+	const uint8_t *start = file->data;
+	const uint8_t *end = file->dataEnd;
 	const uint32_t u24 = 0x00ffffff; // for masking lower 24 bits
+	int numLimbs = walk[4];
+	uint32_t limbAddrsSegAddr = u32r(walk);
+	
+	// assert common segments
+	if ((limbAddrsSegAddr >> 24) < 0x04
+		|| (limbAddrsSegAddr >> 24) > 0x06
+	)
+		return false;
+	
+	// expects format nn000000
+	if (u32r(walk + 4) & u24)
+		return false;
+	
+	if (numLimbs == 0 || numLimbs > 127)
+		return false;
 	
-	// find skeletons
-	for (const uint8_t *walk = start; walk <= end - 8; walk += 4)
+	// not aligned
+	if (limbAddrsSegAddr & 3)
+		return false;
+	
+	const uint8_t *firstLimbAddr = start + (limbAddrsSegAddr & u24);
+	
+	// out of range
+	if (firstLimbAddr + numLimbs * 4 > end)
+		return false;
+	
+	// check whether is likely a list of limb addresses
+	int i;
+	int stride = 0;
+	for (i = 0; i < numLimbs; ++i)
 	{
-		uint32_t skeletonHeaderAddr = (walk - start) | (obj->segment << 24);
-		int numLimbs = walk[4];
-		uint32_t limbAddrsSegAddr = u32r(walk);
-		
-		// assert common segments
-		if ((limbAddrsSegAddr >> 24) < 0x04
-			|| (limbAddrsSegAddr >> 24) > 0x06
-		)
-			continue;
-		
-		// let's assume skeletons don't store
-		// their limb lists in other segments
-		if ((limbAddrsSegAddr >> 24) != obj->segment)
-			continue;
-		
-		// expects format nn000000
-		if (u32r(walk + 4) & u24)
-			continue;
+		uint32_t limbAddr = u32r(firstLimbAddr + i * 4);
+		uint32_t nextLimbAddr = u32r(firstLimbAddr + (i + 1) * 4);
 		
-		if (numLimbs == 0 || numLimbs > 127)
-			continue;
+		// points to some address beyond the EOF
+		if ((limbAddr & u24) >= file->size)
+			break;
 		
-		// not aligned
-		if (limbAddrsSegAddr & 3)
-			continue;
+		// unaligned
+		if (limbAddr & 3)
+			break;
 		
-		const uint8_t *firstLimbAddr = start + (limbAddrsSegAddr & u24);
-		
-		// out of range
-		if (firstLimbAddr + numLimbs * 4 > end)
-			continue;
-		
-		// check whether is likely a list of limb addresses
-		int i;
-		int stride = 0;
-		for (i = 0; i < numLimbs; ++i)
+		// sanity check last limb address
+		if (i == numLimbs - 1)
 		{
-			uint32_t limbAddr = u32r(firstLimbAddr + i * 4);
-			uint32_t nextLimbAddr = u32r(firstLimbAddr + (i + 1) * 4);
-			
-			// points to some address beyond the EOF
-			if ((limbAddr & u24) >= file->size)
-				break;
-			
-			// unaligned
-			if (limbAddr & 3)
-				break;
-			
-			// sanity check last limb address
-			if (i == numLimbs - 1)
-			{
-				// segment mismatch
-				if ((limbAddr >> 24) != (limbAddrsSegAddr >> 24))
-					break;
-				
-				// success
-				i = numLimbs;
-				break;
-			}
-			
-			// initialize stride and sanity check it
-			if (stride == 0)
-			{
-				stride = nextLimbAddr - limbAddr;
-				
-				// common strides
-				if (stride != 12 && stride != 16)
-					break;
-			}
-			
 			// segment mismatch
-			if ((limbAddr >> 24) != (nextLimbAddr >> 24))
+			if ((limbAddr >> 24) != (limbAddrsSegAddr >> 24))
 				break;
 			
-			// every entry should be the same size
-			if (nextLimbAddr - limbAddr != stride)
-				break;
+			// success
+			i = numLimbs;
+			break;
 		}
 		
-		// didn't reach the end of the previous loop
-		if (i < numLimbs)
-			continue;
-		
-		// sanity check limbs themselves
-		for (i = 0; i < numLimbs; ++i)
+		// initialize stride and sanity check it
+		if (stride == 0)
 		{
-			uint32_t limbAddr = u32r(firstLimbAddr + i * 4);
-			const uint8_t *limb = start + (limbAddr & u24);
-			uint32_t limbDL = u32r(limb + 8);
+			stride = nextLimbAddr - limbAddr;
 			
-			// not aligned as DL's should be
-			if (limbDL & 7)
-				break;
-			
-			// allow ram addresses and blank limbs
-			if ((limbDL >> 24) == 0x80
-				|| limbDL == 0
-			)
-				continue;
-			
-			// don't allow bad segments
-			if ((limbDL >> 24) > 0x0F
-				|| (limbDL >> 24) == 0x00
-			)
-				break;
-			
-			// don't allow DL's that are beyond EOF
-			if ((limbDL >> 24) == (limbAddrsSegAddr >> 24)
-				&& start + (limbAddrsSegAddr & u24) >= end
-			)
+			// common strides
+			if (stride != 12 && stride != 16)
 				break;
 		}
 		
-		// didn't reach the end of the previous loop
-		if (i < numLimbs)
-			continue;
+		// segment mismatch
+		if ((limbAddr >> 24) != (nextLimbAddr >> 24))
+			break;
 		
-		// this may be a skeleton
-		LogDebug("skeleton at %08x, %d limbs"
-			, skeletonHeaderAddr, numLimbs
-		);
-		sb_push(obj->skeletons, ((struct ObjectSkeleton){
-			.limbAddrsSegAddr = limbAddrsSegAddr,
-			.limbCount = numLimbs,
-			.segAddr = skeletonHeaderAddr,
-			.isLod = stride == 0x10,
-		}));
+		// every entry should be the same size
+		if (nextLimbAddr - limbAddr != stride)
+			break;
 	}
 	
-	// TODO use skeletons to derive datablobs
-	// (that way, mesh/vertex/texture data is
-	// excluded from the following searches)
+	// didn't reach the end of the previous loop
+	if (i < numLimbs)
+		return false;
 	
-	// search for animations
-	for (const uint8_t *walk = start; walk <= end - 16; walk += 4)
+	// sanity check limbs themselves
+	for (i = 0; i < numLimbs; ++i)
 	{
-		struct ObjectAnimation anim = {
-			.object = obj,
-			.numFrames = u16r(walk + 0),
-			.pad0 = u16r(walk + 2),
-			.rotValSegAddr = u32r(walk + 4),
-			.rotIndexSegAddr = u32r(walk + 8),
-			.limit = u16r(walk + 12),
-			.pad1 = u16r(walk + 14),
-			.segAddr = (walk - start) | (obj->segment << 24),
-		};
-		
-		// these are expected to always be 0
-		if (anim.pad0 || anim.pad1)
-			continue;
-		
-		// these are expected to always be non-zero
-		if (!anim.rotValSegAddr || !anim.rotIndexSegAddr || !anim.numFrames)
-			continue;
-		
-		// reasonable to expect no animation is this long
-		if (anim.numFrames >= 500)
-			continue;
+		uint32_t limbAddr = u32r(firstLimbAddr + i * 4);
+		const uint8_t *limb = start + (limbAddr & u24);
+		uint32_t limbDL = u32r(limb + 8);
 		
-		// mismatching segments
-		if ((anim.rotValSegAddr >> 24) != (anim.rotIndexSegAddr >> 24))
-			continue;
+		// not aligned as DL's should be
+		if (limbDL & 7)
+			break;
 		
-		// bad segment in general
-		if ((anim.rotValSegAddr >> 24) > 0x0F
-			|| (anim.rotValSegAddr >> 24) == 0x00
+		// allow ram addresses and blank limbs
+		if ((limbDL >> 24) == 0x80
+			|| limbDL == 0
 		)
 			continue;
 		
-		// let's assume animations don't reference other segments
-		// (do they ever?)
-		if ((anim.rotValSegAddr >> 24) != obj->segment)
-			continue;
-		
-		// each value is 16 bit, so should be 2-byte-aligned
-		if ((anim.rotValSegAddr & 1) || (anim.rotIndexSegAddr & 1))
-			continue;
-		
-		//
-		// TODO find out whether this check would be okay to include
-		//
-		// for extract safety, you could also check whether the first
-		// u16 in rotValSegAddr is 0, because it seems to be for most
-		// (all?) animations, but it would come at the cost of false
-		// negatives (aka skipping over real animations)
-		//
+		// don't allow bad segments
+		if ((limbDL >> 24) > 0x0F
+			|| (limbDL >> 24) == 0x00
+		)
+			break;
 		
-		// is likely an animation
-		LogDebug("animation at %08x, %d frames"
-			, anim.segAddr, anim.numFrames
-		);
-		sb_push(obj->animations, anim);
+		// don't allow DL's that are beyond EOF
+		if ((limbDL >> 24) == (limbAddrsSegAddr >> 24)
+			&& start + (limbAddrsSegAddr & u24) >= end
+		)
+			break;
 	}
 	
-	// pre-baked pose for viewing player models
-	if (
-		sb_count(obj->skeletons) > 0
-		&& sb_count(obj->animations) == 0
-		&& obj->skeletons->limbCount == 21
-		&& obj->skeletons->isLod
+	// didn't reach the end of the previous loop
+	if (i < numLimbs)
+		return false;
+	
+	// this may be a skeleton
+	*result = (struct ObjectSkeleton){
+		.limbAddrsSegAddr = limbAddrsSegAddr,
+		.limbCount = numLimbs,
+		.segAddr = walk - start,
+		.isLod = stride == 0x10,
+	};
+	
+	return true;
+}
+
+// animation header, referencing data in any segment
+static bool ObjectScanAnimation(const struct File *file, const uint8_t *walk, struct ObjectAnimation *result)
+{
+	struct ObjectAnimation anim = {
+		.numFrames = u16r(walk + 0),
+		.pad0 = u16r(walk + 2),
+		.rotValSegAddr = u32r(walk + 4),
+		.rotIndexSegAddr = u32r(walk + 8),
+		.limit = u16r(walk + 12),
+		.pad1 = u16r(walk + 14),
+		.segAddr = walk - (const uint8_t*)file->data,
+	};
+	
+	// these are expected to always be 0
+	if (anim.pad0 || anim.pad1)
+		return false;
+	
+	// these are expected to always be non-zero
+	if (!anim.rotValSegAddr || !anim.rotIndexSegAddr || !anim.numFrames)
+		return false;
+	
+	// reasonable to expect no animation is this long
+	if (anim.numFrames >= 500)
+		return false;
+	
+	// mismatching segments
+	if ((anim.rotValSegAddr >> 24) != (anim.rotIndexSegAddr >> 24))
+		return false;
+	
+	// bad segment in general
+	if ((anim.rotValSegAddr >> 24) > 0x0F
+		|| (anim.rotValSegAddr >> 24) == 0x00
 	)
+		return false;
+	
+	// each value is 16 bit, so should be 2-byte-aligned
+	if ((anim.rotValSegAddr & 1) || (anim.rotIndexSegAddr & 1))
+		return false;
+	
+	//
+	// TODO find out whether this check would be okay to include
+	//
+	// for extract safety, you could also check whether the first
+	// u16 in rotValSegAddr is 0, because it seems to be for most
+	// (all?) animations, but it would come at the cost of false
+	// negatives (aka skipping over real animations)
+	//
+	
+	*result = anim;
+	
+	return true;
+}
+
+// G_VTX followed by a triangle draw, returns the segment of the vertices
+static int ObjectScanSegmentVote(const struct File *file, const uint8_t *walk)
+{
+	const int vbuf = 64;
+	const uint8_t thisSeg = walk[4];
+	const uint8_t nextCmd = walk[8];
+	uint32_t hi = u32r(walk);
+	uint32_t lo = u32r(walk + 4);
+	uint16_t numv = (hi >> 12) & 0xfff;
+	uint16_t vbidx = ((hi & 0xfff) >> 1) - numv;
+	
+	if (walk[0] != G_VTX || (nextCmd != G_TRI1 && nextCmd != G_TRI2))
+		return -1;
+	
+	bool containsVertices = (
+		numv <= vbuf
+		&& vbidx <= vbuf - numv // sanity check whether write would overflow
+		&& thisSeg < N64_SEGMENT_MAX
+		&& SegmentAddressIsValidFor(file, thisSeg, lo, 8) // technically only need align=4
+	);
+	
+	walk += 8;
+	hi = u32r(walk);
+	lo = u32r(walk + 4);
+	bool containsGeometry = (
+		!(hi & 0x010101) // abc = even numbers
+		&& walk[1] / 2 < vbuf
+		&& walk[2] / 2 < vbuf
+		&& walk[3] / 2 < vbuf
+		&& (
+			(nextCmd == G_TRI1 && !lo) // 05aabbcc 00000000
+			|| (nextCmd == G_TRI2 // 06aabbcc 00ddeeff
+				&& walk[4] == 0
+				&& !(lo & 0x010101) // def = even numbers
+				&& walk[5] / 2 < vbuf
+				&& walk[6] / 2 < vbuf
+				&& walk[7] / 2 < vbuf
+			)
+		)
+	);
+	
+	return (containsVertices && containsGeometry) ? thisSeg : -1;
+}
+
+// offer one word position to the detectors that may want it
+static void ObjectScanWord(const struct File *file, const uint8_t *walk, struct ObjectScan *scan, uint32_t wants)
+{
+	const uint8_t *start = file->data;
+	const uint8_t *end = file->dataEnd;
+	const uint8_t *endAligned8 = start + (file->size & 0xfffffff8); // 8 byte aligned
+	struct ObjectSkeleton skeleton;
+	struct ObjectAnimation anim;
+	
+	if (!((walk - start) & 7))
 	{
-		static struct File pose;
-		static struct Object poseObject;
+		// these are the ways a dlist can end (the branch target is
+		// validated once the segment is known)
+		if ((wants & OBJECT_SCAN_WANTS_DLIST_END)
+			&& walk <= endAligned8 - 8
+			&& ((u32r(walk) == (G_ENDDL << 24) && u32r(walk + 4) == 0)
+				|| u32r(walk) == ((G_DL << 24) | 0x00010000)
+			)
+		)
+			sb_push(scan->dlistEnds, walk - start);
 		
-		if (!pose.size)
+		if ((wants & OBJECT_SCAN_WANTS_VERTICES) && walk <= end - 16)
 		{
-			static uint8_t poseData[] = {
-				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0x0F, 0xA4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0xF0, 0x5C, 0x00, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0xE0, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x20, 0x00, 0x80, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00,
-				0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-				0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00, 0x05,
-				0x00, 0x06, 0x00, 0x07, 0x00, 0x08, 0x00, 0x09, 0x00, 0x0A, 0x00, 0x0B,
-				0x00, 0x0C, 0x00, 0x0D, 0x00, 0x0E, 0x00, 0x0F, 0x00, 0x10, 0x00, 0x11,
-				0x00, 0x12, 0x00, 0x13, 0x00, 0x14, 0x00, 0x15, 0x00, 0x16, 0x00, 0x17,
-				0x00, 0x18, 0x00, 0x19, 0x00, 0x1A, 0x00, 0x1B, 0x00, 0x1C, 0x00, 0x1D,
-				0x00, 0x1E, 0x00, 0x1F, 0x00, 0x20, 0x00, 0x21, 0x00, 0x22, 0x00, 0x23,
-				0x00, 0x24, 0x00, 0x25, 0x00, 0x26, 0x00, 0x27, 0x00, 0x28, 0x00, 0x29,
-				0x00, 0x2A, 0x00, 0x2B, 0x00, 0x2C, 0x00, 0x2D, 0x00, 0x2E, 0x00, 0x2F,
-				0x00, 0x30, 0x00, 0x31, 0x00, 0x32, 0x00, 0x33, 0x00, 0x34, 0x00, 0x35,
-				0x00, 0x36, 0x00, 0x37, 0x00, 0x38, 0x00, 0x39, 0x00, 0x3A, 0x00, 0x3B,
-				0x00, 0x3C, 0x00, 0x3D, 0x00, 0x3E, 0x00, 0x3F, 0x00, 0x40, 0x00, 0x41,
-			};
-			pose.size = sizeof(poseData);
-			pose.data = poseData;
-			pose.dataEnd = poseData + pose.size;
-			poseObject.file = &pose;
+			int segment = ObjectScanSegmentVote(file, walk);
+			
+			if (segment >= 0)
+				scan->segmentVotes[segment] += 1;
 		}
+	}
+	
+	if ((wants & OBJECT_SCAN_WANTS_SKELETON)
+		&& walk <= end - 8
+		&& ObjectScanSkeleton(file, walk, &skeleton)
+	)
+		sb_push(scan->skeletons, skeleton);
+	
+	if ((wants & OBJECT_SCAN_WANTS_ANIMATION)
+		&& walk <= end - 16
+		&& ObjectScanAnimation(file, walk, &anim)
+	)
+		sb_push(scan->animations, anim);
+}
+
+static void ObjectScanFile(const struct File *file, struct ObjectScan *scan)
+{
+	const uint8_t *start = file->data;
+	const uint8_t *end = file->dataEnd;
+	const uint8_t *walk = start;
+	const ObjectScanVec topByte = (ObjectScanVec){} + OBJECT_SCAN_BYTES(0xff, 0, 0, 0);
+	const ObjectScanVec lowHalf = (ObjectScanVec){} + OBJECT_SCAN_BYTES(0, 0, 0xff, 0xff);
+	const ObjectScanVec low24 = (ObjectScanVec){} + OBJECT_SCAN_BYTES(0, 0xff, 0xff, 0xff);
+	const ObjectScanVec segHigh = (ObjectScanVec){} + OBJECT_SCAN_BYTES(0xf0, 0, 0, 0);
+	
+	memset(scan, 0, sizeof(*scan));
+	
+	// most words are vertices, textures, or display list commands, which
+	// none of the detectors want; reject four positions at a time based
+	// on what every detector requires, and look closer at the survivors
+	for (; walk + (OBJECT_SCAN_LANES + 2) * 4 <= end; walk += OBJECT_SCAN_LANES * 4)
+	{
+		ObjectScanVec word;
+		ObjectScanVec next;
+		ObjectScanVec nextCmd;
 		
-		poseObject.segment = obj->segment;
-		sb_push(obj->animations, ((struct ObjectAnimation) {
-			.object = &poseObject,
-			.segAddr = 0x06000000,
-			.numFrames = 1,
-			.limit = 3,
-			.rotValSegAddr = 0x06000000,
-			.rotIndexSegAddr = 0x06000084,
-		}));
+		memcpy(&word, walk, sizeof(word));
+		memcpy(&next, walk + 4, sizeof(next));
+		memcpy(&nextCmd, walk + 8, sizeof(nextCmd));
+		
+		ObjectScanVec wordTop = word & topByte;
+		ObjectScanVec nextTop = next & topByte;
+		ObjectScanVec nextCmdTop = nextCmd & topByte;
+		// lanes are all ones where true, so masking gives the flag
+		ObjectScanVec wants =
+			// skeleton: limb list in segment 4-6, followed by nn000000
+			(((wordTop == OBJECT_SCAN_BYTES(0x04, 0, 0, 0))
+				| (wordTop == OBJECT_SCAN_BYTES(0x05, 0, 0, 0))
+				| (wordTop == OBJECT_SCAN_BYTES(0x06, 0, 0, 0))
+			) & ((next & low24) == 0) & OBJECT_SCAN_WANTS_SKELETON)
+			// animation: zero padding, followed by segment 1-15
+			| (((word & lowHalf) == 0)
+				& ((next & segHigh) == 0)
+				& (nextTop != 0)
+				& OBJECT_SCAN_WANTS_ANIMATION
+			)
+			// display list ends
+			| ((((word == OBJECT_SCAN_BYTES(G_ENDDL, 0, 0, 0)) & (next == 0))
+				| (word == OBJECT_SCAN_BYTES(G_DL, 0x01, 0, 0))
+			) & OBJECT_SCAN_WANTS_DLIST_END)
+			// vertex loads followed by triangles
+			| ((wordTop == OBJECT_SCAN_BYTES(G_VTX, 0, 0, 0))
+				& ((nextCmdTop == OBJECT_SCAN_BYTES(G_TRI1, 0, 0, 0))
+					| (nextCmdTop == OBJECT_SCAN_BYTES(G_TRI2, 0, 0, 0))
+				)
+				& OBJECT_SCAN_WANTS_VERTICES
+			)
+		;
+		
+		if (!(wants[0] | wants[1] | wants[2] | wants[3]))
+			continue;
+		
+		for (int i = 0; i < OBJECT_SCAN_LANES; ++i)
+			if (wants[i])
+				ObjectScanWord(file, walk + i * 4, scan, wants[i]);
 	}
 	
-	// bind pose
-	if (sb_count(obj->skeletons))
-		sb_push(obj->animations, ((struct ObjectAnimation){}));
+	// remainder
+	for (; walk + 4 <= end; walk += 4)
+		ObjectScanWord(file, walk, scan, OBJECT_SCAN_WANTS_ALL);
+}
+
+static void ObjectScanFree(struct ObjectScan *scan)
+{
+	sb_free(scan->skeletons);
+	sb_free(scan->animations);
+	sb_free(scan->dlistEnds);
+}
+
+static void ObjectParseAfterLoad(struct Object *obj, struct ObjectScan *scan)
+{
+	const struct File *file = obj->file;
+	const uint8_t *start = obj->file->data;
+	const uint32_t u24 = 0x00ffffff; // for masking lower 24 bits
 	
-	// rudimentary display list search
-	for (const uint8_t *walk = endAligned8 - 8; walk >= start; walk -= 8)
+	// let's assume skeletons don't store
+	// their limb lists in other segments
+	sb_foreach(scan->skeletons, {
+		if ((each->limbAddrsSegAddr >> 24) != obj->segment)
+			continue;
+		
+		// this may be a skeleton
+		each->segAddr |= obj->segment << 24;
+		LogDebug("skeleton at %08x, %d limbs"
+			, each->segAddr, each->limbCount
+		);
+		sb_push(obj->skeletons, *each);
+	})
+	
+	// TODO use skeletons to derive datablobs
+	// (that way, mesh/vertex/texture data is
+	// excluded from the following searches)
+	
+	// let's assume animations don't reference other segments
+	// (do they ever?)
+	sb_foreach(scan->animations, {
+		if ((each->rotValSegAddr >> 24) != obj->segment)
+			continue;
+		
+		// is likely an animation
+		each->object = obj;
+		each->segAddr |= obj->segment << 24;
+		LogDebug("animation at %08x, %d frames"
+			, each->segAddr, each->numFrames
+		);
+		sb_push(obj->animations, *each);
+	})
+	
+	// rudimentary display list search, walking backwards from each end
+	for (int n = sb_count(scan->dlistEnds) - 1; n >= 0; --n)
 	{
+		const uint8_t *walk = start + scan->dlistEnds[n];
 		uint32_t hi = u32r(walk);
 		uint32_t lo = u32r(walk + 4);
 		
@@ -542,86 +702,126 @@ static void ObjectParseAfterLoad(struct Object *obj)
 	sb_foreach(obj->meshes, { LogDebug("found DL %08x", each->segAddr); });
 }
 
-struct Object *ObjectFromFilename(const char *filename, int segment)
+// animations that aren't part of the object data, so aren't indexed
+static void ObjectAddImplicitAnimations(struct Object *obj)
+{
+	// pre-baked pose for viewing player models
+	if (
+		sb_count(obj->skeletons) > 0
+		&& sb_count(obj->animations) == 0
+		&& obj->skeletons->limbCount == 21
+		&& obj->skeletons->isLod
+	)
+	{
+		static struct File pose;
+		static struct Object poseObject;
+		
+		if (!pose.size)
+		{
+			static uint8_t poseData[] = {
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x0F, 0xA4, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0xF0, 0x5C, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0xE0, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x20, 0x00, 0x80, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00, 0x05,
+				0x00, 0x06, 0x00, 0x07, 0x00, 0x08, 0x00, 0x09, 0x00, 0x0A, 0x00, 0x0B,
+				0x00, 0x0C, 0x00, 0x0D, 0x00, 0x0E, 0x00, 0x0F, 0x00, 0x10, 0x00, 0x11,
+				0x00, 0x12, 0x00, 0x13, 0x00, 0x14, 0x00, 0x15, 0x00, 0x16, 0x00, 0x17,
+				0x00, 0x18, 0x00, 0x19, 0x00, 0x1A, 0x00, 0x1B, 0x00, 0x1C, 0x00, 0x1D,
+				0x00, 0x1E, 0x00, 0x1F, 0x00, 0x20, 0x00, 0x21, 0x00, 0x22, 0x00, 0x23,
+				0x00, 0x24, 0x00, 0x25, 0x00, 0x26, 0x00, 0x27, 0x00, 0x28, 0x00, 0x29,
+				0x00, 0x2A, 0x00, 0x2B, 0x00, 0x2C, 0x00, 0x2D, 0x00, 0x2E, 0x00, 0x2F,
+				0x00, 0x30, 0x00, 0x31, 0x00, 0x32, 0x00, 0x33, 0x00, 0x34, 0x00, 0x35,
+				0x00, 0x36, 0x00, 0x37, 0x00, 0x38, 0x00, 0x39, 0x00, 0x3A, 0x00, 0x3B,
+				0x00, 0x3C, 0x00, 0x3D, 0x00, 0x3E, 0x00, 0x3F, 0x00, 0x40, 0x00, 0x41,
+			};
+			pose.size = sizeof(poseData);
+			pose.data = poseData;
+			pose.dataEnd = poseData + pose.size;
+			poseObject.file = &pose;
+		}
+		
+		poseObject.segment = obj->segment;
+		sb_push(obj->animations, ((struct ObjectAnimation) {
+			.object = &poseObject,
+			.segAddr = 0x06000000,
+			.numFrames = 1,
+			.limit = 3,
+			.rotValSegAddr = 0x06000000,
+			.rotIndexSegAddr = 0x06000084,
+		}));
+	}
+	
+	// bind pose
+	if (sb_count(obj->skeletons))
+		sb_push(obj->animations, ((struct ObjectAnimation){}));
+}
+
+struct Object *ObjectFromFile(struct File *file, int segment)
 {
 	struct Object *result = Calloc(1, sizeof(*result));
+	struct ObjectScan scan;
+	int requestedSegment = segment > 0 ? segment : 0;
+	uint64_t hash = 0;
 	
-	result->file = FileFromFilename(filename);
+	result->file = file;
 	
-	// automatic segment detection
-	if (segment <= 0)
+	// analyzed in a previous session
+	if (ObjectIndexIsOpen())
 	{
-		int counts[N64_SEGMENT_MAX];
-		struct File *file = result->file;
-		uint8_t *end = file->dataEnd;
+		hash = MemHash(file->data, file->size);
 		
-		memset(counts, 0, sizeof(counts));
-		for (uint8_t *walk = file->data; walk <= end - 16; walk += 8)
+		if (ObjectIndexFindObject(hash, file->size, requestedSegment, result))
 		{
-			const uint8_t thisCmd = walk[0];
-			const uint8_t nextCmd = walk[8];
-			
-			// vertex load followed by triangle draw
-			if (thisCmd == G_VTX && (nextCmd == G_TRI1 || nextCmd == G_TRI2))
-			{
-				// try validating
-				const int vbuf = 64;
-				const uint8_t thisSeg = walk[4];
-				uint32_t hi = u32r(walk);
-				uint32_t lo = u32r(walk + 4);
-				uint16_t numv = (hi >> 12) & 0xfff;
-				uint16_t vbidx = ((hi & 0xfff) >> 1) - numv;
-				bool containsVertices = (
-					numv <= vbuf
-					&& vbidx <= vbuf - numv // sanity check whether write would overflow
-					&& (result->segment = thisSeg) < N64_SEGMENT_MAX
-					&& SegmentAddressIsValid(result, lo, 8) // technically only need align=4
-				);
-				bool containsGeometry = (
-					walk += 8
-					&& (hi = u32r(walk))
-					&& (lo = u32r(walk + 4))
-					&& walk[4] == 0
-					&& !(hi & 0x010101) // abc = even numbers
-					&& !(lo & 0x010101) // def = even numbers
-					&& walk[1] / 2 < vbuf
-					&& walk[2] / 2 < vbuf
-					&& walk[3] / 2 < vbuf
-					&& (
-						(nextCmd == G_TRI1 && !lo) // 05aabbcc 00000000
-						|| (nextCmd == G_TRI2 // 06aabbcc 00ddeeff
-							&& walk[5] / 2 < vbuf
-							&& walk[6] / 2 < vbuf
-							&& walk[7] / 2 < vbuf
-						)
-					)
-				);
-				
-				// increment the counter
-				if (containsVertices && containsGeometry)
-					counts[thisSeg] += 1;
-			}
+			ObjectAddImplicitAnimations(result);
+			return result;
 		}
-		
-		// whichever segment is most common will be the one
-		segment = ArrayGetIndexofMaxInt(counts, N64_ARRAY_COUNT(counts));
+	}
+	
+	ObjectScanFile(file, &scan);
+	
+	// automatic segment detection, whichever segment
+	// most vertex loads reference will be the one
+	if (segment <= 0)
+	{
+		segment = ArrayGetIndexofMaxInt(scan.segmentVotes, N64_ARRAY_COUNT(scan.segmentVotes));
 		
 		// fall back to default if no matches
-		if (segment < 0 || !counts[segment])
+		if (segment < 0 || !scan.segmentVotes[segment])
 			segment = 0x06;
 	}
 	
 	result->segment = segment;
 	
-	ObjectParseAfterLoad(result);
+	ObjectParseAfterLoad(result, &scan);
+	ObjectScanFree(&scan);
+	
+	if (ObjectIndexIsOpen())
+		ObjectIndexAddObject(hash, file->size, requestedSegment, result);
+	
+	ObjectAddImplicitAnimations(result);
 	
 	return result;
 }
 
+struct Object *ObjectFromFilename(const char *filename, int segment)
+{
+	return ObjectFromFile(FileFromFilename(filename), segment);
+}
+
 void ObjectFree(struct Object *object)
 {
 	FileFree(object->file);
 	
+	sb_foreach(object->animations, { free(each->frames); })
+	sb_foreach(object->skeletons, { sb_free(each->limbs); })
 	sb_free(object->meshes);
 	sb_free(object->animations);
 	sb_free(object->skeletons);
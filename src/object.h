@@ -29,6 +29,19 @@ struct ObjectAnimation
 	/* 0x000E */ uint16_t pad1;
 	
 	uint32_t segAddr;
+	
+	// decoded on first use, see SkelAnime_Update()
+	int16_t *frames; // native endian, [numFrames][framesLimbCount][xyz]
+	uint8_t framesLimbCount;
+};
+
+// skeleton hierarchy flattened into draw order
+struct ObjectLimb
+{
+	int16_t jointPos[3]; // native endian
+	uint8_t index; // in the skeleton's limb list
+	uint8_t depth; // 0 = root
+	uint32_t dList;
 };
 
 struct ObjectSkeleton
@@ -40,6 +53,9 @@ struct ObjectSkeleton
 	
 	// TODO eventually use ObjectMesh?
 	uint32_t segAddr;
+	
+	// decoded on first use, see SkelAnime_Draw()
+	sb_array(struct ObjectLimb, limbs);
 };
 
 struct Object
@@ -59,6 +75,7 @@ struct ObjectLimbOverride
 	const void *objectData; // optional, 0 for current object
 };
 
+struct Object *ObjectFromFile(struct File *file, int segment);
 struct Object *ObjectFromFilename(const char *filename, int segment);
 void ObjectFree(struct Object *object);
 
@@ -12,6 +12,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#define PROJECT_EXTRACT_MAX_JOBS 64
+#define PROJECT_ROM_MAGIC 0x80371240 // big endian (.z64)
 
 static void ProjectParse_rom(struct Project *proj, struct File *file)
 {
@@ -222,11 +230,36 @@ static void ProjectParse_zzrtl(struct Project *proj)
 		free(zzrpl);
 }
 
+static bool ProjectIsRomFilename(const char *shortname)
+{
+	return strstr(shortname, ".z64")
+		&& strstr(shortname, ".z64")
+			== strrchr(shortname, '.')
+	;
+}
+
 struct Project *ProjectNewFromFilename(const char *filename)
 {
-	struct Project *proj = calloc(1, sizeof(*proj));
-	struct File *file = FileFromFilename(filename);
+	struct Project *proj;
+	struct File *file;
+	
+	if (!filename || !FileExists(filename))
+	{
+		FileSetError("project '%s' not found", filename ? filename : "");
+		return 0;
+	}
 	
+	file = FileFromFilename(filename);
+	if (ProjectIsRomFilename(file->shortname)
+		&& (file->size < 0x1000 || u32r(file->data) != PROJECT_ROM_MAGIC)
+	)
+	{
+		FileSetError("'%s' is not a big endian (.z64) rom", filename);
+		FileFree(file);
+		return 0;
+	}
+	
+	proj = calloc(1, sizeof(*proj));
 	proj->filename = Strdup(file->filename);
 	proj->shortname = Strdup(file->shortname);
 	proj->folder = Strdup(file->filename);
@@ -248,10 +281,7 @@ struct Project *ProjectNewFromFilename(const char *filename)
 		|| strstr(file->shortname, ".rtl")
 	)
 		ProjectParse_zzrtl(proj);
-	else if (strstr(file->shortname, ".z64")
-		&& strstr(file->shortname, ".z64")
-			== strrchr(file->shortname, '.')
-	)
+	else if (ProjectIsRomFilename(file->shortname))
 		ProjectParse_rom(proj, file);
 	
 	if (proj->type != PROJECT_TYPE_ROM)
@@ -311,3 +341,292 @@ void ProjectFree(struct Project *proj)
 	
 	free(proj);
 }
+
+//
+// scene extraction
+//
+// scenes and rooms are position independent (segments 2 and 3), so each
+// is written exactly as it appears in the rom; nothing gets parsed into
+// a struct Scene, and the only memory in use is the rom that's already
+// loaded, regardless of how many scenes there are or how many jobs run
+//
+
+struct ProjectExtractJob
+{
+	struct Project *proj;
+	const char *outFolder;
+	sb_array(struct ProjectExtractedScene, results);
+	int next; // index of the next scene to claim, shared by all workers
+	const char *error;
+	pthread_mutex_t lock;
+};
+
+static uint32_t sCrc32Table[256];
+
+static void Crc32Init(void)
+{
+	for (uint32_t i = 0; i < 256; ++i)
+	{
+		uint32_t c = i;
+		
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		
+		sCrc32Table[i] = c;
+	}
+}
+
+static uint32_t Crc32(const void *data, size_t size)
+{
+	const uint8_t *b = data;
+	uint32_t c = 0xFFFFFFFF;
+	
+	while (size--)
+		c = sCrc32Table[(c ^ *(b++)) & 0xFF] ^ (c >> 8);
+	
+	return ~c;
+}
+
+static void ProjectMkdir(const char *path)
+{
+	mkdir(
+		path
+		#ifndef _WIN32
+		, 0777
+		#endif
+	);
+}
+
+static const char *ProjectExtractWrite(const char *path, const uint8_t *data, uint32_t size)
+{
+	FILE *fp = fopen(path, "wb");
+	
+	if (!fp)
+		return "failed to open file for writing";
+	
+	if (fwrite(data, 1, size, fp) != size)
+	{
+		fclose(fp);
+		return "failed to write file";
+	}
+	
+	if (fclose(fp))
+		return "failed to write file";
+	
+	return 0;
+}
+
+// the room list is the first 0x04 command in the first scene header;
+// ProjectParse_rom() validated it when finding the scene, but scenes
+// from files haven't been, so it must be in the scene and fit inside it
+const uint8_t *ProjectSceneRoomList(const uint8_t *scene, const uint8_t *sceneEnd, int *numRooms)
+{
+	for (const uint8_t *cmd = scene; cmd + 8 <= sceneEnd && *cmd != 0x14; cmd += 8)
+	{
+		if (*cmd == 0x04)
+		{
+			uint32_t offset = u32r(cmd + 4) & 0x00ffffff;
+			
+			if (cmd[4] != 0x02 || offset + cmd[1] * 8 > (uint32_t)(sceneEnd - scene))
+				return 0;
+			
+			*numRooms = cmd[1];
+			return scene + offset;
+		}
+	}
+	
+	return 0;
+}
+
+static const char *ProjectExtractScene(struct ProjectExtractJob *job, int index, struct ProjectExtractedScene *result)
+{
+	struct File *rom = job->proj->file;
+	const struct ProjectScene *scene = &job->proj->scenes[index];
+	const uint8_t *romData = rom->data;
+	const uint8_t *roomList;
+	char path[2048];
+	char *name;
+	const char *error;
+	int numRooms = 0;
+	
+	*result = (struct ProjectExtractedScene){
+		.index = index,
+		.startAddress = scene->startAddress,
+		.endAddress = scene->endAddress,
+		.crc32 = Crc32(romData + scene->startAddress, scene->endAddress - scene->startAddress),
+	};
+	
+	// out/scene/index/scene.zscene, out/scene/index/room_n.zmap
+	snprintf(path, sizeof(path) - 32, "%s/scene/%d/", job->outFolder, index);
+	name = path + strlen(path);
+	ProjectMkdir(path);
+	
+	strcpy(name, "scene.zscene");
+	if ((error = ProjectExtractWrite(path
+		, romData + scene->startAddress
+		, scene->endAddress - scene->startAddress
+	)))
+		return error;
+	
+	if (!(roomList = ProjectSceneRoomList(romData + scene->startAddress, romData + scene->endAddress, &numRooms)))
+		return "scene has no room list";
+	
+	for (int i = 0; i < numRooms; ++i)
+	{
+		struct ProjectExtractedRoom room = {
+			.startAddress = u32r(roomList + i * 8),
+			.endAddress = u32r(roomList + i * 8 + 4),
+		};
+		
+		if (room.endAddress <= room.startAddress || room.endAddress > rom->size)
+			return "room list references data outside the rom";
+		
+		room.crc32 = Crc32(romData + room.startAddress, room.endAddress - room.startAddress);
+		sprintf(name, "room_%d.zmap", i);
+		if ((error = ProjectExtractWrite(path
+			, romData + room.startAddress
+			, room.endAddress - room.startAddress
+		)))
+			return error;
+		
+		sb_push(result->rooms, room);
+	}
+	
+	return 0;
+}
+
+static void *ProjectExtractWorker(void *udata)
+{
+	struct ProjectExtractJob *job = udata;
+	int numScenes = sb_count(job->proj->scenes);
+	
+	for (;;)
+	{
+		struct ProjectExtractedScene result;
+		const char *error;
+		int index;
+		
+		pthread_mutex_lock(&job->lock);
+		index = job->error ? numScenes : job->next++;
+		pthread_mutex_unlock(&job->lock);
+		
+		if (index >= numScenes)
+			break;
+		
+		error = ProjectExtractScene(job, index, &result);
+		
+		pthread_mutex_lock(&job->lock);
+		if (error && !job->error)
+			job->error = error;
+		job->results[index] = result;
+		pthread_mutex_unlock(&job->lock);
+	}
+	
+	return 0;
+}
+
+static const char *ProjectExtractWriteManifest(struct ProjectExtractJob *job)
+{
+	char path[2048];
+	FILE *fp;
+	
+	snprintf(path, sizeof(path), "%s/manifest.json", job->outFolder);
+	if (!(fp = fopen(path, "w")))
+		return "failed to open manifest.json for writing";
+	
+	fprintf(fp, "{\n");
+	fprintf(fp, "\t\"rom\": \"%s\",\n", job->proj->shortname);
+	fprintf(fp, "\t\"romSize\": %u,\n", (uint32_t)job->proj->file->size);
+	fprintf(fp, "\t\"romCrc32\": \"%08x\",\n", Crc32(job->proj->file->data, job->proj->file->size));
+	fprintf(fp, "\t\"scenes\": [\n");
+	sb_foreach_named(job->results, scene, {
+		fprintf(fp, "\t\t{\n");
+		fprintf(fp, "\t\t\t\"path\": \"scene/%d/scene.zscene\",\n", scene->index);
+		fprintf(fp, "\t\t\t\"start\": \"0x%08x\",\n", scene->startAddress);
+		fprintf(fp, "\t\t\t\"end\": \"0x%08x\",\n", scene->endAddress);
+		fprintf(fp, "\t\t\t\"crc32\": \"%08x\",\n", scene->crc32);
+		fprintf(fp, "\t\t\t\"rooms\": [\n");
+		sb_foreach_named(scene->rooms, room, {
+			fprintf(fp, "\t\t\t\t{ \"path\": \"scene/%d/room_%d.zmap\", \"start\": \"0x%08x\", \"end\": \"0x%08x\", \"crc32\": \"%08x\" }%s\n"
+				, scene->index, roomIndex
+				, room->startAddress, room->endAddress, room->crc32
+				, (roomIndex + 1 < sb_count(scene->rooms)) ? "," : ""
+			);
+		})
+		fprintf(fp, "\t\t\t]\n");
+		fprintf(fp, "\t\t}%s\n", (sceneIndex + 1 < sb_count(job->results)) ? "," : "");
+	})
+	fprintf(fp, "\t]\n");
+	fprintf(fp, "}\n");
+	
+	if (fclose(fp))
+		return "failed to write manifest.json";
+	
+	return 0;
+}
+
+const char *ProjectExtractScenes(struct Project *proj, const char *outFolder, int jobs)
+{
+	struct ProjectExtractJob job = {
+		.proj = proj,
+		.outFolder = outFolder,
+	};
+	pthread_t threads[PROJECT_EXTRACT_MAX_JOBS];
+	int numScenes = sb_count(proj->scenes);
+	char path[2048];
+	
+	if (proj->type != PROJECT_TYPE_ROM)
+		return "scene extraction requires a rom";
+	
+	if (!numScenes)
+		return "no scenes found in rom";
+	
+	jobs = MAX(1, MIN(jobs, MIN(PROJECT_EXTRACT_MAX_JOBS, numScenes)));
+	
+	ProjectMkdir(outFolder);
+	snprintf(path, sizeof(path), "%s/scene", outFolder);
+	ProjectMkdir(path);
+	
+	Crc32Init();
+	(void)sb_add(job.results, numScenes);
+	memset(job.results, 0, numScenes * sizeof(*job.results));
+	pthread_mutex_init(&job.lock, 0);
+	
+	LogDebug("extracting %d scenes using %d jobs", numScenes, jobs);
+	for (int i = 0; i < jobs; ++i)
+		if (pthread_create(&threads[i], 0, ProjectExtractWorker, &job))
+			Die("failed to create worker thread");
+	for (int i = 0; i < jobs; ++i)
+		pthread_join(threads[i], 0);
+	
+	pthread_mutex_destroy(&job.lock);
+	
+	if (!job.error)
+		job.error = ProjectExtractWriteManifest(&job);
+	
+	sb_foreach(job.results, { sb_free(each->rooms); })
+	sb_free(job.results);
+	
+	return job.error;
+}
+
+// what both ExtractScenes and Batch Extract run: loads the rom, extracts
+// it, and frees it again; numScenes (optional) receives how many there were
+const char *ProjectExtractScenesFromFilename(const char *romFilename, const char *outFolder, int jobs, int *numScenes)
+{
+	struct Project *proj = ProjectNewFromFilename(romFilename);
+	const char *error;
+	
+	if (numScenes)
+		*numScenes = 0;
+	
+	if (!proj)
+		return FileGetError();
+	
+	error = ProjectExtractScenes(proj, outFolder, jobs);
+	if (numScenes)
+		*numScenes = sb_count(proj->scenes);
+	ProjectFree(proj);
+	
+	return error;
+}
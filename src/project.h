@@ -34,6 +34,22 @@ struct ProjectScene
 	uint32_t sizeBytes;
 };
 
+struct ProjectExtractedRoom
+{
+	uint32_t startAddress;
+	uint32_t endAddress;
+	uint32_t crc32;
+};
+
+struct ProjectExtractedScene
+{
+	int index; // in Project.scenes
+	uint32_t startAddress;
+	uint32_t endAddress;
+	uint32_t crc32;
+	sb_array(struct ProjectExtractedRoom, rooms);
+};
+
 struct Project
 {
 	char *filename;
@@ -52,7 +68,11 @@ struct Project
 	struct File *file;
 };
 
+// returns 0 with the reason in FileGetError() if it can't be opened
 struct Project *ProjectNewFromFilename(const char *filename);
 void ProjectFree(struct Project *proj);
+const char *ProjectExtractScenes(struct Project *proj, const char *outFolder, int jobs);
+const char *ProjectExtractScenesFromFilename(const char *romFilename, const char *outFolder, int jobs, int *numScenes);
+const uint8_t *ProjectSceneRoomList(const uint8_t *scene, const uint8_t *sceneEnd, int *numRooms);
 
 #endif // PROJECT_H_INCLUDED
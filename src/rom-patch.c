@@ -0,0 +1,608 @@
+//
+// rom-patch.c
+//
+// writes files back into a decompressed rom, in place where possible
+//
+// a file that still fits in its original range keeps that range, so no
+// table needs updating, and the slack after it is zeroed; a file that
+// grew is moved to free space, which is either past the last file in the
+// file table (dmadata) or a range vacated by another moved file, and the
+// references to its old range are updated: those in the file table, and
+// those in other tables of start/end pairs such as the scene table
+//
+// edits are made to a copy of the rom read from disk, tracking which
+// byte ranges actually changed, and only those are written back
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rom-patch.h"
+#include "logging.h"
+#include "misc.h"
+#include "file.h"
+
+#define ROM_PATCH_ALIGN(X) (((X) + 15) & ~15)
+#define ROM_PATCH_MERGE_GAP 32 // changed ranges closer than this are written as one
+#define ROM_PATCH_MAGIC 0x80371240 // big endian (.z64)
+#define ROM_PATCH_CRC_START 0x1000
+#define ROM_PATCH_CRC_LENGTH 0x100000
+#define ROM_PATCH_DMA_BOOT 0x1060 // where boot starts, in oot and mm alike
+#define ROM_PATCH_TABLE_RUN 4 // files named in a row by a table of start/end pairs
+
+struct RomPatchRange
+{
+	uint32_t start;
+	uint32_t end;
+};
+
+struct RomPatchFile
+{
+	struct RomPatchRange from;
+	struct RomPatchRange to;
+	uint8_t *data;
+	uint32_t size;
+};
+
+struct RomPatch
+{
+	char *filename;
+	struct File *rom;
+	uint8_t *data; // the rom, grown as needed
+	uint32_t size; // on disk
+	uint32_t newSize;
+	uint8_t padValue;
+	bool isPlanned;
+	struct RomPatchRange dmadata; // the file table
+	sb_array(struct RomPatchRange, dmaFiles); // every file it lists, by start
+	sb_array(struct RomPatchFile, files);
+	sb_array(struct RomPatchRange, dirty);
+};
+
+struct RomPatchReference
+{
+	uint32_t offset; // of the start/end pair
+	struct RomPatchFile *file;
+};
+
+#if 1 // region: private functions
+
+static void RomPatchPut32(uint8_t *dst, uint32_t v)
+{
+	dst[0] = v >> 24;
+	dst[1] = v >> 16;
+	dst[2] = v >> 8;
+	dst[3] = v;
+}
+
+static int RomPatchCompareRanges(const void *a, const void *b)
+{
+	const struct RomPatchRange *rangeA = a;
+	const struct RomPatchRange *rangeB = b;
+	
+	return (rangeA->start > rangeB->start) - (rangeA->start < rangeB->start);
+}
+
+// copies src into the rom, remembering only the runs that differ
+static void RomPatchWrite(struct RomPatch *patch, uint32_t offset, const uint8_t *src, uint32_t size)
+{
+	uint8_t *dst = patch->data + offset;
+	
+	for (uint32_t i = 0; i < size; )
+	{
+		uint32_t start;
+		uint32_t end;
+		
+		if (dst[i] == src[i])
+		{
+			++i;
+			continue;
+		}
+		
+		for (start = i, end = i + 1, i += 1; i < size && i - end < ROM_PATCH_MERGE_GAP; ++i)
+			if (dst[i] != src[i])
+				end = i + 1;
+		
+		memcpy(dst + start, src + start, end - start);
+		sb_push(patch->dirty, ((struct RomPatchRange){ offset + start, offset + end }));
+		i = end;
+	}
+}
+
+static void RomPatchWrite32(struct RomPatch *patch, uint32_t offset, uint32_t value)
+{
+	uint8_t bytes[4];
+	
+	RomPatchPut32(bytes, value);
+	RomPatchWrite(patch, offset, bytes, sizeof(bytes));
+}
+
+static void RomPatchFill(struct RomPatch *patch, uint32_t offset, uint32_t size, uint8_t value)
+{
+	uint8_t *fill;
+	
+	if (!size)
+		return;
+	
+	fill = malloc(size);
+	memset(fill, value, size);
+	RomPatchWrite(patch, offset, fill, size);
+	free(fill);
+}
+
+// files new to the rom have no references to update
+static bool RomPatchFileMoved(const struct RomPatchFile *file)
+{
+	return file->from.end && (file->to.start != file->from.start || file->to.end != file->from.end);
+}
+
+// the file table begins with entries for makerom and boot, which are the
+// same in every decompressed oot and mm rom, and ends with an empty entry
+static bool RomPatchFindDmadata(struct RomPatch *patch)
+{
+	const uint8_t *data = patch->data;
+	
+	for (uint32_t i = 0; i + 0x20 <= patch->size; i += 16)
+	{
+		uint32_t end;
+		
+		if (u32r(data + i) != 0
+			|| u32r(data + i + 4) != ROM_PATCH_DMA_BOOT
+			|| u32r(data + i + 8) != 0
+			|| u32r(data + i + 12) != 0
+			|| u32r(data + i + 16) != ROM_PATCH_DMA_BOOT
+		)
+			continue;
+		
+		for (end = i; end + 16 <= patch->size && u32r(data + end + 4); end += 16)
+			sb_push(patch->dmaFiles, ((struct RomPatchRange){ u32r(data + end), u32r(data + end + 4) }));
+		
+		patch->dmadata = (struct RomPatchRange){ i, end };
+		qsort(patch->dmaFiles, sb_count(patch->dmaFiles), sizeof(*patch->dmaFiles), RomPatchCompareRanges);
+		LogDebug("file table at %08x-%08x, %d files", i, end, sb_count(patch->dmaFiles));
+		
+		return true;
+	}
+	
+	return false;
+}
+
+// 1 if the start/end pair at offset names a file in the file table,
+// 0 if it's empty, -1 otherwise
+static int RomPatchTableEntry(struct RomPatch *patch, uint32_t offset)
+{
+	struct RomPatchRange key = { u32r(patch->data + offset), u32r(patch->data + offset + 4) };
+	const struct RomPatchRange *found;
+	
+	if (!key.start && !key.end)
+		return 0;
+	
+	found = bsearch(&key, patch->dmaFiles, sb_count(patch->dmaFiles), sizeof(key), RomPatchCompareRanges);
+	
+	return (found && found->end == key.end) ? 1 : -1;
+}
+
+// whether the start/end pair at offset is one entry of a table of them,
+// spaced like the scene table (0x14 bytes apart in oot, 0x10 in mm),
+// rather than two words that only happen to match
+static bool RomPatchIsInTable(struct RomPatch *patch, uint32_t offset)
+{
+	const uint32_t strides[] = { 0x14, 0x10 };
+	
+	for (int i = 0; i < sizeof(strides) / sizeof(*strides); ++i)
+	{
+		uint32_t stride = strides[i];
+		int numFiles = 0;
+		int entry;
+		
+		for (uint32_t at = offset; at + 8 <= patch->size && numFiles < ROM_PATCH_TABLE_RUN; at += stride)
+		{
+			if ((entry = RomPatchTableEntry(patch, at)) < 0)
+				break;
+			numFiles += entry;
+		}
+		
+		for (uint32_t at = offset; at >= stride && numFiles < ROM_PATCH_TABLE_RUN; )
+		{
+			at -= stride;
+			if ((entry = RomPatchTableEntry(patch, at)) < 0)
+				break;
+			numFiles += entry;
+		}
+		
+		if (numFiles >= ROM_PATCH_TABLE_RUN)
+			return true;
+	}
+	
+	return false;
+}
+
+// moved files are pointed at their new ranges in the file table, where
+// decompressed roms also repeat the start as the physical address with a
+// zero end, and in any other table of start/end pairs
+static void RomPatchUpdateReferences(struct RomPatch *patch)
+{
+	sb_array(struct RomPatchReference, refs) = 0;
+	uint32_t lowest = UINT32_MAX;
+	uint32_t highest = 0;
+	
+	sb_foreach(patch->files, {
+		if (!RomPatchFileMoved(each))
+			continue;
+		lowest = MIN(lowest, each->from.start);
+		highest = MAX(highest, each->from.start);
+	})
+	
+	if (lowest > highest)
+		return;
+	
+	// found before any are changed, as the tables are recognized by their contents
+	for (uint32_t i = 0; i + 8 <= patch->size; i += 4)
+	{
+		uint32_t word = u32r(patch->data + i);
+		
+		if ((word & 3) || word < lowest || word > highest)
+			continue;
+		
+		sb_foreach(patch->files, {
+			if (!RomPatchFileMoved(each)
+				|| word != each->from.start
+				|| u32r(patch->data + i + 4) != each->from.end
+			)
+				continue;
+			
+			if ((i >= patch->dmadata.start && i < patch->dmadata.end)
+				? ((i - patch->dmadata.start) & 15)
+				: !RomPatchIsInTable(patch, i)
+			)
+			{
+				LogDebug("not a file reference at %08x", i);
+				break;
+			}
+			
+			sb_push(refs, ((struct RomPatchReference){ i, each }));
+			i += 4;
+			break;
+		})
+	}
+	
+	sb_foreach(refs, {
+		const struct RomPatchFile *file = each->file;
+		uint32_t i = each->offset;
+		
+		LogDebug("reference to %08x-%08x at %08x now %08x-%08x"
+			, file->from.start, file->from.end, i, file->to.start, file->to.end
+		);
+		
+		if (i >= patch->dmadata.start && i < patch->dmadata.end)
+		{
+			if (u32r(patch->data + i + 8) == file->from.start)
+				RomPatchWrite32(patch, i + 8, file->to.start);
+			if (u32r(patch->data + i + 12) == file->from.end)
+				RomPatchWrite32(patch, i + 12, file->to.end);
+		}
+		
+		RomPatchWrite32(patch, i, file->to.start);
+		RomPatchWrite32(patch, i + 4, file->to.end);
+	})
+	
+	sb_free(refs);
+}
+
+static uint32_t RomPatchCrc32(const uint8_t *data, size_t size)
+{
+	uint32_t c = 0xFFFFFFFF;
+	
+	while (size--)
+	{
+		c ^= *(data++);
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+	}
+	
+	return ~c;
+}
+
+// the header checksum covers the first mib after the boot code, and is
+// seeded by which boot chip (cic) the boot code is written for
+static void RomPatchUpdateChecksum(struct RomPatch *patch)
+{
+	const uint8_t *data = patch->data;
+	uint32_t bootCrc = RomPatchCrc32(data + 0x40, 0x1000 - 0x40);
+	uint32_t t1, t2, t3, t4, t5, t6;
+	uint32_t seed;
+	uint32_t result[2];
+	int cic;
+	
+	switch (bootCrc)
+	{
+		case 0x6170A4A1: cic = 6101; seed = 0xF8CA4DDC; break;
+		case 0x90BB6CB5: cic = 6102; seed = 0xF8CA4DDC; break;
+		case 0x0B050EE0: cic = 6103; seed = 0xA3886759; break;
+		case 0x98BC2C86: cic = 6105; seed = 0xDF26F436; break;
+		case 0xACC8580A: cic = 6106; seed = 0x1FEA617A; break;
+		default:
+			LogWarn("unknown boot code %08x, rom checksum not updated", bootCrc);
+			return;
+	}
+	
+	t1 = t2 = t3 = t4 = t5 = t6 = seed;
+	for (uint32_t i = ROM_PATCH_CRC_START; i < ROM_PATCH_CRC_START + ROM_PATCH_CRC_LENGTH; i += 4)
+	{
+		uint32_t d = u32r(data + i);
+		uint32_t r = (d << (d & 0x1F)) | (d >> ((32 - (d & 0x1F)) & 0x1F));
+		
+		if (t6 + d < t6)
+			t4 += 1;
+		t6 += d;
+		t3 ^= d;
+		t5 += r;
+		t2 ^= (t2 > d) ? r : t6 ^ d;
+		t1 += (cic == 6105) ? u32r(data + 0x0750 + (i & 0xFF)) ^ d : t5 ^ d;
+	}
+	
+	switch (cic)
+	{
+		case 6103: result[0] = (t6 ^ t4) + t3; result[1] = (t5 ^ t2) + t1; break;
+		case 6106: result[0] = (t6 * t4) + t3; result[1] = (t5 * t2) + t1; break;
+		default: result[0] = t6 ^ t4 ^ t3; result[1] = t5 ^ t2 ^ t1; break;
+	}
+	
+	RomPatchWrite32(patch, 0x10, result[0]);
+	RomPatchWrite32(patch, 0x14, result[1]);
+}
+
+static int RomPatchWriteDirty(struct RomPatch *patch)
+{
+	sb_array(struct RomPatchRange, runs) = 0;
+	uint32_t numBytes = 0;
+	FILE *fp;
+	
+	if (!sb_count(patch->dirty))
+		return EXIT_SUCCESS;
+	
+	qsort(patch->dirty, sb_count(patch->dirty), sizeof(*patch->dirty), RomPatchCompareRanges);
+	sb_foreach(patch->dirty, {
+		if (sb_count(runs) && each->start <= sb_last(runs).end + ROM_PATCH_MERGE_GAP)
+			sb_last(runs).end = MAX(sb_last(runs).end, each->end);
+		else
+			sb_push(runs, *each);
+	})
+	
+	if (!(fp = fopen(patch->filename, "r+b")))
+	{
+		sb_free(runs);
+		return FileSetError("failed to open '%s' for writing", patch->filename);
+	}
+	
+	sb_foreach(runs, {
+		if (fseek(fp, each->start, SEEK_SET)
+			|| fwrite(patch->data + each->start, 1, each->end - each->start, fp) != each->end - each->start
+		)
+		{
+			fclose(fp);
+			sb_free(runs);
+			return FileSetError("failed to write to '%s'", patch->filename);
+		}
+		numBytes += each->end - each->start;
+	})
+	
+	if (fclose(fp))
+	{
+		sb_free(runs);
+		return FileSetError("error closing '%s' after writing", patch->filename);
+	}
+	
+	LogDebug("wrote %u bytes in %d ranges to '%s'", numBytes, sb_count(runs), patch->filename);
+	sb_free(runs);
+	
+	return EXIT_SUCCESS;
+}
+
+#endif // endregion
+
+struct RomPatch *RomPatchNew(const char *romFilename)
+{
+	struct RomPatch *patch;
+	struct File *rom;
+	
+	if (!romFilename || !FileExists(romFilename))
+	{
+		FileSetError("rom '%s' not found", romFilename ? romFilename : "");
+		return 0;
+	}
+	
+	rom = FileFromFilename(romFilename);
+	if (rom->size < ROM_PATCH_CRC_START + ROM_PATCH_CRC_LENGTH || u32r(rom->data) != ROM_PATCH_MAGIC)
+	{
+		FileSetError("'%s' is not a big endian (.z64) rom", romFilename);
+		FileFree(rom);
+		return 0;
+	}
+	
+	patch = Calloc(1, sizeof(*patch));
+	patch->filename = Strdup(romFilename);
+	patch->rom = rom;
+	patch->data = rom->data;
+	patch->size = rom->size;
+	patch->newSize = rom->size;
+	patch->padValue = patch->data[patch->size - 1];
+	
+	if (!RomPatchFindDmadata(patch))
+	{
+		FileSetError("no file table (dmadata) found in '%s'", romFilename);
+		RomPatchFree(patch);
+		return 0;
+	}
+	
+	return patch;
+}
+
+int RomPatchAddFile(struct RomPatch *patch, uint32_t start, uint32_t end, struct File *contents)
+{
+	struct RomPatchFile file = {
+		.from = { start, end },
+		.size = contents->size,
+		.data = Memdup(contents->data, contents->size),
+	};
+	
+	sb_push(patch->files, file);
+	patch->isPlanned = false;
+	
+	return sb_count(patch->files) - 1;
+}
+
+int RomPatchPlan(struct RomPatch *patch)
+{
+	sb_array(struct RomPatchRange, freeRanges) = 0;
+	uint32_t tail;
+	uint32_t newEnd = patch->size;
+	
+	sb_foreach_named(patch->files, file, {
+		const struct RomPatchRange *listed;
+		
+		// the game finds files through the file table, so a file without
+		// an entry there would be written where nothing can load it
+		if (!file->from.end)
+			return FileSetError("a file of 0x%x bytes is new to the rom, which has no file table entry for it", file->size);
+		
+		if (file->from.start >= file->from.end || file->from.end > patch->size || (file->from.start & 3))
+			return FileSetError("file %08x-%08x is not inside the rom", file->from.start, file->from.end);
+		
+		listed = bsearch(&file->from, patch->dmaFiles, sb_count(patch->dmaFiles), sizeof(file->from), RomPatchCompareRanges);
+		if (!listed || listed->end != file->from.end)
+			return FileSetError("file %08x-%08x is not in the file table", file->from.start, file->from.end);
+		
+		sb_foreach(patch->files, {
+			if (each != file && each->from.end && file->from.start < each->from.end && each->from.start < file->from.end)
+				return FileSetError("files %08x-%08x and %08x-%08x overlap"
+					, file->from.start, file->from.end, each->from.start, each->from.end
+				);
+		})
+	})
+	
+	// files that still fit stay put, the rest vacate their ranges
+	sb_foreach(patch->files, {
+		if (ROM_PATCH_ALIGN(each->size) <= each->from.end - each->from.start)
+			each->to = each->from;
+		else
+		{
+			if (each->from.end)
+				sb_push(freeRanges, each->from);
+			each->to = (struct RomPatchRange){ 0 };
+		}
+	})
+	
+	// everything after the last file, which may grow into the maximum size;
+	// going by the file table, as a file may well end in bytes like padding
+	tail = 0;
+	sb_foreach(patch->dmaFiles, { tail = MAX(tail, each->end); })
+	sb_foreach(patch->files, { tail = MAX(tail, each->from.end); })
+	tail = ROM_PATCH_ALIGN(tail);
+	if (tail < ROM_PATCH_MAX_SIZE)
+		sb_push(freeRanges, ((struct RomPatchRange){ tail, ROM_PATCH_MAX_SIZE }));
+	qsort(freeRanges, sb_count(freeRanges), sizeof(*freeRanges), RomPatchCompareRanges);
+	
+	// largest files first, each into the first range it fits
+	for (;;)
+	{
+		struct RomPatchFile *largest = 0;
+		uint32_t size;
+		
+		sb_foreach(patch->files, {
+			if (!each->to.end && (!largest || each->size > largest->size))
+				largest = each;
+		})
+		
+		if (!largest)
+			break;
+		
+		size = ROM_PATCH_ALIGN(largest->size);
+		sb_foreach(freeRanges, {
+			if (each->end - each->start >= size)
+			{
+				largest->to = ((struct RomPatchRange){ each->start, each->start + size });
+				each->start += size;
+				break;
+			}
+		})
+		
+		if (!largest->to.end)
+		{
+			sb_free(freeRanges);
+			return FileSetError("not enough free space in rom for a file of 0x%x bytes", largest->size);
+		}
+		
+		newEnd = MAX(newEnd, largest->to.end);
+	}
+	sb_free(freeRanges);
+	
+	patch->newSize = patch->size;
+	if (newEnd > patch->size)
+		patch->newSize = MIN(ROM_PATCH_MAX_SIZE, (newEnd + ROM_PATCH_GROW_STEP - 1) & ~(ROM_PATCH_GROW_STEP - 1));
+	patch->isPlanned = true;
+	
+	return EXIT_SUCCESS;
+}
+
+void RomPatchGetRange(struct RomPatch *patch, int index, uint32_t *start, uint32_t *end)
+{
+	*start = patch->files[index].to.start;
+	*end = patch->files[index].to.end;
+}
+
+uint8_t *RomPatchGetData(struct RomPatch *patch, int index, uint32_t *size)
+{
+	*size = patch->files[index].size;
+	
+	return patch->files[index].data;
+}
+
+int RomPatchCommit(struct RomPatch *patch)
+{
+	int result;
+	
+	if (!patch->isPlanned && RomPatchPlan(patch))
+	{
+		RomPatchFree(patch);
+		return EXIT_FAILURE;
+	}
+	
+	if (patch->newSize > patch->size)
+	{
+		LogDebug("growing rom from 0x%x to 0x%x bytes", patch->size, patch->newSize);
+		patch->data = realloc(patch->data, patch->newSize);
+		patch->rom->data = patch->data;
+		memset(patch->data + patch->size, patch->padValue, patch->newSize - patch->size);
+		sb_push(patch->dirty, ((struct RomPatchRange){ patch->size, patch->newSize }));
+	}
+	
+	// before the files, so stale references inside their old contents don't matter
+	RomPatchUpdateReferences(patch);
+	
+	sb_foreach(patch->files, {
+		RomPatchWrite(patch, each->to.start, each->data, each->size);
+		RomPatchFill(patch, each->to.start + each->size, each->to.end - each->to.start - each->size, 0);
+	})
+	
+	RomPatchUpdateChecksum(patch);
+	result = RomPatchWriteDirty(patch);
+	RomPatchFree(patch);
+	
+	return result;
+}
+
+void RomPatchFree(struct RomPatch *patch)
+{
+	if (!patch)
+		return;
+	
+	sb_foreach(patch->files, { free(each->data); })
+	sb_free(patch->files);
+	sb_free(patch->dmaFiles);
+	sb_free(patch->dirty);
+	FileFree(patch->rom);
+	free(patch->filename);
+	free(patch);
+}
@@ -0,0 +1,42 @@
+//
+// rom-patch.h
+//
+// writes files back into a decompressed rom, in place where possible
+//
+
+#ifndef ROM_PATCH_H_INCLUDED
+#define ROM_PATCH_H_INCLUDED
+
+#include <stdint.h>
+
+struct File;
+struct RomPatch;
+
+// roms grow in steps of this size when they run out of free space
+#define ROM_PATCH_GROW_STEP 0x100000
+#define ROM_PATCH_MAX_SIZE 0x4000000
+
+// reads the rom from disk; returns 0 with the reason in FileGetError() on failure
+struct RomPatch *RomPatchNew(const char *romFilename);
+
+// queues new contents for the file occupying start-end in the rom,
+// returning its index; contents are copied; the range must be one the
+// file table (dmadata) lists, as files new to the rom would need entries
+// added to it, which isn't supported, so planning refuses them
+int RomPatchAddFile(struct RomPatch *patch, uint32_t start, uint32_t end, struct File *contents);
+
+// decides where every file goes: in its original range if it still fits,
+// otherwise in free space at the end of the rom or left by another file
+int RomPatchPlan(struct RomPatch *patch);
+
+// after planning, where a file will be and its contents, for fixing up
+// references between the files before they are written
+void RomPatchGetRange(struct RomPatch *patch, int index, uint32_t *start, uint32_t *end);
+uint8_t *RomPatchGetData(struct RomPatch *patch, int index, uint32_t *size);
+
+// updates references to moved files, then writes only the bytes that
+// changed back to the rom; frees the patch
+int RomPatchCommit(struct RomPatch *patch);
+void RomPatchFree(struct RomPatch *patch);
+
+#endif // ROM_PATCH_H_INCLUDED
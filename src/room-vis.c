@@ -0,0 +1,331 @@
+//
+// room-vis.c
+//
+// which rooms can be seen from the camera, through doorways
+//
+// every room is given the part of the screen it can be seen through: the
+// rooms the eye is inside get all of it, and from there each doorway hands
+// the room on its other side whatever part of the doorway shows through
+// the room it is seen from; a room ends up visible if it was reached this
+// way and its bounds fall inside what it was given
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "room-vis.h"
+#include "misc.h"
+
+// transition actors don't say how big their doorways are, so a doorway
+// is taken to be anywhere between the two rooms it joins, grown by this
+// much for doorframes only one of the rooms has any geometry for
+#define ROOM_VIS_DOORWAY_MARGIN 100.0f
+
+#define SIZEOF_VTX 16
+
+#define READ_16_BE(BYTES, OFFSET) (int16_t)( \
+	(((const uint8_t*)(BYTES))[OFFSET + 0] << 8) | \
+	(((const uint8_t*)(BYTES))[OFFSET + 1] << 0) \
+)
+
+struct RoomVis
+{
+	const void *data; // the room data the bounds came from
+	uint32_t size;
+	Vec3f min;
+	Vec3f max;
+	bool hasBounds;
+};
+
+// in normalized device coordinates
+struct RoomVisRect
+{
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+};
+
+static const struct RoomVisRect gFullRect = { -1, -1, 1, 1 };
+
+// reused between frames
+static sb_array(bool, gIsVisible);
+static sb_array(bool, gIsReached);
+static sb_array(struct RoomVisRect, gRects);
+static sb_array(int, gQueue);
+
+#if 1 // region: private functions
+
+static void RoomVisGrow(struct RoomVis *vis, Vec3f point)
+{
+	if (!vis->hasBounds)
+	{
+		vis->min = vis->max = point;
+		vis->hasBounds = true;
+		return;
+	}
+	
+	vis->min = (Vec3f){ MIN(vis->min.x, point.x), MIN(vis->min.y, point.y), MIN(vis->min.z, point.z) };
+	vis->max = (Vec3f){ MAX(vis->max.x, point.x), MAX(vis->max.y, point.y), MAX(vis->max.z, point.z) };
+}
+
+// the box around every vertex the room's meshes use, and around
+// the spheres its cullable display lists are drawn within
+static struct RoomVis *RoomVisGetBounds(struct Room *room)
+{
+	struct RoomVis *vis = room->vis;
+	
+	if (!vis)
+		vis = room->vis = Calloc(1, sizeof(*vis));
+	
+	if (vis->data == room->file->data && vis->size == room->file->size)
+		return vis;
+	
+	vis->data = room->file->data;
+	vis->size = room->file->size;
+	vis->hasBounds = false;
+	
+	datablob_foreach_filter(room->blobs, == DATA_BLOB_TYPE_VERTEX, {
+		const uint8_t *vtx = each->refData;
+		
+		for (uint32_t i = 0; i + SIZEOF_VTX <= each->sizeBytes; i += SIZEOF_VTX)
+			RoomVisGrow(vis, (Vec3f){
+				READ_16_BE(vtx, i + 0),
+				READ_16_BE(vtx, i + 2),
+				READ_16_BE(vtx, i + 4)
+			});
+	})
+	
+	if (sb_count(room->headers) && room->headers[0].meshFormat == 2)
+	{
+		sb_foreach(room->headers[0].displayLists, {
+			if (each->radius < 0)
+				continue;
+			RoomVisGrow(vis, Vec3f_Sub(each->center, Vec3f_New(each->radius, each->radius, each->radius)));
+			RoomVisGrow(vis, Vec3f_Add(each->center, Vec3f_New(each->radius, each->radius, each->radius)));
+		});
+	}
+	
+	return vis;
+}
+
+// the part of the screen the points cover, or false if they are all behind
+// the eye; a point behind it can end up anywhere, so then it's all of it
+static bool RoomVisProject(const Vec3f *points, int count, Matrix *projView, struct RoomVisRect *dst)
+{
+	int numBehind = 0;
+	
+	*dst = (struct RoomVisRect){ FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+	
+	for (int i = 0; i < count; ++i)
+	{
+		Vec3f point = points[i];
+		Vec4f clip;
+		
+		Matrix_MultVec3fToVec4f_Ext(&point, &clip, projView);
+		
+		if (clip.w <= 0)
+		{
+			numBehind += 1;
+			continue;
+		}
+		
+		dst->x0 = MIN(dst->x0, clip.x / clip.w);
+		dst->y0 = MIN(dst->y0, clip.y / clip.w);
+		dst->x1 = MAX(dst->x1, clip.x / clip.w);
+		dst->y1 = MAX(dst->y1, clip.y / clip.w);
+	}
+	
+	if (numBehind == count)
+		return false;
+	
+	if (numBehind)
+		*dst = gFullRect;
+	
+	return true;
+}
+
+static bool RoomVisIntersect(struct RoomVisRect a, struct RoomVisRect b, struct RoomVisRect *dst)
+{
+	*dst = (struct RoomVisRect){
+		MAX(a.x0, b.x0),
+		MAX(a.y0, b.y0),
+		MIN(a.x1, b.x1),
+		MIN(a.y1, b.y1)
+	};
+	
+	return dst->x0 < dst->x1 && dst->y0 < dst->y1;
+}
+
+// grows dst to also cover src, returns whether it grew
+static bool RoomVisUnion(struct RoomVisRect *dst, struct RoomVisRect src)
+{
+	struct RoomVisRect old = *dst;
+	
+	dst->x0 = MIN(dst->x0, src.x0);
+	dst->y0 = MIN(dst->y0, src.y0);
+	dst->x1 = MAX(dst->x1, src.x1);
+	dst->y1 = MAX(dst->y1, src.y1);
+	
+	return memcmp(&old, dst, sizeof(old));
+}
+
+static bool RoomVisProjectBox(const struct RoomVis *vis, Matrix *projView, struct RoomVisRect *dst)
+{
+	Vec3f corners[8];
+	
+	for (int i = 0; i < 8; ++i)
+		corners[i] = (Vec3f){
+			(i & 1) ? vis->max.x : vis->min.x,
+			(i & 2) ? vis->max.y : vis->min.y,
+			(i & 4) ? vis->max.z : vis->min.z
+		};
+	
+	return RoomVisProject(corners, 8, projView, dst);
+}
+
+// the opening joins both rooms, so on each axis it lies where their
+// bounds overlap, or in the gap between them if they don't; it's a lot
+// bigger than most doorways, but never smaller, so it never hides a room
+static bool RoomVisProjectDoorway(struct Scene *scene, int from, int to, const struct Instance *doorway, Matrix *projView, struct RoomVisRect *dst)
+{
+	const struct RoomVis *a = RoomVisGetBounds(&scene->rooms[from]);
+	const struct RoomVis *b = RoomVisGetBounds(&scene->rooms[to]);
+	struct RoomVis opening = { .hasBounds = true };
+	const float *aMin = &a->min.x, *aMax = &a->max.x;
+	const float *bMin = &b->min.x, *bMax = &b->max.x;
+	float *min = &opening.min.x, *max = &opening.max.x;
+	
+	// nothing to go by, so it could show anything
+	if (!a->hasBounds || !b->hasBounds)
+	{
+		*dst = gFullRect;
+		return true;
+	}
+	
+	for (int i = 0; i < 3; ++i)
+	{
+		float lo = MAX(aMin[i], bMin[i]);
+		float hi = MIN(aMax[i], bMax[i]);
+		
+		min[i] = MIN(lo, hi) - ROOM_VIS_DOORWAY_MARGIN;
+		max[i] = MAX(lo, hi) + ROOM_VIS_DOORWAY_MARGIN;
+	}
+	RoomVisGrow(&opening, doorway->pos);
+	
+	return RoomVisProjectBox(&opening, projView, dst);
+}
+
+static bool RoomVisContains(const struct RoomVis *vis, Vec3f point)
+{
+	return vis->hasBounds
+		&& point.x >= vis->min.x && point.x <= vis->max.x
+		&& point.y >= vis->min.y && point.y <= vis->max.y
+		&& point.z >= vis->min.z && point.z <= vis->max.z
+	;
+}
+
+static void RoomVisReach(int index, struct RoomVisRect rect)
+{
+	if (!gIsReached[index])
+	{
+		gIsReached[index] = true;
+		gRects[index] = rect;
+	}
+	else if (!RoomVisUnion(&gRects[index], rect))
+		return;
+	
+	sb_push(gQueue, index);
+}
+
+#endif // endregion
+
+const bool *RoomVisCompute(struct Scene *scene, const struct SceneHeader *header, Vec3f eye, Matrix *projView)
+{
+	int numRooms = sb_count(scene->rooms);
+	int numDoorways = sb_count(header->doorways);
+	int numVisits = 0;
+	bool isInside = false;
+	
+	sb_clear(gIsVisible);
+	sb_clear(gIsReached);
+	sb_clear(gRects);
+	sb_clear(gQueue);
+	memset(sb_add(gIsVisible, numRooms), 0, numRooms * sizeof(*gIsVisible));
+	memset(sb_add(gIsReached, numRooms), 0, numRooms * sizeof(*gIsReached));
+	(void)sb_add(gRects, numRooms);
+	
+	if (numDoorways)
+	{
+		sb_foreach(scene->rooms, {
+			if (RoomVisContains(RoomVisGetBounds(each), eye))
+			{
+				RoomVisReach(eachIndex, gFullRect);
+				isInside = true;
+			}
+		});
+	}
+	
+	// looking in from outside, or rooms no doorway leads to,
+	// which the game shows some other way if at all
+	for (int i = 0; i < numRooms; ++i)
+	{
+		bool isLinked = false;
+		
+		sb_foreach(header->doorways, {
+			if (each->doorway.frontRoom == i || each->doorway.backRoom == i)
+				isLinked = true;
+		});
+		
+		if (!isInside || !isLinked)
+			RoomVisReach(i, gFullRect);
+	}
+	
+	// a room can be queued again each time it's seen through more of the
+	// screen, so give up on narrowing things down if that keeps happening
+	while (isInside && sb_count(gQueue) && numVisits++ < numRooms * (numDoorways + 1) * 4)
+	{
+		int from = sb_pop(gQueue);
+		
+		sb_foreach(header->doorways, {
+			int to = (each->doorway.frontRoom == from) ? each->doorway.backRoom
+				: (each->doorway.backRoom == from) ? each->doorway.frontRoom
+				: -1
+			;
+			struct RoomVisRect rect;
+			
+			if (to < 0 || to >= numRooms || to == from)
+				continue;
+			
+			if (RoomVisProjectDoorway(scene, from, to, each, projView, &rect)
+				&& RoomVisIntersect(rect, gRects[from], &rect)
+			)
+				RoomVisReach(to, rect);
+		});
+	}
+	
+	if (sb_count(gQueue))
+		memset(gIsReached, true, numRooms * sizeof(*gIsReached));
+	
+	sb_foreach(scene->rooms, {
+		struct RoomVis *vis = RoomVisGetBounds(each);
+		struct RoomVisRect rect;
+		
+		if (!gIsReached[eachIndex])
+			continue;
+		
+		// nothing to go by, so it's drawn
+		if (!vis->hasBounds)
+			gIsVisible[eachIndex] = true;
+		else if (RoomVisProjectBox(vis, projView, &rect))
+			gIsVisible[eachIndex] = RoomVisIntersect(rect, sb_count(gQueue) ? gFullRect : gRects[eachIndex], &rect);
+	});
+	
+	return gIsVisible;
+}
+
+void RoomVisFree(struct RoomVis *vis)
+{
+	free(vis);
+}
@@ -0,0 +1,27 @@
+//
+// room-vis.h
+//
+// which rooms can be seen from the camera, through doorways
+//
+
+#ifndef ROOM_VIS_H_INCLUDED
+#define ROOM_VIS_H_INCLUDED
+
+#include <stdbool.h>
+#include "extmath.h"
+
+struct Room;
+struct Scene;
+struct SceneHeader;
+struct RoomVis;
+
+// returns one flag per room in the scene, valid until the next call:
+// the rooms the eye is inside are seen through the whole view, and every
+// other room only through the doorways leading to it from a room that is
+// seen; rooms no doorway leads to, or every room if the eye is outside
+// them all, are only tested against the view
+const bool *RoomVisCompute(struct Scene *scene, const struct SceneHeader *header, Vec3f eye, Matrix *projView);
+
+void RoomVisFree(struct RoomVis *vis);
+
+#endif // ROOM_VIS_H_INCLUDED
@@ -5,33 +5,80 @@
 //
 
 #include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "misc.h"
 #include "logging.h"
 #include "cutscene.h"
+#include "file-save.h"
+#include "rom-patch.h"
 
-static struct File *gWork = 0;
-static struct DataBlob *gWorkblob = 0;
-static uint32_t gWorkblobAddr = 0;
-static uint32_t gWorkblobAddrEnd = 0;
-static uint32_t gWorkblobSegment = 0;
-static uint8_t *gWorkblobData = 0;
-static bool gWorkblobAllowDuplicates = false;
-static bool gWorkblobIsDryRun = false;
-static uint32_t gWorkblobExactlyThisSize = 0;
-static uint32_t gWorkblobExactlyThisSizeStartSize = 0;
-static uint32_t gWorkFindAlignment = 0;
-#define WORKBUF_SIZE (1024 * 1024 * 4) // 4mib is generous
+// the writer's state is per thread, so rooms can be serialized in parallel
+#define WORK_LOCAL _Thread_local
+#define SCENE_WRITE_MAX_JOBS 64
+static int gSceneWriteJobs = 0; // 0 for one per core
+static bool gSceneWriteBorrows = true; // false to copy every blob, see SceneWriterSetBorrowing()
+
+// only the bytes the writer generates are put in gWork, the scene's own
+// blobs are left where they are, and gWorkSpans lists where each piece
+// of the output comes from; gWork->size is the size of the whole output
+struct WorkSpan
+{
+	const void *ref; // a blob's own data, or 0 for the bytes in gWork
+	uint32_t offset; // into gWork->data, if those
+	uint32_t size;
+};
+
+// a file as serialized, see WorkFileMake()
+struct WorkFile
+{
+	sb_array(struct FileSpan, spans);
+	void *generated; // a copy of the bytes in gWork, if kept
+	size_t size;
+};
+
+static WORK_LOCAL struct File *gWork = 0;
+static WORK_LOCAL sb_array(struct WorkSpan, gWorkSpans) = 0;
+static WORK_LOCAL size_t gWorkFill = 0; // bytes of gWork->data in use
+static WORK_LOCAL struct DataBlob *gWorkblob = 0;
+static WORK_LOCAL uint32_t gWorkblobAddr = 0;
+static WORK_LOCAL uint32_t gWorkblobAddrEnd = 0;
+static WORK_LOCAL uint32_t gWorkblobSegment = 0;
+static WORK_LOCAL uint8_t *gWorkblobData = 0;
+static WORK_LOCAL size_t gWorkblobDataCapacity = 0;
+static WORK_LOCAL size_t gWorkCapacity = 0;
+static WORK_LOCAL bool gWorkblobAllowDuplicates = false;
+static WORK_LOCAL bool gWorkblobIsDryRun = false;
+static WORK_LOCAL uint32_t gWorkblobExactlyThisSize = 0;
+static WORK_LOCAL uint32_t gWorkblobExactlyThisSizeStartSize = 0;
+static WORK_LOCAL uint32_t gWorkFindAlignment = 0;
+static WORK_LOCAL bool gWorkIsEstimate = false;
+static WORK_LOCAL bool gWorkIsMm = false; // Scene.isMm of the scene being written
+static WORK_LOCAL struct SceneWriteStats *gWorkStats = 0;
+#define WORKBUF_INITIAL_SIZE (64 * 1024) // grows as needed, and is reused between saves
+#define WORKBUF_MAX_FILE_SIZE 0x1000000 // offsets within a segment are 24 bits
 #define WORKBLOB_STACK_SIZE 32
-static uint32_t FIRST_HEADER_SIZE = 0; // sizeBytes of first header in file
+static WORK_LOCAL uint32_t FIRST_HEADER_SIZE = 0; // sizeBytes of first header in file
 #define FIRST_HEADER &(struct DataBlob){ .sizeBytes = FIRST_HEADER_SIZE }
-static struct DataBlob gWorkblobStack[WORKBLOB_STACK_SIZE];
+static WORK_LOCAL struct DataBlob gWorkblobStack[WORKBLOB_STACK_SIZE];
+static WORK_LOCAL struct WorkblobStat
+{
+	int command; // header command owning this blob, or -1
+	bool isHeader;
+	double start; // nonzero if this blob is timed for its command
+} gWorkblobStatStack[WORKBLOB_STACK_SIZE];
 void CollisionHeaderToWorkblob(CollisionHeader *header);
-static struct DataBlob *gBlobsWritten = 0;
-#define MAX_UNIQUE_BLOBS 4096 // oot and mm need 82 and 134 respectively, so this is sufficient
-static struct DataBlob *gUniqueBlobStack = 0;
-static struct DataBlob *gUniqueBlob = 0;
-static int gMostUniqueBlobs = 0;
+static WORK_LOCAL struct DataBlob *gBlobsWritten = 0;
+#define UNIQUE_BLOBS_PER_CHUNK 256 // oot and mm need at most 82 and 134 respectively
+static WORK_LOCAL sb_array(struct DataBlob *, gUniqueBlobChunks) = 0;
+static WORK_LOCAL int gNumUniqueBlobs = 0;
+static WORK_LOCAL int gMostUniqueBlobs = 0;
 #define ALLOCATE_FIRST_HEADER_BLOCK(X, FUNC) \
 	WorkblobSetDryRun(true); \
 	FUNC(X, &X->headers[0], sb_count(X->headers) > 1, sb_count(X->headers) > 1); \
@@ -39,27 +86,32 @@ static int gMostUniqueBlobs = 0;
 	WorkblobSetDryRun(false); \
 	WorkAppendDatablob(FIRST_HEADER);
 
-// invoke once on program exit for cleanup
-void SceneWriterCleanup(void)
+// frees the calling thread's work buffers
+static void WorkFree(void)
 {
-	if (gUniqueBlobStack)
+	if (gUniqueBlobChunks)
 	{
-		free(gUniqueBlobStack);
-		gUniqueBlobStack = 0;
-		LogDebug("produced a maximum of %d (decimal) unique data blobs", gMostUniqueBlobs);
+		sb_foreach(gUniqueBlobChunks, { free(*each); })
+		sb_free(gUniqueBlobChunks);
+		gUniqueBlobChunks = 0;
 	}
 	
 	if (gWorkblobData)
 	{
 		free(gWorkblobData);
 		gWorkblobData = 0;
+		gWorkblobDataCapacity = 0;
 	}
 	
 	if (gWork)
 	{
 		FileFree(gWork);
 		gWork = 0;
+		gWorkCapacity = 0;
 	}
+	
+	sb_free(gWorkSpans);
+	gWorkSpans = 0;
 }
 
 // guarantee a minimum number of alternate headers are written
@@ -80,12 +132,17 @@ static uint32_t Swap32(const uint32_t b)
 	return result;
 }
 
+// grows by whole chunks, which never move, because written blobs link to each other
 static struct DataBlob *NewUniqueBlob(const void *refData)
 {
-	struct DataBlob *blob = gUniqueBlob;
+	struct DataBlob *blob;
+	
+	if (gNumUniqueBlobs == sb_count(gUniqueBlobChunks) * UNIQUE_BLOBS_PER_CHUNK)
+		sb_push(gUniqueBlobChunks, Calloc(UNIQUE_BLOBS_PER_CHUNK, sizeof(*blob)));
 	
-	gUniqueBlob += 1;
-	gMostUniqueBlobs = MAX(gMostUniqueBlobs, gUniqueBlob - gUniqueBlobStack);
+	blob = &gUniqueBlobChunks[gNumUniqueBlobs / UNIQUE_BLOBS_PER_CHUNK][gNumUniqueBlobs % UNIQUE_BLOBS_PER_CHUNK];
+	gNumUniqueBlobs += 1;
+	gMostUniqueBlobs = MAX(gMostUniqueBlobs, gNumUniqueBlobs);
 	
 	*blob = *gWorkblob;
 	blob->refData = refData;
@@ -93,6 +150,88 @@ static struct DataBlob *NewUniqueBlob(const void *refData)
 	return blob;
 }
 
+static double WorkStatTime(void)
+{
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+// the stat that bytes appended for a blob count towards
+static struct SceneWriteStat *WorkStatFor(struct DataBlob *blob)
+{
+	int command;
+	
+	if (!gWorkStats || gWorkblobIsDryRun)
+		return 0;
+	
+	if (blob != gWorkblob)
+		return blob->type == DATA_BLOB_TYPE_UNSET
+			? &gWorkStats->headers // space reserved for the first header
+			: &gWorkStats->blobTypes[blob->type]
+		;
+	
+	if ((command = gWorkblobStatStack[gWorkblob - gWorkblobStack].command) < 0)
+		return &gWorkStats->headers;
+	
+	return &gWorkStats->commands[command];
+}
+
+// makes room for that many more generated bytes; they are grown in
+// place, so offsets into them are unaffected, and the only pointers into
+// them, those of the unique blobs, are moved along with them
+static void WorkReserve(size_t moreBytes)
+{
+	uintptr_t was = (uintptr_t)gWork->data;
+	size_t want = gWorkFill + moreBytes;
+	
+	if (want <= gWorkCapacity)
+		return;
+	
+	while (gWorkCapacity < want)
+		gWorkCapacity *= 2;
+	
+	if (!(gWork->data = realloc(gWork->data, gWorkCapacity)))
+		Die("WorkReserve() failed to grow to 0x%x bytes", (uint32_t)gWorkCapacity);
+	gWork->dataEnd = ((uint8_t*)gWork->data) + gWorkCapacity;
+	
+	for (int i = 0; i < gNumUniqueBlobs; ++i)
+	{
+		struct DataBlob *blob = &gUniqueBlobChunks[i / UNIQUE_BLOBS_PER_CHUNK][i % UNIQUE_BLOBS_PER_CHUNK];
+		
+		blob->refData = ((uint8_t*)gWork->data) + ((uintptr_t)blob->refData - was);
+	}
+}
+
+// same as WorkReserve(), for the blobs under construction, each of
+// which begins where the one it was pushed from currently ends
+static void WorkblobReserve(size_t moreBytes)
+{
+	uintptr_t was = (uintptr_t)gWorkblobData;
+	size_t wasCapacity = gWorkblobDataCapacity;
+	size_t want = ((const uint8_t*)gWorkblob->refData - gWorkblobData) + gWorkblob->sizeBytes + moreBytes;
+	
+	if (want <= gWorkblobDataCapacity)
+		return;
+	
+	while (gWorkblobDataCapacity < want)
+		gWorkblobDataCapacity *= 2;
+	
+	if (!(gWorkblobData = realloc(gWorkblobData, gWorkblobDataCapacity)))
+		Die("WorkblobReserve() failed to grow to 0x%x bytes", (uint32_t)gWorkblobDataCapacity);
+	
+	// popped blobs are included, WorkFirstHeader() reads one
+	for (int i = 0; i < WORKBLOB_STACK_SIZE; ++i)
+	{
+		uintptr_t offset = (uintptr_t)gWorkblobStack[i].refData - was;
+		
+		if (gWorkblobStack[i].refData && offset < wasCapacity)
+			gWorkblobStack[i].refData = gWorkblobData + offset;
+	}
+}
+
 static void WorkReady(void)
 {
 	// big alignment for meshes and textures etc
@@ -100,14 +239,18 @@ static void WorkReady(void)
 	
 	// no blobs written so far
 	gBlobsWritten = 0;
-	gUniqueBlob = gUniqueBlobStack;
+	gNumUniqueBlobs = 0;
 	
 	if (!gWork)
-		gWork = FileNew("work", WORKBUF_SIZE);
+	{
+		gWork = FileNew("work", WORKBUF_INITIAL_SIZE);
+		gWorkCapacity = WORKBUF_INITIAL_SIZE;
+	}
 	
 	if (!gWorkblobData)
 	{
-		gWorkblobData = Calloc(1, WORKBUF_SIZE);
+		gWorkblobData = Calloc(1, WORKBUF_INITIAL_SIZE);
+		gWorkblobDataCapacity = WORKBUF_INITIAL_SIZE;
 		#pragma GCC diagnostic push
 		#pragma GCC diagnostic ignored "-Warray-bounds"
 		// deliberately start at -1 b/c push() puts it at 0
@@ -116,13 +259,85 @@ static void WorkReady(void)
 		#pragma GCC diagnostic pop
 	}
 	
-	if (!gUniqueBlobStack)
+	gWork->size = 0;
+	gWorkFill = 0;
+	sb_clear(gWorkSpans);
+}
+
+// the next size bytes of output are either the data at ref, or the ones
+// just generated at the end of gWork; neighbors are merged where possible
+static void WorkSpanPut(const void *ref, uint32_t size)
+{
+	struct WorkSpan *last = sb_count(gWorkSpans) ? &sb_last(gWorkSpans) : 0;
+	
+	if (!size)
+		return;
+	
+	if (last && !ref && !last->ref)
+		last->size += size;
+	else if (last && ref && ((const uint8_t*)last->ref) + last->size == ref)
+		last->size += size;
+	else
+		sb_push(gWorkSpans, ((struct WorkSpan){ ref, ref ? 0 : gWorkFill, size }));
+	
+	if (!ref)
+		gWorkFill += size;
+	gWork->size += size;
+}
+
+// takes back that many generated bytes from the end of the output
+static void WorkSpanUnput(uint32_t size)
+{
+	while (size && sb_count(gWorkSpans) && !sb_last(gWorkSpans).ref)
 	{
-		gUniqueBlobStack = malloc(MAX_UNIQUE_BLOBS * sizeof(*gUniqueBlobStack));
-		gUniqueBlob = gUniqueBlobStack;
+		uint32_t n = MIN(size, sb_last(gWorkSpans).size);
+		
+		if (!(sb_last(gWorkSpans).size -= n))
+			(void)sb_pop(gWorkSpans);
+		gWorkFill -= n;
+		gWork->size -= n;
+		size -= n;
 	}
+}
+
+// the output so far, in pieces that point into gWork, which are only
+// valid until the next save on this thread unless keepGenerated is set
+static void WorkFileMake(struct WorkFile *dst, bool keepGenerated)
+{
+	const uint8_t *generated = gWork->data;
+	
+	if (keepGenerated)
+		generated = dst->generated = Memdup(gWork->data, MAX(1, gWorkFill));
+	
+	sb_foreach(gWorkSpans, {
+		sb_push(dst->spans, ((struct FileSpan){
+			.data = each->ref ? each->ref : generated + each->offset,
+			.size = each->size,
+			.isBorrowed = each->ref != 0,
+		}));
+	})
+	dst->size = gWork->size;
+}
+
+static void WorkFileFree(struct WorkFile *file)
+{
+	sb_free(file->spans);
+	free(file->generated);
+	*file = (struct WorkFile){0};
+}
+
+// the pieces joined, for anything that can't take them as they are
+static struct File *WorkFileJoin(const struct WorkFile *file)
+{
+	struct File *result = FileNew("work", file->size);
+	uint8_t *dst = result->data;
 	
-	gWork->size = 0;
+	sb_foreach(file->spans, {
+		memcpy(dst, each->data, each->size);
+		dst += each->size;
+	})
+	
+	return result;
 }
 
 static uint32_t WorkFindDatablob(struct DataBlob *blob)
@@ -230,8 +445,21 @@ static uint32_t WorkFindDatablob(struct DataBlob *blob)
 
 static uint32_t WorkAppendDatablob(struct DataBlob *blob)
 {
-	uint8_t *dest = ((uint8_t*)gWork->data) + gWork->size;
+	struct SceneWriteStat *stat = WorkStatFor(blob);
+	uint8_t *dest;
 	uint32_t addr;
+	uint8_t alignBytes;
+	uint32_t padBytes = 0;
+	
+	// the scene's own blobs are written straight from where they are,
+	// and only what the writer generates is copied; display lists are
+	// copied too, because they hold references that can be relocated
+	// after they are appended, which must not change what was written
+	bool isBorrowed = gSceneWriteBorrows
+		&& blob->type != DATA_BLOB_TYPE_UNSET
+		&& blob->type != DATA_BLOB_TYPE_MESH
+		&& blob->refData
+	;
 	
 	if (gWorkblobIsDryRun)
 		return 0;
@@ -239,24 +467,50 @@ static uint32_t WorkAppendDatablob(struct DataBlob *blob)
 	if (!blob->sizeBytes)
 		return 0;
 	
-	while (gWorkblob->alignBytes
-		&& (gWork->size % gWorkblob->alignBytes)
-	)
-	{
-		*dest = 0;
-		
-		gWork->size++;
-		++dest;
-	}
+	// typed blobs are appended with no workblob open, and are not padded
+	alignBytes = gWorkblob >= gWorkblobStack ? gWorkblob->alignBytes : 0;
+	WorkReserve((isBorrowed ? 0 : blob->sizeBytes) + UINT8_MAX); // and any alignment padding
+	dest = ((uint8_t*)gWork->data) + gWorkFill;
+	
+	while (alignBytes && ((gWork->size + padBytes) % alignBytes))
+		dest[padBytes++] = 0;
+	WorkSpanPut(0, padBytes);
+	dest += padBytes;
+	
+	if (stat)
+		stat->padBytes += padBytes;
 	
 	if ((addr = WorkFindDatablob(blob)))
+	{
+		if (stat)
+			stat->dedupBytes += blob->sizeBytes;
+		
 		return addr;
+	}
 	
 	blob->updatedSegmentAddress =
 		(blob->originalSegmentAddress & 0xff000000)
 		| gWork->size
 	;
-	gWork->size += blob->sizeBytes;
+	
+	if (isBorrowed)
+		WorkSpanPut(blob->refData, blob->sizeBytes);
+	else
+	{
+		WorkSpanPut(0, blob->sizeBytes);
+		
+		if (blob->refData)
+			memcpy(dest, blob->refData, blob->sizeBytes);
+		else
+			memset(dest, 0, blob->sizeBytes);
+	}
+	
+	if (stat)
+	{
+		stat->bytes += blob->sizeBytes;
+		if (blob != gWorkblob)
+			stat->count += 1;
+	}
 	
 	// link into list of known written datablobs
 	if (blob->type != DATA_BLOB_TYPE_UNSET)
@@ -271,11 +525,6 @@ static uint32_t WorkAppendDatablob(struct DataBlob *blob)
 		gBlobsWritten = tmp;
 	}
 	
-	if (blob->refData)
-		memcpy(dest, blob->refData, blob->sizeBytes);
-	else if (blob->type == DATA_BLOB_TYPE_UNSET) // maybe DATA_BLOB_TYPE_BLANK sometime?
-		memset(dest, 0, blob->sizeBytes);
-	
 	/*
 	LogDebug("append blob type %d size %08x at %08x (formerly %08x)"
 		, blob->type
@@ -288,6 +537,49 @@ static uint32_t WorkAppendDatablob(struct DataBlob *blob)
 	return blob->updatedSegmentAddress;
 }
 
+// data pushed while a header is being written belongs to the command
+// just put into the header, and so does everything pushed beneath it
+static void WorkblobStatPush(void)
+{
+	struct WorkblobStat *stat = &gWorkblobStatStack[gWorkblob - gWorkblobStack];
+	const struct DataBlob *parentBlob = gWorkblob - 1;
+	
+	stat->command = -1;
+	stat->isHeader = false;
+	stat->start = 0;
+	
+	if (gWorkblob == gWorkblobStack)
+		return;
+	
+	if (!stat[-1].isHeader)
+		stat->command = stat[-1].command;
+	else if ((parentBlob->sizeBytes & 7) == 4
+		&& ((const uint8_t*)parentBlob->refData)[parentBlob->sizeBytes - 4] < SCENE_WRITE_STAT_COMMANDS
+	)
+	{
+		stat->command = ((const uint8_t*)parentBlob->refData)[parentBlob->sizeBytes - 4];
+		stat->start = WorkStatTime();
+	}
+}
+
+static void WorkblobStatPop(void)
+{
+	struct WorkblobStat *stat = &gWorkblobStatStack[gWorkblob - gWorkblobStack];
+	
+	if (stat->start && !gWorkblobIsDryRun)
+	{
+		gWorkStats->commands[stat->command].seconds += WorkStatTime() - stat->start;
+		gWorkStats->commands[stat->command].count += 1;
+	}
+}
+
+// marks the blob just pushed as a header, made of 8-byte commands
+static void WorkblobStatHeader(void)
+{
+	if (gWorkStats)
+		gWorkblobStatStack[gWorkblob - gWorkblobStack].isHeader = true;
+}
+
 static void WorkblobPush(uint8_t alignBytes)
 {
 	if ((gWorkblob - gWorkblobStack) >= WORKBLOB_STACK_SIZE - 1)
@@ -306,6 +598,9 @@ static void WorkblobPush(uint8_t alignBytes)
 	gWorkblob->originalSegmentAddress = gWorkblobSegment;
 	gWorkblob->alignBytes = alignBytes;
 	gWorkFindAlignment = alignBytes;
+	
+	if (gWorkStats)
+		WorkblobStatPush();
 }
 
 static uint32_t WorkblobPop(void)
@@ -316,6 +611,8 @@ static uint32_t WorkblobPop(void)
 	gWorkblobAddr = WorkAppendDatablob(gWorkblob);
 	gWorkblobAddrEnd = gWorkblobAddr + gWorkblob->sizeBytes;
 	if (!gWorkblob->sizeBytes) gWorkblobAddr = 0;
+	if (gWorkStats)
+		WorkblobStatPop();
 	gWorkblob -= 1;
 	
 	if (gWorkblob >= gWorkblobStack)
@@ -331,6 +628,9 @@ static void WorkblobSegment(uint8_t segment)
 
 static void WorkblobPut8(uint8_t data)
 {
+	if ((const uint8_t*)gWorkblob->refData + gWorkblob->sizeBytes >= gWorkblobData + gWorkblobDataCapacity)
+		WorkblobReserve(1);
+	
 	((uint8_t*)gWorkblob->refData)[gWorkblob->sizeBytes++] = data;
 }
 
@@ -358,6 +658,7 @@ static void WorkblobPut32(uint32_t data)
 
 static void WorkblobPutByteArray(const uint8_t data[], int len)
 {
+	WorkblobReserve(len);
 	memcpy(((uint8_t*)gWorkblob->refData) + gWorkblob->sizeBytes, data, len);
 	
 	gWorkblob->sizeBytes += len;
@@ -400,7 +701,7 @@ static void WorkFirstHeader(void)
 	gWorkblob += 1;
 	
 	memcpy(gWork->data, gWorkblob->refData, gWorkblob->sizeBytes);
-	gWork->size -= gWorkblob->sizeBytes;
+	WorkSpanUnput(gWorkblob->sizeBytes);
 	
 	gWorkblob -= 1;
 }
@@ -429,6 +730,7 @@ static uint32_t WorkAppendRoomHeader(struct Room *room, struct RoomHeader *heade
 	
 	// the header
 	WorkblobPush(8);
+	WorkblobStatHeader();
 	
 	// alternate headers command
 	if (alternateHeaders)
@@ -568,7 +870,7 @@ static uint32_t WorkAppendRoomHeader(struct Room *room, struct RoomHeader *heade
 		WorkblobPush(4);
 		
 		sb_foreach(header->instances, {
-			struct Instance inst = InstanceMakeWritable(*each);
+			struct Instance inst = InstanceMakeWritable(*each, gWorkIsMm);
 			WorkblobPut16(inst.id);
 			WorkblobPut16(rintf(inst.pos.x));
 			WorkblobPut16(rintf(inst.pos.y));
@@ -605,6 +907,7 @@ static uint32_t WorkAppendSceneHeader(struct Scene *scene, struct SceneHeader *h
 	
 	// the header
 	WorkblobPush(8);
+	WorkblobStatHeader();
 	
 	// alternate headers command
 	if (alternateHeaders)
@@ -735,7 +1038,7 @@ static uint32_t WorkAppendSceneHeader(struct Scene *scene, struct SceneHeader *h
 		WorkblobPut32(0x00000000 | (sb_count(header->spawns) << 16));
 		WorkblobPush(4);
 		sb_foreach(header->spawns, {
-			struct Instance inst = InstanceMakeWritable(*each);
+			struct Instance inst = InstanceMakeWritable(*each, scene->isMm);
 			WorkblobPut16(inst.id);
 			WorkblobPut16(rintf(inst.pos.x));
 			WorkblobPut16(rintf(inst.pos.y));
@@ -778,7 +1081,7 @@ static uint32_t WorkAppendSceneHeader(struct Scene *scene, struct SceneHeader *h
 		
 		WorkblobPush(4);
 		sb_foreach(header->doorways, {
-			struct Instance inst = InstanceMakeWritable(*each);
+			struct Instance inst = InstanceMakeWritable(*each, scene->isMm);
 			WorkblobPut8(inst.doorway.frontRoom);
 			WorkblobPut8(inst.doorway.frontCamera);
 			WorkblobPut8(inst.doorway.backRoom);
@@ -884,38 +1187,38 @@ static uint32_t WorkAppendSceneHeader(struct Scene *scene, struct SceneHeader *h
 	return WorkblobPop();
 }
 
-void RoomToFilename(struct Room *room, const char *filename)
+// appends one of a scene or room's own blobs, then points
+// everything referencing it at where it ended up
+static void WorkAppendOwnDatablob(struct DataBlob *blob)
 {
-	if (filename == 0)
-		filename = room->file->filename;
-	else {
-		free(room->file->filename);
-		room->file->filename = Strdup(filename);
-	}
+	double start = gWorkStats ? WorkStatTime() : 0;
 	
-	LogDebug("write room '%s'", filename);
+	WorkAppendDatablob(blob);
+	DataBlobApplyUpdatedSegmentAddresses(blob);
 	
+	if (gWorkStats)
+		gWorkStats->blobTypes[blob->type].seconds += WorkStatTime() - start;
+}
+
+// serializes a room into gWork
+static void RoomSerialize(struct Room *room)
+{
 	// prepare fresh work buffer
 	WorkReady();
 	ALLOCATE_FIRST_HEADER_BLOCK(room, WorkAppendRoomHeader)
 	
-	// write output file
-	FileToFilename(gWork, filename);
-	
 	// clear udata
 	datablob_foreach(room->blobs, { each->udata = 0; })
 	
 	// append all non-mesh blobs first
 	datablob_foreach_filter(room->blobs, != DATA_BLOB_TYPE_MESH, {
 		if (sb_count(each->refs) == 0) continue; // skip deleted textures
-		WorkAppendDatablob(each);
-		DataBlobApplyUpdatedSegmentAddresses(each);
+		WorkAppendOwnDatablob(each);
 	});
 	
 	// append mesh blobs
 	datablob_foreach_filter(room->blobs, == DATA_BLOB_TYPE_MESH, {
-		WorkAppendDatablob(each);
-		DataBlobApplyUpdatedSegmentAddresses(each);
+		WorkAppendOwnDatablob(each);
 	});
 	
 	gWorkFindAlignment = 4; // more lenient alignment after meshes written
@@ -942,45 +1245,282 @@ void RoomToFilename(struct Room *room, const char *filename)
 		WorkFirstHeader();
 		sb_free(alternateHeaders);
 	}
+}
+
+static size_t WorkBytesHeld(void)
+{
+	return gWorkCapacity
+		+ gWorkblobDataCapacity
+		+ sb_count(gUniqueBlobChunks) * UNIQUE_BLOBS_PER_CHUNK * sizeof(struct DataBlob)
+	;
+}
+
+static void WorkStatAdd(struct SceneWriteStat *dst, const struct SceneWriteStat *src)
+{
+	dst->count += src->count;
+	dst->bytes += src->bytes;
+	dst->dedupBytes += src->dedupBytes;
+	dst->padBytes += src->padBytes;
+	dst->seconds += src->seconds;
+}
+
+// rooms serialized on other threads report to the caller's stats
+static void WorkStatsAdd(struct SceneWriteStats *dst, const struct SceneWriteStats *src)
+{
+	for (int i = 0; i < DATA_BLOB_TYPE_COUNT; ++i)
+		WorkStatAdd(&dst->blobTypes[i], &src->blobTypes[i]);
+	for (int i = 0; i < SCENE_WRITE_STAT_COMMANDS; ++i)
+		WorkStatAdd(&dst->commands[i], &src->commands[i]);
+	WorkStatAdd(&dst->headers, &src->headers);
+	dst->workBytes += src->workBytes;
+}
+
+static int SceneWriteNumCores(void)
+{
+	#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors;
+	#else
+		return sysconf(_SC_NPROCESSORS_ONLN);
+	#endif
+}
+
+struct RoomSerializeJob
+{
+	struct Scene *scene;
+	sb_array(struct WorkFile, results); // one per room, in order
+	struct SceneWriteStats *stats; // the caller's, if any
+	int next; // index of the next room to claim, shared by all workers
+};
+
+// the threads that serialize rooms are started by the first save that
+// wants them and kept until SceneWriterCleanup(), and so are the work
+// buffers each one holds, so saving again doesn't grow them from zero
+static struct
+{
+	pthread_t threads[SCENE_WRITE_MAX_JOBS];
+	int numThreads;
+	pthread_mutex_t submit; // held by the save whose job it is
+	pthread_mutex_t lock; // guards the rest, and the job
+	pthread_cond_t wake; // a job was posted, or the workers should exit
+	pthread_cond_t done; // a worker finished its part of the job
+	struct RoomSerializeJob *job;
+	uint32_t generation; // bumped for every job posted
+	int seats; // how many more workers may take part in the job
+	int busy; // workers still taking part
+	bool quit;
+} sRoomPool = {
+	.submit = PTHREAD_MUTEX_INITIALIZER,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+// serializes rooms until there are none left, keeping a copy of each
+// one, so they can be handed on in order afterwards
+static void RoomSerializeJobRun(struct RoomSerializeJob *job)
+{
+	struct SceneWriteStats stats = {0};
+	int numRooms = sb_count(job->scene->rooms);
+	
+	gWorkIsMm = job->scene->isMm;
+	gWorkStats = job->stats ? &stats : 0;
+	
+	for (;;)
+	{
+		int index;
+		
+		pthread_mutex_lock(&sRoomPool.lock);
+		index = job->next++;
+		pthread_mutex_unlock(&sRoomPool.lock);
+		
+		if (index >= numRooms)
+			break;
+		
+		RoomSerialize(&job->scene->rooms[index]);
+		WorkFileMake(&job->results[index], true);
+	}
+	
+	if (job->stats)
+	{
+		stats.workBytes = WorkBytesHeld();
+		pthread_mutex_lock(&sRoomPool.lock);
+		WorkStatsAdd(job->stats, &stats);
+		pthread_mutex_unlock(&sRoomPool.lock);
+	}
 	
-	// write output file
-	FileToFilename(gWork, filename);
+	gWorkStats = 0;
 }
 
-void SceneToFilename(struct Scene *scene, const char *filename)
+// each worker has writer state of its own, freed when it exits
+static void *RoomSerializeWorker(void *udata)
 {
-	struct DataBlob *blob;
-	bool useOriginalFilenames = false;
-	static char append[2048];
+	uint32_t generation = 0;
 	
-	if (filename == 0)
+	(void)udata;
+	
+	pthread_mutex_lock(&sRoomPool.lock);
+	for (;;)
 	{
-		filename = scene->file->filename;
-		useOriginalFilenames = true;
+		struct RoomSerializeJob *job;
 		
-		if (filename == 0)
-			return;
+		while (!sRoomPool.quit && sRoomPool.generation == generation)
+			pthread_cond_wait(&sRoomPool.wake, &sRoomPool.lock);
+		
+		if (sRoomPool.quit)
+			break;
+		
+		generation = sRoomPool.generation;
+		if (sRoomPool.seats <= 0)
+			continue;
+		sRoomPool.seats -= 1;
+		job = sRoomPool.job;
+		pthread_mutex_unlock(&sRoomPool.lock);
+		
+		RoomSerializeJobRun(job);
+		
+		pthread_mutex_lock(&sRoomPool.lock);
+		if (!--sRoomPool.busy)
+			pthread_cond_signal(&sRoomPool.done);
 	}
-	else
+	pthread_mutex_unlock(&sRoomPool.lock);
+	
+	WorkFree();
+	
+	return 0;
+}
+
+// runs the job on that many workers, starting more if there are too few
+static void RoomPoolRun(struct RoomSerializeJob *job, int jobs)
+{
+	pthread_mutex_lock(&sRoomPool.submit);
+	
+	for ( ; sRoomPool.numThreads < jobs; ++sRoomPool.numThreads)
+		if (pthread_create(&sRoomPool.threads[sRoomPool.numThreads], 0, RoomSerializeWorker, 0))
+			Die("failed to create worker thread");
+	
+	pthread_mutex_lock(&sRoomPool.lock);
+	sRoomPool.job = job;
+	sRoomPool.seats = jobs;
+	sRoomPool.busy = jobs;
+	sRoomPool.generation += 1;
+	pthread_cond_broadcast(&sRoomPool.wake);
+	while (sRoomPool.busy)
+		pthread_cond_wait(&sRoomPool.done, &sRoomPool.lock);
+	sRoomPool.job = 0;
+	pthread_mutex_unlock(&sRoomPool.lock);
+	
+	pthread_mutex_unlock(&sRoomPool.submit);
+}
+
+static void RoomPoolFree(void)
+{
+	pthread_mutex_lock(&sRoomPool.submit);
+	
+	pthread_mutex_lock(&sRoomPool.lock);
+	sRoomPool.quit = true;
+	pthread_cond_broadcast(&sRoomPool.wake);
+	pthread_mutex_unlock(&sRoomPool.lock);
+	
+	for (int i = 0; i < sRoomPool.numThreads; ++i)
+		pthread_join(sRoomPool.threads[i], 0);
+	
+	sRoomPool.numThreads = 0;
+	sRoomPool.quit = false;
+	
+	pthread_mutex_unlock(&sRoomPool.submit);
+}
+
+// invoke once on program exit for cleanup
+void SceneWriterCleanup(void)
+{
+	if (gUniqueBlobChunks)
+		LogDebug("produced a maximum of %d (decimal) unique data blobs", gMostUniqueBlobs);
+	
+	if (gWorkblobData)
+		LogDebug("work buffers peaked at 0x%x bytes of output, 0x%x bytes of blobs"
+			, (uint32_t)gWorkCapacity
+			, (uint32_t)gWorkblobDataCapacity
+		);
+	
+	RoomPoolFree();
+	WorkFree();
+}
+
+static int SceneEmitRoom(void emit(void *udata, struct WorkFile *work, int roomIndex), void *udata, struct WorkFile *work, int index)
+{
+	if (gWorkStats)
+		sb_push(gWorkStats->roomSizes, work->size);
+	
+	if (work->size > WORKBUF_MAX_FILE_SIZE)
+		return FileSetError("room %d is 0x%x bytes, too large to address", index, (uint32_t)work->size);
+	
+	emit(udata, work, index);
+	
+	return EXIT_SUCCESS;
+}
+
+// rooms only reference their own segment 3 data and the scene's segment
+// 2 data, which is final by now, so they can be serialized in parallel;
+// they are emitted in order either way, so the output is identical
+static int SceneSerializeRooms(struct Scene *scene, void emit(void *udata, struct WorkFile *work, int roomIndex), void *udata)
+{
+	struct RoomSerializeJob job = {
+		.scene = scene,
+		.stats = gWorkStats,
+	};
+	int numRooms = sb_count(scene->rooms);
+	int jobs = gSceneWriteJobs ? gSceneWriteJobs : SceneWriteNumCores();
+	int result = EXIT_SUCCESS;
+	
+	jobs = MAX(1, MIN(jobs, MIN(SCENE_WRITE_MAX_JOBS, numRooms)));
+	
+	// an estimate only needs the sizes, which are quicker to get here
+	// than by waking the workers and copying every room they make
+	if (jobs == 1 || gWorkIsEstimate)
 	{
-		// append zscene extension if not present
-		if (!strrchr(filename, '.') // no period
-			|| !(strcpy(append, strrchr(filename, '.') + 1)
-				&& strlen(append) == 6 // zscene
-				&& StrToLower(append)
-				&& !strcmp(append, "zscene")
-			)
-		)
-		{
-			snprintf(append, sizeof(append), "%s.zscene", filename);
-			filename = append;
-		}
+		sb_foreach(scene->rooms, {
+			struct WorkFile work = {0};
+			
+			RoomSerialize(each);
+			WorkFileMake(&work, false);
+			result = SceneEmitRoom(emit, udata, &work, eachIndex);
+			WorkFileFree(&work);
+			if (result)
+				break;
+		});
 		
-		free(scene->file->filename);
-		scene->file->filename = Strdup(filename);
+		return result;
 	}
 	
-	LogDebug("write scene '%s'", filename);
+	(void)sb_add(job.results, numRooms);
+	memset(job.results, 0, numRooms * sizeof(*job.results));
+	RoomPoolRun(&job, jobs);
+	
+	sb_foreach(job.results, {
+		if (!result)
+			result = SceneEmitRoom(emit, udata, each, eachIndex);
+		WorkFileFree(each);
+	})
+	sb_free(job.results);
+	
+	return result;
+}
+
+// serializes the scene and then each of its rooms, handing each one to
+// emit() in turn; roomIndex is -1 for the scene itself; stops with the
+// reason in FileGetError() if a file is too large; the pieces emitted
+// point into the scene's own data, which keeps the addresses it was
+// serialized with until SceneSerializeEnd(), so call it once they are
+// written, whether or not this succeeded
+static int SceneSerialize(struct Scene *scene, void emit(void *udata, struct WorkFile *work, int roomIndex), void *udata)
+{
+	double start = gWorkStats ? WorkStatTime() : 0;
+	int result = EXIT_SUCCESS;
+	struct DataBlob *blob;
+	
+	gWorkIsMm = scene->isMm;
 	
 	// make sure everything is zero
 	for (blob = scene->blobs; blob; blob = blob->next)
@@ -1002,15 +1542,13 @@ void SceneToFilename(struct Scene *scene, const char *filename)
 	// append all non-mesh blobs first
 	datablob_foreach_filter(scene->blobs, != DATA_BLOB_TYPE_MESH, {
 		if (sb_count(each->refs) == 0) continue; // skip deleted textures
-		WorkAppendDatablob(each);
-		DataBlobApplyUpdatedSegmentAddresses(each);
+		WorkAppendOwnDatablob(each);
 	});
 	
 	// append mesh blobs
 	datablob_foreach_filter(scene->blobs, == DATA_BLOB_TYPE_MESH, {
-		WorkAppendDatablob(each);
+		WorkAppendOwnDatablob(each);
 		//LogDebug("mesh appended %08x -> %08x", each->originalSegmentAddress, each->updatedSegmentAddress);
-		DataBlobApplyUpdatedSegmentAddresses(each);
 	});
 	
 	gWorkFindAlignment = 4; // more lenient alignment after meshes written
@@ -1038,39 +1576,40 @@ void SceneToFilename(struct Scene *scene, const char *filename)
 		sb_free(alternateHeaders);
 	}
 	
-	// write output file
-	FileToFilename(gWork, filename);
+	if (gWorkStats)
+	{
+		gWorkStats->sceneSize = gWork->size;
+		sb_clear(gWorkStats->roomSizes);
+	}
+	if (gWork->size > WORKBUF_MAX_FILE_SIZE)
+		result = FileSetError("scene is 0x%x bytes, too large to address", (uint32_t)gWork->size);
+	else
+	{
+		struct WorkFile work = {0};
+		
+		WorkFileMake(&work, false);
+		emit(udata, &work, -1);
+		WorkFileFree(&work);
+	}
+	
+	// rooms
+	if (!result)
+		result = SceneSerializeRooms(scene, emit, udata);
 	
-	// write rooms
-	sb_foreach(scene->rooms, {
-		if (useOriginalFilenames)
-		{
-			RoomToFilename(each, 0);
-		}
-		else
-		{
-			static char fn[2048];
-			char *roomNameBuf = strcpy(fn, filename);
-			
-			// TODO: employ DRY on this, copy-pasted from SceneFromFilenamePredictRooms()
-			char *lastSlash = MAX(strrchr(roomNameBuf, '\\'), strrchr(roomNameBuf, '/'));
-			if (!lastSlash)
-				lastSlash = roomNameBuf;
-			else
-				lastSlash += 1;
-			lastSlash = MAX(lastSlash, strstr(lastSlash, "_scene"));
-			if (*lastSlash == '_')
-				lastSlash += 1;
-			else
-				lastSlash = strcpy(strrchr(lastSlash, '.'), "_") + 1;
-			
-			sprintf(lastSlash, "room_%d.zmap", eachIndex);
-			
-			RoomToFilename(each, fn);
-		}
-	});
+	if (gWorkStats)
+	{
+		gWorkStats->seconds += WorkStatTime() - start;
+		gWorkStats->workBytes = MAX(gWorkStats->workBytes, WorkBytesHeld());
+	}
+	
+	return result;
+}
+
+// restore original segment addresses for everything
+static void SceneSerializeEnd(struct Scene *scene)
+{
+	struct DataBlob *blob;
 	
-	// restore original segment addresses for everything
 	sb_foreach(scene->rooms, {
 		blob = each->blobs;
 		datablob_foreach(blob, {
@@ -1082,6 +1621,413 @@ void SceneToFilename(struct Scene *scene, const char *filename)
 	});
 }
 
+struct SceneToFilenameContext
+{
+	struct Scene *scene;
+	struct FileSaveGroup *group;
+	const char *filename;
+	bool useOriginalFilenames;
+};
+
+static void SceneToFilenameEmit(void *udata, struct WorkFile *work, int roomIndex)
+{
+	struct SceneToFilenameContext *ctx = udata;
+	struct Room *room;
+	static char fn[2048];
+	
+	if (roomIndex < 0)
+	{
+		FileSaveGroupAddSpans(ctx->group, work->spans, sb_count(work->spans), ctx->filename);
+		return;
+	}
+	
+	room = &ctx->scene->rooms[roomIndex];
+	if (!ctx->useOriginalFilenames)
+	{
+		char *roomNameBuf = strcpy(fn, ctx->filename);
+		
+		// TODO: employ DRY on this, copy-pasted from SceneFromFilenamePredictRooms()
+		char *lastSlash = MAX(strrchr(roomNameBuf, '\\'), strrchr(roomNameBuf, '/'));
+		if (!lastSlash)
+			lastSlash = roomNameBuf;
+		else
+			lastSlash += 1;
+		lastSlash = MAX(lastSlash, strstr(lastSlash, "_scene"));
+		if (*lastSlash == '_')
+			lastSlash += 1;
+		else
+			lastSlash = strcpy(strrchr(lastSlash, '.'), "_") + 1;
+		
+		sprintf(lastSlash, "room_%d.zmap", roomIndex);
+		
+		free(room->file->filename);
+		room->file->filename = Strdup(fn);
+	}
+	
+	LogDebug("write room '%s'", room->file->filename);
+	FileSaveGroupAddSpans(ctx->group, work->spans, sb_count(work->spans), room->file->filename);
+}
+
+int SceneToFilename(struct Scene *scene, const char *filename)
+{
+	struct SceneToFilenameContext ctx = { .scene = scene };
+	static char append[2048];
+	int result;
+	
+	if (filename == 0)
+	{
+		filename = scene->file->filename;
+		ctx.useOriginalFilenames = true;
+		
+		if (filename == 0)
+			return FileSetError("scene has no filename to save to");
+	}
+	else
+	{
+		// append zscene extension if not present
+		if (!strrchr(filename, '.') // no period
+			|| !(strcpy(append, strrchr(filename, '.') + 1)
+				&& strlen(append) == 6 // zscene
+				&& StrToLower(append)
+				&& !strcmp(append, "zscene")
+			)
+		)
+		{
+			snprintf(append, sizeof(append), "%s.zscene", filename);
+			filename = append;
+		}
+		
+		free(scene->file->filename);
+		scene->file->filename = Strdup(filename);
+	}
+	
+	LogDebug("write scene '%s'", filename);
+	
+	// the scene and its rooms are written to disk together, at the end
+	ctx.group = FileSaveGroupNew();
+	ctx.filename = filename;
+	if ((result = SceneSerialize(scene, SceneToFilenameEmit, &ctx)))
+	{
+		LogError("failed to save scene '%s': %s", filename, FileGetError());
+		FileSaveGroupFree(ctx.group);
+		SceneSerializeEnd(scene);
+		return result;
+	}
+	
+	// the group borrows the scene's data, so it's restored afterwards
+	double start = gWorkStats ? WorkStatTime() : 0;
+	if ((result = FileSaveGroupCommit(ctx.group)))
+		LogError("failed to save scene '%s': %s", filename, FileGetError());
+	if (gWorkStats)
+		gWorkStats->commitSeconds += WorkStatTime() - start;
+	SceneSerializeEnd(scene);
+	
+	return result;
+}
+
+struct SceneToRomContext
+{
+	struct Scene *scene;
+	struct RomPatch *patch;
+};
+
+static void SceneToRomEmit(void *udata, struct WorkFile *work, int roomIndex)
+{
+	struct SceneToRomContext *ctx = udata;
+	struct Scene *scene = ctx->scene;
+	struct File *file = WorkFileJoin(work);
+	
+	// scene is file 0, room n is file n + 1
+	if (roomIndex < 0)
+		RomPatchAddFile(ctx->patch, scene->romStart, scene->romEnd, file);
+	else
+		RomPatchAddFile(ctx->patch, scene->rooms[roomIndex].romStart, scene->rooms[roomIndex].romEnd, file);
+	
+	FileFree(file);
+}
+
+// room lists are written with placeholder names, so point
+// each one at the rooms' final rom addresses
+static void SceneToRomFixRoomLists(struct Scene *scene, struct RomPatch *patch)
+{
+	uint32_t size;
+	uint8_t *data = RomPatchGetData(patch, 0, &size);
+	uint8_t *dataEnd = data + size;
+	sb_array(uint32_t, headers) = 0;
+	
+	// main header, then any alternate headers it lists
+	sb_push(headers, 0);
+	for (const uint8_t *cmd = data; cmd + 8 <= dataEnd && *cmd != 0x14; cmd += 8)
+	{
+		const uint8_t *alternates = data + (u32r(cmd + 4) & 0x00ffffff);
+		
+		if (*cmd != 0x18)
+			continue;
+		
+		for (int i = 0; i < sb_count(scene->headers) - 1 && alternates + i * 4 + 4 <= dataEnd; ++i)
+			if (u32r(alternates + i * 4))
+				sb_push(headers, u32r(alternates + i * 4) & 0x00ffffff);
+	}
+	
+	sb_foreach(headers, {
+		for (uint8_t *cmd = data + *each; cmd + 8 <= dataEnd && *cmd != 0x14; cmd += 8)
+		{
+			uint8_t *list = data + (u32r(cmd + 4) & 0x00ffffff);
+			
+			if (*cmd != 0x04)
+				continue;
+			
+			for (int i = 0; i < cmd[1] && i < sb_count(scene->rooms) && list + i * 8 + 8 <= dataEnd; ++i)
+			{
+				uint32_t start;
+				uint32_t end;
+				
+				RomPatchGetRange(patch, i + 1, &start, &end);
+				for (int k = 0; k < 4; ++k)
+				{
+					list[i * 8 + k] = start >> (24 - k * 8);
+					list[i * 8 + 4 + k] = end >> (24 - k * 8);
+				}
+			}
+		}
+	})
+	
+	sb_free(headers);
+}
+
+int SceneToRom(struct Scene *scene, const char *romFilename)
+{
+	struct RomPatch *patch;
+	sb_array(uint32_t, ranges) = 0; // start, end pairs
+	
+	if (!scene->romEnd)
+		return FileSetError("scene was not loaded from a rom");
+	
+	// see RomPatchAddFile()
+	sb_foreach(scene->rooms, {
+		if (!each->romEnd)
+			return FileSetError("room %d is new to the rom, which has no file table entry for it", eachIndex);
+	})
+	
+	LogDebug("write scene %08x-%08x to rom '%s'", scene->romStart, scene->romEnd, romFilename);
+	
+	if (!(patch = RomPatchNew(romFilename)))
+		return EXIT_FAILURE;
+	
+	int result = SceneSerialize(scene, SceneToRomEmit, &(struct SceneToRomContext){ scene, patch });
+	
+	// the patch has copies of its own
+	SceneSerializeEnd(scene);
+	if (result)
+	{
+		RomPatchFree(patch);
+		return EXIT_FAILURE;
+	}
+	
+	double start = gWorkStats ? WorkStatTime() : 0;
+	if (RomPatchPlan(patch))
+	{
+		RomPatchFree(patch);
+		return EXIT_FAILURE;
+	}
+	
+	SceneToRomFixRoomLists(scene, patch);
+	
+	// where everything will be once committed
+	(void)sb_add(ranges, (sb_count(scene->rooms) + 1) * 2);
+	for (int i = 0; i <= sb_count(scene->rooms); ++i)
+		RomPatchGetRange(patch, i, &ranges[i * 2], &ranges[i * 2 + 1]);
+	
+	if (RomPatchCommit(patch))
+	{
+		sb_free(ranges);
+		return EXIT_FAILURE;
+	}
+	if (gWorkStats)
+		gWorkStats->commitSeconds += WorkStatTime() - start;
+	
+	scene->romStart = ranges[0];
+	scene->romEnd = ranges[1];
+	sb_foreach(scene->rooms, {
+		each->romStart = ranges[(eachIndex + 1) * 2];
+		each->romEnd = ranges[(eachIndex + 1) * 2 + 1];
+	})
+	sb_free(ranges);
+	
+	return EXIT_SUCCESS;
+}
+
+static void SceneEstimateEmit(void *udata, struct WorkFile *work, int roomIndex)
+{
+	(void)udata;
+	(void)work;
+	(void)roomIndex;
+}
+
+// a dry run of a whole save: everything is laid out and measured the
+// same as for a real save, but nothing is written anywhere; stats are
+// reset first, and afterwards hold the file sizes a save would produce
+void SceneEstimateSizes(struct Scene *scene, struct SceneWriteStats *stats)
+{
+	struct SceneWriteStats *saved = gWorkStats;
+	
+	SceneWriteStatsFree(stats);
+	
+	gWorkStats = stats;
+	gWorkIsEstimate = true;
+	(void)SceneSerialize(scene, SceneEstimateEmit, 0);
+	SceneSerializeEnd(scene);
+	gWorkIsEstimate = false;
+	gWorkStats = saved;
+}
+
+static uint32_t SceneRoomSize(struct Scene *scene, const uint32_t *roomSizes, int index)
+{
+	if (index >= sb_count(scene->rooms))
+		return 0;
+	
+	if (roomSizes)
+		return roomSizes[index];
+	
+	return scene->rooms[index].file ? scene->rooms[index].file->size : 0;
+}
+
+// how much memory the game sets aside for this scene's rooms: enough for
+// the largest room, or for the rooms on both sides of any doorway; given
+// no roomSizes, uses the sizes of the rooms as they were loaded
+uint32_t SceneRoomMemory(struct Scene *scene, const uint32_t *roomSizes)
+{
+	uint32_t most = 0;
+	
+	for (int i = 0; i < sb_count(scene->rooms); ++i)
+		most = MAX(most, SceneRoomSize(scene, roomSizes, i));
+	
+	sb_foreach_named(scene->headers, header, {
+		sb_foreach(header->doorways, {
+			if (each->doorway.frontRoom != each->doorway.backRoom)
+				most = MAX(most
+					, SceneRoomSize(scene, roomSizes, each->doorway.frontRoom)
+					+ SceneRoomSize(scene, roomSizes, each->doorway.backRoom)
+				);
+		})
+	})
+	
+	return most;
+}
+
+// how many threads serialize rooms, 0 for one per core
+void SceneWriterSetJobs(int jobs)
+{
+	gSceneWriteJobs = MAX(0, jobs);
+}
+
+// if false, every blob is copied into the output, as it was before
+// the output was written from spans, so the two can be compared
+void SceneWriterSetBorrowing(bool borrow)
+{
+	gSceneWriteBorrows = borrow;
+}
+
+// while set, every save adds its timings and byte counts to stats,
+// and leaves the sizes of the files it wrote there; 0 to stop
+void SceneWriterSetStats(struct SceneWriteStats *stats)
+{
+	gWorkStats = stats;
+}
+
+static void SceneWriteStatLog(const char *name, const struct SceneWriteStat *stat)
+{
+	if (!stat->count && !stat->bytes && !stat->dedupBytes && !stat->padBytes)
+		return;
+	
+	LogInfo("  %-24s %6d %9u %9u %7u %9.3f"
+		, name
+		, stat->count
+		, stat->bytes
+		, stat->dedupBytes
+		, stat->padBytes
+		, stat->seconds * 1000
+	);
+}
+
+void SceneWriteStatsLog(const struct SceneWriteStats *stats)
+{
+	static const char *blobTypeNames[DATA_BLOB_TYPE_COUNT] = {
+		"unset", "mesh", "vertex", "matrix", "texture", "palette", "generic", "eof"
+	};
+	static const char *commandNames[SCENE_WRITE_STAT_COMMANDS] = {
+		[0x00] = "spawn positions",
+		[0x01] = "actors",
+		[0x02] = "actor cutscene cameras",
+		[0x03] = "collision",
+		[0x04] = "room list",
+		[0x06] = "spawn entrances",
+		[0x0A] = "mesh header",
+		[0x0B] = "objects",
+		[0x0D] = "paths",
+		[0x0E] = "doorways",
+		[0x0F] = "lights",
+		[0x13] = "exits",
+		[0x17] = "cutscenes",
+		[0x18] = "alternate headers",
+		[0x1A] = "texture animation",
+		[0x1B] = "actor cutscenes",
+	};
+	struct SceneWriteStat total = stats->headers;
+	uint32_t roomBytes = 0;
+	
+	for (int i = 0; i < DATA_BLOB_TYPE_COUNT; ++i)
+	{
+		total.bytes += stats->blobTypes[i].bytes;
+		total.dedupBytes += stats->blobTypes[i].dedupBytes;
+		total.padBytes += stats->blobTypes[i].padBytes;
+	}
+	for (int i = 0; i < SCENE_WRITE_STAT_COMMANDS; ++i)
+	{
+		total.bytes += stats->commands[i].bytes;
+		total.dedupBytes += stats->commands[i].dedupBytes;
+		total.padBytes += stats->commands[i].padBytes;
+	}
+	sb_foreach(stats->roomSizes, { roomBytes += *each; })
+	
+	LogInfo("save profile: serialized in %.3f ms, written in %.3f ms"
+		, stats->seconds * 1000
+		, stats->commitSeconds * 1000
+	);
+	LogInfo("  scene is 0x%x bytes, %d rooms are 0x%x bytes"
+		, stats->sceneSize
+		, sb_count(stats->roomSizes)
+		, roomBytes
+	);
+	LogInfo("  %u bytes written, %u saved by deduplication, %u of padding"
+		, total.bytes
+		, total.dedupBytes
+		, total.padBytes
+	);
+	LogInfo("  work buffers peaked at %u bytes", (uint32_t)stats->workBytes);
+	LogInfo("  %-24s %6s %9s %9s %7s %9s", "", "count", "bytes", "deduped", "padding", "ms");
+	
+	for (int i = 0; i < DATA_BLOB_TYPE_COUNT; ++i)
+		SceneWriteStatLog(QuickFmt("blob %s", blobTypeNames[i]), &stats->blobTypes[i]);
+	
+	for (int i = 0; i < SCENE_WRITE_STAT_COMMANDS; ++i)
+		SceneWriteStatLog(
+			commandNames[i]
+				? QuickFmt("cmd %02x %s", i, commandNames[i])
+				: QuickFmt("cmd %02x", i)
+			, &stats->commands[i]
+		);
+	
+	SceneWriteStatLog("headers", &stats->headers);
+}
+
+// frees the file sizes and zeroes everything, ready for reuse
+void SceneWriteStatsFree(struct SceneWriteStats *stats)
+{
+	sb_free(stats->roomSizes);
+	memset(stats, 0, sizeof(*stats));
+}
+
 void CollisionHeaderToWorkblob(CollisionHeader *header)
 {
 	WorkblobPush(4);
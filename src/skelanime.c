@@ -13,6 +13,95 @@
 
 static inline stb_sb_find_impl(FindLimbOverride, const struct ObjectLimbOverride, int, each->limbIndex == needle)
 
+// instances playing the same clip at the same position share one pose;
+// the blend weight must match exactly, so sharing never changes what an
+// instance shows, and entries only live for one rendered frame, because
+// the limb matrices they hold are allocated from per-frame graph memory
+#define SKELANIME_POSE_CACHE_SIZE 512 // power of two, kept at most half full
+
+struct SkelAnimePose
+{
+	const struct ObjectSkeleton *skeleton;
+	const struct ObjectAnimation *animation;
+	u32   frame; // rendered frame this entry belongs to
+	u16   frameA;
+	u16   frameB;
+	float weight;
+	Vec3s jointTable[100];
+	
+	// limb matrices relative to the skeleton root, built on first draw
+	int localOffset; // into sPoseCache.locals, or -1
+	
+	// the last limb matrices drawn, reusable as-is by instances
+	// with the same root transform and limb overrides
+	MtxN64 *mtx;
+	Matrix mtxRoot;
+	const struct ObjectLimbOverride *mtxOverrides;
+};
+
+static struct
+{
+	struct SkelAnimePose entries[SKELANIME_POSE_CACHE_SIZE];
+	int numEntries;
+	u32 frame;
+	sb_array(Matrix, locals);
+} sPoseCache = { .frame = 1 };
+
+static struct SkelAnimePose *SkelAnime_FindPose(const SkelAnime *this, int frameA, int frameB, float weight, bool *isNew)
+{
+	const u32 mask = SKELANIME_POSE_CACHE_SIZE - 1;
+	uint32_t weightBits;
+	uintptr_t hash = (uintptr_t)this->skeleton ^ ((uintptr_t)this->animation << 7);
+	
+	memcpy(&weightBits, &weight, sizeof(weightBits));
+	hash = (hash ^ (hash >> 17)) * 0x9E3779B1u;
+	hash += frameA * 0x85EBCA6Bu + frameB * 0xC2B2AE35u + weightBits;
+	hash ^= hash >> 15;
+	
+	*isNew = false;
+	for (u32 i = hash & mask; ; i = (i + 1) & mask)
+	{
+		struct SkelAnimePose *pose = &sPoseCache.entries[i];
+		
+		// entries from previous frames are empty slots
+		if (pose->frame != sPoseCache.frame)
+		{
+			if (sPoseCache.numEntries >= SKELANIME_POSE_CACHE_SIZE / 2)
+				return 0;
+			
+			pose->skeleton = this->skeleton;
+			pose->animation = this->animation;
+			pose->frame = sPoseCache.frame;
+			pose->frameA = frameA;
+			pose->frameB = frameB;
+			pose->weight = weight;
+			pose->localOffset = -1;
+			pose->mtx = 0;
+			sPoseCache.numEntries += 1;
+			*isNew = true;
+			
+			return pose;
+		}
+		
+		if (pose->skeleton == this->skeleton
+			&& pose->animation == this->animation
+			&& pose->frameA == frameA
+			&& pose->frameB == frameB
+			&& pose->weight == weight
+		)
+			return pose;
+	}
+}
+
+void SkelAnime_NewFrame(void)
+{
+	if (!++sPoseCache.frame)
+		++sPoseCache.frame;
+	
+	sPoseCache.numEntries = 0;
+	sb_clear(sPoseCache.locals);
+}
+
 void SkelAnime_Init(SkelAnime *this, const struct Object *object, const struct ObjectSkeleton *skeleton, const struct ObjectAnimation *animation)
 {
 	// don't reinitialize if nothing changed
@@ -36,71 +125,97 @@ void SkelAnime_Free(SkelAnime* this)
 	memset(this, 0, sizeof(*this));
 }
 
-static void SkelAnime_GetFrameData(const struct ObjectAnimation *anim, int frame, int limbCount, Vec3s* frameTable)
+// animations are decoded once into native-endian rows, one per frame,
+// so updating an instance only blends two contiguous rows; the decoded
+// rows are cached on the animation and freed along with its object
+static const int16_t *SkelAnime_GetFrames(const struct ObjectAnimation *anim, int limbCount)
 {
+	struct ObjectAnimation *cache = (struct ObjectAnimation*)anim;
 	const uint8_t *oob = anim->object->file->dataEnd;
 	const int16_t *oob16 = (int16_t*)(oob - sizeof(*oob16));
-	const Vec3s *jointIndices = SEGMENTED_TO_VIRTUAL(anim->rotIndexSegAddr);
 	const Vec3s *jointIndicesOob = (Vec3s*)(oob - sizeof(*jointIndicesOob));
+	const Vec3s *jointIndices = SEGMENTED_TO_VIRTUAL(anim->rotIndexSegAddr);
 	const int16_t *frameData = SEGMENTED_TO_VIRTUAL(anim->rotValSegAddr);
 	const int16_t *staticData = &frameData[0];
-	const int16_t *dynamicData = &frameData[frame];
+	int numFrames = MAX(1, anim->numFrames);
 	uint16_t limit = anim->limit;
+	int16_t *row;
+	
+	if (anim->frames && anim->framesLimbCount == limbCount)
+		return anim->frames;
 	
 	if (!jointIndices || !frameData)
-		Die("SkelAnime_GetFrameData() failed on %08x %08x",
+		Die("SkelAnime_GetFrames() failed on %08x %08x",
 			anim->rotIndexSegAddr, anim->rotValSegAddr
 		);
 	
-	for (int i = 0; i < limbCount; ++i, ++frameTable, ++jointIndices)
+	free(cache->frames);
+	cache->frames = Calloc(numFrames * limbCount * 3, sizeof(*cache->frames));
+	cache->framesLimbCount = limbCount;
+	
+	row = cache->frames;
+	for (int frame = 0; frame < numFrames; ++frame, row += limbCount * 3)
 	{
-		// bounds checking
-		if (jointIndices >= jointIndicesOob)
-			return;
-		
-		Vec3s swapInd = { u16r3(jointIndices) };
-		const int16_t *x = swapInd.x >= limit ? &dynamicData[swapInd.x] : &staticData[swapInd.x];
-		const int16_t *y = swapInd.y >= limit ? &dynamicData[swapInd.y] : &staticData[swapInd.y];
-		const int16_t *z = swapInd.z >= limit ? &dynamicData[swapInd.z] : &staticData[swapInd.z];
-		
-		// bounds checking
-		if (x > oob16 || y > oob16 || z > oob16)
-			return;
+		const int16_t *dynamicData = &frameData[frame];
 		
-		frameTable->x = u16r(x);
-		frameTable->y = u16r(y);
-		frameTable->z = u16r(z);
+		for (int i = 0; i < limbCount; ++i)
+		{
+			// bounds checking, the rest of the row stays zero
+			if (jointIndices + i >= jointIndicesOob)
+				break;
+			
+			Vec3s swapInd = { u16r3(jointIndices + i) };
+			const int16_t *x = swapInd.x >= limit ? &dynamicData[swapInd.x] : &staticData[swapInd.x];
+			const int16_t *y = swapInd.y >= limit ? &dynamicData[swapInd.y] : &staticData[swapInd.y];
+			const int16_t *z = swapInd.z >= limit ? &dynamicData[swapInd.z] : &staticData[swapInd.z];
+			
+			// bounds checking
+			if (x > oob16 || y > oob16 || z > oob16)
+				break;
+			
+			row[i * 3 + 0] = u16r(x);
+			row[i * 3 + 1] = u16r(y);
+			row[i * 3 + 2] = u16r(z);
+		}
 	}
+	
+	return cache->frames;
 }
 
-static void SkelAnime_InterpFrameTable(int limbCount, Vec3s* dst, Vec3s* start, Vec3s* target, float weight)
+// blends two rows of numValues s16's, eight at a time
+typedef int16_t SkelAnimeVecS16 __attribute__((vector_size(8 * sizeof(int16_t))));
+typedef float SkelAnimeVecF32 __attribute__((vector_size(8 * sizeof(float))));
+static void SkelAnime_InterpFrameTable(int numValues, int16_t *dst, const int16_t *start, const int16_t *target, float weight)
 {
-	if (weight < 1.0f)
+	int i = 0;
+	
+	if (weight >= 1.0f)
 	{
-		int16_t diff;
-		int16_t base;
+		memcpy(dst, target, numValues * sizeof(*dst));
+		return;
+	}
+	
+	// same math as the scalar tail, the difference wraps like an s16
+	for (; i + 8 <= numValues; i += 8)
+	{
+		SkelAnimeVecS16 base;
+		SkelAnimeVecS16 next;
+		SkelAnimeVecS16 result;
 		
-		for (int i = 0; i < limbCount; ++i, ++dst, ++start, ++target)
-		{
-			base = start->x;
-			diff = target->x - base;
-			dst->x = (s16)(diff * weight) + base;
-			base = start->y;
-			diff = target->y - base;
-			dst->y = (s16)(diff * weight) + base;
-			base = start->z;
-			diff = target->z - base;
-			dst->z = (s16)(diff * weight) + base;
-		}
+		memcpy(&base, start + i, sizeof(base));
+		memcpy(&next, target + i, sizeof(next));
+		result = __builtin_convertvector(
+			__builtin_convertvector(next - base, SkelAnimeVecF32) * weight
+			, SkelAnimeVecS16
+		) + base;
+		memcpy(dst + i, &result, sizeof(result));
 	}
-	else
+	
+	for (; i < numValues; ++i)
 	{
-		for (int i = 0; i < limbCount; ++i, ++dst, ++target)
-		{
-			dst->x = target->x;
-			dst->y = target->y;
-			dst->z = target->z;
-		}
+		int16_t diff = target[i] - start[i];
+		
+		dst[i] = (s16)(diff * weight) + start[i];
 	}
 }
 
@@ -121,140 +236,231 @@ void SkelAnime_Update(SkelAnime* this, double deltaTimeFrames)
 	if (!this->curFrame && signbit(this->playSpeed) && !signbit(this->curFrame))
 		this->curFrame *= -1;
 	
-	float curFrame = this->curFrame;
+	float curFrame = isfinite(this->curFrame) ? this->curFrame : 0;
+	const int16_t *frames;
+	int rowLength = this->limbCount * 3;
+	int frameA;
+	int frameB;
+	float weight;
+	struct SkelAnimePose *pose;
+	bool isNew;
 	
 	n64_segment_set(obj->segment, anim->object->file->data);
 	
+	frames = SkelAnime_GetFrames(anim, this->limbCount);
 	this->endFrame = anim->numFrames - 1;
 	
+	// single frame animations
+	if (this->endFrame <= 0)
+	{
+		curFrame = 0;
+		frameA = frameB = 0;
+		weight = 0;
+	}
 	// animation in reverse
-	// TODO consolidate these so there's less code
-	if (signbit(curFrame))
+	else if (signbit(curFrame))
 	{
 		curFrame = this->endFrame + fmodf(curFrame, this->endFrame);
-		
-		SkelAnime_GetFrameData(anim, floor(curFrame), this->limbCount, this->jointTable);
-		SkelAnime_GetFrameData(anim, wrapf(floor(curFrame) - 1, 0, this->endFrame), this->limbCount, this->morphTable);
-		
-		SkelAnime_InterpFrameTable(
-			this->limbCount,
-			this->jointTable,
-			this->jointTable,
-			this->morphTable,
-			1.0 - fmod(curFrame, 1.0f)
-		);
+		frameA = floor(curFrame);
+		frameB = wrapf(frameA - 1, 0, this->endFrame);
+		weight = 1.0 - fmod(curFrame, 1.0f);
 	}
 	else
 	{
 		curFrame = fmodf(curFrame, this->endFrame);
-		
-		SkelAnime_GetFrameData(anim, floor(curFrame), this->limbCount, this->jointTable);
-		SkelAnime_GetFrameData(anim, wrapf(floor(curFrame) + 1, 0, this->endFrame), this->limbCount, this->morphTable);
-		
+		frameA = floor(curFrame);
+		frameB = wrapf(frameA + 1, 0, this->endFrame);
+		weight = fmod(curFrame, 1.0f);
+	}
+	
+	pose = SkelAnime_FindPose(this, frameA, frameB, weight, &isNew);
+	
+	// only the first instance on this pose has to blend it
+	if (!pose || isNew)
 		SkelAnime_InterpFrameTable(
-			this->limbCount,
-			this->jointTable,
-			this->jointTable,
-			this->morphTable,
-			fmod(curFrame, 1.0f)
+			rowLength,
+			(int16_t*)(pose ? pose->jointTable : this->jointTable),
+			frames + frameA * rowLength,
+			frames + frameB * rowLength,
+			weight
 		);
-	}
+	
+	if (pose)
+		memcpy(this->jointTable, pose->jointTable, rowLength * sizeof(int16_t));
+	
+	this->pose = pose;
+	this->poseFrame = sPoseCache.frame;
 	
 	this->curFrame += this->playSpeed * deltaTimeFrames;
 	
 	this->prevFrame = curFrame;
 }
 
-static void SkelAnime_Limb(const struct Object *obj, const uint32_t skelSeg, u8 limbId, MtxN64** mtx, Vec3s* jointTable, const struct ObjectLimbOverride *limbOverrides)
+// flattens the child/sibling hierarchy into draw order (preorder), so
+// drawing is a loop instead of recursion through the limb data
+static const struct ObjectLimb *SkelAnime_GetLimbs(const struct ObjectSkeleton *skel)
 {
-	const StandardLimb* limb;
-	const uint32_t* limbList;
-	Vec3s rot = { 0 };
-	Vec3s pos;
-	Vec3f rpos;
+	struct ObjectSkeleton *cache = (struct ObjectSkeleton*)skel;
+	const uint32_t *limbList = SEGMENTED_TO_VIRTUAL(skel->limbAddrsSegAddr);
+	sb_array(struct ObjectLimb, pending) = 0;
+	
+	if (skel->limbs)
+		return skel->limbs;
 	
-	limbList = SEGMENTED_TO_VIRTUAL(skelSeg);
-	limb = SEGMENTED_TO_VIRTUAL(u32r(&limbList[limbId]));
+	sb_new_size(cache->limbs, skel->limbCount);
+	sb_push(pending, ((struct ObjectLimb){ .index = 0, .depth = 0 }));
 	
-	Matrix_Push();
+	// each limb is visited at most once, which also guards against cycles
+	while (sb_count(pending) && sb_count(cache->limbs) < skel->limbCount)
 	{
-		if (limbId == 0)
-		{
-			pos = jointTable[0];
-			rot = jointTable[1];
-		}
-		else
-		{
-			pos = (Vec3s){ u16r3(&limb->jointPos) };
-			
-			limbId++;
-			rot = jointTable[limbId];
-		}
+		struct ObjectLimb each = sb_pop(pending);
+		const StandardLimb *limb = SEGMENTED_TO_VIRTUAL(u32r(&limbList[each.index]));
+		Vec3s jointPos = { u16r3(&limb->jointPos) };
 		
-		veccpy(&rpos, &pos);
-		//LogDebug("limb[%d] pos = %d %d %d", limbId, pos.x, pos.y, pos.z);
-		//static Vec3f rpos; float speed = 0.01; rpos.x += speed; rpos.y += speed; rpos.z += speed;
+		each.jointPos[0] = jointPos.x;
+		each.jointPos[1] = jointPos.y;
+		each.jointPos[2] = jointPos.z;
+		each.dList = u32r(&limb->dList);
+		sb_push(cache->limbs, each);
 		
-		Matrix_TranslateRotateZYX(&rpos, &rot);
+		// pushed in reverse, so children come before siblings
+		if (limb->sibling < skel->limbCount)
+			sb_push(pending, ((struct ObjectLimb){ .index = limb->sibling, .depth = each.depth }));
+		if (limb->child < skel->limbCount)
+			sb_push(pending, ((struct ObjectLimb){ .index = limb->child, .depth = each.depth + 1 }));
+	}
+	
+	sb_free(pending);
+	
+	return skel->limbs;
+}
+
+// limb matrices relative to the skeleton root, in draw order
+static void SkelAnime_BuildLocalMatrices(const struct ObjectLimb *limbs, const Vec3s *jointTable, Matrix *dst)
+{
+	Matrix *parents[256];
+	
+	sb_foreach(limbs, {
+		Vec3s rot = jointTable[each->index + 1];
+		Vec3f pos;
 		
-		const struct ObjectLimbOverride *override = FindLimbOverride(limbOverrides, limbId);
-		if (limb->dList || override)
-		{
-			if (mtx && *mtx)
-			{
-				Matrix_ToMtx((*mtx));
-				gSPMatrix(POLY_OPA_DISP++, (*mtx), G_MTX_LOAD);
-				(*mtx)++;
-			}
-			
-			bool restoreObject = false;
-			uint32_t dlist = u32r(&limb->dList);
-			//if (limbOverrides) LogDebug("limbOverrides = %p, %d = %08x vs %d vs %p", limbOverrides, limbOverrides[0].limbIndex, limbOverrides[0].segAddr, limbId, override);
-			if (override)
-			{
-				dlist = override->segAddr;//, LogDebug("override %d with %08x", limbId, override->segAddr);
-				
-				if (override->objectData)
-				{
-					gSPSegment(POLY_OPA_DISP++, dlist >> 24, override->objectData);
-					restoreObject = true;
-				}
-			}
-			
-			gSPDisplayList(POLY_OPA_DISP++, dlist);
-			
-			if (restoreObject)
-				gSPSegment(POLY_OPA_DISP++, obj->segment, obj->file->data);
-		}
+		// the root limb is positioned by the animation
+		if (each->index == 0)
+			veccpy(&pos, &jointTable[0]);
+		else
+			pos = ((Vec3f){ each->jointPos[0], each->jointPos[1], each->jointPos[2] });
 		
-		if (limb->child != 0xFF)
-			SkelAnime_Limb(obj, skelSeg, limb->child, mtx, jointTable, limbOverrides);
+		Matrix_MtxFCopy(&dst[eachIndex], each->depth ? parents[each->depth - 1] : (Matrix*)&gMtxFClear);
+		Matrix_MtxFTranslateRotateZYX(&dst[eachIndex], &pos, &rot);
+		parents[each->depth] = &dst[eachIndex];
+	})
+}
+
+// valid until the next call
+static const Matrix *SkelAnime_GetLocalMatrices(const SkelAnime *this, struct SkelAnimePose *pose, const struct ObjectLimb *limbs)
+{
+	static sb_array(Matrix, scratch);
+	int numLimbs = sb_count(limbs);
+	
+	if (!pose)
+	{
+		sb_clear(scratch);
+		(void)sb_add(scratch, numLimbs);
+		SkelAnime_BuildLocalMatrices(limbs, this->jointTable, scratch);
+		
+		return scratch;
 	}
-	Matrix_Pop();
 	
-	if (limb->sibling != 0xFF)
-		SkelAnime_Limb(obj, skelSeg, limb->sibling, mtx, jointTable, limbOverrides);
+	if (pose->localOffset < 0)
+	{
+		pose->localOffset = sb_count(sPoseCache.locals);
+		(void)sb_add(sPoseCache.locals, numLimbs);
+		SkelAnime_BuildLocalMatrices(limbs, pose->jointTable, sPoseCache.locals + pose->localOffset);
+	}
+	
+	return sPoseCache.locals + pose->localOffset;
 }
 
 void SkelAnime_Draw(SkelAnime* this, SkelanimeType type, const struct ObjectLimbOverride *limbOverrides)
 {
 	const struct Object *obj = this->object;
 	const struct ObjectSkeleton *skel = this->skeleton;
+	struct SkelAnimePose *pose = this->poseFrame == sPoseCache.frame ? this->pose : 0;
+	const struct ObjectLimb *limbs;
+	const Matrix *local = 0;
 	MtxN64* mtx = NULL;
+	Matrix root;
 	
 	n64_segment_set(obj->segment, obj->file->data);
 	gSPSegment(POLY_OPA_DISP++, obj->segment, obj->file->data);
 	
-	Matrix_Push();
+	limbs = SkelAnime_GetLimbs(skel);
+	
+	if (type == SKELANIME_TYPE_FLEX)
 	{
-		if (type == SKELANIME_TYPE_FLEX)
+		Matrix_Get(&root);
+		
+		// reuse the last instance's matrices if they would come out the same
+		if (pose
+			&& pose->mtx
+			&& pose->mtxOverrides == limbOverrides
+			&& !memcmp(&pose->mtxRoot, &root, sizeof(root))
+		)
+			mtx = pose->mtx;
+		else
 		{
 			mtx = n64_graph_alloc(sizeof(MtxN64) * skel->limbCount);
+			local = SkelAnime_GetLocalMatrices(this, pose, limbs);
 			
-			gSPSegment(POLY_OPA_DISP++, 0x0D, mtx);
+			if (pose)
+			{
+				pose->mtx = mtx;
+				pose->mtxRoot = root;
+				pose->mtxOverrides = limbOverrides;
+			}
 		}
 		
-		SkelAnime_Limb(obj, skel->limbAddrsSegAddr, 0, &mtx, this->jointTable, limbOverrides);
+		gSPSegment(POLY_OPA_DISP++, 0x0D, mtx);
 	}
-	Matrix_Pop();
+	
+	sb_foreach(limbs, {
+		// overrides are indexed like the joint table, but 0 for the root limb
+		int overrideIndex = each->index ? each->index + 1 : 0;
+		const struct ObjectLimbOverride *override = FindLimbOverride(limbOverrides, overrideIndex);
+		
+		if (!each->dList && !override)
+			continue;
+		
+		if (mtx)
+		{
+			if (local)
+			{
+				Matrix world;
+				
+				Matrix_MtxFMtxFMult(&root, (Matrix*)&local[eachIndex], &world);
+				Matrix_MtxFToMtx(&world, mtx);
+			}
+			
+			gSPMatrix(POLY_OPA_DISP++, mtx, G_MTX_LOAD);
+			mtx++;
+		}
+		
+		bool restoreObject = false;
+		uint32_t dlist = each->dList;
+		if (override)
+		{
+			dlist = override->segAddr;
+			
+			if (override->objectData)
+			{
+				gSPSegment(POLY_OPA_DISP++, dlist >> 24, override->objectData);
+				restoreObject = true;
+			}
+		}
+		
+		gSPDisplayList(POLY_OPA_DISP++, dlist);
+		
+		if (restoreObject)
+			gSPSegment(POLY_OPA_DISP++, obj->segment, obj->file->data);
+	})
 }
@@ -38,6 +38,9 @@ typedef struct SkelAnime
 	Vec3s baseTransl;
 	f32   prevFrame;
 	f64 time;
+	// shared with instances on the same clip and frame, see SkelAnime_NewFrame()
+	struct SkelAnimePose *pose;
+	u32   poseFrame;
 } SkelAnime;
 
 typedef enum
@@ -50,5 +53,7 @@ void SkelAnime_Init(SkelAnime*, const struct Object *object, const struct Object
 void SkelAnime_Update(SkelAnime*, double deltaTimeFrames);
 void SkelAnime_Draw(SkelAnime*, SkelanimeType type, const struct ObjectLimbOverride *limbOverrides);
 void SkelAnime_Free(SkelAnime*);
+// call once per rendered frame, before any instances are updated
+void SkelAnime_NewFrame(void);
 
 #endif // SKELANIME_H_INCLUDED
@@ -6,14 +6,33 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <wren.h>
 #include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
 #include <z64convert.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 #include "logging.h"
 #include "project.h"
 #include "fast64.h"
+#include "journal.h"
 #include "misc.h"
+#include "object.h"
+#include "object-index.h"
+#include "file.h"
+#include "file-save.h"
+#include "rom-patch.h"
+#include "mesh-cache.h"
+#include "room-vis.h"
+#include "actor-query.h"
+#include "cutscene.h"
+
+// dies naming the test and the condition that didn't hold
+#define TEST_EXPECT(COND) do { if (!(COND)) Die("%s: failed '%s'", __func__, #COND); } while (0)
 
 // for reporting the correct line number in wren callbacks
 static int sLine = 0;
@@ -700,23 +719,26 @@ void TestSaveLoadCycle(struct Scene *scene, uint32_t identifier)
 	SceneFree(sceneB);
 }
 
-void TestForEachActorInScene(struct Scene *scene, uint32_t identifier)
+// the tests have nothing to fall back on
+static struct Project *TestProjectNew(const char *filename)
+{
+	struct Project *project = ProjectNewFromFilename(filename);
+	
+	if (!project)
+		Die("%s", FileGetError());
+	
+	return project;
+}
+
+static int sTestActorCount;
+
+static void TestCountActorsInScene(struct Scene *scene, uint32_t identifier)
 {
 	if (!scene)
 		return;
 	
 	sb_foreach_named(scene->rooms, room, {
-		sb_foreach_named(room->headers, header, {
-			sb_foreach_named(header->instances, inst, {
-				// example filter
-				if ((inst->id == 0x000A || inst->id == 0x0202)
-					&& ((inst->params >> 5) & 0x7F) == 0x2F
-				)
-					fprintf(stdout, "scene %08x, room %d, header %d, instance %d : %04x %04x\n",
-						identifier, roomIndex, headerIndex, instIndex, inst->id, inst->params
-					);
-			})
-		})
+		sb_foreach(room->headers, { sTestActorCount += sb_count(each->instances); })
 	})
 }
 
@@ -731,7 +753,7 @@ void TestEveryScene(const char *filename, void func(struct Scene *scene, uint32_
 	
 	if (strstr("z64|zzrpl|rtl|toml", extension))
 	{
-		struct Project *project = ProjectNewFromFilename(filename);
+		struct Project *project = TestProjectNew(filename);
 		
 		sb_foreach(project->scenes, {
 			struct Scene *scene = 0;
@@ -770,9 +792,190 @@ void TestSaveLoadCycles(const char *filename)
 	TestEveryScene(filename, TestSaveLoadCycle);
 }
 
-void TestForEachActor(const char *filename)
+void TestForEachActor(const char *filename, const char *expression)
 {
-	TestEveryScene(filename, TestForEachActorInScene);
+	struct Project *project = TestProjectNew(filename);
+	struct ActorQueryIndex *index = ActorQueryIndexNew(project, 8);
+	const struct ActorQueryStats *stats = ActorQueryIndexGetStats(index);
+	sb_array(struct ActorQueryEntry, matches) = 0;
+	sb_array(struct ActorQueryEntry, again) = 0;
+	const char *error;
+	clock_t start;
+	double secFirst;
+	double secAgain;
+	
+	// example filter
+	if (!expression)
+		expression = "(id == 0x000A || id == 0x0202) && ((params >> 5) & 0x7F) == 0x2F";
+	
+	TomlActorQueryAddFields(index, project);
+	
+	start = clock();
+	if ((error = ActorQueryRun(index, expression, &matches)))
+		Die("TestForEachActor: %s", error);
+	secFirst = (double)(clock() - start) / CLOCKS_PER_SEC;
+	
+	start = clock();
+	ActorQueryRun(index, expression, &again);
+	secAgain = (double)(clock() - start) / CLOCKS_PER_SEC;
+	
+	sb_foreach(matches, {
+		fprintf(stdout, "scene %08x, room %d, header %d, instance %d : %04x %04x\n",
+			project->scenes[each->scene].startAddress, each->room, each->header, each->index, each->id, each->params
+		);
+	})
+	
+	// the index reads actors without the scene loader, so it must find as many
+	sTestActorCount = 0;
+	TestEveryScene(filename, TestCountActorsInScene);
+	
+	fprintf(stdout, "indexed %d actors in %d scenes in %.3fs, %d scenes and %d rooms unreadable\n"
+		, stats->numActors, stats->numScenes, stats->seconds, stats->numFailed, stats->numRoomsFailed
+	);
+	fprintf(stdout, "%d matches in %.3fms, again in %.3fms\n"
+		, sb_count(matches), secFirst * 1000, secAgain * 1000
+	);
+	if (sb_count(again) != sb_count(matches) || memcmp(again, matches, sb_count(matches) * sizeof(*matches)))
+		Die("TestForEachActor: repeating the query gave different results");
+	if (sTestActorCount != stats->numActors)
+		Die("TestForEachActor: scene loader found %d actors, the index %d", sTestActorCount, stats->numActors);
+	
+	sb_free(matches);
+	sb_free(again);
+	ActorQueryIndexFree(index);
+	ProjectFree(project);
+	LogDebug("TestForEachActor passed");
+}
+
+// how many of the index's actors match, dying if the expression doesn't parse
+static int TestActorQueryCount(struct ActorQueryIndex *index, const char *expression, sb_array(struct ActorQueryEntry, *matches))
+{
+	const char *error;
+	
+	sb_clear(*matches);
+	if ((error = ActorQueryRun(index, expression, matches)))
+		Die("TestActorQuery: '%s' failed: %s", expression, error);
+	
+	return sb_count(*matches);
+}
+
+// parses expressions over a few made-up actors, then indexes a made-up rom
+void TestActorQuery(void)
+{
+	const struct ActorQueryEntry entries[] = {
+		{ .id = 0x000A, .params = 0x2F << 5, .room = 0 },
+		{ .id = 0x000A, .params = 0x2E << 5, .room = 1 },
+		{ .id = 0x0202, .params = 0x2F << 5 | 1, .room = 2 },
+		{ .id = 0x0008, .params = 0xFFFF, .room = 0, .yrot = 0x4000 },
+		{ .id = 0x000A, .params = 0x2F << 5, .room = 3, .index = 1 },
+	};
+	const int numEntries = sizeof(entries) / sizeof(*entries);
+	struct ActorQueryIndex *index = ActorQueryIndexFromEntries(entries, numEntries);
+	sb_array(struct ActorQueryEntry, matches) = 0;
+	sb_array(struct ActorQueryEntry, scanned) = 0;
+	
+	// same precedence as c, constant expressions match every actor or none
+	const struct { const char *expression; bool isTrue; } precedence[] = {
+		{ "1 + 2 * 3 == 7", true },
+		{ "(1 + 2) * 3 == 9", true },
+		{ "1 << 2 + 1 == 8", true },
+		{ "6 & 3 == 3", false }, // & binds looser than ==
+		{ "(6 & 3) == 2", true },
+		{ "1 | 2 ^ 3", true },
+		{ "1 || 0 && 0", true }, // && binds tighter than ||
+		{ "(1 || 0) && 0", false },
+		{ "!0 == 1", true },
+		{ "-1 < 0 && ~0 == -1", true },
+		{ "7 - 2 - 1 == 4", true }, // left to right
+		{ "16 / 4 / 2 == 2", true },
+	};
+	for (int i = 0; i < sizeof(precedence) / sizeof(*precedence); ++i)
+		if (TestActorQueryCount(index, precedence[i].expression, &matches) != (precedence[i].isTrue ? numEntries : 0))
+			Die("TestActorQuery: '%s' should be %s", precedence[i].expression, precedence[i].isTrue ? "true" : "false");
+	
+	// 'id ==' narrows the search to those ids' actors, but must find the
+	// same ones in the same order as 'id + 0 ==', which checks every actor
+	const char *narrowed[][2] = {
+		{ "id == 0x000A", "id + 0 == 0x000A" },
+		{ "id == 0x000A && (params >> 5 & 0x7F) == 0x2F", "id + 0 == 0x000A && (params >> 5 & 0x7F) == 0x2F" },
+		{ "(id == 0x000A || id == 0x0202) && ((params >> 5) & 0x7F) == 0x2F", "(id + 0 == 0x000A || id + 0 == 0x0202) && ((params >> 5) & 0x7F) == 0x2F" },
+		{ "0x0202 == id || room == 0", "0x0202 == id + 0 || room == 0" },
+		{ "id == 0x000A && id == 0x0008", "id + 0 == 0x000A && id + 0 == 0x0008" },
+		{ "id == 0x10000", "id + 0 == 0x10000" },
+		{ "room == 3 && id == 0x000A", "room == 3 && id + 0 == 0x000A" },
+	};
+	for (int i = 0; i < sizeof(narrowed) / sizeof(*narrowed); ++i)
+	{
+		TestActorQueryCount(index, narrowed[i][0], &matches);
+		TestActorQueryCount(index, narrowed[i][1], &scanned);
+		
+		if (sb_count(matches) != sb_count(scanned)
+			|| memcmp(matches, scanned, sb_count(matches) * sizeof(*matches))
+		)
+			Die("TestActorQuery: '%s' found %d actors, '%s' found %d"
+				, narrowed[i][0], sb_count(matches), narrowed[i][1], sb_count(scanned)
+			);
+	}
+	if (TestActorQueryCount(index, "id == 0x000A && (params >> 5 & 0x7F) == 0x2F", &matches) != 2)
+		Die("TestActorQuery: expected 2 matches, found %d", sb_count(matches));
+	
+	// errors say where they happened
+	const char *errors[][2] = {
+		{ "id == ", "expression ends early at column 7" },
+		{ "id === 1", "unexpected '=' at column 6" },
+		{ "(id == 1", "expected ')' at column 9" },
+		{ "id == 1 2", "unexpected '2' at column 9" },
+		{ "params & nope", "unknown name 'nope' at column 10" },
+		{ "id == 12ab", "bad number at column 7" },
+	};
+	for (int i = 0; i < sizeof(errors) / sizeof(*errors); ++i)
+	{
+		const char *error = ActorQueryRun(index, errors[i][0], &matches);
+		
+		if (!error || strcmp(error, errors[i][1]))
+			Die("TestActorQuery: '%s' gave error '%s', expected '%s'", errors[i][0], error ? error : "(none)", errors[i][1]);
+	}
+	ActorQueryIndexFree(index);
+	
+	// a room outside the rom is skipped, and its neighbours still read;
+	// a room list longer than its scene gives up on that scene alone
+	{
+		struct Project project = { .type = PROJECT_TYPE_ROM, .file = FileNew("TestActorQuery", 0x1000) };
+		uint8_t *data = project.file->data;
+		const uint32_t rooms[3][2] = { { 0x200, 0x240 }, { 0x300, 0x9000 }, { 0x400, 0x440 } };
+		const struct ActorQueryStats *stats;
+		
+		#define W32(OFS, V) for (int k = 0; k < 4; ++k) data[(OFS) + k] = (uint32_t)(V) >> (24 - k * 8);
+		W32(0x100, 0x04030000) W32(0x104, 0x02000020) W32(0x108, 0x14000000)
+		W32(0x180, 0x04280000) W32(0x184, 0x02000020) W32(0x188, 0x14000000)
+		for (int i = 0; i < 3; ++i)
+		{
+			W32(0x120 + i * 8, rooms[i][0])
+			W32(0x124 + i * 8, rooms[i][1])
+			if (rooms[i][1] > project.file->size)
+				continue;
+			W32(rooms[i][0], 0x01010000) W32(rooms[i][0] + 4, 0x03000010) W32(rooms[i][0] + 8, 0x14000000)
+			W32(rooms[i][0] + 0x10, 0x000A0000 | i) W32(rooms[i][0] + 0x1c, 0x00002F << 5)
+		}
+		#undef W32
+		sb_push(project.scenes, ((struct ProjectScene){ .startAddress = 0x100, .endAddress = 0x140 }));
+		sb_push(project.scenes, ((struct ProjectScene){ .startAddress = 0x180, .endAddress = 0x1c0 }));
+		
+		index = ActorQueryIndexNew(&project, 2);
+		stats = ActorQueryIndexGetStats(index);
+		TEST_EXPECT(stats->numScenes == 2 && stats->numFailed == 1);
+		TEST_EXPECT(stats->numRooms == 3 && stats->numRoomsFailed == 1);
+		TEST_EXPECT(TestActorQueryCount(index, "id == 0x000A", &matches) == 2);
+		TEST_EXPECT(matches[0].room == 0 && matches[1].room == 2);
+		
+		ActorQueryIndexFree(index);
+		sb_free(project.scenes);
+		FileFree(project.file);
+	}
+	
+	sb_free(matches);
+	sb_free(scanned);
+	LogDebug("TestActorQuery passed");
 }
 
 void Testz64convertScene(char **scenePath)
@@ -855,3 +1058,1184 @@ void TestFast64toScene(const char *scenePath)
 	const char *error = Fast64_Compile(scenePath);
 	if (error) Die("error: %s", error);
 }
+
+// compiles the scene fast64 exported to 'root' (test/fast64, a cut-down
+// decomp tree) with the native compiler, and compares the scene and room
+// byte for byte against the binaries in its expected/ folder, which were
+// checked field by field against the sources, the f3dex2 encodings, and
+// the z64ovl.ld layout
+void TestFast64Compile(const char *root)
+{
+	const char *outputs[] = { "test_scene.zscene", "test_room_0.zmap" };
+	sb_array(char *, filenames);
+	sb_array(char *, sourcePaths);
+	char mips64 = *gIni.path.mips64;
+	const char *error;
+	char path[1024];
+	
+	snprintf(path, sizeof(path), "%s/assets/scenes/test", root);
+	filenames = FileListFromDirectory(path, 0, true, false, false);
+	sourcePaths = FileListFilterBy(filenames, ".c", 0);
+	
+	// no falling back to mips64-gcc, that would hide what's being tested
+	*gIni.path.mips64 = '\0';
+	error = Fast64_CompileSceneAndRooms(root, sourcePaths);
+	*gIni.path.mips64 = mips64;
+	FileListFree(sourcePaths);
+	FileListFree(filenames);
+	if (error)
+		Die("%s: %s", __func__, error);
+	
+	for (int i = 0; i < sizeof(outputs) / sizeof(*outputs); ++i)
+	{
+		struct File *got = FileFromFilename(ExePath(QuickFmt(WHERE_TMP "%s", outputs[i])));
+		struct File *want;
+		
+		snprintf(path, sizeof(path), "%s/expected/%s", root, outputs[i]);
+		want = FileFromFilename(path);
+		
+		if (got->size != want->size)
+			Die("%s: '%s' is 0x%X bytes, expected 0x%X", __func__
+				, outputs[i], (int)got->size, (int)want->size
+			);
+		
+		for (size_t k = 0; k < want->size; ++k)
+			if (((uint8_t*)got->data)[k] != ((uint8_t*)want->data)[k])
+				Die("%s: '%s' differs at 0x%X, 0x%02X instead of 0x%02X", __func__
+					, outputs[i], (int)k, ((uint8_t*)got->data)[k], ((uint8_t*)want->data)[k]
+				);
+		
+		FileFree(got);
+		FileFree(want);
+	}
+	
+	LogDebug("TestFast64Compile passed");
+}
+
+void TestJournal(void)
+{
+	struct Instance inst = { .id = 0x0010, .params = 0xffff };
+	struct Instance original;
+	struct JournalStats stats;
+	size_t watchSize = offsetof(struct Instance, limbOverrides);
+	
+	JournalClear();
+	JournalWatch(&inst, watchSize);
+	JournalEndFrame(false);
+	original = inst;
+	
+	// a 100 frame gizmo drag coalesces into one step
+	for (int i = 0; i < 100; ++i)
+	{
+		JournalWatch(&inst, watchSize);
+		inst.pos.x += 1.5f;
+		inst.pos.z -= 0.5f;
+		JournalEndFrame(true);
+	}
+	JournalWatch(&inst, watchSize);
+	JournalEndFrame(false);
+	stats = JournalGetStats();
+	TEST_EXPECT(stats.numSteps == 1);
+	LogDebug("drag of %d frames: %d step, %d deltas, %d bytes (instance is %d bytes)"
+		, 100, stats.numSteps, stats.numDeltas, (int)stats.bytesUsed, (int)sizeof(inst)
+	);
+	TEST_EXPECT(stats.bytesUsed < sizeof(inst));
+	
+	// a single field edit
+	JournalWatch(&inst, watchSize);
+	inst.params = 0x0123;
+	JournalEndFrame(false);
+	stats = JournalGetStats();
+	TEST_EXPECT(stats.numSteps == 2 && stats.numDeltas == 2);
+	LogDebug("params edit: %d bytes", (int)stats.bytesUsed);
+	
+	// undo both, then redo both
+	TEST_EXPECT(JournalUndo() && inst.params == 0xffff && inst.pos.x == 150.0f);
+	TEST_EXPECT(JournalUndo() && !memcmp(&inst, &original, watchSize));
+	TEST_EXPECT(!JournalUndo());
+	TEST_EXPECT(JournalRedo() && inst.pos.x == 150.0f && inst.params == 0xffff);
+	TEST_EXPECT(JournalRedo() && inst.params == 0x0123);
+	TEST_EXPECT(!JournalRedo());
+	
+	// a new edit discards the redo history
+	TEST_EXPECT(JournalUndo());
+	JournalWatch(&inst, watchSize);
+	inst.yrot = 0x4000;
+	JournalEndFrame(false);
+	stats = JournalGetStats();
+	TEST_EXPECT(stats.numSteps == 2 && stats.numRedoable == 0);
+	
+	// memory changed behind the journal's back invalidates it
+	inst.yrot = 0;
+	TEST_EXPECT(!JournalUndo());
+	TEST_EXPECT(JournalGetStats().numSteps == 0);
+	
+	// history stays within budget, dropping the oldest steps
+	JournalClear();
+	JournalSetBudget(4096);
+	for (int i = 0; i < 1000; ++i)
+	{
+		JournalWatch(&inst, watchSize);
+		inst.params = i;
+		JournalEndFrame(false);
+	}
+	stats = JournalGetStats();
+	LogDebug("1000 edits: %d steps kept, %d evicted, %d/%d bytes"
+		, stats.numSteps, stats.numEvicted, (int)stats.bytesUsed, (int)stats.bytesBudget
+	);
+	TEST_EXPECT(stats.bytesUsed <= stats.bytesBudget);
+	TEST_EXPECT(stats.numEvicted > 0 && stats.numSteps + stats.numEvicted == 1000);
+	while (JournalUndo());
+	TEST_EXPECT(inst.params == 1000 - stats.numSteps - 1);
+	
+	JournalClear();
+	JournalSetBudget(JOURNAL_DEFAULT_BUDGET);
+	TEST_EXPECT(JournalGetStats().numEvicted == 0);
+	
+	// cutscene edits, nested lists included, are one step like any other
+	{
+		struct CutsceneOot *cs = CutsceneOotNew();
+		CsCmdOot misc = { .type = CS_CMD_OOT_MISC };
+		CsCmdOot cam = { .type = CS_CMD_OOT_CAM_EYE_SPLINE };
+		CsCmdOotCam camEntry = { .startFrame = 1 };
+		
+		sb_push(misc.misc, ((CsCmdOotMisc){ .type = 1, .endFrame = 10 }));
+		sb_push(camEntry.points, ((CutsceneCameraPoint){ .viewAngle = 45 }));
+		sb_push(cam.cam, camEntry);
+		sb_push(cs->commands, misc);
+		sb_push(cs->commands, cam);
+		
+		CutsceneOotWatch(cs, JournalWatch);
+		JournalEndFrame(false);
+		CutsceneOotWatch(cs, JournalWatch);
+		cs->frameCount = 300;
+		cs->commands[0].misc[0].endFrame = 20;
+		cs->commands[1].cam[0].points[0].pos.y = 100;
+		JournalEndFrame(false);
+		
+		stats = JournalGetStats();
+		TEST_EXPECT(stats.numSteps == 1 && stats.numDeltas == 3);
+		TEST_EXPECT(JournalUndo() && cs->frameCount == 0);
+		TEST_EXPECT(cs->commands[0].misc[0].endFrame == 10 && cs->commands[1].cam[0].points[0].pos.y == 0);
+		TEST_EXPECT(JournalRedo() && cs->frameCount == 300);
+		TEST_EXPECT(cs->commands[0].misc[0].endFrame == 20 && cs->commands[1].cam[0].points[0].pos.y == 100);
+		
+		JournalClear();
+		CutsceneOotFree(cs);
+	}
+	
+	LogDebug("TestJournal passed");
+}
+
+// measures a RaycastInstanceList/RefreshObjectStats style pass over a
+// large instance list, against the old layout that embedded SkelAnime
+void TestInstanceLayout(void)
+{
+	struct InstanceEmbeddedSkelAnime { struct Instance inst; SkelAnime skelanime; };
+	sb_array(struct Instance, list) = 0;
+	sb_array(struct InstanceEmbeddedSkelAnime, legacy) = 0;
+	const int numInstances = 5000;
+	const int numPasses = 500;
+	Vec3f point = { 100, 0, 100 };
+	clock_t start;
+	double secNew;
+	double secOld;
+	int hitsNew = 0;
+	int hitsOld = 0;
+	
+	srand(1234);
+	for (int i = 0; i < numInstances; ++i)
+	{
+		struct Instance inst = {
+			.id = rand() & 0x1ff,
+			.pos = { rand() % 4000 - 2000, rand() % 400, rand() % 4000 - 2000 },
+			.prev = INSTANCE_PREV_INIT,
+		};
+		
+		sb_push(list, inst);
+		sb_push(legacy, ((struct InstanceEmbeddedSkelAnime){ .inst = inst }));
+	}
+	
+	#define INSTANCE_PASS(INST, HITS) { \
+		float dx = (INST)->pos.x - point.x; \
+		float dy = (INST)->pos.y - point.y; \
+		float dz = (INST)->pos.z - point.z; \
+		if (dx * dx + dy * dy + dz * dz < 1000 * 1000 && (INST)->id != 0x0010) \
+			HITS += 1; \
+	}
+	
+	start = clock();
+	for (int i = 0; i < numPasses; ++i, point.x += 1)
+		sb_foreach(list, INSTANCE_PASS(each, hitsNew))
+	secNew = (double)(clock() - start) / CLOCKS_PER_SEC;
+	
+	point.x = 100;
+	start = clock();
+	for (int i = 0; i < numPasses; ++i, point.x += 1)
+		sb_foreach(legacy, INSTANCE_PASS(&each->inst, hitsOld))
+	secOld = (double)(clock() - start) / CLOCKS_PER_SEC;
+	
+	#undef INSTANCE_PASS
+	
+	if (hitsNew != hitsOld)
+		Die("TestInstanceLayout: results differ, %d vs %d", hitsNew, hitsOld);
+	
+	LogDebug("%d instances x %d passes, struct Instance is %d bytes (was %d)"
+		, numInstances, numPasses
+		, (int)sizeof(struct Instance), (int)sizeof(struct InstanceEmbeddedSkelAnime)
+	);
+	LogDebug("split layout: %.3f ms/pass", secNew * 1000 / numPasses);
+	LogDebug("embedded layout: %.3f ms/pass (%.2fx slower)"
+		, secOld * 1000 / numPasses, secOld / (secNew > 0 ? secNew : 1e-9)
+	);
+	
+	sb_free(list);
+	sb_free(legacy);
+}
+
+#define TEST_INSTANCE_THREADS 8
+#define TEST_INSTANCE_PER_THREAD 20000
+
+static void *TestInstanceThreadsWorker(void *udata)
+{
+	uint32_t *uuids = udata;
+	
+	for (int i = 0; i < TEST_INSTANCE_PER_THREAD; ++i)
+	{
+		struct Instance inst = { .prev = INSTANCE_PREV_INIT };
+		
+		uuids[i] = inst.prev.uuid;
+		
+		// every other one is kept, so the table grows while in use
+		InstanceGetSkelAnime(&inst)->limbCount = 1;
+		if (i & 1)
+			InstanceFreeCold(&inst);
+	}
+	
+	return 0;
+}
+
+static int TestInstanceThreadsCompare(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+	
+	return (x > y) - (x < y);
+}
+
+// instances made on several threads at once get unique uuids,
+// and their cold data survives other threads growing the table
+void TestInstanceThreads(void)
+{
+	uint32_t *uuids = Calloc(TEST_INSTANCE_THREADS * TEST_INSTANCE_PER_THREAD, sizeof(*uuids));
+	pthread_t threads[TEST_INSTANCE_THREADS];
+	int count = TEST_INSTANCE_THREADS * TEST_INSTANCE_PER_THREAD;
+	
+	for (int i = 0; i < TEST_INSTANCE_THREADS; ++i)
+		if (pthread_create(&threads[i], 0, TestInstanceThreadsWorker, uuids + i * TEST_INSTANCE_PER_THREAD))
+			Die("failed to create worker thread");
+	for (int i = 0; i < TEST_INSTANCE_THREADS; ++i)
+		pthread_join(threads[i], 0);
+	
+	// the ones kept are still there, the others are gone
+	for (int i = 0; i < count; ++i)
+	{
+		struct Instance inst = { .prev = INSTANCE_PREV_INIT_UUID(uuids[i]) };
+		
+		TEST_EXPECT(InstanceGetSkelAnime(&inst)->limbCount == !(i & 1));
+		InstanceFreeCold(&inst);
+	}
+	
+	qsort(uuids, count, sizeof(*uuids), TestInstanceThreadsCompare);
+	for (int i = 1; i < count; ++i)
+		TEST_EXPECT(uuids[i] != uuids[i - 1]);
+	
+	free(uuids);
+	LogDebug("TestInstanceThreads passed");
+}
+
+#undef TEST_INSTANCE_THREADS
+#undef TEST_INSTANCE_PER_THREAD
+
+static uint32_t TestObjectScanSignature(const struct Object *object)
+{
+	uint32_t signature = 0x811C9DC5;
+	
+	#define SIGN(X) signature = (signature ^ (X)) * 0x01000193;
+	sb_foreach(object->skeletons, { SIGN(each->segAddr) SIGN(each->limbCount) })
+	sb_foreach(object->animations, { SIGN(each->segAddr) SIGN(each->numFrames) })
+	sb_foreach(object->meshes, { SIGN(each->segAddr) })
+	#undef SIGN
+	
+	return signature;
+}
+
+// loads each zobj once, returning the time spent in ObjectFromFile()
+// and a signature of what was found in each, for comparing passes
+static double TestObjectScanPass(sb_array(char *, zobjs), sb_array(uint32_t, *signatures))
+{
+	clock_t elapsed = 0;
+	
+	sb_clear(*signatures);
+	sb_foreach(zobjs, {
+		struct File *file = FileFromFilename(*each);
+		struct Object *object;
+		clock_t start;
+		
+		start = clock();
+		object = ObjectFromFile(file, 0x06);
+		elapsed += clock() - start;
+		
+		sb_push(*signatures, TestObjectScanSignature(object));
+		
+		ObjectFree(object);
+	})
+	
+	return (double)elapsed * 1000 / CLOCKS_PER_SEC;
+}
+
+// measures object scanning throughput over every zobj in a project,
+// then again with the object index cold and warm (results must match)
+void TestObjectScan(const char *projectPath)
+{
+	struct Project *project = TestProjectNew(projectPath);
+	sb_array(char *, zobjs) = 0;
+	sb_array(uint32_t, expected) = 0;
+	sb_array(uint32_t, signatures) = 0;
+	const char *indexPath = "bin/TestObjectScan.idx";
+	size_t totalBytes = 0;
+	double msScan;
+	double msCold;
+	double msWarm;
+	double mib;
+	
+	sb_foreach(project->foldersObject, {
+		sb_array(char *, files) = FileListFromDirectory(*each, 1, true, false, false);
+		sb_array(char *, filtered) = FileListFilterBy(files, ".zobj", 0);
+		
+		sb_foreach(filtered, {
+			struct File *file = FileFromFilename(*each);
+			totalBytes += file->size;
+			sb_push(zobjs, Strdup(*each));
+			FileFree(file);
+		})
+		
+		FileListFree(filtered);
+		FileListFree(files);
+	})
+	mib = (double)totalBytes / (1024 * 1024);
+	
+	msScan = TestObjectScanPass(zobjs, &expected);
+	
+	remove(indexPath);
+	ObjectIndexOpen(indexPath);
+	msCold = TestObjectScanPass(zobjs, &signatures);
+	ObjectIndexClose();
+	
+	ObjectIndexOpen(indexPath);
+	msWarm = TestObjectScanPass(zobjs, &signatures);
+	ObjectIndexClose();
+	remove(indexPath);
+	
+	sb_foreach(signatures, {
+		if (*each != expected[eachIndex])
+			Die("TestObjectScan: indexed results differ for '%s'", zobjs[eachIndex]);
+	})
+	
+	LogDebug("%d objects, %.2f mib", sb_count(zobjs), mib);
+	LogDebug("scan: %.2f ms (%.1f mib/s)", msScan, mib / (msScan > 0 ? msScan / 1000 : 1e-9));
+	LogDebug("index cold: %.2f ms", msCold);
+	LogDebug("index warm: %.2f ms (%.1fx faster than scanning)", msWarm, msScan / (msWarm > 0 ? msWarm : 1e-9));
+	
+	sb_foreach(zobjs, { free(*each); })
+	sb_free(zobjs);
+	sb_free(expected);
+	sb_free(signatures);
+	ProjectFree(project);
+}
+
+// resident set size in bytes, or 0 where that is not available
+static size_t TestResidentBytes(void)
+{
+	size_t pages = 0;
+	
+	#ifdef __linux__
+		FILE *fp = fopen("/proc/self/statm", "r");
+		
+		if (!fp)
+			return 0;
+		if (fscanf(fp, "%*u %zu", &pages) != 1)
+			pages = 0;
+		fclose(fp);
+		pages *= sysconf(_SC_PAGESIZE);
+	#endif
+	
+	return pages;
+}
+
+// opens and closes every scene in a project a few times, to see what
+// loading costs in blob allocations, and whether memory creeps upward
+void TestSceneLoadUnload(const char *projectPath)
+{
+	struct Project *project = TestProjectNew(projectPath);
+	const int numPasses = 4;
+	size_t startBytes = TestResidentBytes();
+	
+	for (int pass = 0; pass < numPasses; ++pass)
+	{
+		struct DataBlobAllocCounts before;
+		struct DataBlobAllocCounts after;
+		clock_t start = clock();
+		int numScenes = 0;
+		
+		DataBlobGetAllocCounts(&before);
+		sb_foreach(project->scenes, {
+			if (!each->filename)
+				continue;
+			SceneFree(SceneFromFilenamePredictRooms(each->filename));
+			numScenes += 1;
+		})
+		DataBlobGetAllocCounts(&after);
+		
+		#define DELTA(X) (after.X - before.X)
+		LogDebug("pass %d: %d scenes in %.2f ms, rss %.2f mib (%+.2f mib)"
+			, pass
+			, numScenes
+			, (double)(clock() - start) * 1000 / CLOCKS_PER_SEC
+			, (double)TestResidentBytes() / (1024 * 1024)
+			, ((double)TestResidentBytes() - startBytes) / (1024 * 1024)
+		);
+		LogDebug(" - %d blobs, %d ref arrays carved from %d arena blocks"
+			, DELTA(arenaBlobs), DELTA(arenaRefArrays), DELTA(arenaBlocks)
+		);
+		LogDebug(" - %d blobs, %d ref array allocations on the heap"
+			, DELTA(heapBlobs), DELTA(heapRefArrays)
+		);
+		#undef DELTA
+	}
+	
+	ProjectFree(project);
+	LogDebug("TestSceneLoadUnload passed");
+}
+
+// flattens synthetic room display lists, checking what gets inlined,
+// dropped and kept, and that lists which can't be flattened aren't
+void TestMeshCache(void)
+{
+	static uint8_t sceneData[] = {
+		/* 0x00 */ 0xFB, 0x00, 0x00, 0x00, 0x55, 0x66, 0x77, 0x88, // gDPSetEnvColor
+		/* 0x08 */ 0xDF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // gSPEndDisplayList
+	};
+	static uint8_t roomData[] = {
+		/* 0x00 */ 0xFB, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, // gDPSetEnvColor
+		/* 0x08 */ 0xDE, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x40, // gSPDisplayList to room
+		/* 0x10 */ 0xDE, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, // gSPDisplayList to texanim
+		/* 0x18 */ 0xFB, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, // kept, texanim could change it
+		/* 0x20 */ 0xFB, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, // dropped
+		/* 0x28 */ 0xDE, 0x01, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, // gSPBranchList to scene
+		/* 0x30 */ 0xE7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // never reached
+		/* 0x38 */ 0xDF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* 0x40 */ 0xFB, 0x00, 0x00, 0x00, 0x11, 0x22, 0x33, 0x44, // dropped
+		/* 0x48 */ 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // gSPCullDisplayList, dropped
+		/* 0x50 */ 0x01, 0x00, 0x10, 0x02, 0x03, 0x00, 0x01, 0x00, // gSPVertex
+		/* 0x58 */ 0xDF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		/* 0x60 */ 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // gSPBranchLessZ
+		/* 0x68 */ 0xDF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	};
+	static const int expected[] = { 0x00, 0x50, 0x10, 0x18, -1, 0x38 }; // -1 = scene 0x00
+	struct File sceneFile = { .data = sceneData, .dataEnd = sceneData + sizeof(sceneData), .size = sizeof(sceneData) };
+	struct File roomFile = { .data = roomData, .dataEnd = roomData + sizeof(roomData), .size = sizeof(roomData) };
+	struct Room room = { .file = &roomFile };
+	const uint8_t *flattened = MeshCacheGet(&room, &sceneFile, 0x03000000);
+	
+	if (!flattened)
+		Die("TestMeshCache: list wasn't flattened");
+	for (int i = 0; i < (int)(sizeof(expected) / sizeof(*expected)); ++i)
+	{
+		const uint8_t *want = expected[i] < 0 ? sceneData : roomData + expected[i];
+		
+		if (memcmp(flattened + i * 8, want, 8))
+			Die("TestMeshCache: command %d differs", i);
+	}
+	if (flattened[0x10 + 1] != 0x00)
+		Die("TestMeshCache: texanim call isn't a call");
+	
+	if (MeshCacheGet(&room, &sceneFile, 0x03000000) != flattened)
+		Die("TestMeshCache: list was rebuilt without being invalidated");
+	MeshCacheInvalidateAll();
+	if (!(flattened = MeshCacheGet(&room, &sceneFile, 0x03000000)) || flattened[0] != 0xFB)
+		Die("TestMeshCache: list wasn't rebuilt after invalidating");
+	
+	if (MeshCacheGet(&room, &sceneFile, 0x03000060)
+		|| MeshCacheGet(&room, &sceneFile, 0x03001000)
+	)
+		Die("TestMeshCache: flattened a list that can't be");
+	
+	MeshCacheFree(room.meshCache);
+	LogDebug("TestMeshCache passed");
+}
+
+// four rooms in a row along x joined by doorways, plus a fifth beside
+// the first, in view but only joined to the last, out of sight
+void TestRoomVisibility(void)
+{
+	struct Scene scene = { 0 };
+	struct SceneHeader header = { 0 };
+	struct DataBlob blobs[5];
+	uint8_t vertices[5][2][16] = { 0 };
+	const int boxes[5][2][3] = {
+		{ {    0, 0, -500 }, { 1000, 400,  500 } },
+		{ { 1000, 0, -500 }, { 2000, 400,  500 } },
+		{ { 2000, 0, -500 }, { 3000, 400,  500 } },
+		{ { 3000, 0, -500 }, { 4000, 400,  500 } },
+		{ {  500, 0,  600 }, { 1000, 400, 1600 } },
+	};
+	const struct { Vec3f pos; uint16_t yrot; int front; int back; } doorways[] = {
+		{ { 1000, 0,   0 }, 0x4000, 0, 1 },
+		{ { 2000, 0,   0 }, 0x4000, 1, 2 },
+		{ { 3000, 0,   0 }, 0x4000, 2, 3 },
+		{ { 3500, 0, 550 }, 0x0000, 3, 4 },
+	};
+	const struct { Vec3f eye; Vec3f at; const char *expected; } views[] = {
+		{ {   100, 150, 0 }, {  1000, 150, 0 }, "11110" }, // down the row
+		{ {   900, 150, 0 }, { -1000, 150, 0 }, "10000" }, // back at the wall
+		{ { -5000, 150, 0 }, {     0, 150, 0 }, "11111" }, // from outside
+	};
+	
+	for (int i = 0; i < 5; ++i)
+	{
+		struct Room *room = sb_add(scene.rooms, 1);
+		
+		for (int k = 0; k < 2; ++k)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				vertices[i][k][j * 2 + 0] = boxes[i][k][j] >> 8;
+				vertices[i][k][j * 2 + 1] = boxes[i][k][j];
+			}
+		}
+		
+		blobs[i] = (struct DataBlob){ .refData = vertices[i], .sizeBytes = sizeof(vertices[i]), .type = DATA_BLOB_TYPE_VERTEX };
+		*room = (struct Room){ .file = FileNew("TestRoomVisibility", 0x10), .blobs = &blobs[i] };
+	}
+	
+	for (int i = 0; i < (int)(sizeof(doorways) / sizeof(*doorways)); ++i)
+	{
+		struct Instance *inst = sb_add(header.doorways, 1);
+		
+		*inst = (struct Instance){ .pos = doorways[i].pos, .yrot = doorways[i].yrot };
+		inst->doorway.frontRoom = doorways[i].front;
+		inst->doorway.backRoom = doorways[i].back;
+	}
+	
+	for (int i = 0; i < (int)(sizeof(views) / sizeof(*views)); ++i)
+	{
+		Matrix proj;
+		Matrix view;
+		Matrix projView;
+		const bool *isVisible;
+		
+		Matrix_Projection(&proj, 90, 1, 10, 12800, 1);
+		Matrix_LookAt(&view, views[i].eye, views[i].at, (Vec3f){ 0, 1, 0 });
+		Matrix_MtxFMtxFMult(&proj, &view, &projView);
+		isVisible = RoomVisCompute(&scene, &header, views[i].eye, &projView);
+		
+		for (int k = 0; k < 5; ++k)
+			if (isVisible[k] != (views[i].expected[k] == '1'))
+				Die("TestRoomVisibility: view %d room %d is %s", i, k, isVisible[k] ? "visible" : "hidden");
+	}
+	
+	sb_foreach(scene.rooms, {
+		FileFree(each->file);
+		RoomVisFree(each->vis);
+	});
+	sb_free(scene.rooms);
+	sb_free(header.doorways);
+	LogDebug("TestRoomVisibility passed");
+}
+
+// animates many instances of a synthetic skeleton, checking the decoded
+// and vectorized path against a direct big-endian evaluation
+void TestSkelAnime(void)
+{
+	const int numLimbs = 21;
+	const int numFrames = 40;
+	const int limit = 5;
+	const int numInstances = 64;
+	const int numUpdates = 2000;
+	const int numValues = (numLimbs + 1) * 3;
+	struct File *file = FileNew("TestSkelAnime", 0x10000);
+	uint8_t *data = file->data;
+	struct Object object = { .file = file, .segment = 0x06 };
+	struct ObjectSkeleton skeleton = { .limbAddrsSegAddr = 0x06000100, .limbCount = numLimbs };
+	struct ObjectAnimation animation = {
+		.object = &object,
+		.numFrames = numFrames,
+		.rotIndexSegAddr = 0x06001000,
+		.rotValSegAddr = 0x06002000,
+		.limit = limit,
+	};
+	sb_array(SkelAnime, instances) = 0;
+	clock_t start;
+	double sec;
+	
+	#define W16(OFS, V) { data[OFS] = (V) >> 8; data[(OFS) + 1] = (V); }
+	srand(1234);
+	for (int i = 0; i < numValues; ++i)
+		W16(0x1000 + i * 2, i % 4 ? limit + (i * numFrames) % (numLimbs * numFrames * 3) : i % limit)
+	for (int i = 0; i < 0x4000; ++i)
+		W16(0x2000 + i * 2, rand())
+	#undef W16
+	
+	for (int i = 0; i < numInstances; ++i)
+	{
+		SkelAnime *skelanime = sb_add(instances, 1);
+		
+		memset(skelanime, 0, sizeof(*skelanime));
+		SkelAnime_Init(skelanime, &object, &skeleton, &animation);
+		skelanime->playSpeed = (i & 1) ? -0.5f - i * 0.01f : 0.5f + i * 0.01f;
+	}
+	
+	// compare against the formula applied to the raw object data
+	for (int n = 0; n < 200; ++n)
+	{
+		SkelAnime *skelanime = &instances[n % numInstances];
+		float frame;
+		int a;
+		int b;
+		float weight;
+		
+		SkelAnime_Update(skelanime, 0.37 * n);
+		frame = skelanime->prevFrame;
+		a = floor(frame);
+		b = wrapf(signbit(skelanime->curFrame) ? a - 1 : a + 1, 0, numFrames - 1);
+		weight = signbit(skelanime->curFrame) ? 1.0 - fmod(frame, 1.0f) : fmod(frame, 1.0f);
+		
+		for (int i = 0; i < numValues; ++i)
+		{
+			int index = u16r(data + 0x1000 + i * 2);
+			int16_t valueA = u16r(data + 0x2000 + (index + (index >= limit ? a : 0)) * 2);
+			int16_t valueB = u16r(data + 0x2000 + (index + (index >= limit ? b : 0)) * 2);
+			int16_t diff = valueB - valueA;
+			int16_t expected = weight < 1.0f ? (s16)(diff * weight) + valueA : valueB;
+			
+			if (((int16_t*)skelanime->jointTable)[i] != expected)
+				Die("TestSkelAnime: frame %f value %d is %d, expected %d"
+					, frame, i, ((int16_t*)skelanime->jointTable)[i], expected
+				);
+		}
+	}
+	
+	// instances in step share a pose within a frame, but not across frames
+	SkelAnime_NewFrame();
+	instances[1] = instances[0];
+	SkelAnime_Update(&instances[0], 0.37);
+	SkelAnime_Update(&instances[1], 0.37);
+	if (!instances[0].pose
+		|| instances[0].pose != instances[1].pose
+		|| memcmp(instances[0].jointTable, instances[1].jointTable, numValues * sizeof(int16_t))
+	)
+		Die("TestSkelAnime: instances on the same frame don't share a pose");
+	SkelAnime_NewFrame();
+	SkelAnime_Update(&instances[1], 0.37);
+	if (instances[1].poseFrame == instances[0].poseFrame)
+		Die("TestSkelAnime: pose outlived its frame");
+	
+	start = clock();
+	for (int n = 0; n < numUpdates; ++n)
+	{
+		SkelAnime_NewFrame();
+		sb_foreach(instances, { SkelAnime_Update(each, 0.37); })
+	}
+	sec = (double)(clock() - start) / CLOCKS_PER_SEC;
+	
+	LogDebug("%d instances x %d updates, %.1f ns per update"
+		, numInstances, numUpdates, sec * 1e9 / (numInstances * numUpdates)
+	);
+	
+	free(animation.frames);
+	sb_free(instances);
+	FileFree(file);
+}
+
+// saves a group of files, then checks that failed and interrupted
+// saves leave the previous set of files untouched
+void TestFileSave(void)
+{
+	const int numFiles = 12;
+	char names[12][2048];
+	char extra[2048];
+	char backup[2048];
+	char journal[2048];
+	struct FileSaveGroup *group;
+	struct File *file = FileNew("TestFileSave", 0x40000);
+	struct File *check;
+	clock_t start;
+	
+	for (int i = 0; i < numFiles; ++i)
+		snprintf(names[i], sizeof(names[i]), "%s", ExePath(WHERE_TMP "TestFileSave"));
+	for (int i = 0; i < numFiles; ++i)
+		sprintf(names[i] + strlen(names[i]), "_%d.bin", i);
+	snprintf(extra, sizeof(extra), "%s", ExePath(WHERE_TMP "TestFileSave_missing/x.bin"));
+	snprintf(backup, sizeof(backup), "%s" FILE_SAVE_BACKUP_SUFFIX, names[0]);
+	snprintf(journal, sizeof(journal), "%s", ExePath(WHERE_TMP FILE_SAVE_JOURNAL_FILENAME));
+	
+	// a full save, contents tagged with the index
+	start = clock();
+	group = FileSaveGroupNew();
+	for (int i = 0; i < numFiles; ++i)
+	{
+		memset(file->data, i, file->size);
+		FileSaveGroupAdd(group, file, names[i]);
+	}
+	TEST_EXPECT(FileSaveGroupCommit(group) == EXIT_SUCCESS);
+	LogDebug("saved %d files of %d bytes in %.2f ms"
+		, numFiles, (int)file->size, (double)(clock() - start) * 1000 / CLOCKS_PER_SEC
+	);
+	for (int i = 0; i < numFiles; ++i)
+	{
+		check = FileFromFilename(names[i]);
+		TEST_EXPECT(check->size == file->size && ((uint8_t*)check->data)[file->size - 1] == i);
+		FileFree(check);
+	}
+	TEST_EXPECT(!FileExists(backup));
+	TEST_EXPECT(!FileExists(journal));
+	
+	// one unwritable file means nothing is written
+	group = FileSaveGroupNew();
+	memset(file->data, 0xee, file->size);
+	FileSaveGroupAdd(group, file, names[0]);
+	FileSaveGroupAdd(group, file, extra);
+	TEST_EXPECT(FileSaveGroupCommit(group) == EXIT_FAILURE);
+	LogDebug("failed save reported: %s", FileGetError());
+	check = FileFromFilename(names[0]);
+	TEST_EXPECT(((uint8_t*)check->data)[0] == 0);
+	FileFree(check);
+	
+	// a save interrupted after replacing the first file is rolled back
+	TEST_EXPECT(!rename(names[0], backup));
+	FileToFilename(file, names[0]);
+	{
+		FILE *fp = fopen(journal, "w");
+		
+		TEST_EXPECT(fp);
+		fprintf(fp, "z64scene-save 1\n1 %s\n1 %s\nend\n", names[0], names[1]);
+		fclose(fp);
+	}
+	TEST_EXPECT(FileSaveGroupRecover(names[1]));
+	check = FileFromFilename(names[0]);
+	TEST_EXPECT(((uint8_t*)check->data)[0] == 0);
+	FileFree(check);
+	check = FileFromFilename(names[1]);
+	TEST_EXPECT(((uint8_t*)check->data)[0] == 1);
+	FileFree(check);
+	TEST_EXPECT(!FileExists(backup));
+	TEST_EXPECT(!FileExists(journal));
+	TEST_EXPECT(!FileSaveGroupRecover(names[1]));
+	
+	// contents in pieces, some borrowed, more than one vectored write takes
+	{
+		sb_array(struct FileSpan, spans) = 0;
+		const int numSpans = 3000;
+		
+		for (int i = 0; i < (int)file->size; ++i)
+			((uint8_t*)file->data)[i] = i * 7;
+		for (int i = 0; i < numSpans; ++i)
+			sb_push(spans, ((struct FileSpan){ ((uint8_t*)file->data) + i * 4, 4, i & 1 }));
+		
+		group = FileSaveGroupNew();
+		FileSaveGroupAddSpans(group, spans, numSpans, names[0]);
+		memset(file->data, 0xee, file->size / 2); // only the borrowed pieces should see this
+		TEST_EXPECT(FileSaveGroupCommit(group) == EXIT_SUCCESS);
+		check = FileFromFilename(names[0]);
+		TEST_EXPECT(check->size == numSpans * 4);
+		for (int i = 0; i < numSpans * 4; ++i)
+			TEST_EXPECT(((uint8_t*)check->data)[i] == (((i / 4) & 1) ? 0xee : (uint8_t)(i * 7)));
+		FileFree(check);
+		sb_free(spans);
+	}
+	
+	for (int i = 0; i < numFiles; ++i)
+		remove(names[i]);
+	FileFree(file);
+	LogDebug("TestFileSave passed");
+}
+
+// patches a synthetic rom with one file shrinking in place and one
+// growing, checking the file table and that nothing else was touched
+void TestRomPatch(void)
+{
+	const char *romPath = ExePath(WHERE_TMP "TestRomPatch.z64");
+	const uint32_t tableStart = 0x10000;
+	const uint32_t tableEnd = 0x10100;
+	const uint32_t codeStart = 0x20000;
+	const uint32_t codeEnd = 0x100000;
+	const uint32_t sceneTable = 0x30000;
+	const uint32_t decoy = 0x40000;
+	const uint32_t otherScenes = 0x200000;
+	const uint32_t sceneStart = 0x300000;
+	const uint32_t roomStart = 0x301000;
+	const uint32_t roomEnd = 0x302000;
+	const uint32_t lastEnd = 0x303000;
+	struct File *rom = FileNew("TestRomPatch", 0x400000);
+	struct File *scene = FileNew("scene", 0x1400);
+	struct File *room = FileNew("room", 0x1800);
+	struct File *check;
+	struct RomPatch *patch;
+	uint8_t *data = rom->data;
+	const uint8_t *checkData;
+	uint32_t sceneMovedStart;
+	uint32_t sceneMovedEnd;
+	uint32_t roomMovedStart;
+	uint32_t roomMovedEnd;
+	int numDma = 0;
+	
+	#define W32(OFS, V) for (int k = 0; k < 4; ++k) data[(OFS) + k] = (uint32_t)(V) >> (24 - k * 8);
+	#define DMA(START, END) W32(tableStart + numDma * 16, START) W32(tableStart + numDma * 16 + 4, END) \
+		W32(tableStart + numDma * 16 + 8, START) numDma += 1;
+	
+	// header, then code and files in the decompressed layout; the last
+	// file ends in bytes that look like the padding after it
+	srand(1234);
+	W32(0, 0x80371240)
+	for (uint32_t i = 0x40; i < lastEnd - 0x100; ++i)
+		data[i] = (i >= tableStart && i < tableEnd) ? 0 : rand() | 1;
+	W32(tableStart, 0)
+	W32(tableStart + 4, 0x1060)
+	numDma = 1;
+	DMA(0x1060, tableStart)
+	DMA(tableStart, tableEnd)
+	DMA(codeStart, codeEnd)
+	for (int i = 0; i < 3; ++i)
+	{
+		DMA(otherScenes + i * 0x1000, otherScenes + (i + 1) * 0x1000)
+	}
+	DMA(sceneStart, roomStart)
+	DMA(roomStart, roomEnd)
+	DMA(roomEnd, lastEnd)
+	
+	// the scene table, oot layout, and words in code that only look like references
+	for (int i = 0; i < 3; ++i)
+	{
+		W32(sceneTable + i * 0x14, otherScenes + i * 0x1000)
+		W32(sceneTable + i * 0x14 + 4, otherScenes + (i + 1) * 0x1000)
+	}
+	W32(sceneTable + 3 * 0x14, sceneStart)
+	W32(sceneTable + 3 * 0x14 + 4, roomStart)
+	W32(decoy, sceneStart)
+	W32(decoy + 4, roomStart)
+	W32(decoy + 0x10, roomStart)
+	W32(decoy + 0x14, roomEnd)
+	#undef DMA
+	#undef W32
+	FileToFilename(rom, romPath);
+	
+	// nothing could load a file the file table doesn't list
+	TEST_EXPECT((patch = RomPatchNew(romPath)));
+	TEST_EXPECT(RomPatchAddFile(patch, 0, 0, room) == 0);
+	TEST_EXPECT(RomPatchPlan(patch) != EXIT_SUCCESS && strstr(FileGetError(), "new to the rom"));
+	RomPatchFree(patch);
+	TEST_EXPECT((patch = RomPatchNew(romPath)));
+	TEST_EXPECT(RomPatchAddFile(patch, decoy, decoy + 0x100, room) == 0);
+	TEST_EXPECT(RomPatchPlan(patch) != EXIT_SUCCESS && strstr(FileGetError(), "not in the file table"));
+	RomPatchFree(patch);
+	
+	// both files outgrow their ranges
+	memset(scene->data, 0xaa, scene->size);
+	memset(room->data, 0xbb, room->size);
+	TEST_EXPECT((patch = RomPatchNew(romPath)));
+	TEST_EXPECT(RomPatchAddFile(patch, sceneStart, roomStart, scene) == 0);
+	TEST_EXPECT(RomPatchAddFile(patch, roomStart, roomEnd, room) == 1);
+	TEST_EXPECT(RomPatchPlan(patch) == EXIT_SUCCESS);
+	RomPatchGetRange(patch, 0, &sceneMovedStart, &sceneMovedEnd);
+	RomPatchGetRange(patch, 1, &roomMovedStart, &roomMovedEnd);
+	TEST_EXPECT(sceneMovedStart >= lastEnd && sceneMovedEnd - sceneMovedStart == scene->size);
+	TEST_EXPECT(roomMovedStart >= lastEnd && roomMovedEnd - roomMovedStart == room->size);
+	TEST_EXPECT(RomPatchCommit(patch) == EXIT_SUCCESS);
+	
+	check = FileFromFilename(romPath);
+	checkData = check->data;
+	TEST_EXPECT(check->size == rom->size);
+	TEST_EXPECT(u32r(checkData + tableStart + 7 * 16 + 0) == sceneMovedStart);
+	TEST_EXPECT(u32r(checkData + tableStart + 7 * 16 + 4) == sceneMovedEnd);
+	TEST_EXPECT(u32r(checkData + tableStart + 7 * 16 + 8) == sceneMovedStart);
+	TEST_EXPECT(u32r(checkData + tableStart + 7 * 16 + 12) == 0);
+	TEST_EXPECT(u32r(checkData + tableStart + 8 * 16 + 0) == roomMovedStart);
+	TEST_EXPECT(u32r(checkData + tableStart + 8 * 16 + 4) == roomMovedEnd);
+	TEST_EXPECT(u32r(checkData + tableStart + 8 * 16 + 8) == roomMovedStart);
+	TEST_EXPECT(u32r(checkData + sceneTable + 3 * 0x14) == sceneMovedStart);
+	TEST_EXPECT(u32r(checkData + sceneTable + 3 * 0x14 + 4) == sceneMovedEnd);
+	TEST_EXPECT(!memcmp(checkData + sceneMovedStart, scene->data, scene->size));
+	TEST_EXPECT(!memcmp(checkData + roomMovedStart, room->data, room->size));
+	TEST_EXPECT(!memcmp(checkData + roomEnd, data + roomEnd, lastEnd - roomEnd));
+	TEST_EXPECT(!memcmp(checkData, data, tableStart));
+	TEST_EXPECT(!memcmp(checkData + tableStart + 9 * 16, data + tableStart + 9 * 16, sceneTable + 3 * 0x14 - tableStart - 9 * 16));
+	TEST_EXPECT(!memcmp(checkData + sceneTable + 4 * 0x14, data + sceneTable + 4 * 0x14, sceneStart - sceneTable - 4 * 0x14));
+	
+	FileFree(check);
+	FileFree(scene);
+	FileFree(room);
+	FileFree(rom);
+	remove(romPath);
+	LogDebug("TestRomPatch passed");
+}
+
+// extracts a synthetic rom holding one scene with two rooms, and checks
+// that files which aren't roms are turned away with a reason, not a crash
+void TestProjectExtract(void)
+{
+	const uint32_t sceneStart = 0x1000;
+	const uint32_t sceneEnd = 0x1040;
+	const uint32_t roomStart[2] = { 0x2000, 0x2100 };
+	const uint32_t roomEnd[2] = { 0x2080, 0x2140 };
+	struct File *rom = FileNew("TestProjectExtract", 0x4000);
+	struct File *check;
+	uint8_t *data = rom->data;
+	char romPath[1024];
+	char badPath[1024];
+	char outFolder[1024];
+	const char *error;
+	int numScenes = -1;
+	
+	snprintf(romPath, sizeof(romPath), "%s", ExePath(WHERE_TMP "TestProjectExtract.z64"));
+	snprintf(badPath, sizeof(badPath), "%s", ExePath(WHERE_TMP "TestProjectExtract_bad.z64"));
+	snprintf(outFolder, sizeof(outFolder), "%s", ExePath(WHERE_TMP "TestProjectExtract"));
+	
+	#define W32(OFS, V) for (int k = 0; k < 4; ++k) data[(OFS) + k] = (uint32_t)(V) >> (24 - k * 8);
+	
+	// the scene header has a room list, and the rooms start with headers
+	W32(0, 0x80371240)
+	W32(sceneStart, 0x15000000)
+	W32(sceneStart + 0x08, 0x04020000)
+	W32(sceneStart + 0x0c, 0x02000020)
+	W32(sceneStart + 0x10, 0x14000000)
+	for (int i = 0; i < 2; ++i)
+	{
+		W32(sceneStart + 0x20 + i * 8, roomStart[i])
+		W32(sceneStart + 0x24 + i * 8, roomEnd[i])
+		W32(roomStart[i], 0x16000000)
+		for (uint32_t k = roomStart[i] + 8; k < roomEnd[i]; ++k)
+			data[k] = k * (i + 3);
+	}
+	
+	// and something refers to the scene, like the scene table does
+	W32(0x800, sceneStart)
+	W32(0x804, sceneEnd)
+	#undef W32
+	FileToFilename(rom, romPath);
+	
+	// not there, and not a rom, both say why
+	remove(badPath);
+	error = ProjectExtractScenesFromFilename(badPath, outFolder, 1, &numScenes);
+	TEST_EXPECT(error && strstr(error, "not found") && numScenes == 0);
+	memset(rom->data, 0, 4);
+	FileToFilename(rom, badPath);
+	memcpy(rom->data, "\x80\x37\x12\x40", 4);
+	error = ProjectExtractScenesFromFilename(badPath, outFolder, 1, &numScenes);
+	TEST_EXPECT(error && strstr(error, "not a big endian") && numScenes == 0);
+	
+	// the rooms come out exactly as they are in the rom
+	error = ProjectExtractScenesFromFilename(romPath, outFolder, 2, &numScenes);
+	TEST_EXPECT(!error && numScenes == 1);
+	check = FileFromFilename(QuickFmt("%s/scene/0/scene.zscene", outFolder));
+	TEST_EXPECT(check->size == sceneEnd - sceneStart && !memcmp(check->data, data + sceneStart, check->size));
+	FileFree(check);
+	for (int i = 0; i < 2; ++i)
+	{
+		check = FileFromFilename(QuickFmt("%s/scene/0/room_%d.zmap", outFolder, i));
+		TEST_EXPECT(check->size == roomEnd[i] - roomStart[i] && !memcmp(check->data, data + roomStart[i], check->size));
+		FileFree(check);
+	}
+	TEST_EXPECT(FileExists(QuickFmt("%s/manifest.json", outFolder)));
+	
+	FileFree(rom);
+	remove(romPath);
+	remove(badPath);
+	LogDebug("TestProjectExtract passed");
+}
+
+// profiles saving a scene, checking the dry run estimated the
+// same file sizes the real save went on to write
+void TestSceneWriteProfile(const char *scenePath)
+{
+	const char *outPath = ExePath(WHERE_TMP "TestSceneWriteProfile.zscene");
+	struct Scene *scene = SceneFromFilenamePredictRooms(scenePath);
+	struct SceneWriteStats estimate = {0};
+	struct SceneWriteStats saved = {0};
+	
+	SceneEstimateSizes(scene, &estimate);
+	
+	SceneWriterSetStats(&saved);
+	SceneToFilename(scene, outPath);
+	SceneWriterSetStats(0);
+	SceneWriteStatsLog(&saved);
+	
+	LogDebug("estimated in %.3f ms, saved in %.3f ms"
+		, estimate.seconds * 1000
+		, (saved.seconds + saved.commitSeconds) * 1000
+	);
+	if (estimate.sceneSize != saved.sceneSize)
+		Die("TestSceneWriteProfile: scene estimated 0x%x bytes, wrote 0x%x", estimate.sceneSize, saved.sceneSize);
+	if (sb_count(estimate.roomSizes) != sb_count(saved.roomSizes))
+		Die("TestSceneWriteProfile: estimated %d rooms, wrote %d", sb_count(estimate.roomSizes), sb_count(saved.roomSizes));
+	sb_foreach(saved.roomSizes, {
+		if (estimate.roomSizes[eachIndex] != *each)
+			Die("TestSceneWriteProfile: room %d estimated 0x%x bytes, wrote 0x%x", eachIndex, estimate.roomSizes[eachIndex], *each);
+	})
+	LogDebug("room memory 0x%x, was 0x%x", SceneRoomMemory(scene, saved.roomSizes), SceneRoomMemory(scene, 0));
+	
+	SceneWriteStatsFree(&estimate);
+	SceneWriteStatsFree(&saved);
+	SceneFree(scene);
+	SceneWriterCleanup();
+	LogDebug("TestSceneWriteProfile passed");
+}
+
+static double TestSceneWriteJobsSave(struct Scene *scene, const char *outPath, int jobs, sb_array(char *, *filenames))
+{
+	struct SceneWriteStats stats = {0};
+	double seconds;
+	
+	SceneWriterSetJobs(jobs);
+	SceneWriterSetStats(&stats);
+	SceneToFilename(scene, outPath);
+	SceneWriterSetStats(0);
+	SceneWriterSetJobs(0);
+	seconds = stats.seconds;
+	SceneWriteStatsFree(&stats);
+	
+	sb_push(*filenames, Strdup(scene->file->filename));
+	sb_foreach_named(scene->rooms, room, {
+		sb_push(*filenames, Strdup(room->file->filename));
+	})
+	
+	return seconds;
+}
+
+void TestSceneWriteJobs(const char *scenePath)
+{
+	struct Scene *scene = SceneFromFilenamePredictRooms(scenePath);
+	sb_array(char *, sequential) = 0;
+	sb_array(char *, parallel) = 0;
+	double sequentialSeconds;
+	double parallelSeconds;
+	
+	sequentialSeconds = TestSceneWriteJobsSave(scene, ExePath(WHERE_TMP "TestSceneWriteJobs_seq.zscene"), 1, &sequential);
+	parallelSeconds = TestSceneWriteJobsSave(scene, ExePath(WHERE_TMP "TestSceneWriteJobs_par.zscene"), 0, &parallel);
+	
+	LogDebug("serialized %d rooms in %.3f ms on one thread, %.3f ms in parallel"
+		, sb_count(scene->rooms)
+		, sequentialSeconds * 1000
+		, parallelSeconds * 1000
+	);
+	
+	// the files must match byte for byte, whichever thread wrote them
+	sb_foreach(sequential, {
+		struct File *a = FileFromFilename(*each);
+		struct File *b = FileFromFilename(parallel[eachIndex]);
+		
+		if (a->size != b->size || memcmp(a->data, b->data, a->size))
+			Die("TestSceneWriteJobs: '%s' differs from '%s'", parallel[eachIndex], *each);
+		
+		FileFree(a);
+		FileFree(b);
+		free(*each);
+		free(parallel[eachIndex]);
+	})
+	
+	sb_free(sequential);
+	sb_free(parallel);
+	SceneFree(scene);
+	SceneWriterCleanup();
+	LogDebug("TestSceneWriteJobs passed");
+}
+
+// the files written from spans must match byte for byte the ones
+// written the old way, with every blob copied into one buffer first
+void TestSceneWriteSpans(const char *scenePath)
+{
+	struct Scene *scene = SceneFromFilenamePredictRooms(scenePath);
+	sb_array(char *, spans) = 0;
+	sb_array(char *, copies) = 0;
+	
+	SceneWriterSetBorrowing(false);
+	TestSceneWriteJobsSave(scene, ExePath(WHERE_TMP "TestSceneWriteSpans_copy.zscene"), 1, &copies);
+	SceneWriterSetBorrowing(true);
+	TestSceneWriteJobsSave(scene, ExePath(WHERE_TMP "TestSceneWriteSpans_span.zscene"), 0, &spans);
+	
+	sb_foreach(copies, {
+		struct File *a = FileFromFilename(*each);
+		struct File *b = FileFromFilename(spans[eachIndex]);
+		
+		if (a->size != b->size)
+			Die("TestSceneWriteSpans: '%s' is 0x%x bytes, '%s' is 0x%x", spans[eachIndex], (uint32_t)b->size, *each, (uint32_t)a->size);
+		for (uint32_t i = 0; i < a->size; ++i)
+			if (((uint8_t*)a->data)[i] != ((uint8_t*)b->data)[i])
+				Die("TestSceneWriteSpans: '%s' differs from '%s' at 0x%x", spans[eachIndex], *each, i);
+		
+		FileFree(a);
+		FileFree(b);
+		free(*each);
+		free(spans[eachIndex]);
+	})
+	
+	sb_free(spans);
+	sb_free(copies);
+	SceneFree(scene);
+	SceneWriterCleanup();
+	LogDebug("TestSceneWriteSpans passed");
+}
+
+// opening a second scene must leave the first one's segments, flipbook
+// textures included, as they were, so it still saves the same as before;
+// one scene is from oot and the other from mm, so the first must also
+// keep packing its actors its own way
+void TestSceneContexts(const char *pathA, const char *pathB)
+{
+	struct Scene *a = SceneFromFilenamePredictRooms(pathA);
+	struct Scene *b;
+	sb_array(char *, before) = 0;
+	sb_array(char *, after) = 0;
+	
+	TestSceneWriteJobsSave(a, ExePath(WHERE_TMP "TestSceneContexts_before.zscene"), 1, &before);
+	b = SceneFromFilenamePredictRooms(pathB);
+	
+	if (a->blobContext == b->blobContext)
+		Die("TestSceneContexts: scenes share a context");
+	if (a->isMm == b->isMm)
+		Die("TestSceneContexts: expected one oot scene and one mm scene, both are %s", a->isMm ? "mm" : "oot");
+	
+	sb_foreach_named(a->headers, header, {
+		sb_foreach_named(header->mm.sceneSetupData, material, {
+			int segment = ABS_ALT(material->segment) + 7;
+			
+			if (material->datablob != DataBlobListFindBlobWithOriginalSegmentAddress(
+				DataBlobContextGetHead(a->blobContext, segment)
+				, segment << 24
+			))
+				Die("TestSceneContexts: lost segment 0x%02x", segment);
+		})
+	})
+	
+	TestSceneWriteJobsSave(a, ExePath(WHERE_TMP "TestSceneContexts_after.zscene"), 1, &after);
+	
+	sb_foreach(before, {
+		struct File *x = FileFromFilename(*each);
+		struct File *y = FileFromFilename(after[eachIndex]);
+		
+		if (x->size != y->size || memcmp(x->data, y->data, x->size))
+			Die("TestSceneContexts: '%s' differs from '%s'", after[eachIndex], *each);
+		
+		FileFree(x);
+		FileFree(y);
+		free(*each);
+		free(after[eachIndex]);
+	})
+	
+	sb_free(before);
+	sb_free(after);
+	SceneFree(b);
+	SceneFree(a);
+	SceneWriterCleanup();
+	LogDebug("TestSceneContexts passed");
+}
@@ -11,7 +11,24 @@ void Testz64convertScene(char **scenePath);
 void Testz64convertObject(char **objectPath);
 void TestAnalyzeSceneActors(struct Scene *scene, const char *logFilename);
 void TestSaveLoadCycles(const char *filename);
-void TestForEachActor(const char *filename);
+void TestForEachActor(const char *filename, const char *expression);
+void TestActorQuery(void);
 void TestSwapFunction(void);
 void TestSceneMigrate(const char *dstPath, const char *srcPath, const char *outPath);
 void TestFast64toScene(const char *scenePath);
+void TestFast64Compile(const char *root);
+void TestJournal(void);
+void TestInstanceLayout(void);
+void TestInstanceThreads(void);
+void TestObjectScan(const char *projectPath);
+void TestSceneLoadUnload(const char *projectPath);
+void TestMeshCache(void);
+void TestRoomVisibility(void);
+void TestSkelAnime(void);
+void TestFileSave(void);
+void TestRomPatch(void);
+void TestProjectExtract(void);
+void TestSceneWriteProfile(const char *scenePath);
+void TestSceneWriteJobs(const char *scenePath);
+void TestSceneWriteSpans(const char *scenePath);
+void TestSceneContexts(const char *pathA, const char *pathB);
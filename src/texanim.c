@@ -10,6 +10,7 @@
 
 #include <n64.h>
 #include <stdio.h>
+#include <assert.h>
 
 #define GRAPH_ALLOC n64_graph_alloc
 #define Gfx GbiGfx
@@ -224,25 +225,83 @@ static int32_t AnimatedMat_Lerp(int32_t min, int32_t max, float norm) {
 	return (int32_t)((max - min) * norm) + min;
 }
 
+/**
+ * Evaluates the colors of an interpolated color animation at the given frame.
+ */
+typedef void (*AnimatedMatColorEvalFunc)(AnimatedMatColorParams* colorAnimParams, int32_t curFrame,
+	F3DPrimColor* primColorResult, F3DEnvColor* envColorResult
+);
+
+/**
+ * Hashes everything an interpolated color animation's colors depend on.
+ */
+static uint32_t AnimatedMat_HashColorParams(AnimatedMatColorParams* colorAnimParams, AnimatedMatColorEvalFunc eval) {
+	uint32_t hash = 2166136261u; // fnv-1a
+	bool hasEnvColors = colorAnimParams->envColors != NULL;
+	
+	#define HASH_BYTES(DATA, SIZE) \
+		for (uint32_t i = 0; i < (SIZE); ++i) \
+			hash = (hash ^ ((const uint8_t*)(DATA))[i]) * 16777619u;
+	HASH_BYTES(&eval, sizeof(eval))
+	HASH_BYTES(&colorAnimParams->durationFrames, sizeof(colorAnimParams->durationFrames))
+	HASH_BYTES(&colorAnimParams->keyFrameCount, sizeof(colorAnimParams->keyFrameCount))
+	HASH_BYTES(&hasEnvColors, sizeof(hasEnvColors))
+	HASH_BYTES(colorAnimParams->primColors, sb_count(colorAnimParams->primColors) * sizeof(*colorAnimParams->primColors))
+	HASH_BYTES(colorAnimParams->envColors, sb_count(colorAnimParams->envColors) * sizeof(*colorAnimParams->envColors))
+	HASH_BYTES(colorAnimParams->keyFrames, sb_count(colorAnimParams->keyFrames) * sizeof(*colorAnimParams->keyFrames))
+	#undef HASH_BYTES
+	
+	return hash;
+}
+
+/**
+ * Draws an interpolated color animation from a table of every frame's colors.
+ * The colors only depend on the frame, so each one is evaluated once, and
+ * again only after the keys are loaded or edited.
+ */
+static void AnimatedMat_DrawColorTable(int32_t segment, AnimatedMatColorParams* colorAnimParams, AnimatedMatColorEvalFunc eval) {
+	if (!colorAnimParams->durationFrames) return;
+	int32_t curFrame = (uint32_t)sMatAnimStep % colorAnimParams->durationFrames;
+	uint32_t hash = AnimatedMat_HashColorParams(colorAnimParams, eval);
+	
+	if (colorAnimParams->primTable == NULL || colorAnimParams->tableHash != hash) {
+		sb_clear(colorAnimParams->primTable);
+		sb_clear(colorAnimParams->envTable);
+		memset(sb_add(colorAnimParams->primTable, colorAnimParams->durationFrames), 0,
+			colorAnimParams->durationFrames * sizeof(*colorAnimParams->primTable)
+		);
+		memset(sb_add(colorAnimParams->envTable, colorAnimParams->durationFrames), 0,
+			colorAnimParams->durationFrames * sizeof(*colorAnimParams->envTable)
+		);
+		
+		for (int32_t i = 0; i < colorAnimParams->durationFrames; i++) {
+			eval(colorAnimParams, i, &colorAnimParams->primTable[i], &colorAnimParams->envTable[i]);
+		}
+		
+		colorAnimParams->tableHash = hash;
+	}
+	
+	AnimatedMat_SetColor(segment, &colorAnimParams->primTable[curFrame],
+		(colorAnimParams->envColors != NULL) ? &colorAnimParams->envTable[curFrame] : NULL
+	);
+}
+
 /**
  * Animated Material Type 3:
  * Color key frame animation with linear interpolation.
  */
-static void AnimatedMat_DrawColorLerp(int32_t segment, void* params) {
-	AnimatedMatColorParams* colorAnimParams = (AnimatedMatColorParams*)params;
-	if (!colorAnimParams->durationFrames) return;
+static void AnimatedMat_EvalColorLerp(AnimatedMatColorParams* colorAnimParams, int32_t curFrame,
+	F3DPrimColor* primColorResult, F3DEnvColor* envColorResult
+) {
 	F3DPrimColor* primColorMax = Lib_SegmentedToVirtual(colorAnimParams->primColors);
 	F3DEnvColor* envColorMax;
 	uint16_t* keyFrames = Lib_SegmentedToVirtual(colorAnimParams->keyFrames);
-	int32_t curFrame = (uint32_t)sMatAnimStep % colorAnimParams->durationFrames;
 	int32_t endFrame;
 	int32_t relativeFrame; // relative to the start frame
 	int32_t startFrame;
 	float norm;
 	F3DPrimColor* primColorMin;
-	F3DPrimColor primColorResult;
 	F3DEnvColor* envColorMin;
-	F3DEnvColor envColorResult;
 	int32_t i;
 	
 	keyFrames++;
@@ -263,25 +322,25 @@ static void AnimatedMat_DrawColorLerp(int32_t segment, void* params) {
 	
 	primColorMax += i;
 	primColorMin = primColorMax - 1;
-	primColorResult.r = AnimatedMat_Lerp(primColorMin->r, primColorMax->r, norm);
-	primColorResult.g = AnimatedMat_Lerp(primColorMin->g, primColorMax->g, norm);
-	primColorResult.b = AnimatedMat_Lerp(primColorMin->b, primColorMax->b, norm);
-	primColorResult.a = AnimatedMat_Lerp(primColorMin->a, primColorMax->a, norm);
-	primColorResult.lodFrac = AnimatedMat_Lerp(primColorMin->lodFrac, primColorMax->lodFrac, norm);
+	primColorResult->r = AnimatedMat_Lerp(primColorMin->r, primColorMax->r, norm);
+	primColorResult->g = AnimatedMat_Lerp(primColorMin->g, primColorMax->g, norm);
+	primColorResult->b = AnimatedMat_Lerp(primColorMin->b, primColorMax->b, norm);
+	primColorResult->a = AnimatedMat_Lerp(primColorMin->a, primColorMax->a, norm);
+	primColorResult->lodFrac = AnimatedMat_Lerp(primColorMin->lodFrac, primColorMax->lodFrac, norm);
 	
 	if (colorAnimParams->envColors) {
 		envColorMax = Lib_SegmentedToVirtual(colorAnimParams->envColors);
 		envColorMax += i;
 		envColorMin = envColorMax - 1;
-		envColorResult.r = AnimatedMat_Lerp(envColorMin->r, envColorMax->r, norm);
-		envColorResult.g = AnimatedMat_Lerp(envColorMin->g, envColorMax->g, norm);
-		envColorResult.b = AnimatedMat_Lerp(envColorMin->b, envColorMax->b, norm);
-		envColorResult.a = AnimatedMat_Lerp(envColorMin->a, envColorMax->a, norm);
-	} else {
-		envColorMax = NULL;
+		envColorResult->r = AnimatedMat_Lerp(envColorMin->r, envColorMax->r, norm);
+		envColorResult->g = AnimatedMat_Lerp(envColorMin->g, envColorMax->g, norm);
+		envColorResult->b = AnimatedMat_Lerp(envColorMin->b, envColorMax->b, norm);
+		envColorResult->a = AnimatedMat_Lerp(envColorMin->a, envColorMax->a, norm);
 	}
-	
-	AnimatedMat_SetColor(segment, &primColorResult, (envColorMax != NULL) ? &envColorResult : NULL);
+}
+
+static void AnimatedMat_DrawColorLerp(int32_t segment, void* params) {
+	AnimatedMat_DrawColorTable(segment, (AnimatedMatColorParams*)params, AnimatedMat_EvalColorLerp);
 }
 
 /**
@@ -342,15 +401,13 @@ static uint8_t Scene_LagrangeInterpColor(int32_t n, float x[], float fx[], float
  * Animated Material Type 4:
  * Color key frame animation with non-linear interpolation.
  */
-static void AnimatedMat_DrawColorNonLinearInterp(int32_t segment, void* params) {
-	AnimatedMatColorParams* colorAnimParams = (AnimatedMatColorParams*)params;
-	if (!colorAnimParams->durationFrames) return;
+static void AnimatedMat_EvalColorNonLinearInterp(AnimatedMatColorParams* colorAnimParams, int32_t frame,
+	F3DPrimColor* primColorResult, F3DEnvColor* envColorResult
+) {
 	F3DPrimColor* primColorCur = Lib_SegmentedToVirtual(colorAnimParams->primColors);
 	F3DEnvColor* envColorCur = Lib_SegmentedToVirtual(colorAnimParams->envColors);
 	uint16_t* keyFrames = Lib_SegmentedToVirtual(colorAnimParams->keyFrames);
-	float curFrame = (uint32_t)sMatAnimStep % colorAnimParams->durationFrames;
-	F3DPrimColor primColorResult;
-	F3DEnvColor envColorResult;
+	float curFrame = frame;
 	float x[50];
 	float fxPrimR[50];
 	float fxPrimG[50];
@@ -405,23 +462,22 @@ static void AnimatedMat_DrawColorNonLinearInterp(int32_t segment, void* params)
 		xPtr++;
 	}
 	
-	primColorResult.r = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimR, curFrame);
-	primColorResult.g = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimG, curFrame);
-	primColorResult.b = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimB, curFrame);
-	primColorResult.a = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimA, curFrame);
-	primColorResult.lodFrac = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimLodFrac, curFrame);
+	primColorResult->r = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimR, curFrame);
+	primColorResult->g = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimG, curFrame);
+	primColorResult->b = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimB, curFrame);
+	primColorResult->a = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimA, curFrame);
+	primColorResult->lodFrac = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxPrimLodFrac, curFrame);
 	
 	if (colorAnimParams->envColors != NULL) {
-		envColorCur = Lib_SegmentedToVirtual(colorAnimParams->envColors);
-		envColorResult.r = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvR, curFrame);
-		envColorResult.g = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvG, curFrame);
-		envColorResult.b = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvB, curFrame);
-		envColorResult.a = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvA, curFrame);
-	} else {
-		envColorCur = NULL;
+		envColorResult->r = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvR, curFrame);
+		envColorResult->g = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvG, curFrame);
+		envColorResult->b = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvB, curFrame);
+		envColorResult->a = Scene_LagrangeInterpColor(colorAnimParams->keyFrameCount, x, fxEnvA, curFrame);
 	}
-	
-	AnimatedMat_SetColor(segment, &primColorResult, (envColorCur != NULL) ? &envColorResult : NULL);
+}
+
+static void AnimatedMat_DrawColorNonLinearInterp(int32_t segment, void* params) {
+	AnimatedMat_DrawColorTable(segment, (AnimatedMatColorParams*)params, AnimatedMat_EvalColorNonLinearInterp);
 }
 
 /**
@@ -989,6 +1045,67 @@ void TexAnimSetupSceneMM(int which, AnimatedMaterial *sceneMaterialAnims)
 	sceneDrawConfigHandlers[which]();
 }
 
+/**
+ * The most commands TexAnimSetupSceneMM() writes into either list,
+ * not counting the end of the list.
+ */
+static int TexAnimCountSceneMM(int which, AnimatedMaterial *sceneMaterialAnims)
+{
+	// the draw configs' own commands: the default display list and its
+	// seven segments, the unused configs' segments and colors, config 5's
+	// render mode and color, and great bay temple's color segment
+	static const int numOwnGfx[] = { 8, 0, 0, 5, 3, 2, 1, 0 };
+	static const bool drawsMatAnims[] = { false, true, false, false, false, true, true, true };
+	AnimatedMaterial *matAnim = sceneMaterialAnims;
+	int numGfx = numOwnGfx[which];
+	
+	if (!drawsMatAnims[which] || !sb_count(matAnim) || matAnim->segment == 0)
+		return numGfx;
+	
+	// the same walk as AnimatedMat_DrawMain(); each type it has a handler
+	// for sets one segment per list, the [OOT] ones aren't drawn
+	for (int i = 0; i < sb_count(sceneMaterialAnims); ++i, ++matAnim)
+	{
+		if (matAnim->type <= AnimatedMatType_DoNothing)
+			numGfx += 1;
+		
+		if (matAnim->segment < 0)
+			break;
+	}
+	
+	return numGfx;
+}
+
+/**
+ * Executes the current scene draw config handler into display lists of its own,
+ * so it's only evaluated once per frame however many rooms are drawn.
+ */
+void TexAnimRecordSceneMM(int which, AnimatedMaterial *sceneMaterialAnims, GbiGfx **opa, GbiGfx **xlu)
+{
+	int numGfx = TexAnimCountSceneMM(which, sceneMaterialAnims) + 1; // and the end
+	Gfx *opaGfx = GRAPH_ALLOC(numGfx * sizeof(Gfx));
+	Gfx *xluGfx = GRAPH_ALLOC(numGfx * sizeof(Gfx));
+	typeof(POLY_OPA_DISP) opaHead = POLY_OPA_DISP;
+	typeof(POLY_XLU_DISP) xluHead = POLY_XLU_DISP;
+	
+	POLY_OPA_DISP = opaGfx;
+	POLY_XLU_DISP = xluGfx;
+	
+	TexAnimSetupSceneMM(which, sceneMaterialAnims);
+	
+	gSPEndDisplayList(POLY_OPA_DISP++);
+	gSPEndDisplayList(POLY_XLU_DISP++);
+	
+	assert(POLY_OPA_DISP - opaGfx <= numGfx);
+	assert(POLY_XLU_DISP - xluGfx <= numGfx);
+	
+	POLY_OPA_DISP = opaHead;
+	POLY_XLU_DISP = xluHead;
+	
+	*opa = opaGfx;
+	*xlu = xluGfx;
+}
+
 void TexAnimSetGameplayFrames(float frames)
 {
 	sGameplayFrames = frames;
@@ -1554,6 +1671,8 @@ void AnimatedMaterialFree(AnimatedMaterial *each)
 			sb_free(params->envColors);
 			sb_free(params->keyFrames);
 			sb_free(params->durationEachKey);
+			sb_free(params->primTable);
+			sb_free(params->envTable);
 			
 			break;
 		}
@@ -82,6 +82,11 @@ typedef struct {
 	/* 0x8 */ sb_array(F3DEnvColor, envColors);
 	/* 0xC */ sb_array(uint16_t, keyFrames);
 	sb_array(uint16_t, durationEachKey);
+	
+	// every frame's interpolated colors, rebuilt when the keys change
+	sb_array(F3DPrimColor, primTable);
+	sb_array(F3DEnvColor, envTable);
+	uint32_t tableHash;
 } AnimatedMatColorParams; // size = 0x10
 
 typedef struct {
@@ -290,6 +295,10 @@ void AnimatedMaterialToWorkblob(
 // Executes the current scene draw config handler.
 void TexAnimSetupSceneMM(int which, AnimatedMaterial *sceneMaterialAnims);
 
+// Executes the current scene draw config handler into display lists of its own,
+// which every room drawn this frame can then call instead of executing it again.
+void TexAnimRecordSceneMM(int which, AnimatedMaterial *sceneMaterialAnims, GbiGfx **opa, GbiGfx **xlu);
+
 // Draws an animated material to both OPA and XLU buffers.
 void AnimatedMat_Draw(AnimatedMaterial* matAnim);
 
@@ -8,6 +8,12 @@
 
 #include "toml-parsers.hpp"
 
+extern "C" {
+#include "actor-query.h"
+}
+
+extern "C" const char *ExePath(const char *path);
+
 const char *FindMatchingFile(const char *path, const char *defaultFilename)
 {
 	static char workbuf[1024];
@@ -267,3 +273,37 @@ void TomlInjectDataFromProject(Project *project, ActorDatabase *actorDb, ObjectD
 	TomlInjectActorsFromProject(project, actorDb);
 	TomlInjectObjectsFromProject(project, objectDb);
 }
+
+// names the bits of each actor's params and rotations, so queries can use them
+extern "C" void TomlActorQueryAddFields(struct ActorQueryIndex *index, Project *project)
+{
+	ActorDatabase actorDb;
+	ObjectDatabase objectDb;
+	char tomlPath[1024];
+	
+	snprintf(tomlPath, sizeof(tomlPath), "toml/game/%s/actors.toml", project->game);
+	if (FileExists(ExePath(tomlPath)))
+		actorDb = TomlLoadActorDatabase(tomlPath);
+	TomlInjectDataFromProject(project, &actorDb, &objectDb);
+	
+	for (uint32_t i = 0; i < actorDb.entries.size(); ++i)
+	{
+		for (auto &prop : actorDb.entries[i].properties)
+		{
+			if (!prop.target || !prop.name)
+				continue;
+			
+			enum ActorQueryTarget target =
+				!strcmp(prop.target, "XRot") ? ACTOR_QUERY_TARGET_XROT
+				: !strcmp(prop.target, "YRot") ? ACTOR_QUERY_TARGET_YROT
+				: !strcmp(prop.target, "ZRot") ? ACTOR_QUERY_TARGET_ZROT
+				: ACTOR_QUERY_TARGET_PARAMS
+			;
+			
+			if (target == ACTOR_QUERY_TARGET_PARAMS && strcmp(prop.target, "Var"))
+				continue;
+			
+			ActorQueryIndexAddField(index, i, prop.QuickSanitizedName(), target, prop.mask);
+		}
+	}
+}
@@ -20,6 +20,7 @@ extern "C" {
 #include "file.h"
 #include "rendercode.h"
 #include "object.h"
+#include "object-index.h"
 #include "logging.h"
 }
 
@@ -153,7 +154,7 @@ struct ActorDatabase
 		}
 		
 		const char *RenderCodeGen(
-			std::map<std::string, uint32_t> GetObjectSymbolAddresses(uint16_t objId)
+			const std::map<std::string, uint32_t> &GetObjectSymbolAddresses(uint16_t objId)
 		)
 		{
 			if (!rendercodeToml)
@@ -262,7 +263,7 @@ struct ActorDatabase
 			)");
 			for (int i = 0; i < objects.size(); ++i)
 			{
-				auto symbolAddresses = GetObjectSymbolAddresses(objects[i]);
+				const auto &symbolAddresses = GetObjectSymbolAddresses(objects[i]);
 				
 				for (const auto &sym : symbolAddresses)
 					STRCATF(buf, "%s { 0x%08x }\n", sym.first.c_str(), sym.second);
@@ -477,15 +478,32 @@ struct ObjectDatabase
 			if (FileExists(symsPath))
 			{
 				File *tmp = FileFromFilename(symsPath);
-				STRTOK_LOOP((char*)tmp->data, "\r\n\t =;") {
-					uint32_t v;
-					if (*next == '\0')
-						continue;
-					if (sscanf(next, "%x", &v) != 1)
-						continue;
-					symbolAddresses[each] = v;
-					*next = '\0'; // mark consumed
+				uint64_t hash = ObjectIndexIsOpen() ? ObjectIndexHash(tmp->data, tmp->size) : 0;
+				sb_array(struct ObjectIndexSym, indexed) = ObjectIndexFindSyms(hash, tmp->size);
+				
+				// tokenized in a previous session
+				if (indexed)
+				{
+					sb_foreach(indexed, { symbolAddresses[each->name] = each->value; })
 				}
+				else
+				{
+					STRTOK_LOOP((char*)tmp->data, "\r\n\t =;") {
+						uint32_t v;
+						if (*next == '\0')
+							continue;
+						if (sscanf(next, "%x", &v) != 1)
+							continue;
+						symbolAddresses[each] = v;
+						*next = '\0'; // mark consumed
+					}
+					
+					for (const auto &sym : symbolAddresses)
+						sb_push(indexed, ((struct ObjectIndexSym){ sym.first.c_str(), sym.second }));
+					ObjectIndexAddSyms(hash, tmp->size, indexed, sb_count(indexed));
+				}
+				
+				sb_free(indexed);
 				FileFree(tmp);
 			}
 			else
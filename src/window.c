@@ -23,6 +23,11 @@
 #include "rendercode.h"
 #include "z64convert.h"
 #include "fast64.h"
+#include "journal.h"
+#include "object-index.h"
+#include "mesh-cache.h"
+#include "room-vis.h"
+#include "cutscene.h"
 #include "incbin.h"
 #include <n64.h>
 #include <n64types.h>
@@ -340,12 +345,33 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 						gGui->selectedInstance = &sb_last(*(gGui->instanceList));
 					}
 					
+					JournalClear();
 					GuiPushModal("Inserted path point.");
 					GizmoSetupMove(gState.gizmo);
 				}
 			}
 			break;
 		
+		case GLFW_KEY_Z:
+			// Ctrl+Z to Undo, Ctrl+Shift+Z to Redo
+			if ((mods & GLFW_MOD_CONTROL)
+				&& SHORTCUT_CHECKS
+			) {
+				if (mods & GLFW_MOD_SHIFT)
+					WindowTryRedo(true);
+				else
+					WindowTryUndo(true);
+			}
+			break;
+		
+		case GLFW_KEY_Y:
+			// Ctrl+Y to Redo
+			if ((mods & GLFW_MOD_CONTROL)
+				&& SHORTCUT_CHECKS
+			)
+				WindowTryRedo(true);
+			break;
+		
 		case GLFW_KEY_X:
 			// Ctrl+X to Cut
 			if ((mods & GLFW_MOD_CONTROL)
@@ -654,6 +680,11 @@ void mtx_to_zmtx(Matrix* src, ZeldaMatrix* dest) {
 #define ARRAY_COUNT(X) (sizeof(X) / sizeof((X)[0]))
 #define CLOCK_TIME(hr, min) ((int32_t)(((hr) * 60 + (min)) * (float)0x10000 / (24 * 60) + 0.5f))
 
+// one entry per game minute, each blended at the start of its minute
+#define ENV_TABLE_SIZE (24 * 60)
+#define ENV_TABLE_TIME(INDEX) ((uint16_t)(((INDEX) * 0x10000 + ENV_TABLE_SIZE - 1) / ENV_TABLE_SIZE))
+#define ENV_TABLE_INDEX(TIME) (((uint32_t)(TIME) * ENV_TABLE_SIZE) >> 16)
+
 typedef struct {
 	/* 0x00 */ uint16_t startTime;
 	/* 0x02 */ uint16_t endTime;
@@ -725,39 +756,19 @@ static float Environment_LerpWeight(uint16_t max, uint16_t min, uint16_t val) {
 }
 
 // borrows from Environment_Update()
-static EnvLightSettings GetEnvironment(struct Scene *scene, struct GuiInterop *gui)
+static EnvLightSettings EnvironmentBlend(const EnvLightSettings *lights, int numLights, uint16_t skyboxTime)
 {
-	// quick gray background if no scene loaded
-	if (!scene)
-	{
-		EnvLightSettings tmp;
-		
-		memset(&tmp, 0x80, sizeof(tmp));
-		
-		return tmp;
-	}
-	
-	EnvLightSettings *lights = (void*)scene->headers[0].lights;
-	
-	if (gui->env.envPreviewMode == GUI_ENV_PREVIEW_EACH)
-		return lights[gui->env.envPreviewEach];
-		
-	// testing
-	// 0x8001 is noon
-	static uint16_t skyboxTime = 0x8001; // gSaveContext.skyboxTime
-	static uint16_t dayTime = 0x8001; // gSaveContext.dayTime
-	//const int speed = 100;
-	//skyboxTime += speed;
-	//dayTime += speed;
-	skyboxTime = gui->env.envPreviewTime;
-	dayTime = skyboxTime;
-	
+	uint16_t dayTime = skyboxTime; // gSaveContext.dayTime
 	int envLightConfig = 0; // envCtx->lightConfig
 	int envChangeLightNextConfig = 1; // envCtx->changeLightNextConfig
 	TimeBasedLightEntry *configs = sTimeBasedLightConfigs[envLightConfig];
-	EnvLightSettings *lightSettingsList = lights; // play->envCtx.lightSettingsList;
 	EnvLightSettings dst; // envCtx->lightSettings;
 	
+	// scenes with fewer settings than the configs expect reuse the last one
+	#define lightSettingsList(INDEX) lights[MIN(INDEX, numLights - 1)] // play->envCtx.lightSettingsList
+	
+	memset(&dst, 0, sizeof(dst));
+	
 	for (int i = 0; i < ARRAY_COUNT(*sTimeBasedLightConfigs); i++)
 	{
 		TimeBasedLightEntry config = configs[i];
@@ -768,10 +779,10 @@ static EnvLightSettings GetEnvironment(struct Scene *scene, struct GuiInterop *g
 			continue;
 		
 		TimeBasedLightEntry changeToConfig = sTimeBasedLightConfigs[envChangeLightNextConfig][i];
-		EnvLightSettings lightSetting = lightSettingsList[config.lightSetting];
-		EnvLightSettings nextLightSetting = lightSettingsList[config.nextLightSetting];
-		EnvLightSettings changeToNextLightSetting = lightSettingsList[changeToConfig.nextLightSetting];
-		EnvLightSettings changeToLightSetting = lightSettingsList[changeToConfig.lightSetting];
+		EnvLightSettings lightSetting = lightSettingsList(config.lightSetting);
+		EnvLightSettings nextLightSetting = lightSettingsList(config.nextLightSetting);
+		EnvLightSettings changeToNextLightSetting = lightSettingsList(changeToConfig.nextLightSetting);
+		EnvLightSettings changeToLightSetting = lightSettingsList(changeToConfig.lightSetting);
 		
 		uint8_t blend8[2];
 		int16_t blend16[2];
@@ -861,9 +872,59 @@ static EnvLightSettings GetEnvironment(struct Scene *scene, struct GuiInterop *g
 		break;
 	}
 	
+	#undef lightSettingsList
+	
 	return dst;
 }
 
+// the blended settings for every game minute, rebuilt when the scene's
+// lights change, so scrubbing through the day is only a lookup
+static const EnvLightSettings *GetEnvironmentTable(struct Scene *scene)
+{
+	static EnvLightSettings table[ENV_TABLE_SIZE];
+	static uint64_t tableHash;
+	static bool isValid;
+	const EnvLightSettings *lights = (void*)scene->headers[0].lights;
+	int numLights = sb_count(scene->headers[0].lights);
+	uint64_t hash = MemHash(lights, numLights * sizeof(*lights));
+	
+	if (isValid && hash == tableHash)
+		return table;
+	
+	for (int i = 0; i < ENV_TABLE_SIZE; i++)
+		table[i] = EnvironmentBlend(lights, numLights, ENV_TABLE_TIME(i));
+	
+	tableHash = hash;
+	isValid = true;
+	
+	return table;
+}
+
+static EnvLightSettings GetEnvironment(struct Scene *scene, struct GuiInterop *gui)
+{
+	EnvLightSettings tmp;
+	
+	memset(&tmp, 0x80, sizeof(tmp));
+	gui->env.envTable = 0;
+	
+	// quick gray background if no scene loaded
+	if (!scene || !sb_count(scene->headers[0].lights))
+		return tmp;
+	
+	EnvLightSettings *lights = (void*)scene->headers[0].lights;
+	
+	if (gui->env.envPreviewMode == GUI_ENV_PREVIEW_EACH)
+		return lights[gui->env.envPreviewEach];
+	
+	// 0x8001 is noon
+	const EnvLightSettings *table = GetEnvironmentTable(scene);
+	
+	gui->env.envTable = (const void*)table;
+	gui->env.envTableCount = ENV_TABLE_SIZE;
+	
+	return table[ENV_TABLE_INDEX(gui->env.envPreviewTime)];
+}
+
 #endif // day/night
 
 // test implementation for sun movement
@@ -932,6 +993,69 @@ static void SetupTextureViewerForObject(struct Object *obj)
 	(*gSceneP)->textureBlobs = texBlobs;
 }
 
+// every animation in the previewed object, played side by side
+static struct
+{
+	const struct Object *object;
+	const struct ObjectSkeleton *skeleton;
+	const struct ObjectAnimation *animations;
+	sb_array(SkelAnime, instances); // one per animation
+} gZobjAnimSheet;
+
+static void ZobjAnimSheetClear(void)
+{
+	sb_free(gZobjAnimSheet.instances);
+	sb_free(gGui->zobjAnimCostUsec);
+	memset(&gZobjAnimSheet, 0, sizeof(gZobjAnimSheet));
+}
+
+// updates and draws every animation on its own spot in a grid, timing
+// each one; the instances keep playing between frames, and are only
+// set up again when the object or skeleton changes
+static void DrawZobjAnimSheet(struct Object *obj, struct ObjectSkeleton *skel, float scale)
+{
+	int numAnims = sb_count(obj->animations);
+	int cols = ceilf(sqrtf(numAnims));
+	int rows = cols ? (numAnims + cols - 1) / cols : 0;
+	float spacing = gGui->zobjAnimSheetSpacing;
+	
+	if (gZobjAnimSheet.object != obj
+		|| gZobjAnimSheet.skeleton != skel
+		|| gZobjAnimSheet.animations != obj->animations
+		|| sb_count(gZobjAnimSheet.instances) != numAnims
+	)
+	{
+		ZobjAnimSheetClear();
+		gZobjAnimSheet.object = obj;
+		gZobjAnimSheet.skeleton = skel;
+		gZobjAnimSheet.animations = obj->animations;
+		memset(sb_add(gZobjAnimSheet.instances, numAnims), 0, numAnims * sizeof(SkelAnime));
+		memset(sb_add(gGui->zobjAnimCostUsec, numAnims), 0, numAnims * sizeof(float));
+		sb_foreach(gZobjAnimSheet.instances, {
+			SkelAnime_Init(each, obj, skel, &obj->animations[eachIndex]);
+		});
+	}
+	
+	sb_foreach(gZobjAnimSheet.instances, {
+		int col = eachIndex % cols;
+		int row = eachIndex / cols;
+		double start = glfwGetTime();
+		float *cost = &gGui->zobjAnimCostUsec[eachIndex];
+		float usec;
+		
+		Matrix_Translate((col - (cols - 1) * 0.5f) * spacing, 0, (row - (rows - 1) * 0.5f) * spacing, MTXMODE_NEW);
+		Matrix_Scale(scale, scale, scale, MTXMODE_APPLY);
+		gSPMatrix(POLY_OPA_DISP++, Matrix_NewMtxN64(), G_MTX_MODELVIEW | G_MTX_LOAD);
+		
+		SkelAnime_Update(each, gInput.delta_time_sec * (20.0)); // anims made for 20fps
+		SkelAnime_Draw(each, SKELANIME_TYPE_FLEX, 0);
+		
+		// smoothed, so it can be read while it plays
+		usec = (glfwGetTime() - start) * 1000000.0;
+		*cost = *cost ? *cost + (usec - *cost) * 0.05f : usec;
+	});
+}
+
 // binary config file with minimal lighting setup
 INCBIN(LevelLightingProfiles, "embed/levelLightingProfiles.bin");
 
@@ -966,6 +1090,7 @@ struct Scene *WindowOpenFile(const char *fn)
 		gGui->zobjCurrentDl = 0;
 		gGui->zobjCurrentSkel = 0;
 		gGui->zobjCurrentAnim = 0;
+		ZobjAnimSheetClear();
 		gGui->zobj = ObjectFromFilename(fn, 0);
 		struct Scene *scene = WindowLoadSceneExt(0, &todo, 0, 0x1C0); // TODO automatic size
 		SetupTextureViewerForObject(gGui->zobj);
@@ -982,6 +1107,16 @@ void WindowSaveScene(void)
 	if (!*gSceneP)
 		return;
 	
+	// scenes opened from a rom are patched back into it
+	if ((*gSceneP)->romFilename)
+	{
+		if (SceneToRom(*gSceneP, (*gSceneP)->romFilename))
+			GuiPushModal(QuickFmt("Failed to save scene to rom: %s", FileGetError()));
+		else
+			GuiPushModal("Saved scene and rooms to rom successfully.");
+		return;
+	}
+	
 	// overwrite loaded scene and rooms
 	SceneToFilename(*gSceneP, 0);
 	
@@ -1008,6 +1143,7 @@ void WindowSaveSceneAs(void)
 void WindowClearCache(void)
 {
 	n64_clear_cache();
+	MeshCacheInvalidateAll();
 }
 
 struct Scene *WindowLoadSceneExt(const char *fn, struct File *romFile, uint32_t romStart, uint32_t romEnd)
@@ -1035,6 +1171,7 @@ struct Scene *WindowLoadSceneExt(const char *fn, struct File *romFile, uint32_t
 	
 	// view new scene
 	*gSceneP = scene;
+	JournalClear();
 	
 	// reset these
 	gGui->selectedRoomIndex = 0;
@@ -1239,79 +1376,268 @@ Vec2f WindowTryCursorVsLine2D(Vec2f start2D, Vec2f end2D)
 	);
 }
 
-bool WindowDrawLine3D(Vec3f a3D, Vec3f b3D)
+// the part of a path line in front of the near plane, and on screen
+struct PathOverlaySegment
 {
-	Vec3f start3D = a3D; // start/end points in 3D space
-	Vec3f end3D = b3D;
-	Vec4f start = WindowGetLocalScreenPos4(a3D); // start/end points in 2D space
-	Vec4f end = WindowGetLocalScreenPos4(b3D);
-	bool isHovered = false;
+	Vec3f start3D;
+	Vec3f end3D;
+	Vec2f start2D;
+	Vec2f end2D;
+	int firstLine; // into PathOverlay.lines, or -1 if none of it is drawn
+};
+
+// the lines between the selected path's points, projected once and drawn
+// as-is until the camera, the window, or the points move
+static struct PathOverlay
+{
+	const struct Instance *points;
+	sb_array(Vec3f, positions); // where the points were
+	Matrix projViewMtx;
+	int winWidth;
+	int winHeight;
+	sb_array(struct PathOverlaySegment, segments);
+	sb_array(struct GuiLine, lines);
+	
+	// which segments pass near each cell of the screen, for hover tests
+	int gridCols;
+	int gridRows;
+	sb_array(int, cellStart); // per cell, into cellSegments, plus the end
+	sb_array(int, cellSegments);
+} gPathOverlay;
+
+#define PATH_OVERLAY_CELL_SIZE 64 // pixels
+#define PATH_OVERLAY_HOVER_DIST 10 // see WindowTryCursorVsLine2D()
+#define PATH_OVERLAY_LINES_EACH 6
+#define PATH_OVERLAY_OUTLINE_COLOR 0x00000080
+#define PATH_OVERLAY_INNER_COLOR 0xffffffff
+#define PATH_OVERLAY_HOVER_COLOR 0x00ff00ff
+
+// cuts the line a-b down to the part in front of the near plane, in world
+// and clip space; w changes linearly along the line, so the cut is exact;
+// returns false if none of it is in front
+static bool WindowClipLine3D(Vec3f *a3D, Vec3f *b3D, Vec4f *a, Vec4f *b)
+{
+	Matrix_MultVec3fToVec4f_Ext(a3D, a, &gState.projViewMtx);
+	Matrix_MultVec3fToVec4f_Ext(b3D, b, &gState.projViewMtx);
+	
+	if (a->w < PROJ_NEAR && b->w < PROJ_NEAR)
+		return false;
 	
-	// one or both points not in front of camera
-	if (start.w <= 0 || end.w <= 0)
+	if (a->w < PROJ_NEAR)
 	{
-		float step = 1.0 / Vec3f_DistXYZ(a3D, b3D);
-		Vec3f prev = a3D;
-		step *= 10; // 3d worldspace units (1 = precise, 10 = fast)
-		bool unknownEnd = end.w <= 0;
-		for (float amount = 0; amount <= 1; amount += step)
-		{
-			Vec3f next = Vec3f_LERP(a3D, b3D, amount);
-			Vec4f newEnd;
-			Vec4f newStart;
-			// first valid start-point
-			if (start.w <= 0 && (newStart = WindowGetLocalScreenPos4(prev)).w > 0)
-				start = newStart, start3D = prev;
-			// last valid end-point
-			if (unknownEnd && (newEnd = WindowGetLocalScreenPos4(next)).w > 0)
-				end = newEnd, end3D = next;
-			prev = next;
-		}
+		*a3D = Vec3f_LERP(*a3D, *b3D, (PROJ_NEAR - a->w) / (b->w - a->w));
+		Matrix_MultVec3fToVec4f_Ext(a3D, a, &gState.projViewMtx);
+	}
+	else if (b->w < PROJ_NEAR)
+	{
+		*b3D = Vec3f_LERP(*b3D, *a3D, (PROJ_NEAR - b->w) / (a->w - b->w));
+		Matrix_MultVec3fToVec4f_Ext(b3D, b, &gState.projViewMtx);
 	}
 	
-	// both points are in front of the camera
-	if (start.w > 0 && end.w > 0)
+	return true;
+}
+
+static Vec2f WindowClipToScreen(Vec4f clip)
+{
+	f32 w = gState.winWidth * 0.5f;
+	f32 h = gState.winHeight * 0.5f;
+	
+	return Vec2f_New(
+		w + (clip.x / clip.w) * w,
+		h - (clip.y / clip.w) * h
+	);
+}
+
+static void PathOverlayPushLine(Vec2f a, Vec2f b, uint32_t color, float thickness)
+{
+	*sb_add(gPathOverlay.lines, 1) = (struct GuiLine){ UNFOLD_VEC2(a), UNFOLD_VEC2(b), color, thickness };
+}
+
+static bool PathOverlayIsCurrent(const struct Instance *points)
+{
+	struct PathOverlay *overlay = &gPathOverlay;
+	
+	if (overlay->points != points
+		|| sb_count(overlay->positions) != sb_count(points)
+		|| overlay->winWidth != gState.winWidth
+		|| overlay->winHeight != gState.winHeight
+		|| memcmp(&overlay->projViewMtx, &gState.projViewMtx, sizeof(overlay->projViewMtx))
+	)
+		return false;
+	
+	for (int i = 0; i < sb_count(points); ++i)
+		if (memcmp(&overlay->positions[i], &points[i].pos, sizeof(points[i].pos)))
+			return false;
+	
+	return true;
+}
+
+static void PathOverlayBuildGrid(void)
+{
+	struct PathOverlay *overlay = &gPathOverlay;
+	int numCells;
+	
+	overlay->gridCols = overlay->winWidth / PATH_OVERLAY_CELL_SIZE + 1;
+	overlay->gridRows = overlay->winHeight / PATH_OVERLAY_CELL_SIZE + 1;
+	numCells = overlay->gridCols * overlay->gridRows;
+	sb_clear(overlay->cellStart);
+	sb_clear(overlay->cellSegments);
+	memset(sb_add(overlay->cellStart, numCells + 1), 0, (numCells + 1) * sizeof(int));
+	
+	// counted, then filled in, so each cell's segments are contiguous
+	for (int pass = 0; pass < 2; ++pass)
 	{
-		Vec2f start2D = { UNFOLD_VEC2(start) };
-		Vec2f end2D = { UNFOLD_VEC2(end) };
-		uint32_t innerColor = 0xffffffff;
-		Vec2f result;
-		
-		// right-click while hovering on a path to subdivide it
-		if (GizmoIsIdle(gState.gizmo) && !isnan((result = WindowTryCursorVsLine2D(start2D, end2D)).x))
+		if (pass)
 		{
-			innerColor = 0x00ff00ff;
-			worldRayData.renderGroupClicked = RENDERGROUP_PATHLINE;
-			float dist = Vec2f_DistXZ(start2D, result) / Vec2f_DistXZ(start2D, end2D);
-			dist = clamp(dist, 0.10, 0.90); // don't spawn too close to endpoints
-			worldRayData.pos = Vec3f_LERP(start3D, end3D, dist);
-			isHovered = true;
+			for (int i = 0, total = 0; i <= numCells; ++i)
+			{
+				int count = overlay->cellStart[i];
+				
+				overlay->cellStart[i] = total;
+				total += count;
+			}
+			(void)sb_add(overlay->cellSegments, overlay->cellStart[numCells]);
 		}
 		
-		// draw arrow
-		if (true)
+		sb_foreach(overlay->segments, {
+			int dist = PATH_OVERLAY_HOVER_DIST;
+			int x0 = (MIN(each->start2D.x, each->end2D.x) - dist) / PATH_OVERLAY_CELL_SIZE;
+			int y0 = (MIN(each->start2D.y, each->end2D.y) - dist) / PATH_OVERLAY_CELL_SIZE;
+			int x1 = (MAX(each->start2D.x, each->end2D.x) + dist) / PATH_OVERLAY_CELL_SIZE;
+			int y1 = (MAX(each->start2D.y, each->end2D.y) + dist) / PATH_OVERLAY_CELL_SIZE;
+			
+			if (each->firstLine < 0)
+				continue;
+			
+			for (int y = MAX(y0, 0); y <= MIN(y1, overlay->gridRows - 1); ++y)
+			{
+				for (int x = MAX(x0, 0); x <= MIN(x1, overlay->gridCols - 1); ++x)
+				{
+					int cell = y * overlay->gridCols + x;
+					
+					if (pass)
+						overlay->cellSegments[overlay->cellStart[cell]++] = eachIndex;
+					else
+						overlay->cellStart[cell] += 1;
+				}
+			}
+		});
+		
+		// the fill advanced each start to the next one's, so shift them back
+		if (pass)
 		{
-			Vec2f slope = Vec2f_Normalize(Vec2f_GetLineSlope(start2D, end2D));
-			Vec2f invert = { -slope.y, slope.x };
-			int spread = 15;
-			int length = 15;
-			float thickness = 10;
-			Vec2f base = Vec2f_Add(end2D, Vec2f_MulVal(slope, -length));
-			Vec2f wings[] = {
-				Vec2f_Add(base, Vec2f_MulVal(invert, spread)),
-				Vec2f_Add(base, Vec2f_MulVal(invert, -spread))
-			};
-			for (int i = 0; i < ARRAY_COUNT(wings); ++i)
-				GuiPushLine(UNFOLD_VEC2(wings[i]), UNFOLD_VEC2(end2D), 0x00000080, thickness + 2); // outline
-			for (int i = 0; i < ARRAY_COUNT(wings); ++i)
-				GuiPushLine(UNFOLD_VEC2(wings[i]), UNFOLD_VEC2(end2D), innerColor, thickness);
+			memmove(overlay->cellStart + 1, overlay->cellStart, numCells * sizeof(int));
+			overlay->cellStart[0] = 0;
 		}
+	}
+}
+
+static void PathOverlayBuild(const struct Instance *points)
+{
+	struct PathOverlay *overlay = &gPathOverlay;
+	
+	overlay->points = points;
+	overlay->projViewMtx = gState.projViewMtx;
+	overlay->winWidth = gState.winWidth;
+	overlay->winHeight = gState.winHeight;
+	sb_clear(overlay->positions);
+	sb_clear(overlay->segments);
+	sb_clear(overlay->lines);
+	sb_foreach_named(points, point, { sb_push(overlay->positions, point->pos); });
+	
+	for (int i = 0; i < sb_count(points) - 1; ++i)
+	{
+		struct PathOverlaySegment *segment = sb_add(overlay->segments, 1);
+		Vec4f start;
+		Vec4f end;
 		
-		GuiPushLine(UNFOLD_VEC2(start2D), UNFOLD_VEC2(end2D), 0x00000080, 7.0f); // outline
-		GuiPushLine(UNFOLD_VEC2(start2D), UNFOLD_VEC2(end2D), innerColor, 5.0f);
+		segment->start3D = points[i].pos;
+		segment->end3D = points[i + 1].pos;
+		segment->firstLine = -1;
+		
+		if (!WindowClipLine3D(&segment->start3D, &segment->end3D, &start, &end))
+			continue;
+		
+		segment->start2D = WindowClipToScreen(start);
+		segment->end2D = WindowClipToScreen(end);
+		segment->firstLine = sb_count(overlay->lines);
+		
+		// arrow, then the line itself, inner colors last in each pair
+		Vec2f slope = Vec2f_Normalize(Vec2f_GetLineSlope(segment->start2D, segment->end2D));
+		Vec2f invert = { -slope.y, slope.x };
+		int spread = 15;
+		int length = 15;
+		float thickness = 10;
+		Vec2f base = Vec2f_Add(segment->end2D, Vec2f_MulVal(slope, -length));
+		Vec2f wings[] = {
+			Vec2f_Add(base, Vec2f_MulVal(invert, spread)),
+			Vec2f_Add(base, Vec2f_MulVal(invert, -spread))
+		};
+		for (int k = 0; k < ARRAY_COUNT(wings); ++k)
+			PathOverlayPushLine(wings[k], segment->end2D, PATH_OVERLAY_OUTLINE_COLOR, thickness + 2);
+		for (int k = 0; k < ARRAY_COUNT(wings); ++k)
+			PathOverlayPushLine(wings[k], segment->end2D, PATH_OVERLAY_INNER_COLOR, thickness);
+		PathOverlayPushLine(segment->start2D, segment->end2D, PATH_OVERLAY_OUTLINE_COLOR, 7.0f);
+		PathOverlayPushLine(segment->start2D, segment->end2D, PATH_OVERLAY_INNER_COLOR, 5.0f);
 	}
 	
-	return isHovered;
+	PathOverlayBuildGrid();
+}
+
+static void PathOverlaySetInnerColor(const struct PathOverlaySegment *segment, uint32_t color)
+{
+	struct GuiLine *lines = gPathOverlay.lines + segment->firstLine;
+	
+	lines[2].color = lines[3].color = lines[5].color = color;
+}
+
+// draws arrows along a path, returns the index of the line between
+// points the cursor is over (the last one if several are), or -1
+static int WindowDrawPathLines(const struct Instance *points)
+{
+	struct PathOverlay *overlay = &gPathOverlay;
+	int hovered = -1;
+	
+	if (!PathOverlayIsCurrent(points))
+		PathOverlayBuild(points);
+	
+	// right-click while hovering on a path to subdivide it
+	int cellX = gInput.mouse.pos.x / PATH_OVERLAY_CELL_SIZE;
+	int cellY = gInput.mouse.pos.y / PATH_OVERLAY_CELL_SIZE;
+	if (GizmoIsIdle(gState.gizmo)
+		&& gInput.mouse.pos.x >= 0 && cellX < overlay->gridCols
+		&& gInput.mouse.pos.y >= 0 && cellY < overlay->gridRows
+	)
+	{
+		int cell = cellY * overlay->gridCols + cellX;
+		
+		for (int i = overlay->cellStart[cell]; i < overlay->cellStart[cell + 1]; ++i)
+		{
+			int index = overlay->cellSegments[i];
+			struct PathOverlaySegment *segment = &overlay->segments[index];
+			Vec2f result = WindowTryCursorVsLine2D(segment->start2D, segment->end2D);
+			
+			if (isnan(result.x))
+				continue;
+			
+			float dist = Vec2f_DistXZ(segment->start2D, result) / Vec2f_DistXZ(segment->start2D, segment->end2D);
+			dist = clamp(dist, 0.10, 0.90); // don't spawn too close to endpoints
+			worldRayData.renderGroupClicked = RENDERGROUP_PATHLINE;
+			worldRayData.pos = Vec3f_LERP(segment->start3D, segment->end3D, dist);
+			PathOverlaySetInnerColor(segment, PATH_OVERLAY_HOVER_COLOR);
+			hovered = MAX(hovered, index);
+		}
+	}
+	
+	GuiPushLines(overlay->lines, sb_count(overlay->lines));
+	
+	if (hovered >= 0)
+		sb_foreach(overlay->segments, {
+			if (each->firstLine >= 0)
+				PathOverlaySetInnerColor(each, PATH_OVERLAY_INNER_COLOR);
+		});
+	
+	return hovered;
 }
 
 Vec4f WindowGetLocalScreenVec(Vec3f point)
@@ -1341,6 +1667,8 @@ bool WindowTryInstanceDuplicate(void)
 		sb_push(*gGui->instanceList, newInst);
 		gGui->selectedInstance = &sb_last(*gGui->instanceList);
 		gGui->selectedInstance->prev = (typeof(gGui->selectedInstance->prev))INSTANCE_PREV_INIT;
+		GuiInstanceAdded(gGui->selectedInstance);
+		JournalClear();
 		
 		GuiPushModal("Duplicated instance.");
 		GizmoSetupMove(gState.gizmo);
@@ -1377,6 +1705,8 @@ bool WindowTryInstancePaste(bool showModal, bool deferWithRaycast)
 		sb_push(*gGui->instanceList, newInst);
 		gGui->selectedInstance = &sb_last(*gGui->instanceList);
 		gGui->selectedInstance->prev = (typeof(gGui->selectedInstance->prev))INSTANCE_PREV_INIT;
+		GuiInstanceAdded(gGui->selectedInstance);
+		JournalClear();
 		
 		GuiPushModal("Pasted instance.");
 		
@@ -1404,7 +1734,10 @@ bool WindowTryInstanceDelete(bool showModal)
 			}
 			
 			LogDebug("delete instance %d", indexOf);
+			InstanceFreeCold(gGui->selectedInstance);
+			GuiInstanceRemoved(gGui->selectedInstance);
 			sb_remove(*gGui->instanceList, indexOf);
+			JournalClear();
 			
 			GizmoSetupIdle(gState.gizmo);
 			GizmoRemoveChildren(gState.gizmo);
@@ -1443,6 +1776,46 @@ bool WindowTryInstanceCut(bool showModal)
 	return false;
 }
 
+bool WindowTryUndo(bool showModal)
+{
+	// don't pull values out from under an active drag
+	if (!GizmoIsIdle(gState.gizmo))
+		return false;
+	
+	if (!JournalUndo())
+	{
+		if (showModal)
+			GuiPushModal("Nothing to undo.");
+		
+		return false;
+	}
+	
+	// keep the gizmo on the instance it was moving
+	if (gGui->selectedInstance)
+		GizmoSetPosition(gState.gizmo, UNFOLD_VEC3(gGui->selectedInstance->pos));
+	
+	return true;
+}
+
+bool WindowTryRedo(bool showModal)
+{
+	if (!GizmoIsIdle(gState.gizmo))
+		return false;
+	
+	if (!JournalRedo())
+	{
+		if (showModal)
+			GuiPushModal("Nothing to redo.");
+		
+		return false;
+	}
+	
+	if (gGui->selectedInstance)
+		GizmoSetPosition(gState.gizmo, UNFOLD_VEC3(gGui->selectedInstance->pos));
+	
+	return true;
+}
+
 bool WindowTryInstanceCopy(bool showModal)
 {
 	if (WindowTryInstance(true))
@@ -1544,9 +1917,30 @@ static void SkinMatrix_Vec3fMtxFMultXYZ(Matrix* mf, Vec3f* src, Vec3f* dest)
 	dest->z = mw + ((src->x * mx) + (src->y * my) + (src->z * mz));
 }
 
+// draws a room's display list using its flattened copy, when it has one
+static void DrawRoomDisplayList(struct Room *room, const struct File *sceneFile, uint32_t segAddr, bool isXlu)
+{
+	const void *flattened = MeshCacheGet(room, sceneFile, segAddr);
+	
+	if (isXlu)
+	{
+		if (flattened)
+			gSPDisplayList(POLY_XLU_DISP++, flattened);
+		else
+			gSPDisplayList(POLY_XLU_DISP++, segAddr);
+	}
+	else
+	{
+		if (flattened)
+			gSPDisplayList(POLY_OPA_DISP++, flattened);
+		else
+			gSPDisplayList(POLY_OPA_DISP++, segAddr);
+	}
+}
+
 // FIXME using distance-to-camera as an approximation for now, but is imperfect
 //       (see the code that has been commented out for how it is intended to work)
-static void DrawRoomCullable(struct RoomHeader *header, int16_t zFar, uint32_t flags)
+static void DrawRoomCullable(struct Room *room, const struct File *sceneFile, struct RoomHeader *header, int16_t zFar, uint32_t flags)
 {
 	typedef struct RoomShapeCullableEntryLinked
 	{
@@ -1710,7 +2104,7 @@ static void DrawRoomCullable(struct RoomHeader *header, int16_t zFar, uint32_t f
 			{
 				if (displayList)
 				{
-					gSPDisplayList(POLY_OPA_DISP++, displayList);
+					DrawRoomDisplayList(room, sceneFile, displayList, false);
 				}
 			}
 		}
@@ -1750,7 +2144,7 @@ static void DrawRoomCullable(struct RoomHeader *header, int16_t zFar, uint32_t f
 				else
 				*/
 				{
-					gSPDisplayList(POLY_XLU_DISP++, displayList);
+					DrawRoomDisplayList(room, sceneFile, displayList, true);
 				}
 			}
 		}
@@ -1991,6 +2385,7 @@ static WrenForeignMethodFn RenderCodeBindForeignMethod(
 			.xrot = xrot,
 			.yrot = yrot,
 			.zrot = zrot,
+			.rendercodeChildIndex = sb_count(inst->rendercodeChildren) + 1,
 			.prev = INSTANCE_PREV_INIT_UUID(inst->prev.uuid)
 		};
 		sb_push(inst->rendercodeChildren, child);
@@ -2242,6 +2637,7 @@ static WrenForeignMethodFn RenderCodeBindForeignMethod(
 	
 	void DrawSkeleton(WrenVM* vm, int argc) {
 		struct Instance *inst = WREN_UDATA;
+		SkelAnime *skelanime = InstanceGetSkelAnime(inst);
 		ReadyMatrix(inst, false, true);
 		if (sObject) {
 			const struct ObjectAnimation *animations = sObject->animations;
@@ -2257,20 +2653,20 @@ static WrenForeignMethodFn RenderCodeBindForeignMethod(
 				// is index, rather than segment address
 				if (address < 0x01000000) {
 					SkelAnime_Init(
-						&inst->skelanime
+						skelanime
 						, sObject
 						, &sObject->skeletons[address]
 						, &animations[anim]
 					);
-					SkelAnime_Update(&inst->skelanime, 0);
+					SkelAnime_Update(skelanime, 0);
 				}
 				// TODO address based skelanime
 			}
 			if (argc > 2)
-				inst->skelanime.playSpeed = wrenGetSlotDouble(vm, 3);
-			if (inst->skelanime.limbCount) {
-				SkelAnime_Update(&inst->skelanime, gInput.delta_time_sec * (20.0));
-				SkelAnime_Draw(&inst->skelanime, SKELANIME_TYPE_FLEX, inst->limbOverrides);
+				skelanime->playSpeed = wrenGetSlotDouble(vm, 3);
+			if (skelanime->limbCount) {
+				SkelAnime_Update(skelanime, gInput.delta_time_sec * (20.0));
+				SkelAnime_Draw(skelanime, SKELANIME_TYPE_FLEX, inst->limbOverrides);
 				gRenderCodeDrewSomething = true;
 			}
 		}
@@ -2546,7 +2942,9 @@ void WindowMainLoop(const char *sceneFn)
 			.isFogEnabled = true,
 			.isLightingEnabled = true,
 			.envPreviewMode = GUI_ENV_PREVIEW_EACH
-		}
+		},
+		.zobjAnimSheetSpacing = 400,
+		.showAllRooms = true, // doorway culling is opt-in
 	};
 	gGui = &gui;
 	GuiSetInterop(gGui);
@@ -2730,6 +3128,7 @@ void WindowMainLoop(const char *sceneFn)
 		
 		n64_update_tick();
 		n64_buffer_init();
+		SkelAnime_NewFrame(); // shared poses point into graph memory
 		
 		n64_culling(false);
 		n64_mtx_model(model);
@@ -2804,10 +3203,30 @@ void WindowMainLoop(const char *sceneFn)
 		
 		n64_segment_set(0x02, scene->file->data);
 		
+		// rooms that can't be seen from here aren't drawn at all,
+		// if the user opted into that
+		const bool *isRoomVisible = gui.showAllRooms ? 0 : RoomVisCompute(
+			scene
+			, gui.sceneHeader ? gui.sceneHeader : &scene->headers[0]
+			, gState.cameraFly.eye
+			, &gState.projViewMtx
+		);
+		gui.numRoomsDrawn = 0;
+		
+		// scene texture animations are the same for every room,
+		// so they're evaluated once and each room calls the result
+		GbiGfx *texanimOpa = 0;
+		GbiGfx *texanimXlu = 0;
+		if (scene->file->size != 0x11240 && scene->headers[0].mm.sceneSetupType != -1)
+			TexAnimRecordSceneMM(scene->headers[0].mm.sceneSetupType, scene->headers[0].mm.sceneSetupData, &texanimOpa, &texanimXlu);
+		
 		sb_foreach(scene->rooms, {
 			void *sceneSegment = scene->file->data;
 			void *roomSegment = each->file->data;
-			struct SceneHeader *sceneHeader = &scene->headers[0];
+			
+			if (isRoomVisible && !isRoomVisible[eachIndex])
+				continue;
+			gui.numRoomsDrawn += 1;
 			
 			n64_segment_set(0x03, roomSegment);
 			
@@ -2829,22 +3248,26 @@ void WindowMainLoop(const char *sceneFn)
 			// animate water in forest test scene
 			if (scene->file->size == 0x11240)
 				AnimateTheWater();
-			else if (sceneHeader->mm.sceneSetupType != -1)
-				TexAnimSetupSceneMM(sceneHeader->mm.sceneSetupType, sceneHeader->mm.sceneSetupData);
+			else if (texanimOpa)
+			{
+				gSPDisplayList(POLY_OPA_DISP++, texanimOpa);
+				gSPDisplayList(POLY_XLU_DISP++, texanimXlu);
+			}
 			
 			if (each->headers[0].meshFormat == 2)
 			{
-				DrawRoomCullable(&each->headers[0], result->fog_far, ROOM_DRAW_OPA | ROOM_DRAW_XLU);
+				DrawRoomCullable(each, scene->file, &each->headers[0], result->fog_far, ROOM_DRAW_OPA | ROOM_DRAW_XLU);
 				//break; // process only room[0] for now
 				continue;
 			}
 			
+			struct Room *room = each;
 			typeof(each->headers[0].displayLists) dls = each->headers[0].displayLists;
 			sb_foreach(dls, {
 				if (each->opa)
-					gSPDisplayList(POLY_OPA_DISP++, each->opa);
+					DrawRoomDisplayList(room, scene->file, each->opa, false);
 				if (each->xlu)
-					gSPDisplayList(POLY_XLU_DISP++, each->xlu);
+					DrawRoomDisplayList(room, scene->file, each->xlu, true);
 			});
 			
 			//if (each == &scene->rooms[0])
@@ -2899,11 +3322,17 @@ void WindowMainLoop(const char *sceneFn)
 			gSPMatrix(POLY_OPA_DISP++, Matrix_NewMtxN64(), G_MTX_MODELVIEW | G_MTX_LOAD);
 			
 			struct Object *obj = gGui->zobj;
+			struct ObjectSkeleton *skel = &obj->skeletons[gGui->zobjCurrentSkel];
 			struct ObjectAnimation *anim = 0;
 			if (sb_count(obj->animations)) anim = &obj->animations[gGui->zobjCurrentAnim];
-			SkelAnime_Init(&gSkelAnimeTest, obj, &obj->skeletons[gGui->zobjCurrentSkel], anim);
-			if (anim) SkelAnime_Update(&gSkelAnimeTest, gInput.delta_time_sec * (20.0)); // anims made for 20fps
-			SkelAnime_Draw(&gSkelAnimeTest, SKELANIME_TYPE_FLEX, 0);
+			if (gGui->zobjShowAnimSheet && anim)
+				DrawZobjAnimSheet(obj, skel, scale);
+			else
+			{
+				SkelAnime_Init(&gSkelAnimeTest, obj, skel, anim);
+				if (anim) SkelAnime_Update(&gSkelAnimeTest, gInput.delta_time_sec * (20.0)); // anims made for 20fps
+				SkelAnime_Draw(&gSkelAnimeTest, SKELANIME_TYPE_FLEX, 0);
+			}
 		}
 		
 		// old viewer
@@ -3113,15 +3542,12 @@ void WindowMainLoop(const char *sceneFn)
 				DrawInstanceList(&each->points);
 				// render lines only for selected path
 				if (&each->points == gGui->instanceList) {
-					for (int i = 0; i < sb_count(each->points) - 1; ++i) {
-						Vec3f point = each->points[i].pos;
-						Vec3f next = each->points[i + 1].pos;
-						if (WindowDrawLine3D(point, next)) {
-							gGui->rightClickedLineIndex = i;
-							gGui->rightClickedLinePathIndex = eachIndex;
-							if (gInput.mouse.clicked.right) // hack to keep selection active
-								gGui->selectedInstance = &each->points[i];
-						}
+					int i = WindowDrawPathLines(each->points);
+					if (i >= 0) {
+						gGui->rightClickedLineIndex = i;
+						gGui->rightClickedLinePathIndex = eachIndex;
+						if (gInput.mouse.clicked.right) // hack to keep selection active
+							gGui->selectedInstance = &each->points[i];
 					}
 					// draw clickable marker at each point
 					if (GizmoIsIdle(gState.gizmo))
@@ -3218,6 +3644,27 @@ void WindowMainLoop(const char *sceneFn)
 			}
 		}
 		
+		// record edits made this frame for undo/redo, including whatever
+		// the gizmo moves; a held mouse button or active gizmo means the
+		// edit is still in progress
+		if (gGui->selectedInstance)
+			JournalWatch(gGui->selectedInstance, offsetof(struct Instance, limbOverrides));
+		for (int i = 0; i < GizmoGetNumChildren(gizmo); ++i)
+			JournalWatch(GizmoGetChild(gizmo, i), sizeof(Vec3f));
+		if (gGui->sceneHeader)
+		{
+			struct SceneHeader *header = gGui->sceneHeader;
+			
+			CutsceneOotWatch(header->cutsceneOot, JournalWatch);
+			CutsceneListMmWatch(header->cutsceneListMm, JournalWatch);
+			JournalWatch(header->actorCutscenes, sb_count(header->actorCutscenes) * sizeof(*header->actorCutscenes));
+			JournalWatch(header->actorCsCamInfo, sb_count(header->actorCsCamInfo) * sizeof(*header->actorCsCamInfo));
+			sb_foreach(header->actorCsCamInfo, {
+				JournalWatch(each->actorCsCamFuncData, sb_count(each->actorCsCamFuncData) * sizeof(*each->actorCsCamFuncData));
+			})
+		}
+		JournalEndFrame(GizmoHasFocus(gizmo) || gInput.mouse.button.left || GuiHasFocusKeyboard());
+		
 		// consume left-click if nothing already has
 		gInput.mouse.clicked.left = false;
 		gInput.mouse.clicked.right = false;
@@ -3247,6 +3694,7 @@ void WindowMainLoop(const char *sceneFn)
 	glfwTerminate();
 	
 	// cleanup
+	ObjectIndexClose();
 	if (scene)
 		SceneFree(scene);
 	if (gizmo)
@@ -83,6 +83,8 @@ bool WindowTryInstanceDelete(bool showModal);
 bool WindowTryInstanceCut(bool showModal);
 bool WindowTryInstancePaste(bool showModal, bool deferWithRaycast);
 bool WindowTryInstanceCopy(bool showModal);
+bool WindowTryUndo(bool showModal);
+bool WindowTryRedo(bool showModal);
 const char *WindowNewSceneFromObjex(const char *fn, struct Scene **dst, bool showError);
 const char *WindowNewSceneFromFast64(const char *fn, struct Scene **dst, bool showError);
 
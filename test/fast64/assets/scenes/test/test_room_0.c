@@ -0,0 +1,89 @@
+#include "ultra64.h"
+#include "macros.h"
+#include "z64.h"
+#include "test_scene.h"
+
+
+/**
+ * Header Child Day (Default)
+*/
+#define LENGTH_TEST_ROOM_0_HEADER00_OBJECTLIST 2
+#define LENGTH_TEST_ROOM_0_HEADER00_ACTORLIST 2
+SceneCmd test_room_0_header00[] = {
+    SCENE_CMD_ECHO_SETTINGS(0x00),
+    SCENE_CMD_ROOM_BEHAVIOR(0x00, 0x00, false, false),
+    SCENE_CMD_SKYBOX_DISABLES(false, false),
+    SCENE_CMD_TIME_SETTINGS(0xFF, 0xFF, 10),
+    SCENE_CMD_ROOM_SHAPE(&test_room_0_shapeHeader),
+    SCENE_CMD_OBJECT_LIST(LENGTH_TEST_ROOM_0_HEADER00_OBJECTLIST, test_room_0_header00_objectList),
+    SCENE_CMD_ACTOR_LIST(LENGTH_TEST_ROOM_0_HEADER00_ACTORLIST, test_room_0_header00_actorList),
+    SCENE_CMD_END(),
+};
+
+s16 test_room_0_header00_objectList[LENGTH_TEST_ROOM_0_HEADER00_OBJECTLIST] = {
+    OBJECT_BOX,
+    OBJECT_DODONGO,
+};
+
+ActorEntry test_room_0_header00_actorList[LENGTH_TEST_ROOM_0_HEADER00_ACTORLIST] = {
+    // Treasure Chest
+    {
+        /* Actor ID   */ ACTOR_EN_BOX,
+        /* Position   */ { 0, 0, -40 },
+        /* Rotation   */ { DEG_TO_BINANG(0.000), DEG_TO_BINANG(180.000), DEG_TO_BINANG(0.000) },
+        /* Parameters */ 0x5AA0
+    },
+
+    // Test Actor
+    {
+        /* Actor ID   */ ACTOR_EN_TEST,
+        /* Position   */ { 48, 0, 16 },
+        /* Rotation   */ { 0x0000, DEG_TO_BINANG(-45.000), 0x0000 },
+        /* Parameters */ 0xFFFF
+    },
+};
+
+RoomShapeNormal test_room_0_shapeHeader = {
+    ROOM_SHAPE_TYPE_NORMAL,
+    ARRAY_COUNT(test_room_0_shapeDListsEntry),
+    test_room_0_shapeDListsEntry,
+    test_room_0_shapeDListsEntry + ARRAY_COUNT(test_room_0_shapeDListsEntry)
+};
+
+RoomShapeDListsEntry test_room_0_shapeDListsEntry[1] = {
+    { test_room_0_entry_0_opaque, NULL },
+};
+
+Gfx test_room_0_entry_0_opaque[] = {
+    gsSPDisplayList(test_room_0_dl_mesh_layer_Opaque),
+    gsSPEndDisplayList(),
+};
+
+u64 test_room_0_dl_tex_rgba16[] = {
+#include "test_room_0_dl_tex.rgba16.inc.c"
+};
+
+Vtx test_room_0_dl_mesh_layer_Opaque_vtx_0[4] = {
+    {{ {-100, 0, 100}, 0, {-16, 1008}, {0x00, 0x7F, 0x00, 0xFF} }},
+    {{ {100, 0, 100}, 0, {1008, 1008}, {0x00, 0x7F, 0x00, 0xFF} }},
+    {{ {100, 0, -100}, 0, {1008, -16}, {0x00, 0x7F, 0x00, 0xFF} }},
+    {{ {-100, 0, -100}, 0, {-16, -16}, {0x00, 0x7F, 0x00, 0xFF} }},
+};
+
+Gfx test_room_0_dl_mesh_layer_Opaque_tri_0[] = {
+    gsSPVertex(test_room_0_dl_mesh_layer_Opaque_vtx_0 + 0, 4, 0),
+    gsSP2Triangles(0, 1, 2, 0, 0, 2, 3, 0),
+    gsSPEndDisplayList(),
+};
+
+Gfx mat_test_room_0_dl_f3d_material_layerOpaque[] = {
+    gsDPPipeSync(),
+    gsDPSetTextureImage(G_IM_FMT_RGBA, G_IM_SIZ_16b_LOAD_BLOCK, 1, test_room_0_dl_tex_rgba16),
+    gsSPEndDisplayList(),
+};
+
+Gfx test_room_0_dl_mesh_layer_Opaque[] = {
+    gsSPDisplayList(mat_test_room_0_dl_f3d_material_layerOpaque),
+    gsSPDisplayList(test_room_0_dl_mesh_layer_Opaque_tri_0),
+    gsSPEndDisplayList(),
+};
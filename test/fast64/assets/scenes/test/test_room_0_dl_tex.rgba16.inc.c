@@ -0,0 +1 @@
+0xF801F801F801F801, 0x07C107C107C107C1, 0x003F003F003F003F, 0xFFFFFFFFFFFFFFFF, 
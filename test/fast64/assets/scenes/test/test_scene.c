@@ -0,0 +1,107 @@
+#include "ultra64.h"
+#include "macros.h"
+#include "z64.h"
+#include "test_scene.h"
+
+
+/**
+ * Header Child Day (Default)
+*/
+#define LENGTH_TEST_SCENE_HEADER00_PLAYERENTRYLIST 2
+#define LENGTH_TEST_SCENE_HEADER00_ENTRANCELIST 2
+#define LENGTH_TEST_SCENE_HEADER00_EXITLIST 2
+#define LENGTH_TEST_SCENE_HEADER00_LIGHTSETTINGS 1
+SceneCmd test_scene_header00[] = {
+    SCENE_CMD_SOUND_SETTINGS(0x00, 0x13, 0x02),
+    SCENE_CMD_ROOM_LIST(1, test_scene_roomList),
+    SCENE_CMD_MISC_SETTINGS(SCENE_CAM_TYPE_DEFAULT, 0x00),
+    SCENE_CMD_COL_HEADER(&test_scene_collisionHeader),
+    SCENE_CMD_ENTRANCE_LIST(test_scene_header00_entranceList),
+    SCENE_CMD_SPECIAL_FILES(0x00, OBJECT_GAMEPLAY_DANGEON_KEEP),
+    SCENE_CMD_SPAWN_LIST(LENGTH_TEST_SCENE_HEADER00_PLAYERENTRYLIST, test_scene_header00_playerEntryList),
+    SCENE_CMD_SKYBOX_SETTINGS(0x01, 0x00, LIGHT_MODE_TIME),
+    SCENE_CMD_EXIT_LIST(test_scene_header00_exitList),
+    SCENE_CMD_ENV_LIGHT_SETTINGS(LENGTH_TEST_SCENE_HEADER00_LIGHTSETTINGS, test_scene_header00_lightSettings),
+    SCENE_CMD_END(),
+};
+
+RomFile test_scene_roomList[] = {
+    { (uintptr_t)_test_room_0SegmentRomStart, (uintptr_t)_test_room_0SegmentRomEnd },
+};
+
+ActorEntry test_scene_header00_playerEntryList[LENGTH_TEST_SCENE_HEADER00_PLAYERENTRYLIST] = {
+    {
+        /* Actor ID   */ ACTOR_PLAYER,
+        /* Position   */ { -32, 0, 64 },
+        /* Rotation   */ { DEG_TO_BINANG(0.000), DEG_TO_BINANG(90.000), DEG_TO_BINANG(0.000) },
+        /* Parameters */ 0x0FFF
+    },
+    {
+        /* Actor ID   */ ACTOR_PLAYER,
+        /* Position   */ { 80, 0, -64 },
+        /* Rotation   */ { DEG_TO_BINANG(0.000), DEG_TO_BINANG(-90.000), DEG_TO_BINANG(0.000) },
+        /* Parameters */ 0x0D04
+    },
+};
+
+Spawn test_scene_header00_entranceList[LENGTH_TEST_SCENE_HEADER00_ENTRANCELIST] = {
+    // { Spawn Actor List Index, Room Index }
+    { 0, 0 },
+    { 1, 0 },
+};
+
+u16 test_scene_header00_exitList[LENGTH_TEST_SCENE_HEADER00_EXITLIST] = {
+    ENTR_DEKU_TREE_0,
+    ENTR_DODONGOS_CAVERN_0,
+};
+
+EnvLightSettings test_scene_header00_lightSettings[LENGTH_TEST_SCENE_HEADER00_LIGHTSETTINGS] = {
+    // Dawn
+    {
+        {    70,    45,    57 },   // Ambient Color
+        {    73,    73,    73 },   // Diffuse0 Direction
+        {   180,   154,   138 },   // Diffuse0 Color
+        {   -73,   -73,   -73 },   // Diffuse1 Direction
+        {    20,    20,    60 },   // Diffuse1 Color
+        {   140,   120,   100 },   // Fog Color
+        ((1 << 10) | 993),          // Blend Rate & Fog Near
+        12800,                      // Fog Far
+    },
+};
+
+SurfaceType test_scene_polygonTypes[] = {
+    { 0x00000000, 0x000007C0 },
+};
+
+CollisionPoly test_scene_polygons[] = {
+    { 0x0000, 0x0000, 0x0001, 0x0002, COLPOLY_SNORMAL(0.0), COLPOLY_SNORMAL(1.0), COLPOLY_SNORMAL(0.0), 0x0000 },
+    { 0x0000, 0x0000, 0x0002, 0x0003, COLPOLY_SNORMAL(0.0), COLPOLY_SNORMAL(1.0), COLPOLY_SNORMAL(0.0), 0x0000 },
+};
+
+Vec3s test_scene_vertices[4] = {
+    { -100, 0, -100 },
+    { -100, 0, 100 },
+    { 100, 0, 100 },
+    { 100, 0, -100 },
+};
+
+WaterBox test_scene_waterBoxes[] = {
+    { -50, -20, -50, 100, 100, 0x00000000 },
+};
+
+CollisionHeader test_scene_collisionHeader = {
+    -100,
+    0,
+    -100,
+    100,
+    0,
+    100,
+    4,
+    test_scene_vertices,
+    2,
+    test_scene_polygons,
+    test_scene_polygonTypes,
+    0,
+    1,
+    test_scene_waterBoxes
+};
@@ -0,0 +1,34 @@
+#ifndef TEST_SCENE_H
+#define TEST_SCENE_H
+
+#include "ultra64.h"
+#include "macros.h"
+#include "z64.h"
+
+
+extern SceneCmd test_scene_header00[];
+extern RomFile test_scene_roomList[];
+extern u8 _test_room_0SegmentRomStart[];
+extern u8 _test_room_0SegmentRomEnd[];
+extern ActorEntry test_scene_header00_playerEntryList[];
+extern Spawn test_scene_header00_entranceList[];
+extern u16 test_scene_header00_exitList[];
+extern EnvLightSettings test_scene_header00_lightSettings[];
+extern SurfaceType test_scene_polygonTypes[];
+extern CollisionPoly test_scene_polygons[];
+extern Vec3s test_scene_vertices[];
+extern WaterBox test_scene_waterBoxes[];
+extern CollisionHeader test_scene_collisionHeader;
+extern SceneCmd test_room_0_header00[];
+extern s16 test_room_0_header00_objectList[];
+extern ActorEntry test_room_0_header00_actorList[];
+extern RoomShapeNormal test_room_0_shapeHeader;
+extern RoomShapeDListsEntry test_room_0_shapeDListsEntry[1];
+extern Gfx test_room_0_entry_0_opaque[];
+extern u64 test_room_0_dl_tex_rgba16[];
+extern Vtx test_room_0_dl_mesh_layer_Opaque_vtx_0[4];
+extern Gfx test_room_0_dl_mesh_layer_Opaque_tri_0[];
+extern Gfx mat_test_room_0_dl_f3d_material_layerOpaque[];
+extern Gfx test_room_0_dl_mesh_layer_Opaque[];
+
+#endif
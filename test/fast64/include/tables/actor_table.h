@@ -0,0 +1,14 @@
+/**
+ * Actor Table (the first few entries)
+ */
+/* 0x0000 */ DEFINE_ACTOR_INTERNAL(Player, ACTOR_PLAYER, ALLOCTYPE_NORMAL, "Player")
+/* 0x0001 */ DEFINE_ACTOR_UNSET(ACTOR_UNSET_1)
+/* 0x0002 */ DEFINE_ACTOR(En_Test, ACTOR_EN_TEST, ALLOCTYPE_NORMAL, "En_Test")
+/* 0x0003 */ DEFINE_ACTOR_UNSET(ACTOR_UNSET_3)
+/* 0x0004 */ DEFINE_ACTOR(En_GirlA, ACTOR_EN_GIRLA, ALLOCTYPE_NORMAL, "En_GirlA")
+/* 0x0005 */ DEFINE_ACTOR_UNSET(ACTOR_UNSET_5)
+/* 0x0006 */ DEFINE_ACTOR_UNSET(ACTOR_UNSET_6)
+/* 0x0007 */ DEFINE_ACTOR(En_Part, ACTOR_EN_PART, ALLOCTYPE_NORMAL, "En_Part")
+/* 0x0008 */ DEFINE_ACTOR(En_Light, ACTOR_EN_LIGHT, ALLOCTYPE_NORMAL, "En_Light")
+/* 0x0009 */ DEFINE_ACTOR(En_Door, ACTOR_EN_DOOR, ALLOCTYPE_NORMAL, "En_Door")
+/* 0x000A */ DEFINE_ACTOR(En_Box, ACTOR_EN_BOX, ALLOCTYPE_NORMAL, "En_Box")
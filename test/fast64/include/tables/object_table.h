@@ -0,0 +1,18 @@
+/**
+ * Object Table (the first few entries)
+ */
+/* 0x0000 */ DEFINE_OBJECT_UNSET(OBJECT_UNSET_0)
+/* 0x0001 */ DEFINE_OBJECT(gameplay_keep, OBJECT_GAMEPLAY_KEEP)
+/* 0x0002 */ DEFINE_OBJECT(gameplay_field_keep, OBJECT_GAMEPLAY_FIELD_KEEP)
+/* 0x0003 */ DEFINE_OBJECT(gameplay_dangeon_keep, OBJECT_GAMEPLAY_DANGEON_KEEP)
+/* 0x0004 */ DEFINE_OBJECT_UNSET(OBJECT_UNSET_4)
+/* 0x0005 */ DEFINE_OBJECT_UNSET(OBJECT_UNSET_5)
+/* 0x0006 */ DEFINE_OBJECT(object_human, OBJECT_HUMAN)
+/* 0x0007 */ DEFINE_OBJECT(object_okuta, OBJECT_OKUTA)
+/* 0x0008 */ DEFINE_OBJECT(object_crow, OBJECT_CROW)
+/* 0x0009 */ DEFINE_OBJECT(object_poh, OBJECT_POH)
+/* 0x000A */ DEFINE_OBJECT(object_dy_obj, OBJECT_DY_OBJ)
+/* 0x000B */ DEFINE_OBJECT(object_wallmaster, OBJECT_WALLMASTER)
+/* 0x000C */ DEFINE_OBJECT(object_dodongo, OBJECT_DODONGO)
+/* 0x000D */ DEFINE_OBJECT(object_firefly, OBJECT_FIREFLY)
+/* 0x000E */ DEFINE_OBJECT(object_box, OBJECT_BOX)
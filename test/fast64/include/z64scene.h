@@ -0,0 +1,28 @@
+#ifndef Z64SCENE_H
+#define Z64SCENE_H
+
+typedef enum RoomShapeType {
+    /* 0 */ ROOM_SHAPE_TYPE_NORMAL,
+    /* 1 */ ROOM_SHAPE_TYPE_IMAGE,
+    /* 2 */ ROOM_SHAPE_TYPE_CULLABLE,
+    /* 3 */ ROOM_SHAPE_TYPE_MAX
+} RoomShapeType;
+
+typedef enum LightMode {
+    /* 0 */ LIGHT_MODE_TIME, // environment depends on the time of day
+    /* 1 */ LIGHT_MODE_SETTINGS // environment depends on light settings
+} LightMode;
+
+typedef enum SceneCamType {
+    /* 0 */ SCENE_CAM_TYPE_DEFAULT,
+    /* 16 */ SCENE_CAM_TYPE_FIXED_SHOP_VIEWPOINT = 0x10,
+    /* 32 */ SCENE_CAM_TYPE_FIXED_TOGGLE_VIEWPOINT = 0x20,
+    /* 48 */ SCENE_CAM_TYPE_FIXED = 0x30,
+    /* 64 */ SCENE_CAM_TYPE_FIXED_MARKET = 0x40,
+    /* 80 */ SCENE_CAM_TYPE_SHOOTING_GALLERY = 0x50
+} SceneCamType;
+
+#define ROOM_DRAW_OPA (1 << 0)
+#define ROOM_DRAW_XLU (1 << 1)
+
+#endif